@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <chrono>
 #include <cstddef>
 #include "audio_core/dsp_interface.h"
 #include "audio_core/sink.h"
@@ -12,6 +13,11 @@
 
 namespace AudioCore {
 
+/// Samples queued for the sink in turbo mode before new frames are dropped (about 60 ms)
+constexpr std::size_t TurboModeMaxQueuedSamples = 0x800;
+
+AudioOutputStats g_audio_output_stats;
+
 DspInterface::DspInterface() = default;
 DspInterface::~DspInterface() = default;
 
@@ -38,28 +44,57 @@ void DspInterface::EnableStretching(bool enable) {
     perform_time_stretching = enable;
 }
 
+void DspInterface::SetDumpCallback(std::function<void(const s16*, std::size_t)> cb) {
+    dump_callback = std::move(cb);
+}
+
 void DspInterface::OutputFrame(StereoFrame16& frame) {
+    if (dump_callback) {
+        dump_callback(frame[0].data(), frame.size());
+    }
+
     if (sink == nullptr) {
         return;
     }
 
-    fifo.Push(frame.data(), frame.size());
+    // In turbo mode the DSP outputs audio faster than real time, so whole frames are dropped
+    // instead of stretching them
+    if (Settings::values.turbo_mode && fifo.Size() >= TurboModeMaxQueuedSamples) {
+        return;
+    }
+
+    const std::size_t pushed = fifo.Push(frame.data(), frame.size());
+    if (pushed < frame.size()) {
+        g_audio_output_stats.overruns += frame.size() - pushed;
+    }
 }
 
 void DspInterface::OutputSample(std::array<s16, 2> sample) {
+    if (dump_callback) {
+        dump_callback(sample.data(), 1);
+    }
+
     if (sink == nullptr) {
         return;
     }
 
-    fifo.Push(&sample, 1);
+    if (Settings::values.turbo_mode && fifo.Size() >= TurboModeMaxQueuedSamples) {
+        return;
+    }
+
+    if (fifo.Push(&sample, 1) == 0) {
+        ++g_audio_output_stats.overruns;
+    }
 }
 
 void DspInterface::OutputCallback(s16* buffer, std::size_t num_frames) {
+    // This runs on the audio device thread, nothing here may allocate or lock
+    const auto start = std::chrono::steady_clock::now();
+
     std::size_t frames_written;
-    if (perform_time_stretching) {
-        const std::vector<s16> in = fifo.Pop();
-        const std::size_t num_in = in.size() / 2;
-        frames_written = time_stretcher.Process(in.data(), num_in, buffer, num_frames);
+    if (perform_time_stretching && !Settings::values.turbo_mode) {
+        const std::size_t num_in = fifo.Pop(stretch_buffer.data(), fifo.Capacity());
+        frames_written = time_stretcher.Process(stretch_buffer.data(), num_in, buffer, num_frames);
     } else if (flushing_time_stretcher) {
         time_stretcher.Flush();
         frames_written = time_stretcher.Process(nullptr, 0, buffer, num_frames);
@@ -72,6 +107,9 @@ void DspInterface::OutputCallback(s16* buffer, std::size_t num_frames) {
     if (frames_written > 0) {
         std::memcpy(&last_frame[0], buffer + 2 * (frames_written - 1), 2 * sizeof(s16));
     }
+    if (frames_written < num_frames) {
+        ++g_audio_output_stats.underruns;
+    }
 
     // Hold last emitted frame; this prevents popping.
     for (std::size_t i = frames_written; i < num_frames; i++) {
@@ -88,6 +126,16 @@ void DspInterface::OutputCallback(s16* buffer, std::size_t num_frames) {
             buffer[i * 2 + 1] = static_cast<s16>(buffer[i * 2 + 1] * volume_scale_factor);
         }
     }
+
+    const u64 duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    std::size_t bucket = 0;
+    while (bucket + 1 < g_audio_output_stats.callback_duration_histogram.size() &&
+           duration_us >= (u64{1} << bucket)) {
+        ++bucket;
+    }
+    ++g_audio_output_stats.callback_duration_histogram[bucket];
 }
 
 } // namespace AudioCore
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 #include "audio_core/audio_types.h"
@@ -20,6 +23,19 @@ namespace AudioCore {
 
 class Sink;
 
+/// Counters of the audio output path, readable from any thread
+struct AudioOutputStats {
+    /// Sink callbacks that got fewer frames than they asked for
+    std::atomic<u64> underruns{0};
+    /// Frames output by the DSP that didn't fit in the FIFO
+    std::atomic<u64> overruns{0};
+    /// Sink callbacks by duration. Bucket i counts callbacks that took less than 2^i microseconds,
+    /// the last bucket counts the rest.
+    std::array<std::atomic<u64>, 16> callback_duration_histogram;
+};
+
+extern AudioOutputStats g_audio_output_stats;
+
 class DspInterface {
 public:
     DspInterface();
@@ -101,6 +117,14 @@ public:
     /// Enable/disable audio stretching.
     void EnableStretching(bool enable);
 
+    /**
+     * Set a callback that receives every sample output by the DSP, before stretching and
+     * independently of the sink. Used to dump audio.
+     * @param samples Samples in interleaved stereo PCM16 format.
+     * @param sample_count Number of samples.
+     */
+    void SetDumpCallback(std::function<void(const s16*, std::size_t)> cb);
+
 protected:
     void OutputFrame(StereoFrame16& frame);
     void OutputSample(std::array<s16, 2> sample);
@@ -109,9 +133,13 @@ private:
     void OutputCallback(s16* buffer, std::size_t num_frames);
 
     std::unique_ptr<Sink> sink;
+    std::function<void(const s16*, std::size_t)> dump_callback;
     std::atomic<bool> perform_time_stretching = false;
     std::atomic<bool> flushing_time_stretcher = false;
     Common::RingBuffer<s16, 0x2000, 2> fifo;
+    /// Frames popped from the FIFO for the time stretcher. Allocated up front, since the sink
+    /// callback runs on a realtime thread.
+    std::array<s16, 0x2000 * 2> stretch_buffer;
     std::array<s16, 2> last_frame{};
     TimeStretcher time_stretcher;
 };
@@ -0,0 +1,64 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <utility>
+#include "bench/bench.h"
+
+namespace Bench {
+
+void Report(std::string_view name, double nanoseconds, std::size_t operations, u64 checksum) {
+    fmt::print("  {:<40} {:>10.3f} ms {:>10.2f} ns/op (checksum {:016x})\n", name,
+               nanoseconds / 1000000.0, nanoseconds / static_cast<double>(operations), checksum);
+}
+
+void Fail(std::string_view message) {
+    fmt::print(stderr, "error: {}\n", message);
+    std::exit(1);
+}
+
+} // namespace Bench
+
+int main(int argc, char** argv) {
+    constexpr std::array<std::pair<std::string_view, void (*)()>, 3> benchmarks{{
+        {"surface_index", Bench::RunSurfaceIndex},
+        {"morton", Bench::RunMorton},
+        {"core_timing", Bench::RunCoreTiming},
+    }};
+
+    // Runs every benchmark, or only the ones named on the command line
+    bool found_all = true;
+    for (int i = 1; i < argc; ++i) {
+        const auto it = std::find_if(benchmarks.begin(), benchmarks.end(),
+                                     [&](const auto& benchmark) {
+                                         return benchmark.first == argv[i];
+                                     });
+        if (it == benchmarks.end()) {
+            fmt::print(stderr, "unknown benchmark: {}\n", argv[i]);
+            found_all = false;
+        }
+    }
+    if (!found_all) {
+        fmt::print(stderr, "available benchmarks:");
+        for (const auto& [name, run] : benchmarks) {
+            fmt::print(stderr, " {}", name);
+        }
+        fmt::print(stderr, "\n");
+        return 1;
+    }
+
+    for (const auto& [name, run] : benchmarks) {
+        const bool selected = argc == 1 || std::any_of(argv + 1, argv + argc, [&](const char* arg) {
+                                  return name == arg;
+                              });
+        if (selected) {
+            fmt::print("{}\n", name);
+            run();
+        }
+    }
+
+    return 0;
+}
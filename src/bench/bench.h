@@ -0,0 +1,54 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+#include "common/common_types.h"
+
+namespace Bench {
+
+/// Number of times every measurement is repeated, the fastest run is reported
+constexpr int NumRuns = 5;
+
+/// Runs func NumRuns times and returns the duration of the fastest run in nanoseconds
+template <typename Func>
+double MeasureFastest(Func&& func) {
+    double fastest = std::numeric_limits<double>::max();
+    for (int run = 0; run < NumRuns; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        fastest = std::min(fastest, elapsed.count());
+    }
+    return fastest;
+}
+
+/**
+ * Prints the result of a measurement.
+ * @param name Name of the measurement
+ * @param nanoseconds Duration of the measured run
+ * @param operations Number of operations done by the run
+ * @param checksum Value computed from the results of the run, so they aren't optimized away
+ */
+void Report(std::string_view name, double nanoseconds, std::size_t operations, u64 checksum);
+
+/// Prints an error and exits with a failure status
+[[noreturn]] void Fail(std::string_view message);
+
+/// Replays a stream of surface cache inserts, removes and overlap queries
+void RunSurfaceIndex();
+
+/// Copies surfaces between Morton order and OpenGL rows in both directions
+void RunMorton();
+
+/// Replays a stream of event schedules, cancellations and advances of the timing
+void RunCoreTiming();
+
+} // namespace Bench
@@ -0,0 +1,291 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "bench/bench.h"
+#include "core/core_timing.h"
+
+namespace Bench {
+
+namespace {
+
+struct Operation {
+    enum class Type { Schedule, Unschedule, Advance };
+
+    Type type;
+    u32 event_type;
+    u64 userdata;
+    s64 ticks; ///< Delay of a scheduled event, length of an advance
+};
+
+enum EventType : u32 { Periodic, ThreadWakeup, OneShot, NumEventTypes };
+
+/// Periods of the events that reschedule themselves from their callback, like the LCD and audio
+/// events do
+constexpr std::array<s64, 8> periods{4468531, 1117133, 268111, 89370, 60000, 30000, 16384, 8192};
+
+constexpr u32 NumSlices = 100000;
+constexpr s64 SliceLength = 20000;
+constexpr u32 NumThreads = 256;
+constexpr u32 ThreadEventsPerSlice = 4;
+
+/**
+ * Generates the operations of a game with NumThreads threads. Every slice some threads start
+ * waiting with a timeout and others are woken up before it, which cancels their wakeup event. Like
+ * the kernel does, threads that aren't waiting are also unscheduled when woken up.
+ */
+std::vector<Operation> GenerateTrace() {
+    std::mt19937 rng(0x3d5);
+    const auto random = [&rng](s64 min, s64 max) {
+        return std::uniform_int_distribution<s64>(min, max)(rng);
+    };
+
+    std::vector<Operation> operations;
+    for (u32 i = 0; i < periods.size(); ++i) {
+        operations.push_back({Operation::Type::Schedule, Periodic, i, periods[i]});
+    }
+
+    // Time each thread wakes up at, 0 if it isn't waiting
+    std::array<s64, NumThreads> wakeup_times{};
+    s64 now = 0;
+    for (u32 slice = 0; slice < NumSlices; ++slice) {
+        for (u32 i = 0; i < ThreadEventsPerSlice; ++i) {
+            const u32 thread = static_cast<u32>(random(0, NumThreads - 1));
+            if (wakeup_times[thread] > now) {
+                operations.push_back({Operation::Type::Unschedule, ThreadWakeup, thread, 0});
+                wakeup_times[thread] = 0;
+            } else {
+                const s64 timeout = random(10000, 10000000);
+                operations.push_back({Operation::Type::Schedule, ThreadWakeup, thread, timeout});
+                wakeup_times[thread] = now + timeout;
+            }
+        }
+
+        const u32 thread = static_cast<u32>(random(0, NumThreads - 1));
+        if (wakeup_times[thread] <= now) {
+            operations.push_back({Operation::Type::Unschedule, ThreadWakeup, thread, 0});
+        }
+
+        operations.push_back({Operation::Type::Schedule, OneShot, slice, random(100, 40000)});
+        operations.push_back({Operation::Type::Advance, 0, 0, SliceLength});
+        now += SliceLength;
+    }
+
+    return operations;
+}
+
+/// An event that ran, identified by its time, type and userdata
+using FiredEvent = std::tuple<s64, u32, u64>;
+
+/// Replays the trace against Core::Timing, calling on_fired for every event that runs
+template <typename Func>
+void ReplayTiming(const std::vector<Operation>& operations, Func&& on_fired) {
+    Core::Timing timing;
+    const std::shared_ptr<Core::Timing::Timer> timer = timing.GetTimer(0);
+
+    const auto fire = [&](u32 type, std::uintptr_t userdata, int cycles_late) {
+        on_fired(FiredEvent{static_cast<s64>(timer->GetTicks()) - cycles_late, type, userdata});
+    };
+
+    std::array<Core::TimingEventType*, NumEventTypes> event_types;
+    event_types[Periodic] =
+        timing.RegisterEvent("Periodic", [&](std::uintptr_t userdata, int cycles_late) {
+            fire(Periodic, userdata, cycles_late);
+            timing.ScheduleEvent(periods[userdata] - cycles_late, event_types[Periodic],
+                                 userdata);
+        });
+    event_types[ThreadWakeup] =
+        timing.RegisterEvent("ThreadWakeup", [&](std::uintptr_t userdata, int cycles_late) {
+            fire(ThreadWakeup, userdata, cycles_late);
+        });
+    event_types[OneShot] =
+        timing.RegisterEvent("OneShot", [&](std::uintptr_t userdata, int cycles_late) {
+            fire(OneShot, userdata, cycles_late);
+        });
+
+    for (const Operation& operation : operations) {
+        switch (operation.type) {
+        case Operation::Type::Schedule:
+            timing.ScheduleEvent(operation.ticks, event_types[operation.event_type],
+                                 operation.userdata);
+            break;
+        case Operation::Type::Unschedule:
+            timing.UnscheduleEvent(event_types[operation.event_type], operation.userdata);
+            break;
+        case Operation::Type::Advance: {
+            // Slices end early at the next event, like they do when the CPU runs them
+            const s64 end = static_cast<s64>(timer->GetTicks()) + operation.ticks;
+            while (static_cast<s64>(timer->GetTicks()) < end) {
+                timer->SetNextSlice(end - static_cast<s64>(timer->GetTicks()));
+                timer->AddTicks(timer->GetDowncount());
+                timer->Advance();
+            }
+            break;
+        }
+        }
+    }
+}
+
+/// The queue Core::Timing used before events were cancelled through slots: cancelling removes the
+/// events from the heap and rebuilds it
+class RebuildingQueue {
+public:
+    template <typename Func>
+    void Replay(const std::vector<Operation>& operations, Func&& on_fired) {
+        for (const Operation& operation : operations) {
+            switch (operation.type) {
+            case Operation::Type::Schedule:
+                Schedule(operation.ticks, operation.event_type, operation.userdata);
+                break;
+            case Operation::Type::Unschedule: {
+                const auto it = std::remove_if(queue.begin(), queue.end(), [&](const Event& event) {
+                    return event.type == operation.event_type &&
+                           event.userdata == operation.userdata;
+                });
+                if (it != queue.end()) {
+                    queue.erase(it, queue.end());
+                    std::make_heap(queue.begin(), queue.end(), std::greater<>());
+                }
+                break;
+            }
+            case Operation::Type::Advance:
+                now += operation.ticks;
+                while (!queue.empty() && queue.front().time <= now) {
+                    const Event event = queue.front();
+                    std::pop_heap(queue.begin(), queue.end(), std::greater<>());
+                    queue.pop_back();
+                    on_fired(FiredEvent{event.time, event.type, event.userdata});
+                    if (event.type == Periodic) {
+                        Schedule(periods[event.userdata] - (now - event.time), Periodic,
+                                 event.userdata);
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+private:
+    struct Event {
+        s64 time;
+        u64 fifo_order;
+        u64 userdata;
+        u32 type;
+
+        bool operator>(const Event& right) const {
+            return std::tie(time, fifo_order) > std::tie(right.time, right.fifo_order);
+        }
+    };
+
+    void Schedule(s64 delay, u32 type, u64 userdata) {
+        queue.push_back({now + delay, fifo_order++, userdata, type});
+        std::push_heap(queue.begin(), queue.end(), std::greater<>());
+    }
+
+    std::vector<Event> queue;
+    u64 fifo_order = 0;
+    s64 now = 0;
+};
+
+constexpr u32 NumCallbackTypes = 8;
+constexpr u32 NumCallbacks = 10000000;
+
+/// Calls capturing callbacks through Core::TimedCallback and through a function pointer with a
+/// context pointer, the cheapest alternative that could replace it
+void RunCallbackDispatch() {
+    std::mt19937 rng(0x3d5);
+    std::vector<u32> order(NumCallbacks);
+    for (u32& type : order) {
+        type = rng() % NumCallbackTypes;
+    }
+
+    std::array<u64, NumCallbackTypes> counters{};
+
+    std::array<Core::TimedCallback, NumCallbackTypes> callbacks;
+    for (u64& counter : counters) {
+        callbacks[&counter - counters.data()] = [&counter](std::uintptr_t userdata,
+                                                           int cycles_late) {
+            counter += userdata + cycles_late;
+        };
+    }
+
+    struct PointerCallback {
+        void (*function)(void* context, std::uintptr_t userdata, int cycles_late);
+        void* context;
+    };
+    std::array<PointerCallback, NumCallbackTypes> pointer_callbacks;
+    for (u64& counter : counters) {
+        pointer_callbacks[&counter - counters.data()] = {
+            [](void* context, std::uintptr_t userdata, int cycles_late) {
+                *static_cast<u64*>(context) += userdata + cycles_late;
+            },
+            &counter};
+    }
+
+    const auto checksum = [&counters] {
+        u64 sum = 0;
+        for (const u64 counter : counters) {
+            sum += counter;
+        }
+        return sum;
+    };
+
+    const double function_ns = MeasureFastest([&] {
+        counters = {};
+        for (u32 i = 0; i < NumCallbacks; ++i) {
+            callbacks[order[i]](i, 1);
+        }
+    });
+    Report("TimedCallback", function_ns, NumCallbacks, checksum());
+
+    const double pointer_ns = MeasureFastest([&] {
+        counters = {};
+        for (u32 i = 0; i < NumCallbacks; ++i) {
+            const PointerCallback& callback = pointer_callbacks[order[i]];
+            callback.function(callback.context, i, 1);
+        }
+    });
+    Report("function and context pointer", pointer_ns, NumCallbacks, checksum());
+}
+
+} // Anonymous namespace
+
+void RunCoreTiming() {
+    const std::vector<Operation> operations = GenerateTrace();
+
+    std::vector<FiredEvent> timing_fired;
+    ReplayTiming(operations, [&](const FiredEvent& event) { timing_fired.push_back(event); });
+    std::vector<FiredEvent> queue_fired;
+    RebuildingQueue{}.Replay(operations,
+                             [&](const FiredEvent& event) { queue_fired.push_back(event); });
+    if (timing_fired != queue_fired) {
+        Fail("Core::Timing and the rebuilding queue ran different events");
+    }
+
+    u64 checksum = 0;
+    const auto add_to_checksum = [&checksum](const FiredEvent& event) {
+        checksum = checksum * 31 + std::get<0>(event) + std::get<2>(event);
+    };
+
+    const double timing_ns = MeasureFastest([&] {
+        checksum = 0;
+        ReplayTiming(operations, add_to_checksum);
+    });
+    Report("Core::Timing", timing_ns, operations.size(), checksum);
+
+    const double queue_ns = MeasureFastest([&] {
+        checksum = 0;
+        RebuildingQueue{}.Replay(operations, add_to_checksum);
+    });
+    Report("heap rebuilt on cancel (before)", queue_ns, operations.size(), checksum);
+
+    RunCallbackDispatch();
+}
+
+} // namespace Bench
@@ -0,0 +1,119 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include "bench/bench.h"
+#include "video_core/renderer/morton_copy.h"
+#include "video_core/renderer/surface_params.h"
+
+namespace Bench {
+
+namespace {
+
+using OpenGL::SurfaceParams;
+using PixelFormat = SurfaceParams::PixelFormat;
+
+using CopyTileFunc = void (*)(u32, u8*, u8*);
+
+/// Size of the copied surface in pixels
+constexpr u32 Width = 1024;
+constexpr u32 Height = 1024;
+constexpr u32 NumTiles = Width / 8 * Height / 8;
+
+/// Copies every tile of a surface the way MortonCopy does, without splitting the work across
+/// threads
+template <PixelFormat format, CopyTileFunc copy_tile>
+void CopySurface(u8* tile_buffer, u8* gl_buffer) {
+    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
+    constexpr u32 gl_bytes_per_pixel = SurfaceParams::GetGLBytesPerPixel(format);
+    constexpr u32 tile_size = bytes_per_pixel * 64;
+    gl_buffer += gl_bytes_per_pixel - bytes_per_pixel;
+
+    for (u32 tile = 0; tile < NumTiles; ++tile) {
+        const u32 x = (tile % (Width / 8)) * 8;
+        const u32 y = (tile / (Width / 8)) * 8;
+        copy_tile(Width, tile_buffer + tile * tile_size,
+                  gl_buffer + ((Height - 8 - y) * Width + x) * gl_bytes_per_pixel);
+    }
+}
+
+u64 Hash(const std::vector<u8>& data) {
+    u64 hash = 0xcbf29ce484222325;
+    for (const u8 byte : data) {
+        hash = (hash ^ byte) * 0x100000001b3;
+    }
+    return hash;
+}
+
+/// Checks that MortonCopyTile matches MortonCopyTileGeneric and times both in one direction
+template <bool morton_to_gl, PixelFormat format>
+void RunDirection(std::mt19937& rng) {
+    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
+    constexpr u32 gl_bytes_per_pixel = SurfaceParams::GetGLBytesPerPixel(format);
+
+    std::vector<u8> source((morton_to_gl ? bytes_per_pixel : gl_bytes_per_pixel) * Width * Height);
+    for (u8& byte : source) {
+        byte = static_cast<u8>(rng());
+    }
+
+    // Copies from source into a zeroed destination so bytes the copy skips are compared too
+    const auto run = [&source](auto copy_surface) {
+        std::vector<u8> destination(
+            (morton_to_gl ? gl_bytes_per_pixel : bytes_per_pixel) * Width * Height);
+        std::vector<u8> input = source;
+        if constexpr (morton_to_gl) {
+            copy_surface(input.data(), destination.data());
+        } else {
+            copy_surface(destination.data(), input.data());
+        }
+        return destination;
+    };
+
+    constexpr auto vectorized = CopySurface<format, OpenGL::MortonCopyTile<morton_to_gl, format>>;
+    constexpr auto scalar =
+        CopySurface<format, OpenGL::MortonCopyTileGeneric<morton_to_gl, format>>;
+
+    const std::string name = fmt::format("{} {}", SurfaceParams::PixelFormatAsString(format),
+                                         morton_to_gl ? "to GL" : "from GL");
+    if (run(vectorized) != run(scalar)) {
+        Fail(fmt::format("MortonCopyTile doesn't match MortonCopyTileGeneric for {}", name));
+    }
+
+    std::vector<u8> tiles(bytes_per_pixel * Width * Height);
+    std::vector<u8> gl_buffer(gl_bytes_per_pixel * Width * Height);
+    (morton_to_gl ? tiles : gl_buffer) = source;
+    const std::vector<u8>& destination = morton_to_gl ? gl_buffer : tiles;
+
+    const double vectorized_ns =
+        MeasureFastest([&] { vectorized(tiles.data(), gl_buffer.data()); });
+    Report(name, vectorized_ns, NumTiles, Hash(destination));
+
+    const double scalar_ns = MeasureFastest([&] { scalar(tiles.data(), gl_buffer.data()); });
+    Report(name + " (scalar)", scalar_ns, NumTiles, Hash(destination));
+}
+
+template <PixelFormat format>
+void RunFormat(std::mt19937& rng) {
+    RunDirection<true, format>(rng);
+    RunDirection<false, format>(rng);
+}
+
+} // Anonymous namespace
+
+void RunMorton() {
+    std::mt19937 rng(0x3d5);
+    RunFormat<PixelFormat::RGBA8>(rng);
+    RunFormat<PixelFormat::RGB8>(rng);
+    RunFormat<PixelFormat::RGB5A1>(rng);
+    RunFormat<PixelFormat::RGB565>(rng);
+    RunFormat<PixelFormat::RGBA4>(rng);
+    RunFormat<PixelFormat::D16>(rng);
+    RunFormat<PixelFormat::D24>(rng);
+    RunFormat<PixelFormat::D24S8>(rng);
+}
+
+} // namespace Bench
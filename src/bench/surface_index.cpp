@@ -0,0 +1,251 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+#include <boost/icl/interval_map.hpp>
+#include <boost/range/iterator_range.hpp>
+#include "bench/bench.h"
+#include "core/memory.h"
+#include "video_core/renderer/surface_index.h"
+#include "video_core/renderer/surface_params.h"
+
+namespace Bench {
+
+namespace {
+
+using OpenGL::CachedSurface;
+using OpenGL::Surface;
+using OpenGL::SurfaceIndex;
+using OpenGL::SurfaceInterval;
+
+/// The interval map the rasterizer cache used before SurfaceIndex
+using SurfaceCache =
+    boost::icl::interval_map<PAddr, std::set<Surface>, boost::icl::partial_absorber, std::less,
+                             boost::icl::inplace_plus, boost::icl::inter_section, SurfaceInterval>;
+
+struct Operation {
+    enum class Type { Insert, Remove, Query };
+
+    Type type;
+    u32 surface; ///< Index of the inserted or removed surface
+    PAddr addr;
+    PAddr end;
+};
+
+struct Trace {
+    std::vector<Operation> operations;
+    std::size_t num_surfaces = 0;
+};
+
+constexpr u32 NumFrames = 600;
+constexpr u32 NumInitialSurfaces = 1500;
+constexpr u32 QueriesPerFrame = 150;
+constexpr u32 InvalidationsPerFrame = 4;
+constexpr u32 ReplacementsPerFrame = 10;
+
+/**
+ * Generates the operations of a game that keeps about NumInitialSurfaces surfaces cached. Every
+ * frame looks up textures and render targets, mostly hitting cached surfaces, invalidates a few
+ * large regions written by the CPU or DMA, and replaces some textures.
+ */
+Trace GenerateTrace() {
+    std::mt19937 rng(0x3d5);
+    const auto random = [&rng](u32 min, u32 max) {
+        return std::uniform_int_distribution<u32>(min, max)(rng);
+    };
+
+    Trace trace;
+    std::vector<std::pair<PAddr, PAddr>> ranges;
+    std::vector<u32> live;
+
+    const auto insert = [&] {
+        PAddr addr;
+        u32 size;
+        if (random(0, 7) == 0) {
+            // Color or depth buffer in VRAM
+            addr = Memory::VRAM_PADDR + random(0, 23) * 0x40000;
+            size = (random(0, 1) == 0 ? 400 : 320) * 240 * 4;
+        } else {
+            // Texture in the first half of FCRAM
+            const u32 side = 8u << random(0, 6);
+            addr = Memory::FCRAM_PADDR + random(0, Memory::FCRAM_SIZE / 2 / 128 - 1) * 128;
+            size = side * side * (random(0, 1) == 0 ? 2 : 4);
+        }
+
+        const u32 surface = static_cast<u32>(trace.num_surfaces++);
+        ranges.emplace_back(addr, addr + size);
+        live.push_back(surface);
+        trace.operations.push_back({Operation::Type::Insert, surface, addr, addr + size});
+    };
+
+    const auto query = [&](PAddr addr, PAddr end) {
+        trace.operations.push_back({Operation::Type::Query, 0, addr, end});
+    };
+
+    for (u32 i = 0; i < NumInitialSurfaces; ++i) {
+        insert();
+    }
+
+    for (u32 frame = 0; frame < NumFrames; ++frame) {
+        for (u32 i = 0; i < QueriesPerFrame; ++i) {
+            if (random(0, 2) != 0) {
+                // Lookup of a cached surface or a part of it
+                const auto [addr, end] = ranges[live[random(0, live.size() - 1)]];
+                const u32 offset = random(0, (end - addr) / 2) & ~0x7f;
+                query(addr + offset, end);
+            } else {
+                // Lookup of a surface that usually isn't cached
+                const PAddr addr =
+                    Memory::FCRAM_PADDR + random(0, Memory::FCRAM_SIZE / 2 / 128 - 1) * 128;
+                query(addr, addr + random(256, 16 * 1024));
+            }
+        }
+
+        for (u32 i = 0; i < InvalidationsPerFrame; ++i) {
+            const PAddr addr = Memory::FCRAM_PADDR + random(0, Memory::FCRAM_SIZE / 2 - 1);
+            query(addr, addr + random(64 * 1024, 1024 * 1024));
+        }
+
+        for (u32 i = 0; i < ReplacementsPerFrame; ++i) {
+            const std::size_t position = random(0, live.size() - 1);
+            const u32 surface = live[position];
+            live[position] = live.back();
+            live.pop_back();
+            const auto [addr, end] = ranges[surface];
+            trace.operations.push_back({Operation::Type::Remove, surface, addr, end});
+            insert();
+        }
+    }
+
+    return trace;
+}
+
+/// Replays the trace against a SurfaceIndex, calling on_result for every surface a query reports
+template <typename Func>
+void ReplayIndex(const Trace& trace, const std::vector<Surface>& surfaces, Func&& on_result) {
+    SurfaceIndex index;
+    std::vector<u32> ids(surfaces.size());
+    for (const Operation& operation : trace.operations) {
+        switch (operation.type) {
+        case Operation::Type::Insert:
+            ids[operation.surface] = index.Insert(surfaces[operation.surface], operation.addr,
+                                                  operation.end, [](PAddr, PAddr) {});
+            break;
+        case Operation::Type::Remove:
+            index.Remove(ids[operation.surface], [](PAddr, PAddr) {});
+            break;
+        case Operation::Type::Query:
+            index.ForEachOverlapping(operation.addr, operation.end, on_result);
+            break;
+        }
+    }
+}
+
+/**
+ * Replays the trace against a SurfaceCache, calling on_result for every surface a query reports.
+ * Like the old lookups, surfaces are reported once per interval of the map they're in.
+ */
+template <typename Func>
+void ReplayIntervalMap(const Trace& trace, const std::vector<Surface>& surfaces,
+                       Func&& on_result) {
+    SurfaceCache cache;
+    for (const Operation& operation : trace.operations) {
+        const SurfaceInterval interval(operation.addr, operation.end);
+        switch (operation.type) {
+        case Operation::Type::Insert:
+            cache.add({interval, std::set<Surface>{surfaces[operation.surface]}});
+            break;
+        case Operation::Type::Remove:
+            cache.subtract({interval, std::set<Surface>{surfaces[operation.surface]}});
+            break;
+        case Operation::Type::Query:
+            for (const auto& pair : boost::make_iterator_range(cache.equal_range(interval))) {
+                for (const Surface& surface : pair.second) {
+                    on_result(surface);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/// Checks that both structures find the same surfaces for every query
+void Verify(const Trace& trace, const std::vector<Surface>& surfaces) {
+    SurfaceIndex index;
+    SurfaceCache cache;
+    std::vector<u32> ids(surfaces.size());
+    for (const Operation& operation : trace.operations) {
+        const SurfaceInterval interval(operation.addr, operation.end);
+        switch (operation.type) {
+        case Operation::Type::Insert:
+            ids[operation.surface] = index.Insert(surfaces[operation.surface], operation.addr,
+                                                  operation.end, [](PAddr, PAddr) {});
+            cache.add({interval, std::set<Surface>{surfaces[operation.surface]}});
+            break;
+        case Operation::Type::Remove:
+            index.Remove(ids[operation.surface], [](PAddr, PAddr) {});
+            cache.subtract({interval, std::set<Surface>{surfaces[operation.surface]}});
+            break;
+        case Operation::Type::Query: {
+            std::set<CachedSurface*> from_index;
+            index.ForEachOverlapping(operation.addr, operation.end, [&](const Surface& surface) {
+                if (!from_index.insert(surface.get()).second) {
+                    Fail("SurfaceIndex reported a surface twice");
+                }
+            });
+            std::set<CachedSurface*> from_map;
+            for (const auto& pair : boost::make_iterator_range(cache.equal_range(interval))) {
+                for (const Surface& surface : pair.second) {
+                    from_map.insert(surface.get());
+                }
+            }
+            if (from_index != from_map) {
+                Fail("SurfaceIndex and the interval map found different surfaces");
+            }
+            break;
+        }
+        }
+    }
+}
+
+} // Anonymous namespace
+
+void RunSurfaceIndex() {
+    const Trace trace = GenerateTrace();
+
+    // The structures only copy and compare the surfaces, so they're stand-ins that don't own
+    // anything and are never dereferenced
+    std::vector<std::max_align_t> storage(trace.num_surfaces);
+    std::vector<Surface> surfaces;
+    surfaces.reserve(trace.num_surfaces);
+    for (std::max_align_t& stand_in : storage) {
+        surfaces.emplace_back(Surface{}, reinterpret_cast<CachedSurface*>(&stand_in));
+    }
+
+    Verify(trace, surfaces);
+
+    u64 checksum = 0;
+    const auto add_to_checksum = [&checksum](const Surface& surface) {
+        checksum += reinterpret_cast<std::uintptr_t>(surface.get());
+    };
+
+    const double index_ns = MeasureFastest([&] {
+        checksum = 0;
+        ReplayIndex(trace, surfaces, add_to_checksum);
+    });
+    Report("SurfaceIndex", index_ns, trace.operations.size(), checksum);
+
+    const double map_ns = MeasureFastest([&] {
+        checksum = 0;
+        ReplayIntervalMap(trace, surfaces, add_to_checksum);
+    });
+    Report("interval map (before SurfaceIndex)", map_ns, trace.operations.size(), checksum);
+}
+
+} // namespace Bench
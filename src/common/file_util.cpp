@@ -353,6 +353,21 @@ u64 GetSize(FILE* f) {
     return size;
 }
 
+s64 GetModificationTime(const std::string& filename) {
+    struct stat buf;
+#ifdef _WIN32
+    if (_wstat64(Common::UTF8ToUTF16W(filename).c_str(), &buf) == 0)
+#else
+    if (stat(filename.c_str(), &buf) == 0)
+#endif
+    {
+        return static_cast<s64>(buf.st_mtime);
+    }
+
+    LOG_ERROR(Common_Filesystem, "Stat failed {}: {}", filename, GetLastErrorMsg());
+    return 0;
+}
+
 bool CreateEmptyFile(const std::string& filename) {
     LOG_TRACE(Common_Filesystem, "{}", filename);
 
@@ -551,6 +566,7 @@ void InitUserPaths(const std::string& user_path) {
     g_paths[UserPath::DumpDir] = user_path + "dump/";
     g_paths[UserPath::LoadDir] = user_path + "load/";
     g_paths[UserPath::PreloadDir] = user_path + "preload/";
+    g_paths[UserPath::TextureCacheDir] = user_path + "texture_cache/";
 }
 
 const std::string& GetUserPath(UserPath path) {
@@ -37,6 +37,7 @@ enum class UserPath {
     SDMCDir,
     ShaderDir,
     SysDataDir,
+    TextureCacheDir,
     UserDir,
 };
 
@@ -64,6 +65,9 @@ u64 GetSize(const int fd);
 // Overloaded GetSize, accepts FILE*
 u64 GetSize(FILE* f);
 
+// Returns the time filename was last modified in seconds since the epoch, or 0 on failure
+s64 GetModificationTime(const std::string& filename);
+
 // Returns true if successful, or path already exists.
 bool CreateDir(const std::string& filename);
 
@@ -0,0 +1,44 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "common/common_types.h"
+
+namespace Common {
+
+/// Read-only memory mapping of a whole file
+class MappedFile : NonCopyable {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    /// Maps the file, returns false if it doesn't exist or can't be mapped
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const {
+        return data != nullptr;
+    }
+
+    const u8* GetData() const {
+        return data;
+    }
+
+    std::size_t GetSize() const {
+        return size;
+    }
+
+private:
+    const u8* data = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+} // namespace Common
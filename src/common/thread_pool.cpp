@@ -0,0 +1,105 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(std::size_t num_workers) {
+    workers.reserve(num_workers);
+    for (std::size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)>& function) {
+    if (workers.empty() || count < 2) {
+        for (std::size_t i = 0; i < count; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> loop_lock(loop_mutex);
+    RunLoop(count, function);
+}
+
+void ThreadPool::ParallelForNoWait(std::size_t count,
+                                   const std::function<void(std::size_t)>& function) {
+    std::unique_lock<std::mutex> loop_lock(loop_mutex, std::defer_lock);
+    if (workers.empty() || count < 2 || !loop_lock.try_lock()) {
+        for (std::size_t i = 0; i < count; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    RunLoop(count, function);
+}
+
+void ThreadPool::RunLoop(std::size_t count, const std::function<void(std::size_t)>& function) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->function = &function;
+        this->count = count;
+        next_index = 0;
+        busy_workers = workers.size();
+        ++generation;
+    }
+    work_cv.notify_all();
+
+    RunIterations();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return busy_workers == 0; });
+    this->function = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+    std::size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_cv.wait(lock, [&] { return stop || generation != seen_generation; });
+            if (stop) {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        RunIterations();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy_workers == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunIterations() {
+    for (std::size_t i = next_index++; i < count; i = next_index++) {
+        (*function)(i);
+    }
+}
+
+ThreadPool& GetThreadPool() {
+    static ThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return thread_pool;
+}
+
+} // namespace Common
@@ -0,0 +1,67 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+/// Fixed set of worker threads that run the iterations of loops
+class ThreadPool {
+public:
+    /// @param num_workers Number of worker threads. The calling thread also takes part in loops.
+    explicit ThreadPool(std::size_t num_workers);
+    ~ThreadPool();
+
+    /**
+     * Calls function for every index in [0, count) and returns when all calls returned.
+     * Indices are handed out dynamically, so calls run in no particular order and on any thread.
+     * Waits for loops other threads are running on the pool. Must not be called from function.
+     */
+    void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& function);
+
+    /**
+     * Like ParallelFor, but if another thread is running a loop on the pool, makes all calls on the
+     * calling thread instead of waiting for it.
+     */
+    void ParallelForNoWait(std::size_t count, const std::function<void(std::size_t)>& function);
+
+    /// Gets the number of threads loops are spread over, including the calling thread
+    std::size_t GetThreadCount() const {
+        return workers.size() + 1;
+    }
+
+private:
+    void RunLoop(std::size_t count, const std::function<void(std::size_t)>& function);
+    void WorkerLoop();
+    void RunIterations();
+
+    std::vector<std::thread> workers;
+
+    /// Held by the thread running a loop on the pool
+    std::mutex loop_mutex;
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::size_t generation = 0;
+    std::size_t busy_workers = 0;
+    bool stop = false;
+
+    const std::function<void(std::size_t)>* function = nullptr;
+    std::size_t count = 0;
+    std::atomic<std::size_t> next_index{0};
+};
+
+/// Gets the thread pool shared by the emulator's loops, with a worker for every host thread but one
+ThreadPool& GetThreadPool();
+
+} // namespace Common
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include <type_traits>
 #include <dynarmic/A32/a32.h>
 #include <dynarmic/exclusive_monitor.h>
 #include "common/assert.h"
@@ -11,6 +12,7 @@
 #include "core/core.h"
 #include "core/hle/kernel/svc.h"
 #include "core/memory.h"
+#include "core/savestate.h"
 
 class DynarmicUserCallbacks final : public Dynarmic::A32::UserCallbacks {
 public:
@@ -20,65 +22,61 @@ public:
     ~DynarmicUserCallbacks() = default;
 
     std::uint8_t MemoryRead8(VAddr vaddr) override {
-        return memory.Read8(vaddr);
+        return ReadMemory<u8>(vaddr, [&] { return memory.Read8(vaddr); });
     }
 
     std::uint16_t MemoryRead16(VAddr vaddr) override {
-        return memory.Read16(vaddr);
+        return ReadMemory<u16>(vaddr, [&] { return memory.Read16(vaddr); });
     }
 
     std::uint32_t MemoryRead32(VAddr vaddr) override {
-        return memory.Read32(vaddr);
+        return ReadMemory<u32>(vaddr, [&] { return memory.Read32(vaddr); });
     }
 
     std::uint64_t MemoryRead64(VAddr vaddr) override {
-        return memory.Read64(vaddr);
+        return ReadMemory<u64>(vaddr, [&] { return memory.Read64(vaddr); });
     }
 
     void MemoryWrite8(VAddr vaddr, std::uint8_t value) override {
-        memory.Write8(vaddr, value);
+        WriteMemory(vaddr, value, [&] { memory.Write8(vaddr, value); });
     }
 
     void MemoryWrite16(VAddr vaddr, std::uint16_t value) override {
-        memory.Write16(vaddr, value);
+        WriteMemory(vaddr, value, [&] { memory.Write16(vaddr, value); });
     }
 
     void MemoryWrite32(VAddr vaddr, std::uint32_t value) override {
-        memory.Write32(vaddr, value);
+        WriteMemory(vaddr, value, [&] { memory.Write32(vaddr, value); });
     }
 
     void MemoryWrite64(VAddr vaddr, std::uint64_t value) override {
-        memory.Write64(vaddr, value);
+        WriteMemory(vaddr, value, [&] { memory.Write64(vaddr, value); });
     }
 
     bool MemoryWriteExclusive8(VAddr vaddr, std::uint8_t value,
                                [[maybe_unused]] std::uint8_t expected) override {
-        MemoryWrite8(vaddr, value);
-        return true;
+        return WriteMemoryExclusive(vaddr, value, [&] { memory.Write8(vaddr, value); });
     }
 
     bool MemoryWriteExclusive16(VAddr vaddr, std::uint16_t value,
                                 [[maybe_unused]] std::uint16_t expected) override {
-        MemoryWrite16(vaddr, value);
-        return true;
+        return WriteMemoryExclusive(vaddr, value, [&] { memory.Write16(vaddr, value); });
     }
 
     bool MemoryWriteExclusive32(VAddr vaddr, std::uint32_t value,
                                 [[maybe_unused]] std::uint32_t expected) override {
-        MemoryWrite32(vaddr, value);
-        return true;
+        return WriteMemoryExclusive(vaddr, value, [&] { memory.Write32(vaddr, value); });
     }
 
     bool MemoryWriteExclusive64(VAddr vaddr, std::uint64_t value,
                                 [[maybe_unused]] std::uint64_t expected) override {
-        MemoryWrite64(vaddr, value);
-        return true;
+        return WriteMemoryExclusive(vaddr, value, [&] { memory.Write64(vaddr, value); });
     }
 
     void InterpreterFallback(VAddr pc, std::size_t num_instructions) override {}
 
     void CallSVC(std::uint32_t swi) override {
-        svc_context.CallSVC(swi);
+        OnEmulationThread([&] { svc_context.CallSVC(swi); });
     }
 
     void ExceptionRaised(VAddr pc, Dynarmic::A32::Exception exception) override {
@@ -110,6 +108,103 @@ public:
         return static_cast<u64>(ticks <= 0 ? 0 : ticks);
     }
 
+    /// Runs func on the emulation thread if the core runs on a host thread of its own
+    template <typename Func>
+    auto OnEmulationThread(Func&& func) -> decltype(func()) {
+        if (!parent.system.IsParallelCoreThread()) {
+            return func();
+        }
+
+        if constexpr (std::is_void_v<decltype(func())>) {
+            parent.system.RunOnEmulationThread(func);
+        } else {
+            decltype(func()) result{};
+            parent.system.RunOnEmulationThread([&] { result = func(); });
+            return result;
+        }
+    }
+
+    // The accesses below use the host pointer of the page table of the core once they fetched it.
+    // Looking the page up again could find it cached by the rasterizer meanwhile, which must only
+    // be handled on the emulation thread.
+
+    template <typename T, typename Func>
+    T ReadMemory(VAddr vaddr, Func&& read) {
+        if (const u8* ptr = parent.current_page_table->Get(vaddr)) {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        if (!parent.system.IsParallelCoreThread()) {
+            return read();
+        }
+
+        // Exclusive loads come through here while the exclusive monitor is held, and can't be told
+        // apart from other loads. The emulation thread may be waiting for the monitor, so the core
+        // can't wait for it: the page is read without flushing the rasterizer first.
+        const u8* ptr = GetPageWithoutHostPointer(vaddr);
+        if (ptr == nullptr) {
+            return 0;
+        }
+
+        T value;
+        std::memcpy(&value, ptr, sizeof(T));
+        return value;
+    }
+
+    template <typename T, typename Func>
+    void WriteMemory(VAddr vaddr, T value, Func&& write) {
+        if (u8* ptr = parent.current_page_table->Get(vaddr)) {
+            std::memcpy(ptr, &value, sizeof(T));
+            return;
+        }
+
+        // Plain stores are never made while the exclusive monitor is held
+        OnEmulationThread(std::forward<Func>(write));
+    }
+
+    template <typename T, typename Func>
+    bool WriteMemoryExclusive(VAddr vaddr, T value, Func&& write) {
+        if (u8* ptr = parent.current_page_table->Get(vaddr)) {
+            std::memcpy(ptr, &value, sizeof(T));
+            return true;
+        }
+
+        if (!parent.system.IsParallelCoreThread()) {
+            write();
+            return true;
+        }
+
+        // The exclusive monitor is held, so the core can't wait for the emulation thread. The store
+        // fails and the guest retries it once the page has been flushed and invalidated.
+        // Stores to unmapped pages are dropped like plain ones.
+        return GetPageWithoutHostPointer(vaddr) == nullptr;
+    }
+
+    /**
+     * Handles an access of the core running in parallel to a page without a host pointer. If the
+     * rasterizer caches the page, the emulation thread is asked to flush and invalidate it after
+     * the slice, which is ended early, so later accesses find a host pointer.
+     * @returns The memory backing the page, or nullptr if it's unmapped.
+     */
+    u8* GetPageWithoutHostPointer(VAddr vaddr) {
+        if (parent.current_page_table->attributes[vaddr >> Memory::PAGE_BITS] !=
+            Memory::PageType::RasterizerCachedMemory) {
+            LOG_ERROR(Core_ARM11, "unmapped access @ 0x{:08X} on core {}", vaddr, parent.GetID());
+            return nullptr;
+        }
+
+        const VAddr page = vaddr & ~Memory::PAGE_MASK;
+        parent.system.RunAfterParallelSlice([page] {
+            Memory::RasterizerFlushVirtualRegion(page, Memory::PAGE_SIZE,
+                                                 Memory::FlushMode::FlushAndInvalidate);
+        });
+        parent.PrepareReschedule();
+
+        return memory.GetPointerForRasterizerCache(vaddr);
+    }
+
     ARM_Dynarmic& parent;
     Kernel::SVCContext svc_context;
     Memory::MemorySystem& memory;
@@ -135,6 +230,27 @@ void ThreadContext::SetFpscr(u32 value) {
     context.SetFpscr(value);
 }
 
+void ThreadContext::SaveState(Core::StateWriter& writer) const {
+    writer.Write(context.Regs());
+    writer.Write(context.ExtRegs());
+    writer.Write(context.Cpsr());
+    writer.Write(context.Fpscr());
+    writer.Write(fpexc);
+}
+
+bool ThreadContext::LoadState(Core::StateReader& reader) {
+    u32 cpsr = 0;
+    u32 fpscr = 0;
+    if (!reader.Read(context.Regs()) || !reader.Read(context.ExtRegs()) || !reader.Read(cpsr) ||
+        !reader.Read(fpscr) || !reader.Read(fpexc)) {
+        return false;
+    }
+
+    context.SetCpsr(cpsr);
+    context.SetFpscr(fpscr);
+    return true;
+}
+
 ARM_Dynarmic::ARM_Dynarmic(Core::System* system, Memory::MemorySystem& memory, u32 id,
                            std::shared_ptr<Core::Timing::Timer> timer,
                            Dynarmic::ExclusiveMonitor* exclusive_monitor)
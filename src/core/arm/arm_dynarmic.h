@@ -18,6 +18,8 @@ class MemorySystem;
 } // namespace Memory
 
 namespace Core {
+class StateReader;
+class StateWriter;
 class System;
 } // namespace Core
 
@@ -32,6 +34,12 @@ public:
     void SetCpsr(u32 value);
     void SetFpscr(u32 value);
 
+    /// Serializes the registers of the context
+    void SaveState(Core::StateWriter& writer) const;
+
+    /// Restores registers serialized by SaveState. Returns false if the state is truncated.
+    bool LoadState(Core::StateReader& reader);
+
 private:
     friend class ARM_Dynarmic;
 
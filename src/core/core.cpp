@@ -4,6 +4,7 @@
 
 #include <dynarmic/exclusive_monitor.h>
 #include <memory>
+#include <random>
 #include <utility>
 #include "audio_core/dsp_interface.h"
 #include "audio_core/hle/hle.h"
@@ -27,6 +28,7 @@
 #include "core/hw/hw.h"
 #include "core/loader/loader.h"
 #include "core/movie.h"
+#include "core/savestate.h"
 #include "core/settings.h"
 #include "enet/enet.h"
 #include "network/room.h"
@@ -116,29 +118,34 @@ System::ResultStatus System::Run() {
             max_slice = std::min(max_slice, cpu_core->GetTimer().GetMaxSliceLength());
         }
 
-        for (std::shared_ptr<ARM_Dynarmic>& cpu_core : cpu_cores) {
-            cpu_core->GetTimer().SetNextSlice(max_slice);
-            const u64 start_ticks = cpu_core->GetTimer().GetTicks();
+        if (parallel_core != nullptr && CanRunCoresInParallel()) {
+            RunSliceInParallel(max_slice);
+        } else {
+            for (std::shared_ptr<ARM_Dynarmic>& cpu_core : cpu_cores) {
+                cpu_core->GetTimer().SetNextSlice(max_slice);
+                const u64 start_ticks = cpu_core->GetTimer().GetTicks();
 
-            LOG_TRACE(Core_ARM11, "Core {} running for {} ticks", cpu_core->GetID(),
-                      cpu_core->GetTimer().GetDowncount());
+                LOG_TRACE(Core_ARM11, "Core {} running for {} ticks", cpu_core->GetID(),
+                          cpu_core->GetTimer().GetDowncount());
 
-            running_core = cpu_core.get();
-            kernel->SetRunningCPU(running_core);
+                running_core = cpu_core.get();
+                kernel->SetRunningCPU(running_core);
 
-            if (kernel->GetCurrentThreadManager().GetCurrentThread() == nullptr) {
-                LOG_TRACE(Core_ARM11, "Core {} idling", cpu_core->GetID());
-                cpu_core->GetTimer().Idle();
-                PrepareReschedule();
-            } else {
-                cpu_core->Run();
-            }
+                if (kernel->GetCurrentThreadManager().GetCurrentThread() == nullptr) {
+                    LOG_TRACE(Core_ARM11, "Core {} idling", cpu_core->GetID());
+                    cpu_core->GetTimer().Idle();
+                    PrepareReschedule();
+                } else {
+                    cpu_core->Run();
+                }
 
-            max_slice = cpu_core->GetTimer().GetTicks() - start_ticks;
+                max_slice = cpu_core->GetTimer().GetTicks() - start_ticks;
+            }
         }
     }
 
     Reschedule();
+    HandleStateRequests();
 
     if (reset_requested.exchange(false)) {
         Reset();
@@ -250,6 +257,11 @@ System::ResultStatus System::Load(Frontend::EmuWindow& emu_window, const std::st
     cheat_engine = std::make_shared<Cheats::Engine>(*this);
     perf_stats = std::make_unique<PerfStats>();
     custom_tex_cache = std::make_unique<Core::CustomTexCache>();
+    texture_disk_cache = std::make_unique<Core::TextureDiskCache>();
+
+    if (Settings::values.use_texture_disk_cache) {
+        texture_disk_cache->Open(Kernel().GetCurrentProcess()->codeset->program_id);
+    }
 
     if (Settings::values.use_custom_textures) {
         FileUtil::CreateFullPath(fmt::format("{}textures/{:016X}/",
@@ -261,6 +273,7 @@ System::ResultStatus System::Load(Frontend::EmuWindow& emu_window, const std::st
                                              Kernel().GetCurrentProcess()->codeset->program_id));
 
         custom_tex_cache->FindCustomTextures();
+        custom_tex_cache->OpenPack();
     }
 
     if (Settings::values.preload_custom_textures) {
@@ -282,6 +295,58 @@ bool System::IsInitialized() const {
                         [](std::shared_ptr<ARM_Dynarmic> ptr) { return ptr == nullptr; });
 }
 
+bool System::CanRunCoresInParallel() const {
+    // Both cores use the page table of the current process, so they have to run the same one
+    const Kernel::Thread* thread_1 = kernel->GetThreadManager(0).GetCurrentThread();
+    const Kernel::Thread* thread_2 = kernel->GetThreadManager(1).GetCurrentThread();
+    return thread_1 != nullptr && thread_2 != nullptr &&
+           thread_1->owner_process == thread_2->owner_process;
+}
+
+void System::RunSliceInParallel(s64 max_slice) {
+    ARM_Dynarmic& core_1 = *cpu_cores[0];
+    ARM_Dynarmic& core_2 = parallel_core->GetCore();
+
+    // Unlike running the cores in turn, both cores get the whole slice. If core 1 stops early,
+    // it catches up on core 2 in the next call of Run.
+    LOG_TRACE(Core_ARM11, "Cores running in parallel for {} ticks", max_slice);
+
+    core_2.GetTimer().SetNextSlice(max_slice);
+    parallel_core->StartSlice();
+
+    core_1.GetTimer().SetNextSlice(max_slice);
+    running_core = &core_1;
+    kernel->SetRunningCPU(running_core);
+    core_1.Run();
+
+    parallel_core->FinishSlice();
+}
+
+void System::RunOnEmulationThread(const std::function<void()>& function) {
+    parallel_core->RunOnEmulationThread([this, &function] {
+        ARM_Dynarmic* const core = &parallel_core->GetCore();
+        if (running_core != core) {
+            running_core = core;
+            kernel->SetRunningCPU(running_core);
+        }
+        function();
+    });
+}
+
+void System::RunAfterParallelSlice(std::function<void()> function) {
+    parallel_core->RunAfterSlice(std::move(function));
+}
+
+void System::InvalidateCacheRange(u32 start_address, std::size_t length) {
+    for (const auto& cpu : cpu_cores) {
+        if (parallel_core != nullptr && cpu.get() == &parallel_core->GetCore()) {
+            parallel_core->InvalidateCacheRange(start_address, length);
+        } else {
+            cpu->InvalidateCacheRange(start_address, length);
+        }
+    }
+}
+
 void System::PrepareReschedule() {
     running_core->PrepareReschedule();
     reschedule_pending = true;
@@ -299,6 +364,45 @@ void System::Reschedule() {
     }
 }
 
+void System::HandleStateRequests() {
+    std::string save_path;
+    std::string load_path;
+    std::optional<std::size_t> steps;
+
+    {
+        std::lock_guard lock(state_request_mutex);
+        save_path = std::exchange(save_state_path, {});
+        load_path = std::exchange(load_state_path, {});
+        steps = std::exchange(rewind_steps, std::nullopt);
+    }
+
+    if (!save_path.empty()) {
+        const std::vector<u8> state = SaveState(*this);
+        FileUtil::IOFile file(save_path, "wb");
+        if (file.WriteBytes(state.data(), state.size()) != state.size()) {
+            LOG_ERROR(Core, "Failed to write save state to {}", save_path);
+        }
+    }
+
+    if (steps) {
+        rewind_buffer.Rewind(*this, *steps);
+    } else if (frame_limiter.RewindCaptureDue()) {
+        rewind_buffer.Capture(*this, Settings::values.rewind_captures);
+    } else if (!Settings::values.enable_rewind) {
+        rewind_buffer.Clear();
+    }
+
+    if (!load_path.empty()) {
+        FileUtil::IOFile file(load_path, "rb");
+        std::vector<u8> state(file.IsOpen() ? file.GetSize() : 0);
+        if (!file.IsOpen() || file.ReadBytes(state.data(), state.size()) != state.size()) {
+            LOG_ERROR(Core, "Failed to read save state from {}", load_path);
+        } else {
+            LoadState(*this, state);
+        }
+    }
+}
+
 System::ResultStatus System::Init(Frontend::EmuWindow& emu_window, u32 system_mode) {
     memory = std::make_unique<Memory::MemorySystem>();
     timing = std::make_unique<Timing>();
@@ -319,6 +423,10 @@ System::ResultStatus System::Init(Frontend::EmuWindow& emu_window, u32 system_mo
 
     running_core = cpu_cores[0].get();
 
+    if (Settings::values.enable_core_2 && Settings::values.run_cores_in_parallel) {
+        parallel_core = std::make_unique<ParallelCore>(*cpu_cores[1]);
+    }
+
     kernel->SetCPUs(cpu_cores);
     kernel->SetRunningCPU(cpu_cores[0].get());
 
@@ -401,6 +509,10 @@ const Core::CustomTexCache& System::CustomTexCache() const {
     return *custom_tex_cache;
 }
 
+Core::TextureDiskCache& System::TextureDiskCache() {
+    return *texture_disk_cache;
+}
+
 Network::RoomMember& System::RoomMember() {
     return *room_member;
 }
@@ -420,16 +532,19 @@ void System::RegisterSoftwareKeyboard(std::shared_ptr<Frontend::SoftwareKeyboard
 void System::Shutdown() {
     VideoCore::Shutdown();
     perf_stats.reset();
+    rewind_buffer.Clear();
     cheat_engine.reset();
     archive_manager.reset();
     service_manager.reset();
     dsp_core.reset();
+    parallel_core.reset();
     cpu_cores.clear();
     kernel.reset();
     timing.reset();
     app_loader.reset();
     exclusive_monitor.reset();
     custom_tex_cache.reset();
+    texture_disk_cache.reset();
     running_core = nullptr;
     room_member->SendGameInfo(Network::GameInfo{});
 }
@@ -491,6 +606,25 @@ void System::SetResetFilePath(const std::string filepath) {
     m_filepath = filepath;
 }
 
+void System::RequestSaveState(const std::string& path) {
+    std::lock_guard lock(state_request_mutex);
+    save_state_path = path;
+}
+
+void System::RequestLoadState(const std::string& path) {
+    std::lock_guard lock(state_request_mutex);
+    load_state_path = path;
+}
+
+void System::RequestRewind(std::size_t steps) {
+    std::lock_guard lock(state_request_mutex);
+    rewind_steps = steps;
+}
+
+RewindBuffer& System::GetRewindBuffer() {
+    return rewind_buffer;
+}
+
 void System::SetBeforeLoadingAfterFirstTime(std::function<void()> function) {
     before_loading_after_first_time = function;
 }
@@ -6,16 +6,20 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include "common/common_types.h"
 #include "core/arm/arm_dynarmic.h"
 #include "core/custom_tex_cache.h"
+#include "core/texture_disk_cache.h"
 #include "core/frontend/applets/mii_selector.h"
 #include "core/frontend/applets/swkbd.h"
 #include "core/loader/loader.h"
 #include "core/memory.h"
+#include "core/parallel_core.h"
 #include "core/perf_stats.h"
+#include "core/rewind.h"
 
 namespace Frontend {
 class EmuWindow;
@@ -110,6 +114,18 @@ public:
 
     void SetResetFilePath(const std::string filepath);
 
+    /// Request saving the emulated hardware state to a file after the current slice
+    void RequestSaveState(const std::string& path);
+
+    /// Request loading the emulated hardware state from a file after the current slice
+    void RequestLoadState(const std::string& path);
+
+    /// Request restoring a rewind capture after the current slice, 0 being the newest capture
+    void RequestRewind(std::size_t steps);
+
+    /// Gets a reference to the rewind buffer
+    RewindBuffer& GetRewindBuffer();
+
     /**
      * Load an executable application.
      * @param emu_window Reference to the host-system window used for video output and keyboard
@@ -134,12 +150,25 @@ public:
         return cpu_cores.size();
     }
 
-    void InvalidateCacheRange(u32 start_address, std::size_t length) {
-        for (const auto& cpu : cpu_cores) {
-            cpu->InvalidateCacheRange(start_address, length);
-        }
+    void InvalidateCacheRange(u32 start_address, std::size_t length);
+
+    /// Returns true if called from the host thread of a core running in parallel
+    bool IsParallelCoreThread() const {
+        return parallel_core != nullptr && parallel_core->IsCoreThread();
     }
 
+    /**
+     * Runs a function on the emulation thread, with the core running in parallel as the running
+     * core. Must be called from the host thread of that core.
+     */
+    void RunOnEmulationThread(const std::function<void()>& function);
+
+    /**
+     * Runs a function on the emulation thread once the slice of the core running in parallel
+     * ends, without waiting for it. Must be called from the host thread of that core.
+     */
+    void RunAfterParallelSlice(std::function<void()> function);
+
     /**
      * Gets a reference to the emulated DSP.
      * @returns A reference to the emulated DSP.
@@ -196,6 +225,9 @@ public:
     /// Gets a const reference to the custom texture cache system
     const Core::CustomTexCache& CustomTexCache() const;
 
+    /// Gets a reference to the disk cache of decoded and filtered textures
+    Core::TextureDiskCache& TextureDiskCache();
+
     /// Gets a reference to the room member
     Network::RoomMember& RoomMember();
 
@@ -244,6 +276,15 @@ private:
     /// Reschedule the core emulation
     void Reschedule();
 
+    /// Saves, loads or rewinds the state if requested, and takes due rewind captures
+    void HandleStateRequests();
+
+    /// Returns true if the cores can run their next slice in parallel
+    bool CanRunCoresInParallel() const;
+
+    /// Runs a slice of core 2 on its host thread and a slice of core 1 on this thread
+    void RunSliceInParallel(s64 max_slice);
+
     /// AppLoader used to load the current executing application
     std::unique_ptr<Loader::AppLoader> app_loader;
 
@@ -252,6 +293,9 @@ private:
     ARM_Dynarmic* running_core = nullptr;
     std::shared_ptr<Dynarmic::ExclusiveMonitor> exclusive_monitor;
 
+    /// Host thread of core 2, if the cores run in parallel
+    std::unique_ptr<ParallelCore> parallel_core;
+
     /// DSP core
     std::shared_ptr<AudioCore::DspInterface> dsp_core;
 
@@ -271,6 +315,9 @@ private:
     /// Custom texture cache system
     std::unique_ptr<Core::CustomTexCache> custom_tex_cache;
 
+    /// Disk cache of decoded and filtered textures
+    std::unique_ptr<Core::TextureDiskCache> texture_disk_cache;
+
     std::unique_ptr<Service::FS::ArchiveManager> archive_manager;
 
     std::unique_ptr<Memory::MemorySystem> memory;
@@ -293,6 +340,12 @@ private:
     std::atomic<bool> reset_requested{false};
     std::atomic<bool> shutdown_requested{false};
 
+    std::mutex state_request_mutex;
+    std::string save_state_path;
+    std::string load_state_path;
+    std::optional<std::size_t> rewind_steps;
+    RewindBuffer rewind_buffer;
+
     std::function<void()> before_loading_after_first_time;
     std::function<void()> emulation_starting_after_first_time;
     std::function<void(ResultStatus)> on_load_failed;
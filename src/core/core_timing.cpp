@@ -8,6 +8,7 @@
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "core/core_timing.h"
+#include "core/savestate.h"
 #include "core/settings.h"
 
 namespace Core {
@@ -56,9 +57,7 @@ void Timing::ScheduleEvent(s64 cycles_into_future, const TimingEventType* event_
             timer->ForceExceptionCheck(cycles_into_future);
         }
 
-        timer->event_queue.emplace_back(
-            Event{timeout, timer->event_fifo_id++, userdata, event_type});
-        std::push_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
+        timer->PushEvent(Event{timeout, timer->event_fifo_id++, userdata, event_type});
     } else {
         timer->ts_queue.Push(Event{static_cast<s64>(timer->GetTicks() + cycles_into_future), 0,
                                    userdata, event_type});
@@ -66,28 +65,19 @@ void Timing::ScheduleEvent(s64 cycles_into_future, const TimingEventType* event_
 }
 
 void Timing::UnscheduleEvent(const TimingEventType* event_type, u64 userdata) {
-    for (auto timer : timers) {
-        auto itr = std::remove_if(
-            timer->event_queue.begin(), timer->event_queue.end(),
-            [&](const Event& e) { return e.type == event_type && e.userdata == userdata; });
-
-        // Removing random items breaks the invariant so we have to re-establish it.
-        if (itr != timer->event_queue.end()) {
-            timer->event_queue.erase(itr, timer->event_queue.end());
-            std::make_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
-        }
+    const Timer::EventKey key{event_type, userdata};
+    for (const std::shared_ptr<Timer>& timer : timers) {
+        timer->CancelEvents(key);
     }
 }
 
 void Timing::RemoveEvent(const TimingEventType* event_type) {
-    for (auto timer : timers) {
-        auto itr = std::remove_if(timer->event_queue.begin(), timer->event_queue.end(),
-                                  [&](const Event& e) { return e.type == event_type; });
-
-        // Removing random items breaks the invariant so we have to re-establish it.
-        if (itr != timer->event_queue.end()) {
-            timer->event_queue.erase(itr, timer->event_queue.end());
-            std::make_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
+    // Rarely used, so the events aren't indexed by type alone
+    for (const std::shared_ptr<Timer>& timer : timers) {
+        for (const auto& [key, first_slot] : timer->first_slots) {
+            if (key.type == event_type) {
+                timer->CancelEvents(key);
+            }
         }
     }
 }
@@ -116,6 +106,94 @@ std::shared_ptr<Timing::Timer> Timing::GetTimer(std::size_t cpu_id) {
     return timers[cpu_id];
 }
 
+void Timing::SaveState(StateWriter& writer) {
+    for (const std::shared_ptr<Timer>& timer : timers) {
+        timer->MoveEvents();
+
+        writer.Write(timer->executed_ticks);
+        writer.Write(timer->slice_length);
+        writer.Write(timer->downcount);
+        writer.Write(timer->idled_cycles);
+        writer.Write(timer->event_fifo_id);
+        writer.Write(static_cast<u32>(timer->event_queue.size() - timer->cancelled_count));
+
+        for (const Timer::QueuedEvent& queued : timer->event_queue) {
+            if (timer->IsCancelled(queued)) {
+                continue;
+            }
+
+            const Event& event = queued.event;
+            writer.Write(event.time);
+            writer.Write(event.fifo_order);
+            writer.Write(event.userdata);
+            writer.WriteString(*event.type->name);
+        }
+    }
+}
+
+bool Timing::ReadState(StateReader& reader, std::vector<SavedTimer>& saved_timers) const {
+    saved_timers.resize(timers.size());
+
+    for (SavedTimer& saved : saved_timers) {
+        u32 count = 0;
+        if (!reader.Read(saved.executed_ticks) || !reader.Read(saved.slice_length) ||
+            !reader.Read(saved.downcount) || !reader.Read(saved.idled_cycles) ||
+            !reader.Read(saved.event_fifo_id) || !reader.Read(count)) {
+            return false;
+        }
+
+        saved.events.clear();
+        for (u32 i = 0; i < count; ++i) {
+            Event event{};
+            std::string name;
+            if (!reader.Read(event.time) || !reader.Read(event.fifo_order) ||
+                !reader.Read(event.userdata) || !reader.ReadString(name)) {
+                return false;
+            }
+
+            const auto itr = event_types.find(name);
+            if (itr == event_types.end()) {
+                LOG_ERROR(Core_Timing, "Save state has an event of unknown type {}", name);
+                return false;
+            }
+
+            event.type = &itr->second;
+            saved.events.push_back(event);
+        }
+    }
+
+    return true;
+}
+
+void Timing::RestoreState(const std::vector<SavedTimer>& saved_timers) {
+    ASSERT(saved_timers.size() == timers.size());
+
+    for (std::size_t i = 0; i < timers.size(); ++i) {
+        Timer& timer = *timers[i];
+        const SavedTimer& saved = saved_timers[i];
+
+        // Drop events scheduled from other threads since the state was saved
+        timer.MoveEvents();
+
+        timer.executed_ticks = saved.executed_ticks;
+        timer.slice_length = saved.slice_length;
+        timer.downcount = saved.downcount;
+        timer.idled_cycles = saved.idled_cycles;
+        timer.event_fifo_id = saved.event_fifo_id;
+
+        timer.event_queue.clear();
+        timer.event_queue.reserve(saved.events.size());
+        timer.cancelled_count = 0;
+        timer.slots.clear();
+        timer.first_free_slot = Timer::InvalidSlot;
+        timer.first_slots.clear();
+
+        for (const Event& event : saved.events) {
+            timer.PushEvent(event);
+        }
+    }
+}
+
 Timing::Timer::Timer() {
     slice_length = Settings::values.set_slice_length_to_this_in_core_timing_timer_timer;
     downcount = Settings::values.set_downcount_to_this_in_core_timing_timer_timer;
@@ -154,16 +232,105 @@ void Timing::Timer::ForceExceptionCheck(s64 cycles) {
 void Timing::Timer::MoveEvents() {
     for (Event ev; ts_queue.Pop(ev);) {
         ev.fifo_order = event_fifo_id++;
-        event_queue.emplace_back(std::move(ev));
-        std::push_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+        PushEvent(ev);
+    }
+}
+
+void Timing::Timer::PushEvent(const Event& event) {
+    u32 slot = first_free_slot;
+    if (slot == InvalidSlot) {
+        slot = static_cast<u32>(slots.size());
+        slots.emplace_back();
+    } else {
+        first_free_slot = slots[slot].next;
+    }
+
+    // Only allocates the first time an event with this type and userdata is scheduled
+    const EventKey key{event.type, event.userdata};
+    u32& first_slot = first_slots.try_emplace(key, InvalidSlot).first->second;
+
+    Slot& new_slot = slots[slot];
+    new_slot.key = key;
+    new_slot.previous = InvalidSlot;
+    new_slot.next = first_slot;
+    if (first_slot != InvalidSlot) {
+        slots[first_slot].previous = slot;
+    }
+    first_slot = slot;
+
+    event_queue.push_back(QueuedEvent{event, slot, new_slot.generation});
+    std::push_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+}
+
+void Timing::Timer::PopEvent() {
+    ReleaseSlot(event_queue.front().slot);
+    std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+    event_queue.pop_back();
+    DropCancelledEvents();
+}
+
+void Timing::Timer::CancelEvents(const EventKey& key) {
+    const auto it = first_slots.find(key);
+    if (it == first_slots.end() || it->second == InvalidSlot) {
+        return;
+    }
+
+    for (u32 slot = it->second; slot != InvalidSlot;) {
+        const u32 next = slots[slot].next;
+        ReleaseSlot(slot);
+        ++cancelled_count;
+        slot = next;
+    }
+
+    DropCancelledEvents();
+}
+
+void Timing::Timer::ReleaseSlot(u32 slot) {
+    Slot& released = slots[slot];
+    if (released.previous != InvalidSlot) {
+        slots[released.previous].next = released.next;
+    } else {
+        first_slots.find(released.key)->second = released.next;
+    }
+    if (released.next != InvalidSlot) {
+        slots[released.next].previous = released.previous;
+    }
+
+    ++released.generation;
+    released.next = first_free_slot;
+    first_free_slot = slot;
+}
+
+void Timing::Timer::DropCancelledEvents() {
+    if (cancelled_count == 0) {
+        return;
+    }
+
+    // Rebuilding the heap is linear, so doing it once cancelled entries are the majority keeps
+    // the queue small at an amortized constant cost per cancelled event
+    if (cancelled_count > event_queue.size() / 2) {
+        event_queue.erase(std::remove_if(event_queue.begin(), event_queue.end(),
+                                         [this](const QueuedEvent& queued) {
+                                             return IsCancelled(queued);
+                                         }),
+                          event_queue.end());
+        std::make_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+        cancelled_count = 0;
+        return;
+    }
+
+    while (!event_queue.empty() && IsCancelled(event_queue.front())) {
+        std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+        event_queue.pop_back();
+        --cancelled_count;
     }
 }
 
 s64 Timing::Timer::GetMaxSliceLength() const {
-    const auto& next_event = event_queue.begin();
-    if (next_event != event_queue.end()) {
-        ASSERT(next_event->time - executed_ticks > 0);
-        return next_event->time - executed_ticks;
+    if (!event_queue.empty()) {
+        const Event& next_event = event_queue.front().event;
+        ASSERT(next_event.time - executed_ticks > 0);
+        return next_event.time - executed_ticks;
     }
     return Settings::values
         .return_this_if_the_event_queue_is_empty_in_core_timing_timer_getmaxslicelength;
@@ -180,10 +347,9 @@ void Timing::Timer::Advance() {
 
     is_timer_sane = true;
 
-    while (!event_queue.empty() && event_queue.front().time <= executed_ticks) {
-        Event evt = std::move(event_queue.front());
-        std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<>());
-        event_queue.pop_back();
+    while (!event_queue.empty() && event_queue.front().event.time <= executed_ticks) {
+        const Event evt = event_queue.front().event;
+        PopEvent();
         evt.type->callback(evt.userdata, executed_ticks - evt.time);
     }
 
@@ -196,7 +362,7 @@ void Timing::Timer::SetNextSlice(s64 max_slice_length) {
     // Still events left (scheduled in the future)
     if (!event_queue.empty()) {
         slice_length = static_cast<int>(
-            std::min<s64>(event_queue.front().time - executed_ticks, max_slice_length));
+            std::min<s64>(event_queue.front().event.time - executed_ticks, max_slice_length));
     }
 
     downcount = slice_length;
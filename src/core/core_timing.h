@@ -112,6 +112,9 @@ constexpr u64 cyclesToMs(s64 cycles) {
 
 namespace Core {
 
+class StateReader;
+class StateWriter;
+
 using TimedCallback = std::function<void(std::uintptr_t user_data, int cycles_late)>;
 
 struct TimingEventType {
@@ -157,13 +160,92 @@ public:
 
     private:
         friend class Timing;
+
+        /// Identifies the events UnscheduleEvent removes
+        struct EventKey {
+            const TimingEventType* type;
+            u64 userdata;
+
+            bool operator==(const EventKey& right) const {
+                return type == right.type && userdata == right.userdata;
+            }
+        };
+
+        struct EventKeyHash {
+            std::size_t operator()(const EventKey& key) const {
+                return std::hash<const void*>()(key.type) ^ std::hash<u64>()(key.userdata);
+            }
+        };
+
+        static constexpr u32 InvalidSlot = std::numeric_limits<u32>::max();
+
+        /**
+         * Tracks a queued event until it runs or is cancelled. Slots are reused, and their
+         * generation changes every time they're released, so queue entries of cancelled events
+         * can be told apart from live ones without searching anything.
+         */
+        struct Slot {
+            EventKey key;
+            u32 generation = 0;
+
+            /// Neighbors among the queued events with the same key while in use, the next free
+            /// slot while free
+            u32 previous = InvalidSlot;
+            u32 next = InvalidSlot;
+        };
+
+        /// An entry of the queue. It's cancelled once the generation of its slot changed.
+        struct QueuedEvent {
+            Event event;
+            u32 slot;
+            u32 generation;
+
+            bool operator>(const QueuedEvent& right) const {
+                return event > right.event;
+            }
+        };
+
+        /// Adds an event with its fifo_order already set to the queue
+        void PushEvent(const Event& event);
+
+        /// Removes the event at the front of the queue
+        void PopEvent();
+
+        /// Cancels all queued events with the given key
+        void CancelEvents(const EventKey& key);
+
+        /// Returns true if the queue entry belongs to a cancelled event
+        bool IsCancelled(const QueuedEvent& queued) const {
+            return slots[queued.slot].generation != queued.generation;
+        }
+
+        /// Unlinks a slot from the events with the same key and puts it on the free list
+        void ReleaseSlot(u32 slot);
+
+        /// Drops the cancelled events at the front of the queue, and all of them once they make up
+        /// most of it
+        void DropCancelledEvents();
+
         // The queue is a min-heap using std::make_heap/push_heap/pop_heap.
-        // We don't use std::priority_queue because we need to be able to serialize, unserialize and
-        // erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't
-        // accommodated by the standard adaptor class.
-        std::vector<Event> event_queue;
+        // We don't use std::priority_queue because we need to be able to serialize and unserialize
+        // the events regardless of the queue order, which isn't accommodated by the standard
+        // adaptor class.
+        // Events are cancelled by releasing their slot, in O(1) per event. Their entries stay in
+        // the queue until they reach its front or the queue is compacted. The front entry is never
+        // a cancelled one.
+        std::vector<QueuedEvent> event_queue;
         u64 event_fifo_id = 0;
 
+        /// Number of cancelled entries in event_queue
+        std::size_t cancelled_count = 0;
+
+        std::vector<Slot> slots;
+        u32 first_free_slot = InvalidSlot;
+
+        /// First slot of the queued events with each type and userdata. Keys are kept after their
+        /// last event is gone, so rescheduling the same event doesn't allocate.
+        std::unordered_map<EventKey, u32, EventKeyHash> first_slots;
+
         // The queue for storing the events from other threads threadsafe until they will be added
         // to the event_queue by the emu thread
         Common::MPSCQueue<Event> ts_queue;
@@ -206,6 +288,28 @@ public:
 
     std::shared_ptr<Timer> GetTimer(std::size_t cpu_id);
 
+    /// The state of a timer read back by ReadState, applied by RestoreState
+    struct SavedTimer {
+        s64 executed_ticks;
+        s64 slice_length;
+        s64 downcount;
+        u64 idled_cycles;
+        u64 event_fifo_id;
+        std::vector<Event> events;
+    };
+
+    /// Serializes the timers and their event queues. Events are identified by their type's name.
+    void SaveState(StateWriter& writer);
+
+    /**
+     * Reads the timers serialized by SaveState without changing them.
+     * @returns false if the state is truncated or doesn't match the number of timers.
+     */
+    bool ReadState(StateReader& reader, std::vector<SavedTimer>& saved_timers) const;
+
+    /// Replaces the timers and their event queues with ones read by ReadState
+    void RestoreState(const std::vector<SavedTimer>& saved_timers);
+
 private:
     // unordered_map stores each element separately as a linked list node so pointers to
     // elements remain stable regardless of rehashes/resizing.
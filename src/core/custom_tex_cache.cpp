@@ -2,15 +2,70 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include <fmt/format.h>
 #include <stb_image.h>
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
 #include "core/core.h"
 #include "core/custom_tex_cache.h"
 
 namespace Core {
 
+namespace {
+
+constexpr u32 PACK_MAGIC = 0x50544356; // VCTP
+constexpr u32 PACK_VERSION = 1;
+
+/**
+ * A pack starts with the header, followed by the textures as RGBA8 with the bottom row first, like
+ * they are uploaded to OpenGL. The index of the textures, sorted by hash, is at the end.
+ */
+struct PackHeader {
+    u32 magic;
+    u32 version;
+    u64 index_offset;
+    u64 texture_count;
+};
+
+static_assert(sizeof(PackHeader) == 24, "PackHeader is written to files");
+
+/// Decodes a PNG file to RGBA8 with the bottom row first
+bool DecodeTexture(const std::string& file, const std::string& path, CustomTexInfo& tex_info) {
+    int width;
+    int height;
+    unsigned char* image =
+        stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()),
+                              static_cast<int>(file.size()), &width, &height, nullptr, 4);
+    if (image == nullptr) {
+        LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path);
+        return false;
+    }
+    tex_info.width = static_cast<u32>(width);
+    tex_info.height = static_cast<u32>(height);
+    tex_info.tex.assign(image, image + tex_info.width * tex_info.height * 4);
+    stbi_image_free(image);
+
+    // Make sure the texture size is a power of 2
+    std::bitset<32> width_bits(tex_info.width);
+    std::bitset<32> height_bits(tex_info.height);
+    if (width_bits.count() != 1 || height_bits.count() != 1) {
+        LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2", path);
+        return false;
+    }
+
+    LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path);
+    Common::FlipRGBA8Texture(tex_info.tex, tex_info.width, tex_info.height);
+    return true;
+}
+
+} // namespace
+
 CustomTexCache::CustomTexCache() = default;
 
 CustomTexCache::~CustomTexCache() = default;
@@ -31,9 +86,10 @@ const CustomTexInfo& CustomTexCache::LookupTexture(const u64 hash) const {
     return custom_textures.at(hash);
 }
 
-void CustomTexCache::CacheTexture(const u64 hash, const std::vector<u8>& tex, const u32 width,
+void CustomTexCache::CacheTexture(const u64 hash, std::vector<u8> tex, const u32 width,
                                   const u32 height) {
-    custom_textures[hash] = {width, height, tex};
+    std::lock_guard lock(mutex);
+    custom_textures[hash] = {width, height, std::move(tex)};
 }
 
 void CustomTexCache::AddTexturePath(const u64 hash, const std::string& path,
@@ -46,13 +102,18 @@ void CustomTexCache::AddTexturePath(const u64 hash, const std::string& path,
 }
 
 void CustomTexCache::FindCustomTextures() {
-    const auto f = [this](Settings::PreloadCustomTexturesFolder folder) {
-        const std::string path = fmt::format(
-            "{}textures/{:016X}/",
-            FileUtil::GetUserPath(folder == Settings::PreloadCustomTexturesFolder::Load
-                                      ? FileUtil::UserPath::LoadDir
-                                      : FileUtil::UserPath::PreloadDir),
-            Core::System::GetInstance().Kernel().GetCurrentProcess()->codeset->program_id);
+    FindCustomTextures(
+        Core::System::GetInstance().Kernel().GetCurrentProcess()->codeset->program_id);
+}
+
+void CustomTexCache::FindCustomTextures(u64 program_id) {
+    const auto f = [this, program_id](Settings::PreloadCustomTexturesFolder folder) {
+        const std::string path =
+            fmt::format("{}textures/{:016X}/",
+                        FileUtil::GetUserPath(folder == Settings::PreloadCustomTexturesFolder::Load
+                                                  ? FileUtil::UserPath::LoadDir
+                                                  : FileUtil::UserPath::PreloadDir),
+                        program_id);
 
         if (FileUtil::Exists(path)) {
             FileUtil::FSTEntry texture_dir;
@@ -88,35 +149,232 @@ void CustomTexCache::FindCustomTextures() {
 
 void CustomTexCache::PreloadTextures(
     std::function<void(std::size_t current, std::size_t total)> callback) {
-    std::size_t current = 1;
+    std::vector<const CustomTexPathInfo*> paths;
     for (const auto& path : custom_texture_paths) {
-        if (path.second.folder == Settings::values.preload_custom_textures_folder) {
-            Core::CustomTexInfo tex_info;
-            unsigned char* image =
-                stbi_load(path.second.path.c_str(), reinterpret_cast<int*>(&tex_info.width),
-                          reinterpret_cast<int*>(&tex_info.height), nullptr, 4);
-            if (image != nullptr) {
-                tex_info.tex.resize(tex_info.width * tex_info.height * 4);
-                std::memcpy(tex_info.tex.data(), image, tex_info.tex.size());
-                free(image);
-
-                // Make sure the texture size is a power of 2
-                std::bitset<32> width_bits(tex_info.width);
-                std::bitset<32> height_bits(tex_info.height);
-                if (width_bits.count() == 1 && height_bits.count() == 1) {
-                    LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path.second.path);
-                    Common::FlipRGBA8Texture(tex_info.tex, tex_info.width, tex_info.height);
-                    CacheTexture(path.second.hash, tex_info.tex, tex_info.width, tex_info.height);
-                    callback(current++, custom_texture_paths.size());
-                } else {
-                    LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2",
-                              path.second.path);
-                }
-            } else {
-                LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path.second.path);
+        // Textures in the pack are loaded from it when they are used
+        if (path.second.folder == Settings::values.preload_custom_textures_folder &&
+            !IsTexturePacked(path.second.hash)) {
+            paths.push_back(&path.second);
+        }
+    }
+
+    std::size_t current = 1;
+    Common::GetThreadPool().ParallelFor(paths.size(), [&](std::size_t i) {
+        Core::CustomTexInfo tex_info;
+        if (LoadTexture(*paths[i], tex_info)) {
+            CacheTexture(paths[i]->hash, std::move(tex_info.tex), tex_info.width,
+                         tex_info.height);
+
+            std::lock_guard lock(mutex);
+            callback(current++, paths.size());
+        }
+    });
+}
+
+bool CustomTexCache::LoadTexture(const CustomTexPathInfo& path_info, CustomTexInfo& tex_info) {
+    std::string file;
+    if (FileUtil::ReadFileToString(false, path_info.path, file) == 0) {
+        LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path_info.path);
+        return false;
+    }
+
+    // Hashing the file is much faster than decoding it, and makes sure edited textures aren't
+    // loaded from the disk cache
+    TextureDiskCache& disk_cache = Core::System::GetInstance().TextureDiskCache();
+    const TextureDiskCacheKey key{path_info.hash, Common::ComputeHash64(file.data(), file.size()),
+                                  0, 1};
+    if (const auto cached = disk_cache.Find(key)) {
+        tex_info.width = cached->width;
+        tex_info.height = cached->height;
+        tex_info.tex.assign(cached->data, cached->data + cached->width * cached->height * 4);
+        return true;
+    }
+
+    if (!DecodeTexture(file, path_info.path, tex_info)) {
+        return false;
+    }
+    disk_cache.Add(key, tex_info.width, tex_info.height, tex_info.tex.data());
+    return true;
+}
+
+std::string CustomTexCache::GetPackPath(u64 program_id) {
+    return fmt::format("{}textures/{:016X}.pack",
+                       FileUtil::GetUserPath(FileUtil::UserPath::LoadDir), program_id);
+}
+
+bool CustomTexCache::IsTexturePacked(u64 hash) const {
+    return FindPackEntry(hash) != nullptr;
+}
+
+bool CustomTexCache::LoadPackedTexture(u64 hash, CustomTexInfo& tex_info) const {
+    const PackEntry* entry = FindPackEntry(hash);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    const u8* const data = pack_file.GetData() + entry->offset;
+    tex_info.width = entry->width;
+    tex_info.height = entry->height;
+    tex_info.tex.assign(data, data + entry->width * entry->height * 4);
+    return true;
+}
+
+const CustomTexCache::PackEntry* CustomTexCache::FindPackEntry(u64 hash) const {
+    const auto it = std::lower_bound(
+        pack_entries.begin(), pack_entries.end(), hash,
+        [](const PackEntry& entry, u64 hash) { return entry.hash < hash; });
+    if (it == pack_entries.end() || it->hash != hash) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+void CustomTexCache::OpenPack() {
+    ClosePack();
+
+    const std::string path = GetPackPath(
+        Core::System::GetInstance().Kernel().GetCurrentProcess()->codeset->program_id);
+    if (!FileUtil::Exists(path)) {
+        return;
+    }
+    if (!pack_file.Open(path)) {
+        LOG_ERROR(Render_OpenGL, "Failed to open custom texture pack {}", path);
+        return;
+    }
+
+    const u8* const data = pack_file.GetData();
+    const std::size_t size = pack_file.GetSize();
+
+    PackHeader header;
+    if (size < sizeof(header)) {
+        LOG_ERROR(Render_OpenGL, "Custom texture pack {} is invalid", path);
+        pack_file.Close();
+        return;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != PACK_MAGIC || header.version != PACK_VERSION ||
+        header.index_offset > size ||
+        header.texture_count > (size - header.index_offset) / sizeof(PackEntry)) {
+        LOG_ERROR(Render_OpenGL, "Custom texture pack {} is invalid", path);
+        pack_file.Close();
+        return;
+    }
+
+    pack_entries.resize(static_cast<std::size_t>(header.texture_count));
+    std::memcpy(pack_entries.data(), data + header.index_offset,
+                pack_entries.size() * sizeof(PackEntry));
+
+    for (const PackEntry& entry : pack_entries) {
+        if (entry.offset > header.index_offset ||
+            static_cast<u64>(entry.width) * entry.height * 4 > header.index_offset - entry.offset) {
+            LOG_ERROR(Render_OpenGL, "Custom texture pack {} is invalid", path);
+            pack_entries.clear();
+            pack_file.Close();
+            return;
+        }
+    }
+
+    // Textures edited or replaced after the pack was created are loaded from their files
+    const s64 pack_time = FileUtil::GetModificationTime(path);
+    const auto is_outdated = [this, pack_time](const PackEntry& entry) {
+        const auto it = custom_texture_paths.find(entry.hash);
+        return it != custom_texture_paths.end() &&
+               FileUtil::GetModificationTime(it->second.path) > pack_time;
+    };
+    const auto outdated = std::remove_if(pack_entries.begin(), pack_entries.end(), is_outdated);
+    if (outdated != pack_entries.end()) {
+        LOG_WARNING(Render_OpenGL,
+                    "{} textures are newer than custom texture pack {}, create it again to "
+                    "include them",
+                    pack_entries.end() - outdated, path);
+        pack_entries.erase(outdated, pack_entries.end());
+    }
+
+    LOG_INFO(Render_OpenGL, "Loaded custom texture pack with {} textures", pack_entries.size());
+}
+
+void CustomTexCache::ClosePack() {
+    pack_entries.clear();
+    pack_file.Close();
+}
+
+bool CustomTexCache::CreatePack(
+    u64 program_id, std::function<void(std::size_t current, std::size_t total)> callback) {
+    const std::string path = GetPackPath(program_id);
+    const std::string temporary_path = path + ".tmp";
+
+    // The textures in use are left alone, as the renderer may be using them on another thread.
+    // The pack is written to a temporary file first, so a failure leaves the old one intact.
+    CustomTexCache textures_to_pack;
+    textures_to_pack.FindCustomTextures(program_id);
+
+    std::vector<const CustomTexPathInfo*> paths;
+    for (const auto& path : textures_to_pack.custom_texture_paths) {
+        if (path.second.folder == Settings::PreloadCustomTexturesFolder::Load) {
+            paths.push_back(&path.second);
+        }
+    }
+
+    FileUtil::IOFile file(temporary_path, "wb");
+    PackHeader header{PACK_MAGIC, PACK_VERSION, sizeof(PackHeader), 0};
+    if (!file.IsOpen() || file.WriteObject(header) != 1) {
+        LOG_ERROR(Render_OpenGL, "Failed to create custom texture pack {}", temporary_path);
+        return false;
+    }
+
+    // Decode a few textures per thread at a time, so the whole pack doesn't have to fit in memory
+    Common::ThreadPool& thread_pool = Common::GetThreadPool();
+    const std::size_t batch_size = thread_pool.GetThreadCount() * 4;
+    std::vector<CustomTexInfo> batch(batch_size);
+    std::unique_ptr<bool[]> decoded(new bool[batch_size]);
+
+    std::vector<PackEntry> entries;
+    for (std::size_t start = 0; start < paths.size(); start += batch_size) {
+        const std::size_t count = std::min(batch_size, paths.size() - start);
+        thread_pool.ParallelFor(count, [&](std::size_t i) {
+            const CustomTexPathInfo& path_info = *paths[start + i];
+            std::string png;
+            decoded[i] = FileUtil::ReadFileToString(false, path_info.path, png) != 0 &&
+                         DecodeTexture(png, path_info.path, batch[i]);
+        });
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!decoded[i]) {
+                continue;
+            }
+            std::vector<u8>& tex = batch[i].tex;
+            entries.push_back({paths[start + i]->hash, batch[i].width, batch[i].height,
+                               header.index_offset});
+            if (file.WriteBytes(tex.data(), tex.size()) != tex.size()) {
+                LOG_ERROR(Render_OpenGL, "Failed to write custom texture pack {}",
+                          temporary_path);
+                return false;
             }
+            header.index_offset += tex.size();
+            tex = {};
         }
+
+        callback(start + count, paths.size());
     }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const PackEntry& a, const PackEntry& b) { return a.hash < b.hash; });
+    header.texture_count = entries.size();
+    if (file.WriteArray(entries.data(), entries.size()) != entries.size() ||
+        !file.Seek(0, SEEK_SET) || file.WriteObject(header) != 1 || !file.Close()) {
+        LOG_ERROR(Render_OpenGL, "Failed to write custom texture pack {}", temporary_path);
+        return false;
+    }
+
+    if ((FileUtil::Exists(path) && !FileUtil::Delete(path)) ||
+        !FileUtil::Rename(temporary_path, path)) {
+        LOG_ERROR(Render_OpenGL, "Failed to replace custom texture pack {}", path);
+        return false;
+    }
+
+    LOG_INFO(Render_OpenGL, "Created custom texture pack {} with {} textures", path,
+             entries.size());
+    return true;
 }
 
 bool CustomTexCache::CustomTextureExists(u64 hash) const {
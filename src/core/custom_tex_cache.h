@@ -5,11 +5,13 @@
 #pragma once
 
 #include <functional>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include "common/common_types.h"
+#include "common/mapped_file.h"
 #include "core/settings.h"
 
 namespace Core {
@@ -36,20 +38,60 @@ public:
     void SetTextureDumped(const u64 hash);
     bool IsTextureCached(const u64 hash) const;
     const CustomTexInfo& LookupTexture(const u64 hash) const;
-    void CacheTexture(const u64 hash, const std::vector<u8>& tex, const u32 width,
-                      const u32 height);
+    /// Can be called from any thread
+    void CacheTexture(const u64 hash, std::vector<u8> tex, const u32 width, const u32 height);
     void AddTexturePath(const u64 hash, const std::string& path,
                         const Settings::PreloadCustomTexturesFolder folder);
     void FindCustomTextures();
     void PreloadTextures(std::function<void(std::size_t current, std::size_t total)> callback);
+    /// Decodes a custom texture, or loads it from the texture disk cache
+    bool LoadTexture(const CustomTexPathInfo& path_info, CustomTexInfo& tex_info);
     bool CustomTextureExists(u64 hash) const;
     const CustomTexPathInfo& LookupTexturePathInfo(u64 hash) const;
     bool IsTexturePathMapEmpty() const;
 
+    /// Gets the path of the custom texture pack of a title
+    static std::string GetPackPath(u64 program_id);
+    bool IsTexturePacked(u64 hash) const;
+    /// Copies a texture from the memory mapped custom texture pack
+    bool LoadPackedTexture(u64 hash, CustomTexInfo& tex_info) const;
+    /**
+     * Maps the custom texture pack of the current title if it has one. Textures whose file in the
+     * load folder is newer than the pack are loaded from the file instead.
+     * Must be called after FindCustomTextures.
+     */
+    void OpenPack();
+    /// Unmaps the custom texture pack, textures are loaded from their files until it's opened again
+    void ClosePack();
+    /**
+     * Decodes the custom textures in the load folder of a title and writes them to its custom
+     * texture pack. The next time the title is started, the pack is used instead of the textures
+     * it contains. Can be called from any thread, but if the title is running, its pack must be
+     * closed with ClosePack first, as it's replaced.
+     */
+    static bool CreatePack(u64 program_id,
+                           std::function<void(std::size_t current, std::size_t total)> callback);
+
 private:
+    struct PackEntry {
+        u64 hash;
+        u32 width;
+        u32 height;
+        u64 offset;
+    };
+
+    const PackEntry* FindPackEntry(u64 hash) const;
+
+    void FindCustomTextures(u64 program_id);
+
     std::unordered_set<u64> dumped_textures;
     std::unordered_map<u64, CustomTexInfo> custom_textures;
     std::unordered_map<u64, CustomTexPathInfo> custom_texture_paths;
+
+    std::mutex mutex;
+
+    Common::MappedFile pack_file;
+    std::vector<PackEntry> pack_entries; ///< Sorted by hash
 };
 
 } // namespace Core
@@ -41,6 +41,8 @@ private:
     };
 };
 
+GraphicsContext::~GraphicsContext() = default;
+
 EmuWindow::EmuWindow() {
     touch_state = std::make_shared<TouchState>();
     Input::RegisterFactory<Input::TouchDevice>("emu_window", touch_state);
@@ -50,6 +52,10 @@ EmuWindow::~EmuWindow() {
     Input::UnregisterFactory<Input::TouchDevice>("emu_window");
 }
 
+std::unique_ptr<GraphicsContext> EmuWindow::CreateSharedContext() const {
+    return nullptr;
+}
+
 /**
  * Check if the given x/y coordinates are within the touchpad specified by the framebuffer layout
  * @param layout FramebufferLayout object describing the framebuffer size and screen positions
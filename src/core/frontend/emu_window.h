@@ -12,6 +12,18 @@
 
 namespace Frontend {
 
+/// OpenGL context that shares its objects with the one of the window, for use on another thread
+class GraphicsContext {
+public:
+    virtual ~GraphicsContext();
+
+    /// Makes the context current on the calling thread
+    virtual void MakeCurrent() = 0;
+
+    /// Releases the context from the calling thread
+    virtual void DoneCurrent() = 0;
+};
+
 /**
  * Abstraction class used to provide an interface between emulation code and the frontend
  * Design notes on the interaction between EmuWindow and the emulation core:
@@ -31,6 +43,13 @@ public:
     /// Polls window events
     virtual void PollEvents() = 0;
 
+    /**
+     * Creates a context sharing its objects with the one of the window. Must be called from the
+     * thread the window's context is current on.
+     * @returns nullptr if the frontend doesn't support shared contexts
+     */
+    virtual std::unique_ptr<GraphicsContext> CreateSharedContext() const;
+
     /**
      * Signal that a touch pressed event has occurred (e.g. mouse click pressed)
      * @param framebuffer_x Framebuffer x-coordinate that was pressed
@@ -90,6 +90,16 @@ public:
     /// Closes all handles held in this table.
     void Clear();
 
+    /// Calls `function` with each valid handle and the object it points to, in slot order.
+    template <typename Function>
+    void ForEach(Function&& function) const {
+        for (std::size_t slot = 0; slot < MAX_COUNT; ++slot) {
+            if (objects[slot] != nullptr) {
+                function(static_cast<Handle>(generations[slot] | (slot << 15)), *objects[slot]);
+            }
+        }
+    }
+
 private:
     /**
      * This is the maximum limit of handles allowed per process in CTR-OS. It can be further
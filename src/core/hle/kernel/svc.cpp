@@ -117,6 +117,36 @@ private:
     u32 GetReg(std::size_t n);
     void SetReg(std::size_t n, u32 value);
 
+    // Idle loop skipping
+
+    /// Number of polls in a row from the same address after which the rest of the slice is skipped
+    static constexpr u32 IdlePollsBeforeSkipping = 16;
+
+    /// Maximum ticks between two polls for them to count as the same idle loop. A loop that runs
+    /// longer than this between polls does other work, which skipping would starve.
+    static constexpr u64 MaxTicksBetweenIdlePolls = 1000;
+
+    /**
+     * Called when the running thread polled for something to do, found nothing, and no other
+     * thread is ready. A thread doing that over and over from the same address, with little code
+     * run in between, spins in an idle loop, so the rest of the slice is skipped to get to the
+     * next event sooner. This is a heuristic: the code between the polls may still have side
+     * effects, like writing memory another core reads, which skipping delays.
+     */
+    void OnIdlePoll();
+
+    /// Address of the last idle poll
+    u32 idle_poll_pc = 0;
+
+    /// Ticks of the running core at the last idle poll, or at the end of the slice it skipped
+    u64 idle_poll_ticks = 0;
+
+    /// Number of idle polls in a row from idle_poll_pc
+    u32 idle_polls = 0;
+
+    /// True if the SVC being handled was an idle poll
+    bool polled_idle = false;
+
     // SVC interfaces
 
     ResultCode ControlMemory(u32* out_addr, u32 addr0, u32 addr1, u32 size, u32 operation,
@@ -425,6 +455,7 @@ ResultCode SVC::WaitSynchronization1(Handle handle, s64 nano_seconds) {
 
     if (object->ShouldWait(thread)) {
         if (nano_seconds == 0) {
+            OnIdlePoll();
             return RESULT_TIMEOUT;
         }
 
@@ -508,8 +539,10 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
 
         // If a timeout value of 0 was provided, just return the Timeout error code instead of
         // suspending the thread.
-        if (nano_seconds == 0)
+        if (nano_seconds == 0) {
+            OnIdlePoll();
             return RESULT_TIMEOUT;
+        }
 
         // Put the thread to sleep
         thread->status = ThreadStatus::WaitSynchAll;
@@ -564,8 +597,10 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
 
         // If a timeout value of 0 was provided, just return the Timeout error code instead of
         // suspending the thread.
-        if (nano_seconds == 0)
+        if (nano_seconds == 0) {
+            OnIdlePoll();
             return RESULT_TIMEOUT;
+        }
 
         // Put the thread to sleep
         thread->status = ThreadStatus::WaitSynchAny;
@@ -1223,8 +1258,10 @@ void SVC::SleepThread(s64 nanoseconds) {
 
     // Don't attempt to yield execution if there are no available threads to run,
     // this way we avoid a useless reschedule to the idle thread.
-    if (nanoseconds == 0 && !thread_manager.HaveReadyThreads())
+    if (nanoseconds == 0 && !thread_manager.HaveReadyThreads()) {
+        OnIdlePoll();
         return;
+    }
 
     // Sleep current thread and check for next thread to schedule
     thread_manager.WaitCurrentThread_Sleep();
@@ -1594,7 +1631,11 @@ void SVC::CallSVC(u32 immediate) {
     const FunctionDef* info = GetSVCInfo(immediate);
     if (info) {
         if (info->func) {
+            polled_idle = false;
             (this->*(info->func))();
+            if (!polled_idle) {
+                idle_polls = 0;
+            }
         } else {
             LOG_ERROR(Kernel_SVC, "unimplemented SVC function {}(..)", info->name);
         }
@@ -1611,6 +1652,38 @@ void SVC::SetReg(std::size_t n, u32 value) {
     system.GetRunningCore().SetReg(static_cast<int>(n), value);
 }
 
+void SVC::OnIdlePoll() {
+    if (kernel.GetCurrentThreadManager().HaveReadyThreads()) {
+        return;
+    }
+
+    ARM_Dynarmic& cpu = system.GetRunningCore();
+    const u32 pc = cpu.GetPC();
+    const u64 ticks = cpu.GetTimer().GetTicks();
+    if (pc != idle_poll_pc || ticks - idle_poll_ticks > MaxTicksBetweenIdlePolls) {
+        idle_poll_pc = pc;
+        idle_polls = 0;
+    }
+    idle_poll_ticks = ticks;
+    polled_idle = true;
+
+    if (++idle_polls < IdlePollsBeforeSkipping || !Settings::values.skip_idle_loops ||
+        Settings::values.idle_loop_skipping_disabled_titles.count(
+            kernel.GetCurrentProcess()->codeset->program_id) != 0) {
+        return;
+    }
+
+    LOG_TRACE(Kernel_SVC, "Skipping idle loop at 0x{:08X}", pc);
+
+    // Ending the slice here moves the emulated time to the end of the slice, which is at most the
+    // next event
+    cpu.GetTimer().Idle();
+    system.PrepareReschedule();
+
+    // The skipped ticks don't count as time between polls
+    idle_poll_ticks = cpu.GetTimer().GetTicks();
+}
+
 SVCContext::SVCContext(Core::System& system) : impl(std::make_unique<SVC>(system)) {}
 SVCContext::~SVCContext() = default;
 
@@ -17,6 +17,7 @@
 #include "core/hw/hw.h"
 #include "core/hw/lcd.h"
 #include "core/memory.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/renderer/rasterizer.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/video_core.h"
@@ -725,6 +726,10 @@ void GSP_GPU::SetLedForceOff(Kernel::HLERequestContext& ctx) {
 }
 
 void GSP_GPU::SaveVramSysArea(Kernel::HLERequestContext& ctx) {
+    if (VideoCore::g_gpu_thread != nullptr) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+
     VideoCore::g_renderer->Rasterizer()->ClearCache();
     std::memcpy(vram.data(), system.Memory().GetPhysicalPointer(Memory::VRAM_PADDR), vram.size());
     std::memcpy(&lcd_regs, &LCD::g_regs, sizeof(lcd_regs));
@@ -735,6 +740,10 @@ void GSP_GPU::SaveVramSysArea(Kernel::HLERequestContext& ctx) {
 }
 
 void GSP_GPU::RestoreVramSysArea(Kernel::HLERequestContext& ctx) {
+    if (VideoCore::g_gpu_thread != nullptr) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+
     std::memcpy(system.Memory().GetPhysicalPointer(Memory::VRAM_PADDR), vram.data(), vram.size());
     std::memcpy(&LCD::g_regs, &lcd_regs, sizeof(lcd_regs));
     std::memcpy(&GPU::g_regs, &gpu_regs, sizeof(gpu_regs));
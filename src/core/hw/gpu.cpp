@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include <functional>
 #include <numeric>
 #include <type_traits>
 #include "common/alignment.h"
@@ -18,6 +19,7 @@
 #include "core/memory.h"
 #include "core/settings.h"
 #include "video_core/command_processor.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/renderer/rasterizer.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/utils.h"
@@ -31,6 +33,15 @@ Memory::MemorySystem* g_memory;
 /// Event ID for CoreTiming
 static Core::TimingEventType* vblank_event;
 
+/// Event ID for delivering the results of GPU thread work
+static Core::TimingEventType* gpu_thread_event;
+
+/// Frames skipped since the last presented frame in turbo mode
+static u32 frames_since_present;
+
+/// Emulated time the GPU thread gets to run work before the CPU thread waits for it
+constexpr s64 gpu_thread_latency_ticks = usToCycles(250);
+
 template <typename T>
 inline void Read(T& var, const u32 raw_addr) {
     u32 addr = raw_addr - HW::VADDR_GPU;
@@ -68,6 +79,27 @@ static Common::Vec4<u8> DecodePixel(Regs::PixelFormat input_format, const u8* sr
     }
 }
 
+/// Signals a GSP interrupt, deferring it to the CPU thread when called on the GPU thread
+static void SignalGPUInterrupt(Service::GSP::InterruptId interrupt_id) {
+    if (VideoCore::g_gpu_thread != nullptr && VideoCore::g_gpu_thread->IsGPUThread()) {
+        VideoCore::g_gpu_thread->DeferInterrupt(interrupt_id);
+    } else {
+        Service::GSP::SignalInterrupt(interrupt_id);
+    }
+}
+
+/// Runs work on the GPU thread if it's enabled, otherwise right away
+static void RunGPUWork(std::function<void()> work) {
+    if (VideoCore::g_gpu_thread == nullptr) {
+        work();
+        return;
+    }
+
+    const u64 fence = VideoCore::g_gpu_thread->Push(std::move(work));
+    Core::System::GetInstance().CoreTiming().ScheduleEvent(gpu_thread_latency_ticks,
+                                                           gpu_thread_event, fence);
+}
+
 static void MemoryFill(const Regs::MemoryFillConfig& config) {
     const PAddr start_addr = config.GetStartAddress();
     const PAddr end_addr = config.GetEndAddress();
@@ -404,19 +436,21 @@ inline void Write(u32 addr, const T data) {
         auto& config = g_regs.memory_fill_config[is_second_filler];
 
         if (config.trigger) {
-            MemoryFill(config);
-            LOG_TRACE(HW_GPU, "MemoryFill from {:#010X} to {:#010X}", config.GetStartAddress(),
-                      config.GetEndAddress());
-
-            // It seems that it won't signal interrupt if "address_start" is zero.
-            // TODO: hwtest this
-            if (config.GetStartAddress() != 0) {
-                if (!is_second_filler) {
-                    Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC0);
-                } else {
-                    Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC1);
+            RunGPUWork([config = config, is_second_filler] {
+                MemoryFill(config);
+                LOG_TRACE(HW_GPU, "MemoryFill from {:#010X} to {:#010X}",
+                          config.GetStartAddress(), config.GetEndAddress());
+
+                // It seems that it won't signal interrupt if "address_start" is zero.
+                // TODO: hwtest this
+                if (config.GetStartAddress() != 0) {
+                    if (!is_second_filler) {
+                        SignalGPUInterrupt(Service::GSP::InterruptId::PSC0);
+                    } else {
+                        SignalGPUInterrupt(Service::GSP::InterruptId::PSC1);
+                    }
                 }
-            }
+            });
 
             // Reset "trigger" flag and set the "finish" flag
             // NOTE: This was confirmed to happen on hardware even if "address_start" is zero.
@@ -429,28 +463,33 @@ inline void Write(u32 addr, const T data) {
     case GPU_REG_INDEX(display_transfer_config.trigger): {
         const auto& config = g_regs.display_transfer_config;
         if (config.trigger & 1) {
-            if (config.is_texture_copy) {
-                TextureCopy(config);
-                LOG_TRACE(HW_GPU,
-                          "TextureCopy: {:#X} bytes from {:#010X}({}+{})-> "
-                          "{:#010X}({}+{}), flags {:#010X}",
-                          config.texture_copy.size, config.GetPhysicalInputAddress(),
-                          config.texture_copy.input_width * 16, config.texture_copy.input_gap * 16,
-                          config.GetPhysicalOutputAddress(), config.texture_copy.output_width * 16,
-                          config.texture_copy.output_gap * 16, config.flags);
-            } else {
-                DisplayTransfer(config);
-                LOG_TRACE(HW_GPU,
-                          "DisplayTransfer: {:#010X}({}x{})-> "
-                          "{:#010X}({}x{}), dst format {:x}, flags {:#010X}",
-                          config.GetPhysicalInputAddress(), config.input_width.Value(),
-                          config.input_height.Value(), config.GetPhysicalOutputAddress(),
-                          config.output_width.Value(), config.output_height.Value(),
-                          static_cast<u32>(config.output_format.Value()), config.flags);
-            }
+            RunGPUWork([config = config] {
+                if (config.is_texture_copy) {
+                    TextureCopy(config);
+                    LOG_TRACE(HW_GPU,
+                              "TextureCopy: {:#X} bytes from {:#010X}({}+{})-> "
+                              "{:#010X}({}+{}), flags {:#010X}",
+                              config.texture_copy.size, config.GetPhysicalInputAddress(),
+                              config.texture_copy.input_width * 16,
+                              config.texture_copy.input_gap * 16,
+                              config.GetPhysicalOutputAddress(),
+                              config.texture_copy.output_width * 16,
+                              config.texture_copy.output_gap * 16, config.flags);
+                } else {
+                    DisplayTransfer(config);
+                    LOG_TRACE(HW_GPU,
+                              "DisplayTransfer: {:#010X}({}x{})-> "
+                              "{:#010X}({}x{}), dst format {:x}, flags {:#010X}",
+                              config.GetPhysicalInputAddress(), config.input_width.Value(),
+                              config.input_height.Value(), config.GetPhysicalOutputAddress(),
+                              config.output_width.Value(), config.output_height.Value(),
+                              static_cast<u32>(config.output_format.Value()), config.flags);
+                }
+
+                SignalGPUInterrupt(Service::GSP::InterruptId::PPF);
+            });
 
             g_regs.display_transfer_config.trigger = 0;
-            Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PPF);
         }
         break;
     }
@@ -460,7 +499,9 @@ inline void Write(u32 addr, const T data) {
         const auto& config = g_regs.command_processor_config;
         if (config.trigger & 1) {
             u32* buffer = (u32*)g_memory->GetPhysicalPointer(config.GetPhysicalAddress());
-            Pica::CommandProcessor::ProcessCommandList(buffer, config.size);
+            RunGPUWork([buffer, size = config.size] {
+                Pica::CommandProcessor::ProcessCommandList(buffer, size);
+            });
             g_regs.command_processor_config.trigger = 0;
         }
         break;
@@ -485,7 +526,19 @@ template void Write<u8>(u32 addr, const u8 data);
 
 /// Update hardware
 static void VBlankCallback(std::uintptr_t user_data, s64 cycles_late) {
-    VideoCore::g_renderer->SwapBuffers();
+    // The screens are loaded from emulated memory
+    if (VideoCore::g_gpu_thread != nullptr) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+
+    // In turbo mode, only every Nth frame is presented
+    if (Settings::values.turbo_mode && !VideoCore::g_renderer_screenshot_requested &&
+        ++frames_since_present < Settings::values.turbo_mode_present_interval) {
+        VideoCore::g_renderer->SkipFrame();
+    } else {
+        frames_since_present = 0;
+        VideoCore::g_renderer->SwapBuffers();
+    }
 
     // Signal to GSP that GPU interrupt has occurred
     // TODO(yuriks): hwtest to determine if PDC0 is for the Top screen and PDC1 for the Sub
@@ -499,6 +552,16 @@ static void VBlankCallback(std::uintptr_t user_data, s64 cycles_late) {
     Core::System::GetInstance().CoreTiming().ScheduleEvent(frame_ticks - cycles_late, vblank_event);
 }
 
+/// Delivers the results of GPU thread work once emulation reaches the time it's done
+static void GPUThreadCallback(std::uintptr_t user_data, s64 cycles_late) {
+    if (VideoCore::g_gpu_thread == nullptr) {
+        return;
+    }
+
+    VideoCore::g_gpu_thread->WaitForFence(user_data);
+    VideoCore::g_gpu_thread->RunDeferred(user_data);
+}
+
 /// Initialize hardware
 void Init(Memory::MemorySystem& memory) {
     g_memory = &memory;
@@ -533,6 +596,8 @@ void Init(Memory::MemorySystem& memory) {
     Core::Timing& timing = Core::System::GetInstance().CoreTiming();
     vblank_event = timing.RegisterEvent("GPU::VBlankCallback", VBlankCallback);
     timing.ScheduleEvent(frame_ticks, vblank_event);
+    gpu_thread_event = timing.RegisterEvent("GPU::GPUThreadCallback", GPUThreadCallback);
+    frames_since_present = 0;
 }
 
 } // namespace GPU
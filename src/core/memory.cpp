@@ -16,6 +16,7 @@
 #include "core/hle/kernel/process.h"
 #include "core/hle/lock.h"
 #include "core/memory.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/renderer/rasterizer.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/video_core.h"
@@ -381,11 +382,23 @@ void MemorySystem::RasterizerMarkRegionCached(PAddr start, u32 size, bool cached
     }
 }
 
+/**
+ * Waits for the GPU thread before the CPU thread reads memory the GPU may write or writes memory
+ * queued GPU work may read. Once it's idle the rasterizer can be used from the CPU thread.
+ */
+static void WaitForGPUThread() {
+    if (VideoCore::g_gpu_thread != nullptr && !VideoCore::g_gpu_thread->IsGPUThread()) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+}
+
 void RasterizerFlushRegion(PAddr start, u32 size) {
     if (VideoCore::g_renderer == nullptr) {
         return;
     }
 
+    WaitForGPUThread();
+
     VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size);
 }
 
@@ -394,6 +407,8 @@ void RasterizerInvalidateRegion(PAddr start, u32 size) {
         return;
     }
 
+    WaitForGPUThread();
+
     VideoCore::g_renderer->Rasterizer()->InvalidateRegion(start, size);
 }
 
@@ -404,6 +419,7 @@ void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
         return;
     }
 
+    WaitForGPUThread();
     VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
 }
 
@@ -414,6 +430,8 @@ void RasterizerFlushVirtualRegion(VAddr start, u32 size, FlushMode mode) {
         return;
     }
 
+    WaitForGPUThread();
+
     VAddr end = start + size;
 
     auto CheckRegion = [&](VAddr region_start, VAddr region_end, PAddr paddr_region_start) {
@@ -13,6 +13,7 @@
 #include "common/fastmem_mapper.h"
 
 class ARM_Dynarmic;
+class DynarmicUserCallbacks;
 
 namespace AudioCore {
 class DspInterface;
@@ -61,6 +62,7 @@ enum class PageType {
 class PageTable final {
 private:
     friend class ::ARM_Dynarmic;
+    friend class ::DynarmicUserCallbacks;
     friend class ::Common::FastmemMapper;
     friend class ::Memory::MemorySystem;
 
@@ -301,13 +303,6 @@ public:
 
     void SetDSP(AudioCore::DspInterface& dsp);
 
-private:
-    template <typename T>
-    T Read(const VAddr vaddr);
-
-    template <typename T>
-    void Write(const VAddr vaddr, const T data);
-
     /**
      * Gets the pointer for virtual memory where the page is marked as RasterizerCachedMemory.
      * This is used to access the memory where the page pointer is nullptr due to rasterizer cache.
@@ -316,6 +311,13 @@ private:
      */
     u8* GetPointerForRasterizerCache(VAddr addr);
 
+private:
+    template <typename T>
+    T Read(const VAddr vaddr);
+
+    template <typename T>
+    void Write(const VAddr vaddr, const T data);
+
     void MapPages(PageTable& page_table, u32 base, u32 size, u8* memory, PageType type);
 
     class Impl;
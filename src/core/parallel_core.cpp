@@ -0,0 +1,104 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/assert.h"
+#include "core/arm/arm_dynarmic.h"
+#include "core/parallel_core.h"
+
+namespace Core {
+
+ParallelCore::ParallelCore(ARM_Dynarmic& core) : core(core), thread([this] { ThreadLoop(); }) {}
+
+ParallelCore::~ParallelCore() {
+    {
+        std::lock_guard lock(mutex);
+        ASSERT(!running);
+        stop = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void ParallelCore::StartSlice() {
+    {
+        std::lock_guard lock(mutex);
+        ASSERT(!running);
+        running = true;
+    }
+    cv.notify_all();
+}
+
+void ParallelCore::FinishSlice() {
+    std::unique_lock lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this] { return request != nullptr || !running; });
+        if (request == nullptr) {
+            break;
+        }
+
+        // The core waits for the function, so nothing else can hand one over meanwhile
+        lock.unlock();
+        (*request)();
+        lock.lock();
+
+        request = nullptr;
+        cv.notify_all();
+    }
+
+    for (const auto& [start_address, length] : pending_invalidations) {
+        core.InvalidateCacheRange(start_address, length);
+    }
+    pending_invalidations.clear();
+
+    // The core is stopped, so nothing is added meanwhile
+    lock.unlock();
+    for (const std::function<void()>& function : pending_functions) {
+        function();
+    }
+    pending_functions.clear();
+}
+
+void ParallelCore::RunOnEmulationThread(const std::function<void()>& function) {
+    DEBUG_ASSERT(IsCoreThread());
+
+    std::unique_lock lock(mutex);
+    request = &function;
+    cv.notify_all();
+    cv.wait(lock, [this] { return request == nullptr; });
+}
+
+void ParallelCore::RunAfterSlice(std::function<void()> function) {
+    DEBUG_ASSERT(IsCoreThread());
+
+    std::lock_guard lock(mutex);
+    pending_functions.push_back(std::move(function));
+}
+
+void ParallelCore::InvalidateCacheRange(u32 start_address, std::size_t length) {
+    std::lock_guard lock(mutex);
+    if (running) {
+        pending_invalidations.emplace_back(start_address, length);
+    } else {
+        core.InvalidateCacheRange(start_address, length);
+    }
+}
+
+void ParallelCore::ThreadLoop() {
+    std::unique_lock lock(mutex);
+    for (;;) {
+        cv.wait(lock, [this] { return running || stop; });
+        if (stop) {
+            return;
+        }
+
+        lock.unlock();
+        core.Run();
+        lock.lock();
+
+        running = false;
+        cv.notify_all();
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,86 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+
+class ARM_Dynarmic;
+
+namespace Core {
+
+/**
+ * Runs the slices of a CPU core on a host thread of its own, while the emulation thread runs the
+ * other core. Only guest code runs on that thread: SVCs and stores to memory the rasterizer caches
+ * are handed over to the emulation thread, so the kernel, the services and the video core stay
+ * single threaded. The emulation thread does that work once its own slice is done and it waits
+ * for this one, which bounds the skew between the cores to a slice. Loads and exclusive stores may
+ * be made while the exclusive monitor is held, so they can't wait for the emulation thread. The
+ * pages they touch are flushed and invalidated after the slice instead.
+ */
+class ParallelCore : NonCopyable {
+public:
+    explicit ParallelCore(ARM_Dynarmic& core);
+    ~ParallelCore();
+
+    ARM_Dynarmic& GetCore() {
+        return core;
+    }
+
+    /// Returns true if called from the thread of the core
+    bool IsCoreThread() const {
+        return std::this_thread::get_id() == thread.get_id();
+    }
+
+    /// Starts running a slice of the core. The timer of the core must be set up for the slice.
+    void StartSlice();
+
+    /// Runs the functions handed over by the core until its slice ends
+    void FinishSlice();
+
+    /**
+     * Runs a function on the emulation thread and waits for it to return. Must be called from the
+     * thread of the core.
+     */
+    void RunOnEmulationThread(const std::function<void()>& function);
+
+    /**
+     * Queues a function to run on the emulation thread once the slice of the core ends, without
+     * waiting for it. Must be called from the thread of the core.
+     */
+    void RunAfterSlice(std::function<void()> function);
+
+    /// Invalidates cached code of the core, after the slice if the core is running
+    void InvalidateCacheRange(u32 start_address, std::size_t length);
+
+private:
+    void ThreadLoop();
+
+    ARM_Dynarmic& core;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool running = false;
+    bool stop = false;
+
+    /// Function handed over by the core, waiting to be run on the emulation thread
+    const std::function<void()>* request = nullptr;
+
+    /// Ranges to invalidate once the core stops
+    std::vector<std::pair<u32, std::size_t>> pending_invalidations;
+
+    /// Functions handed over by the core to run once it stops
+    std::vector<std::function<void()>> pending_functions;
+
+    std::thread thread;
+};
+
+} // namespace Core
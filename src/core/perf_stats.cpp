@@ -26,6 +26,14 @@ void PerfStats::EndSystemFrame() {
 
     previous_frame_length = frame_end - previous_frame_end;
     previous_frame_end = frame_end;
+
+    ++frames_since_fps_measurement_start;
+    const std::chrono::duration<double> measurement_length = frame_end - fps_measurement_start;
+    if (measurement_length >= 1s) {
+        emulated_fps = frames_since_fps_measurement_start / measurement_length.count();
+        frames_since_fps_measurement_start = 0;
+        fps_measurement_start = frame_end;
+    }
 }
 
 double PerfStats::GetLastFrameTimeScale() const {
@@ -39,14 +47,23 @@ double PerfStats::GetLastFrameTimeScale() const {
            FRAME_LENGTH;
 }
 
+double PerfStats::GetEmulatedFps() const {
+    std::lock_guard<std::mutex> lock(object_mutex);
+    return emulated_fps;
+}
+
 void FrameLimiter::DoFrameLimiting(std::chrono::microseconds current_system_time_us) {
+    if (Settings::values.enable_rewind) {
+        ++frames_since_rewind_capture;
+    }
+
     if (frame_advancing_enabled) {
         // Frame advancing is enabled: wait on event instead of doing framelimiting
         frame_advance_event.Wait();
         return;
     }
 
-    if (!Settings::values.limit_speed) {
+    if (!Settings::values.limit_speed || Settings::values.turbo_mode) {
         return;
     }
 
@@ -104,4 +121,14 @@ bool FrameLimiter::FrameAdvancingEnabled() const {
     return frame_advancing_enabled;
 }
 
+bool FrameLimiter::RewindCaptureDue() {
+    if (!Settings::values.enable_rewind ||
+        frames_since_rewind_capture < std::max<u32>(Settings::values.rewind_interval, 1)) {
+        return false;
+    }
+
+    frames_since_rewind_capture = 0;
+    return true;
+}
+
 } // namespace Core
@@ -19,6 +19,9 @@ public:
     void EndSystemFrame();
     double GetLastFrameTimeScale() const;
 
+    /// Returns the number of emulated frames per wall-clock second, measured over the last second
+    double GetEmulatedFps() const;
+
 private:
     mutable std::mutex object_mutex;
 
@@ -29,6 +32,16 @@ private:
     /// Total visible duration (including frame-limiting, etc.) of the previous system frame
     std::chrono::high_resolution_clock::duration previous_frame_length =
         std::chrono::high_resolution_clock::duration::zero();
+
+    /// Point when the current emulated frame rate measurement started
+    std::chrono::high_resolution_clock::time_point fps_measurement_start =
+        std::chrono::high_resolution_clock::now();
+
+    /// System frames ended since fps_measurement_start
+    u32 frames_since_fps_measurement_start = 0;
+
+    /// Emulated frame rate of the last measurement
+    double emulated_fps = 0.0;
 };
 
 class FrameLimiter {
@@ -39,6 +52,9 @@ public:
     void AdvanceFrame();
     bool FrameAdvancingEnabled() const;
 
+    /// Returns true once every Settings::values.rewind_interval frames if rewinding is enabled
+    bool RewindCaptureDue();
+
 private:
     /// Emulated system time (in microseconds) at the last limiter invocation
     std::chrono::microseconds previous_system_time_us{0};
@@ -55,6 +71,9 @@ private:
 
     /// Event to advance the frame when frame advancing is enabled
     Common::Event frame_advance_event;
+
+    /// Frames since the last rewind capture
+    std::atomic<u32> frames_since_rewind_capture{0};
 };
 
 } // namespace Core
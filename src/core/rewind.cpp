@@ -0,0 +1,267 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "audio_core/dsp_interface.h"
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/thread_pool.h"
+#include "core/core.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/memory.h"
+#include "core/memory.h"
+#include "core/rewind.h"
+#include "core/savestate.h"
+
+namespace Core {
+
+namespace {
+
+constexpr std::size_t PAGE_SIZE = Memory::PAGE_SIZE;
+constexpr std::size_t FCRAM_PAGES = Memory::FCRAM_SIZE / PAGE_SIZE;
+constexpr std::size_t VRAM_PAGES = Memory::VRAM_SIZE / PAGE_SIZE;
+constexpr std::size_t DSP_RAM_PAGES = Memory::DSP_RAM_SIZE / PAGE_SIZE;
+constexpr std::size_t TOTAL_PAGES = FCRAM_PAGES + VRAM_PAGES + DSP_RAM_PAGES;
+
+/// Number of pages a thread compares at a time during a capture
+constexpr std::size_t PAGES_PER_CHUNK = 256;
+
+template <typename T>
+void Append(std::vector<u8>& out, T value) {
+    const std::size_t offset = out.size();
+    out.resize(offset + sizeof(T));
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T Get(const u8*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+/**
+ * Calls `function` with the index and host pointer of each page of emulated memory that's part of
+ * the state: the allocated pages of FCRAM, then all of VRAM and DSP RAM.
+ */
+template <typename Function>
+void ForEachUsedPage(System& system, Function&& function) {
+    Memory::MemorySystem& memory = system.Memory();
+
+    for (const Kernel::MemoryRegionInfo& region : system.Kernel().memory_regions) {
+        Kernel::MemoryRegionInfo::IntervalSet used;
+        used += Kernel::MemoryRegionInfo::Interval(region.base, region.base + region.size);
+        used -= region.free_blocks;
+
+        for (const auto& interval : used) {
+            const std::size_t first = interval.lower() / PAGE_SIZE;
+            const std::size_t last = (interval.upper() + PAGE_SIZE - 1) / PAGE_SIZE;
+            for (std::size_t page = first; page < last; ++page) {
+                function(page, memory.GetFCRAMPointer(static_cast<u32>(page * PAGE_SIZE)));
+            }
+        }
+    }
+
+    u8* const vram = memory.GetPhysicalPointer(Memory::VRAM_PADDR);
+    for (std::size_t i = 0; i < VRAM_PAGES; ++i) {
+        function(FCRAM_PAGES + i, vram + i * PAGE_SIZE);
+    }
+
+    u8* const dsp_ram = system.DSP().GetDspMemory().data();
+    for (std::size_t i = 0; i < DSP_RAM_PAGES; ++i) {
+        function(FCRAM_PAGES + VRAM_PAGES + i, dsp_ram + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * Encodes the XOR of `older` and `newer` as (u16 zero count, u16 literal count, literal bytes)
+ * runs covering `size` bytes exactly.
+ */
+void EncodeRuns(const u8* older, const u8* newer, std::size_t size, std::vector<u8>& out) {
+    std::size_t i = 0;
+    while (i < size) {
+        const std::size_t zeroes_start = i;
+        while (i < size && i - zeroes_start < 0xFFFF && older[i] == newer[i]) {
+            ++i;
+        }
+        const std::size_t literals_start = i;
+        while (i < size && i - literals_start < 0xFFFF && older[i] != newer[i]) {
+            ++i;
+        }
+
+        Append(out, static_cast<u16>(literals_start - zeroes_start));
+        Append(out, static_cast<u16>(i - literals_start));
+        for (std::size_t j = literals_start; j < i; ++j) {
+            out.push_back(older[j] ^ newer[j]);
+        }
+    }
+}
+
+/// XORs the runs encoded by EncodeRuns into `data`. Returns a pointer past the runs.
+const u8* ApplyRuns(const u8* in, u8* data, std::size_t size) {
+    std::size_t i = 0;
+    while (i < size) {
+        i += Get<u16>(in);
+        const u16 literals = Get<u16>(in);
+        for (u16 j = 0; j < literals; ++j) {
+            data[i++] ^= *in++;
+        }
+    }
+    return in;
+}
+
+} // namespace
+
+void RewindBuffer::Capture(System& system, std::size_t capacity) {
+    SaveStateWithoutMemory(system, scratch);
+
+    if (reference == nullptr) {
+        // Left uninitialized, so only the pages that get tracked are backed by host memory
+        reference.reset(new u8[TOTAL_PAGES * PAGE_SIZE]);
+        tracked_pages.assign(TOTAL_PAGES, false);
+    }
+
+    const bool has_previous = !current.empty();
+    Delta delta;
+
+    compared_pages.clear();
+    ForEachUsedPage(system, [&](std::size_t page, const u8* live) {
+        if (!tracked_pages[page]) {
+            // Newly allocated, so its contents don't matter to older captures
+            tracked_pages[page] = true;
+            ++tracked_page_count;
+            std::memcpy(reference.get() + page * PAGE_SIZE, live, PAGE_SIZE);
+            return;
+        }
+        compared_pages.emplace_back(page, live);
+    });
+
+    // Comparing the pages is bound by memory bandwidth, which one thread doesn't saturate
+    const std::size_t num_chunks =
+        (compared_pages.size() + PAGES_PER_CHUNK - 1) / PAGES_PER_CHUNK;
+    if (chunk_runs.size() < num_chunks) {
+        chunk_runs.resize(num_chunks);
+    }
+    Common::GetThreadPool().ParallelFor(num_chunks, [&](std::size_t chunk) {
+        std::vector<u8>& runs = chunk_runs[chunk];
+        runs.clear();
+
+        const std::size_t end = std::min(compared_pages.size(), (chunk + 1) * PAGES_PER_CHUNK);
+        for (std::size_t i = chunk * PAGES_PER_CHUNK; i < end; ++i) {
+            const auto [page, live] = compared_pages[i];
+            u8* const saved = reference.get() + page * PAGE_SIZE;
+            if (std::memcmp(saved, live, PAGE_SIZE) == 0) {
+                continue;
+            }
+
+            if (has_previous) {
+                Append(runs, static_cast<u32>(page));
+                EncodeRuns(saved, live, PAGE_SIZE, runs);
+            }
+            std::memcpy(saved, live, PAGE_SIZE);
+        }
+    });
+
+    if (has_previous) {
+        for (std::size_t chunk = 0; chunk < num_chunks; ++chunk) {
+            delta.memory.insert(delta.memory.end(), chunk_runs[chunk].begin(),
+                                chunk_runs[chunk].end());
+        }
+
+        if (current.size() == scratch.size()) {
+            EncodeRuns(current.data(), scratch.data(), current.size(), delta.state);
+        } else {
+            delta.state = current;
+            delta.state_is_copy = true;
+        }
+
+        delta.memory.shrink_to_fit();
+        delta.state.shrink_to_fit();
+        delta_bytes += delta.GetSize();
+        deltas.push_back(std::move(delta));
+    }
+
+    while (!deltas.empty() && deltas.size() >= std::max<std::size_t>(capacity, 1)) {
+        delta_bytes -= deltas.front().GetSize();
+        deltas.pop_front();
+    }
+
+    std::swap(current, scratch);
+}
+
+bool RewindBuffer::Rewind(System& system, std::size_t steps) {
+    if (current.empty() || steps > deltas.size()) {
+        LOG_ERROR(Core, "Can't rewind {} captures, {} available", steps, GetCaptureCount());
+        return false;
+    }
+
+    // The older state is rebuilt in scratch, so the buffer is left as it is if it's rejected
+    scratch = current;
+    for (std::size_t i = 0; i < steps; ++i) {
+        const Delta& delta = deltas[deltas.size() - 1 - i];
+        if (delta.state_is_copy) {
+            scratch = delta.state;
+        } else {
+            ApplyRuns(delta.state.data(), scratch.data(), scratch.size());
+        }
+    }
+
+    // The reference is only rewound once the state has been validated, loading can't fail after
+    const bool loaded = LoadStateWithoutMemory(system, scratch, [this, &system, steps] {
+        for (std::size_t i = 0; i < steps; ++i) {
+            const Delta& delta = deltas[deltas.size() - 1 - i];
+            const u8* in = delta.memory.data();
+            const u8* const end = delta.memory.data() + delta.memory.size();
+            while (in < end) {
+                const std::size_t page = Get<u32>(in);
+                in = ApplyRuns(in, reference.get() + page * PAGE_SIZE, PAGE_SIZE);
+            }
+        }
+        RestoreMemory(system);
+    });
+    if (!loaded) {
+        return false;
+    }
+
+    std::swap(current, scratch);
+    for (std::size_t i = 0; i < steps; ++i) {
+        delta_bytes -= deltas.back().GetSize();
+        deltas.pop_back();
+    }
+    return true;
+}
+
+void RewindBuffer::RestoreMemory(System& system) const {
+    ForEachUsedPage(system, [this](std::size_t page, u8* live) {
+        // The FCRAM allocations were restored from the state, so these are the pages it used,
+        // which were tracked when it was captured
+        DEBUG_ASSERT(tracked_pages[page]);
+        std::memcpy(live, reference.get() + page * PAGE_SIZE, PAGE_SIZE);
+    });
+}
+
+void RewindBuffer::Clear() {
+    current = {};
+    scratch = {};
+    compared_pages = {};
+    chunk_runs = {};
+    reference.reset();
+    tracked_pages = {};
+    tracked_page_count = 0;
+    deltas.clear();
+    delta_bytes = 0;
+}
+
+std::size_t RewindBuffer::GetCaptureCount() const {
+    return current.empty() ? 0 : deltas.size() + 1;
+}
+
+std::size_t RewindBuffer::GetMemoryUsage() const {
+    return current.capacity() + scratch.capacity() + tracked_page_count * PAGE_SIZE +
+           delta_bytes;
+}
+
+} // namespace Core
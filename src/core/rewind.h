@@ -0,0 +1,90 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+
+class System;
+
+/**
+ * Ring of recent emulated hardware states.
+ * Emulated memory is tracked page by page: a reference copy of every page used so far holds the
+ * newest capture, and each capture compares the used pages against it, storing the ones that
+ * changed as XORed and run-length encoded reverse deltas before updating the reference in place.
+ * The rest of the state is small and stored as a byte-wise reverse delta.
+ * There's no tracking of which pages were written, as the JIT writes to emulated memory directly,
+ * so every capture reads all of the used memory twice. The comparison is spread across threads.
+ */
+class RewindBuffer {
+public:
+    /// Saves the current state, dropping the oldest capture if the buffer is full
+    void Capture(System& system, std::size_t capacity);
+
+    /**
+     * Restores an earlier capture. Captures newer than the restored one are dropped.
+     * @param steps Number of captures to go back, 0 being the newest capture.
+     * @returns true on success. The buffer and the system are left unchanged on failure.
+     */
+    bool Rewind(System& system, std::size_t steps);
+
+    /// Drops all captures
+    void Clear();
+
+    /// Gets the number of captures that can be restored
+    std::size_t GetCaptureCount() const;
+
+    /// Gets the number of bytes used by the captures
+    std::size_t GetMemoryUsage() const;
+
+private:
+    /// Turns a capture into the one before it
+    struct Delta {
+        /// Changed memory pages, as runs of the XOR of both versions of each page
+        std::vector<u8> memory;
+
+        /// The older state without memory, XOR encoded if both have the same size, else a copy
+        std::vector<u8> state;
+        bool state_is_copy = false;
+
+        std::size_t GetSize() const {
+            return memory.capacity() + state.capacity();
+        }
+    };
+
+    /// Copies the pages of the reference used by the current state back into emulated memory
+    void RestoreMemory(System& system) const;
+
+    /// Newest capture without emulated memory
+    std::vector<u8> current;
+
+    /// Buffer the next capture is written to, kept to avoid reallocating it every capture
+    std::vector<u8> scratch;
+
+    /// Index and host pointer of the pages compared by a capture, kept like scratch
+    std::vector<std::pair<std::size_t, const u8*>> compared_pages;
+
+    /// Changed pages found by each thread during a capture, kept like scratch
+    std::vector<std::vector<u8>> chunk_runs;
+
+    /// Emulated memory of the newest capture, indexed like the pages of FCRAM, VRAM and DSP RAM
+    /// laid out one after another. Only the pages marked in `tracked_pages` are valid.
+    std::unique_ptr<u8[]> reference;
+    std::vector<bool> tracked_pages;
+    std::size_t tracked_page_count = 0;
+
+    /// Deltas that turn a capture into the one before it, newest at the back
+    std::deque<Delta> deltas;
+
+    std::size_t delta_bytes = 0;
+};
+
+} // namespace Core
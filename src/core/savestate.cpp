@@ -0,0 +1,552 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include "audio_core/dsp_interface.h"
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/service/gsp/gsp.h"
+#include "core/hw/gpu.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/savestate.h"
+#include "video_core/gpu_thread.h"
+#include "video_core/pica.h"
+#include "video_core/renderer/rasterizer.h"
+#include "video_core/renderer/renderer.h"
+#include "video_core/video_core.h"
+
+namespace Core {
+
+namespace {
+
+constexpr u32 STATE_MAGIC = 0x53535656; // "VVSS"
+constexpr u32 STATE_VERSION = 3;
+
+struct StateHeader {
+    u32 magic;
+    u32 version;
+    u64 program_id;
+    u32 num_cores;
+    u32 flags;
+};
+static_assert(sizeof(StateHeader) == 24, "StateHeader has incorrect size");
+
+/// Set in StateHeader::flags when FCRAM, VRAM and DSP RAM were left out of the state
+constexpr u32 STATE_FLAG_NO_MEMORY = 1;
+
+/**
+ * Describes what a save state depends on but can't recreate: the threads that exist and the
+ * memory mappings of the current process. The state contains the registers of those threads and
+ * the memory behind those mappings, so it can only be loaded while they still exist. Everything
+ * described stays the same across boots of the same title. What the threads are doing, like their
+ * status, priority and wait objects, is left out, so states taken at any point of the same scene
+ * are compatible.
+ */
+std::vector<u32> DescribeLayout(System& system) {
+    Kernel::KernelSystem& kernel = system.Kernel();
+    std::vector<u32> layout;
+
+    for (u32 i = 0; i < system.GetNumCores(); ++i) {
+        const std::vector<std::shared_ptr<Kernel::Thread>>& threads =
+            kernel.GetThreadManager(i).GetThreadList();
+        layout.push_back(static_cast<u32>(threads.size()));
+        for (const std::shared_ptr<Kernel::Thread>& thread : threads) {
+            layout.push_back(thread->thread_id);
+            layout.push_back(thread->entry_point);
+            layout.push_back(thread->tls_address);
+            layout.push_back(static_cast<u32>(thread->processor_id));
+        }
+    }
+
+    const u8* const fcram = system.Memory().GetFCRAMPointer(0);
+    const std::shared_ptr<Kernel::Process> process = kernel.GetCurrentProcess();
+    layout.push_back(static_cast<u32>(process->vm_manager.vma_map.size()));
+    for (const auto& [base, vma] : process->vm_manager.vma_map) {
+        layout.push_back(vma.base);
+        layout.push_back(vma.size);
+        layout.push_back(static_cast<u32>(vma.type));
+        layout.push_back(static_cast<u32>(vma.permissions));
+        layout.push_back(static_cast<u32>(vma.meminfo_state));
+
+        // Memory outside of FCRAM is allocated by the host and moves between boots
+        const bool in_fcram =
+            vma.backing_memory >= fcram && vma.backing_memory < fcram + Memory::FCRAM_SIZE;
+        layout.push_back(in_fcram ? static_cast<u32>(vma.backing_memory - fcram) : ~0U);
+    }
+
+    return layout;
+}
+
+/// Saves the FCRAM allocator state, which changes along with the memory mappings
+void SaveAllocations(System& system, StateWriter& writer) {
+    for (const Kernel::MemoryRegionInfo& region : system.Kernel().memory_regions) {
+        writer.Write(region.used);
+        writer.Write(static_cast<u32>(region.free_blocks.iterative_size()));
+        for (const auto& interval : region.free_blocks) {
+            writer.Write(interval.lower());
+            writer.Write(interval.upper());
+        }
+    }
+    writer.Write(system.Kernel().GetCurrentProcess()->memory_used);
+}
+
+void SaveThreads(System& system, StateWriter& writer) {
+    for (u32 i = 0; i < system.GetNumCores(); ++i) {
+        ARM_Dynarmic& core = system.GetCore(i);
+        Kernel::ThreadManager& thread_manager = system.Kernel().GetThreadManager(i);
+        const Kernel::Thread* current_thread = thread_manager.GetCurrentThread();
+
+        for (const std::shared_ptr<Kernel::Thread>& thread : thread_manager.GetThreadList()) {
+            if (thread.get() != current_thread) {
+                thread->context->SaveState(writer);
+                continue;
+            }
+
+            // The registers of the running thread are only in the core
+            std::unique_ptr<ThreadContext> context = core.NewContext();
+            core.SaveContext(context);
+            context->SaveState(writer);
+        }
+
+        writer.Write(core.GetCP15Register(69)); // UPRW
+        writer.Write(core.GetCP15Register(70)); // URO
+    }
+}
+
+void SaveMemory(System& system, StateWriter& writer) {
+    Memory::MemorySystem& memory = system.Memory();
+
+    // Only the allocated parts of FCRAM are saved
+    for (const Kernel::MemoryRegionInfo& region : system.Kernel().memory_regions) {
+        Kernel::MemoryRegionInfo::IntervalSet used;
+        used += Kernel::MemoryRegionInfo::Interval(region.base, region.base + region.size);
+        used -= region.free_blocks;
+
+        writer.Write(static_cast<u32>(used.iterative_size()));
+        for (const auto& interval : used) {
+            const u32 offset = interval.lower();
+            const u32 size = interval.upper() - interval.lower();
+            writer.Write(offset);
+            writer.Write(size);
+            writer.WriteBytes(memory.GetFCRAMPointer(offset), size);
+        }
+    }
+
+    writer.WriteBytes(memory.GetPhysicalPointer(Memory::VRAM_PADDR), Memory::VRAM_SIZE);
+    writer.WriteBytes(system.DSP().GetDspMemory().data(), Memory::DSP_RAM_SIZE);
+}
+
+/// The parts of a save state that are validated before anything is changed
+struct ParsedState {
+    struct CoreState {
+        std::vector<std::unique_ptr<ThreadContext>> thread_contexts;
+        u32 uprw;
+        u32 uro;
+    };
+
+    struct MemoryBlock {
+        u32 offset;
+        u32 size;
+        const u8* data;
+    };
+
+    struct RegionState {
+        u32 used;
+        Kernel::MemoryRegionInfo::IntervalSet free_blocks;
+    };
+
+    std::vector<RegionState> regions;
+    u32 process_memory_used = 0;
+    std::vector<CoreState> cores;
+    std::vector<MemoryBlock> fcram;
+    const u8* vram = nullptr;
+    const u8* dsp_ram = nullptr;
+    std::vector<Timing::SavedTimer> timers;
+    const u8* gpu_regs = nullptr;
+    const u8* lcd_regs = nullptr;
+    const u8* pica = nullptr;
+    u64 gpu_thread_fence = 0;
+    std::vector<VideoCore::DeferredInterrupt> deferred_interrupts;
+};
+
+void SaveDeferredInterrupts(StateWriter& writer) {
+    if (VideoCore::g_gpu_thread == nullptr) {
+        writer.Write(u64{0});
+        writer.Write(u32{0});
+        return;
+    }
+
+    const std::vector<VideoCore::DeferredInterrupt> interrupts =
+        VideoCore::g_gpu_thread->GetDeferred();
+    writer.Write(VideoCore::g_gpu_thread->GetLastFence());
+    writer.Write(static_cast<u32>(interrupts.size()));
+    for (const VideoCore::DeferredInterrupt& interrupt : interrupts) {
+        writer.Write(interrupt.fence);
+        writer.Write(interrupt.interrupt_id);
+    }
+}
+
+bool ParseDeferredInterrupts(StateReader& reader, ParsedState& parsed) {
+    u32 count = 0;
+    if (!reader.Read(parsed.gpu_thread_fence) || !reader.Read(count)) {
+        return false;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        VideoCore::DeferredInterrupt interrupt{};
+        if (!reader.Read(interrupt.fence) || !reader.Read(interrupt.interrupt_id)) {
+            return false;
+        }
+        parsed.deferred_interrupts.push_back(interrupt);
+    }
+
+    return true;
+}
+
+bool ParseAllocations(System& system, StateReader& reader, ParsedState& parsed) {
+    for (const Kernel::MemoryRegionInfo& region : system.Kernel().memory_regions) {
+        ParsedState::RegionState region_state{};
+        u32 count = 0;
+        if (!reader.Read(region_state.used) || !reader.Read(count)) {
+            return false;
+        }
+
+        for (u32 i = 0; i < count; ++i) {
+            u32 lower = 0;
+            u32 upper = 0;
+            if (!reader.Read(lower) || !reader.Read(upper) || lower >= upper ||
+                lower < region.base || upper > region.base + region.size) {
+                return false;
+            }
+            region_state.free_blocks += Kernel::MemoryRegionInfo::Interval(lower, upper);
+        }
+        parsed.regions.push_back(std::move(region_state));
+    }
+
+    return reader.Read(parsed.process_memory_used);
+}
+
+bool ParseThreads(System& system, StateReader& reader, ParsedState& parsed) {
+    parsed.cores.resize(system.GetNumCores());
+
+    for (u32 i = 0; i < system.GetNumCores(); ++i) {
+        ParsedState::CoreState& core_state = parsed.cores[i];
+        const std::size_t thread_count =
+            system.Kernel().GetThreadManager(i).GetThreadList().size();
+
+        for (std::size_t j = 0; j < thread_count; ++j) {
+            std::unique_ptr<ThreadContext> context = system.GetCore(i).NewContext();
+            if (!context->LoadState(reader)) {
+                return false;
+            }
+            core_state.thread_contexts.push_back(std::move(context));
+        }
+
+        if (!reader.Read(core_state.uprw) || !reader.Read(core_state.uro)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ParseMemory(System& system, StateReader& reader, ParsedState& parsed) {
+    for (std::size_t i = 0; i < system.Kernel().memory_regions.size(); ++i) {
+        u32 count = 0;
+        if (!reader.Read(count)) {
+            return false;
+        }
+
+        for (u32 j = 0; j < count; ++j) {
+            ParsedState::MemoryBlock block{};
+            if (!reader.Read(block.offset) || !reader.Read(block.size) ||
+                static_cast<u64>(block.offset) + block.size > Memory::FCRAM_SIZE) {
+                return false;
+            }
+
+            block.data = reader.ReadSpan(block.size);
+            if (block.data == nullptr) {
+                return false;
+            }
+            parsed.fcram.push_back(block);
+        }
+    }
+
+    parsed.vram = reader.ReadSpan(Memory::VRAM_SIZE);
+    parsed.dsp_ram = reader.ReadSpan(Memory::DSP_RAM_SIZE);
+    return reader.IsGood();
+}
+
+} // namespace
+
+StateWriter::StateWriter(std::vector<u8>& buffer) : buffer(buffer) {}
+
+void StateWriter::WriteBytes(const void* data, std::size_t size) {
+    const u8* bytes = static_cast<const u8*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void StateWriter::WriteString(const std::string& string) {
+    Write(static_cast<u32>(string.size()));
+    WriteBytes(string.data(), string.size());
+}
+
+StateReader::StateReader(const std::vector<u8>& buffer) : buffer(buffer) {}
+
+bool StateReader::ReadBytes(void* data, std::size_t size) {
+    if (!good || buffer.size() - offset < size) {
+        good = false;
+        return false;
+    }
+
+    std::memcpy(data, buffer.data() + offset, size);
+    offset += size;
+    return true;
+}
+
+const u8* StateReader::ReadSpan(std::size_t size) {
+    if (!good || buffer.size() - offset < size) {
+        good = false;
+        return nullptr;
+    }
+
+    const u8* data = buffer.data() + offset;
+    offset += size;
+    return data;
+}
+
+bool StateReader::ReadString(std::string& string) {
+    u32 size = 0;
+    if (!Read(size) || buffer.size() - offset < size) {
+        good = false;
+        return false;
+    }
+
+    string.assign(reinterpret_cast<const char*>(buffer.data() + offset), size);
+    offset += size;
+    return true;
+}
+
+namespace {
+
+void Save(System& system, std::vector<u8>& state, u32 flags) {
+    ASSERT(system.IsInitialized());
+
+    // Finish queued GPU work. Its interrupts stay deferred until their completion events, which
+    // are saved along with them.
+    if (VideoCore::g_gpu_thread != nullptr) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+
+    // Write surfaces rendered by the host GPU back to emulated memory
+    VideoCore::g_renderer->Rasterizer()->FlushAll();
+
+    state.clear();
+    StateWriter writer(state);
+
+    const StateHeader header{
+        STATE_MAGIC,
+        STATE_VERSION,
+        system.Kernel().GetCurrentProcess()->codeset->program_id,
+        system.GetNumCores(),
+        flags,
+    };
+    writer.Write(header);
+
+    const std::vector<u32> layout = DescribeLayout(system);
+    writer.Write(static_cast<u32>(layout.size()));
+    writer.WriteBytes(layout.data(), layout.size() * sizeof(u32));
+
+    SaveAllocations(system, writer);
+    SaveThreads(system, writer);
+    if ((flags & STATE_FLAG_NO_MEMORY) == 0) {
+        SaveMemory(system, writer);
+    }
+
+    system.CoreTiming().SaveState(writer);
+
+    writer.WriteBytes(&GPU::g_regs, sizeof(GPU::g_regs));
+    writer.WriteBytes(&LCD::g_regs, sizeof(LCD::g_regs));
+
+    Pica::SaveState(writer);
+
+    SaveDeferredInterrupts(writer);
+}
+
+bool Load(System& system, const std::vector<u8>& state,
+          const std::function<void()>& restore_memory) {
+    ASSERT(system.IsInitialized());
+
+    StateReader reader(state);
+
+    StateHeader header{};
+    if (!reader.Read(header) || header.magic != STATE_MAGIC) {
+        LOG_ERROR(Core, "Invalid save state");
+        return false;
+    }
+
+    if (header.version != STATE_VERSION) {
+        LOG_ERROR(Core, "Unsupported save state version {}", header.version);
+        return false;
+    }
+
+    if (header.program_id != system.Kernel().GetCurrentProcess()->codeset->program_id ||
+        header.num_cores != system.GetNumCores()) {
+        LOG_ERROR(Core, "Save state was created by a different title");
+        return false;
+    }
+
+    const bool has_memory = (header.flags & STATE_FLAG_NO_MEMORY) == 0;
+    if (has_memory == static_cast<bool>(restore_memory)) {
+        LOG_ERROR(Core, "Save state {} emulated memory", has_memory ? "includes" : "lacks");
+        return false;
+    }
+
+    const std::vector<u32> layout = DescribeLayout(system);
+    u32 layout_size = 0;
+    if (!reader.Read(layout_size)) {
+        LOG_ERROR(Core, "Save state is truncated");
+        return false;
+    }
+
+    const u8* saved_layout = reader.ReadSpan(static_cast<std::size_t>(layout_size) * sizeof(u32));
+    if (saved_layout == nullptr) {
+        LOG_ERROR(Core, "Save state is truncated");
+        return false;
+    }
+
+    if (layout_size != layout.size() ||
+        std::memcmp(saved_layout, layout.data(), layout.size() * sizeof(u32)) != 0) {
+        LOG_ERROR(Core, "Save state was created while the title had different threads or memory "
+                        "mappings");
+        return false;
+    }
+
+    // Parse and validate everything before changing anything, so a rejected state leaves the
+    // system running
+    ParsedState parsed;
+    if (!ParseAllocations(system, reader, parsed) || !ParseThreads(system, reader, parsed) ||
+        (has_memory && !ParseMemory(system, reader, parsed)) ||
+        !system.CoreTiming().ReadState(reader, parsed.timers)) {
+        LOG_ERROR(Core, "Save state is truncated or invalid");
+        return false;
+    }
+
+    parsed.gpu_regs = reader.ReadSpan(sizeof(GPU::g_regs));
+    parsed.lcd_regs = reader.ReadSpan(sizeof(LCD::g_regs));
+    parsed.pica = Pica::ReadState(reader);
+    if (!reader.IsGood() || !ParseDeferredInterrupts(reader, parsed)) {
+        LOG_ERROR(Core, "Save state is truncated");
+        return false;
+    }
+
+    if (!reader.IsAtEnd()) {
+        LOG_ERROR(Core, "Save state has trailing data");
+        return false;
+    }
+
+    // Queued GPU work belongs to the timeline that's about to be replaced
+    if (VideoCore::g_gpu_thread != nullptr) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
+
+    // Drop everything the rasterizer cached from the memory that's about to be replaced
+    VideoCore::g_renderer->Rasterizer()->ClearCache();
+
+    auto& regions = system.Kernel().memory_regions;
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        regions[i].used = parsed.regions[i].used;
+        regions[i].free_blocks = std::move(parsed.regions[i].free_blocks);
+    }
+    system.Kernel().GetCurrentProcess()->memory_used = parsed.process_memory_used;
+
+    if (has_memory) {
+        Memory::MemorySystem& memory = system.Memory();
+        for (const ParsedState::MemoryBlock& block : parsed.fcram) {
+            std::memcpy(memory.GetFCRAMPointer(block.offset), block.data, block.size);
+        }
+        std::memcpy(memory.GetPhysicalPointer(Memory::VRAM_PADDR), parsed.vram,
+                    Memory::VRAM_SIZE);
+        std::memcpy(system.DSP().GetDspMemory().data(), parsed.dsp_ram, Memory::DSP_RAM_SIZE);
+    } else {
+        restore_memory();
+    }
+
+    for (u32 i = 0; i < system.GetNumCores(); ++i) {
+        ARM_Dynarmic& core = system.GetCore(i);
+        Kernel::ThreadManager& thread_manager = system.Kernel().GetThreadManager(i);
+        ParsedState::CoreState& core_state = parsed.cores[i];
+
+        const std::vector<std::shared_ptr<Kernel::Thread>>& threads =
+            thread_manager.GetThreadList();
+        for (std::size_t j = 0; j < threads.size(); ++j) {
+            threads[j]->context = std::move(core_state.thread_contexts[j]);
+        }
+
+        const Kernel::Thread* current_thread = thread_manager.GetCurrentThread();
+        if (current_thread != nullptr) {
+            core.LoadContext(current_thread->context);
+        }
+        core.SetCP15Register(69, core_state.uprw);
+        core.SetCP15Register(70, core_state.uro);
+
+        // Code may have changed along with memory
+        core.ClearInstructionCache();
+    }
+
+    system.CoreTiming().RestoreState(parsed.timers);
+
+    std::memcpy(&GPU::g_regs, parsed.gpu_regs, sizeof(GPU::g_regs));
+    std::memcpy(&LCD::g_regs, parsed.lcd_regs, sizeof(LCD::g_regs));
+
+    Pica::RestoreState(parsed.pica);
+
+    if (VideoCore::g_gpu_thread != nullptr) {
+        // The restored completion events deliver the interrupts
+        VideoCore::g_gpu_thread->RestoreDeferred(parsed.gpu_thread_fence,
+                                                 std::move(parsed.deferred_interrupts));
+    } else {
+        // Without the GPU thread the completion events do nothing, so deliver them now
+        for (const VideoCore::DeferredInterrupt& interrupt : parsed.deferred_interrupts) {
+            Service::GSP::SignalInterrupt(interrupt.interrupt_id);
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+std::vector<u8> SaveState(System& system) {
+    std::vector<u8> state;
+    SaveState(system, state);
+    return state;
+}
+
+void SaveState(System& system, std::vector<u8>& state) {
+    Save(system, state, 0);
+}
+
+void SaveStateWithoutMemory(System& system, std::vector<u8>& state) {
+    Save(system, state, STATE_FLAG_NO_MEMORY);
+}
+
+bool LoadState(System& system, const std::vector<u8>& state) {
+    return Load(system, state, nullptr);
+}
+
+bool LoadStateWithoutMemory(System& system, const std::vector<u8>& state,
+                            const std::function<void()>& restore_memory) {
+    return Load(system, state, restore_memory);
+}
+
+} // namespace Core
@@ -0,0 +1,109 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+
+class System;
+
+/// Appends the raw bytes of values to a save state buffer
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<u8>& buffer);
+
+    void WriteBytes(const void* data, std::size_t size);
+    void WriteString(const std::string& string);
+
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Only trivially copyable types can be written to a save state");
+        WriteBytes(&value, sizeof(T));
+    }
+
+private:
+    std::vector<u8>& buffer;
+};
+
+/// Reads values back from a save state buffer. A failed read leaves the reader in a failed state.
+class StateReader {
+public:
+    explicit StateReader(const std::vector<u8>& buffer);
+
+    bool ReadBytes(void* data, std::size_t size);
+    bool ReadString(std::string& string);
+
+    /// Skips `size` bytes and returns a pointer to them in the buffer, or nullptr on failure
+    const u8* ReadSpan(std::size_t size);
+
+    template <typename T>
+    bool Read(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Only trivially copyable types can be read from a save state");
+        return ReadBytes(&value, sizeof(T));
+    }
+
+    /// Returns true if every read so far succeeded
+    bool IsGood() const {
+        return good;
+    }
+
+    /// Returns true if the whole buffer was consumed
+    bool IsAtEnd() const {
+        return offset == buffer.size();
+    }
+
+private:
+    const std::vector<u8>& buffer;
+    std::size_t offset = 0;
+    bool good = true;
+};
+
+/**
+ * Serializes the emulated hardware state: the used parts of FCRAM and the FCRAM allocations, VRAM,
+ * DSP RAM, the registers of every thread, the core timing event queues, the GPU/LCD registers and
+ * the Pica state.
+ * Kernel objects, DSP HLE and HLE service modules are not part of the state. Instead, the state
+ * records the threads and memory mappings of the title, and can be loaded in any boot of the same
+ * title while they match. The kernel keeps scheduling the threads as it currently does.
+ * Must be called between two System::Run calls.
+ * @returns The serialized state.
+ */
+std::vector<u8> SaveState(System& system);
+
+/// Same as above, but reuses the memory of `state`, which is overwritten
+void SaveState(System& system, std::vector<u8>& state);
+
+/**
+ * Restores a state created by SaveState.
+ * Must be called between two System::Run calls.
+ * The whole state is validated before anything is changed.
+ * @returns true on success. The system is left unchanged on failure.
+ */
+bool LoadState(System& system, const std::vector<u8>& state);
+
+/**
+ * Same as SaveState, but leaves out FCRAM, VRAM and DSP RAM, for callers that keep their own copy
+ * of emulated memory.
+ */
+void SaveStateWithoutMemory(System& system, std::vector<u8>& state);
+
+/**
+ * Restores a state created by SaveStateWithoutMemory.
+ * @param restore_memory Called to put emulated memory back once the state has been validated.
+ *     Loading can't fail after it's called.
+ * @returns true on success. The system is left unchanged on failure.
+ */
+bool LoadStateWithoutMemory(System& system, const std::vector<u8>& state,
+                            const std::function<void()>& restore_memory);
+
+} // namespace Core
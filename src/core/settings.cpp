@@ -22,9 +22,12 @@ Values values;
 void Apply() {
     InputCommon::ReloadInputDevices();
 
-    VideoCore::g_hardware_shader_enabled = values.use_hardware_shader;
+    VideoCore::g_hardware_shader_enabled =
+        values.use_hardware_renderer && values.use_hardware_shader;
     VideoCore::g_hardware_shader_accurate_multiplication =
         values.hardware_shader_accurate_multiplication;
+    VideoCore::g_shader_jit_enabled = values.use_shader_jit;
+    VideoCore::g_shader_profiling_enabled = values.enable_shader_profiling;
 
     if (VideoCore::g_renderer) {
         VideoCore::g_renderer->UpdateCurrentFramebufferLayout();
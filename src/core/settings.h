@@ -9,6 +9,7 @@
 #include <atomic>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "common/common_types.h"
 #include "core/hle/service/cam/cam.h"
@@ -131,11 +132,19 @@ struct Values {
 
     // General
     bool enable_core_2 = false;
+    bool run_cores_in_parallel = false;
     bool limit_speed = true;
     u16 speed_limit = 100;
+    bool turbo_mode = false;
+    u32 turbo_mode_present_interval = 10;
     bool use_custom_cpu_ticks = false;
     u64 custom_cpu_ticks = 77;
     u32 cpu_clock_percentage = 100;
+    bool skip_idle_loops = false;
+    std::unordered_set<u64> idle_loop_skipping_disabled_titles;
+    bool enable_rewind = false;
+    u32 rewind_interval = 10;
+    u32 rewind_captures = 60;
     s64 core_system_run_default_max_slice_value = BASE_CLOCK_RATE_ARM11 / 234;
     s64 set_slice_length_to_this_in_core_timing_timer_timer = BASE_CLOCK_RATE_ARM11 / 234;
     s64 set_downcount_to_this_in_core_timing_timer_timer = BASE_CLOCK_RATE_ARM11 / 234;
@@ -163,13 +172,22 @@ struct Values {
     std::array<Service::CAM::Flip, Service::CAM::NumCameras> camera_flip{};
 
     // Graphics
+    bool use_hardware_renderer = true;
+    bool enable_gpu_thread = false;
     bool use_hardware_shader = true;
     bool hardware_shader_accurate_multiplication = false;
     bool enable_disk_shader_cache = false;
+    bool async_shader_compilation = false;
+    bool use_shader_jit = true;
+    bool enable_shader_profiling = false;
     bool enable_vsync = false;
+    bool use_async_texture_upload = false;
+    bool async_texture_upload_placeholders = false;
+    u32 surface_cache_budget = 0; // MiB, 0 means no limit
     bool dump_textures = false;
     bool use_custom_textures = false;
     bool preload_custom_textures = false;
+    bool use_texture_disk_cache = false;
     PreloadCustomTexturesFolder preload_custom_textures_folder = PreloadCustomTexturesFolder::Load;
     bool enable_linear_filtering = true;
     bool sharper_distant_objects = false;
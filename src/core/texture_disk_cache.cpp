@@ -0,0 +1,157 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <fmt/format.h>
+#include "common/logging/log.h"
+#include "core/texture_disk_cache.h"
+
+namespace Core {
+
+namespace {
+
+constexpr u32 TEXTURE_DISK_CACHE_MAGIC = 0x31435456; // VTC1
+constexpr u32 TEXTURE_DISK_CACHE_VERSION = 1;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+};
+
+struct EntryHeader {
+    TextureDiskCacheKey key;
+    u32 width;
+    u32 height;
+};
+
+static_assert(std::is_trivially_copyable_v<TextureDiskCacheKey> &&
+                  sizeof(TextureDiskCacheKey) == 24,
+              "TextureDiskCacheKey is written to files");
+static_assert(sizeof(EntryHeader) == 32, "EntryHeader is written to files");
+
+} // namespace
+
+void TextureDiskCache::Open(u64 program_id) {
+    Close();
+
+    const std::string& dir = FileUtil::GetUserPath(FileUtil::UserPath::TextureCacheDir);
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(Render, "Failed to create {}", dir);
+        return;
+    }
+    path = fmt::format("{}{:016X}.vtc", dir, program_id);
+    if (!FileUtil::Exists(path)) {
+        return;
+    }
+
+    const std::size_t valid_size = Map();
+    if (valid_size == 0) {
+        LOG_INFO(Render, "Different texture disk cache version, deleting");
+        mapped_file.Close();
+        textures.clear();
+        FileUtil::Delete(path);
+        return;
+    }
+
+    if (valid_size != mapped_file.GetSize()) {
+        // The last texture was only partly written, probably because vvctre was closed meanwhile
+        LOG_WARNING(Render, "Texture disk cache is truncated, removing the last texture");
+        mapped_file.Close();
+        textures.clear();
+        if (!FileUtil::IOFile(path, "r+b").Resize(valid_size)) {
+            LOG_ERROR(Render, "Failed to resize the texture disk cache, deleting");
+            FileUtil::Delete(path);
+            return;
+        }
+        Map();
+    }
+
+    LOG_INFO(Render, "Found a texture disk cache with {} textures", textures.size());
+}
+
+void TextureDiskCache::Close() {
+    std::lock_guard lock(add_mutex);
+    append_file.Close();
+    added.clear();
+    textures.clear();
+    mapped_file.Close();
+    path.clear();
+}
+
+std::size_t TextureDiskCache::Map() {
+    if (!mapped_file.Open(path)) {
+        return 0;
+    }
+
+    const u8* const data = mapped_file.GetData();
+    const std::size_t size = mapped_file.GetSize();
+
+    FileHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != TEXTURE_DISK_CACHE_MAGIC || header.version != TEXTURE_DISK_CACHE_VERSION) {
+        return 0;
+    }
+
+    std::size_t offset = sizeof(header);
+    while (size - offset >= sizeof(EntryHeader)) {
+        EntryHeader entry;
+        std::memcpy(&entry, data + offset, sizeof(entry));
+
+        const u64 texture_size = static_cast<u64>(entry.width) * entry.height * 4;
+        if (texture_size > size - offset - sizeof(entry)) {
+            break;
+        }
+
+        textures.insert_or_assign(entry.key,
+                                  Texture{entry.width, entry.height, data + offset + sizeof(entry)});
+        offset += sizeof(entry) + static_cast<std::size_t>(texture_size);
+    }
+
+    return offset;
+}
+
+std::optional<TextureDiskCache::Texture> TextureDiskCache::Find(
+    const TextureDiskCacheKey& key) const {
+    const auto it = textures.find(key);
+    if (it == textures.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void TextureDiskCache::Add(const TextureDiskCacheKey& key, u32 width, u32 height,
+                           const u8* data) {
+    std::lock_guard lock(add_mutex);
+
+    if (!IsOpen() || textures.count(key) != 0 || !added.insert(key).second) {
+        return;
+    }
+
+    if (!append_file.IsOpen()) {
+        if (!append_file.Open(path, "ab")) {
+            LOG_ERROR(Render, "Failed to open the texture disk cache");
+            return;
+        }
+        if (append_file.GetSize() == 0 &&
+            append_file.WriteObject(FileHeader{TEXTURE_DISK_CACHE_MAGIC,
+                                               TEXTURE_DISK_CACHE_VERSION}) != 1) {
+            LOG_ERROR(Render, "Failed to write the texture disk cache header");
+            append_file.Close();
+            return;
+        }
+    }
+
+    const std::size_t texture_size = static_cast<std::size_t>(width) * height * 4;
+    if (append_file.WriteObject(EntryHeader{key, width, height}) != 1 ||
+        append_file.WriteArray(data, texture_size) != texture_size) {
+        // A partly written texture is removed when the file is opened again
+        LOG_ERROR(Render, "Failed to write to the texture disk cache");
+        append_file.Close();
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,78 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/hash.h"
+#include "common/mapped_file.h"
+
+namespace Core {
+
+struct TextureDiskCacheKey {
+    u64 source_hash;  ///< Hash of the texture data in 3DS memory
+    u64 variant_hash; ///< Hash of what the texture is made with, like a filter or a custom texture
+    u32 pixel_format; ///< Pixel format of the texture in 3DS memory
+    u32 scale;
+
+    bool operator==(const TextureDiskCacheKey& rhs) const {
+        return source_hash == rhs.source_hash && variant_hash == rhs.variant_hash &&
+               pixel_format == rhs.pixel_format && scale == rhs.scale;
+    }
+};
+
+/**
+ * Content-addressed cache of RGBA8 textures that are slow to make, like decoded custom textures
+ * and filtered textures. The file of a title is memory mapped when it's opened, so textures from
+ * earlier sessions can be uploaded straight from the mapping. Textures added in this session are
+ * appended to the file and can be found from the next session on.
+ */
+class TextureDiskCache : NonCopyable {
+public:
+    struct Texture {
+        u32 width;
+        u32 height;
+        const u8* data; ///< width * height RGBA8 texels, in the row order they were added in
+    };
+
+    /// Opens the cache file of a title, creating it when a texture is added
+    void Open(u64 program_id);
+    void Close();
+
+    bool IsOpen() const {
+        return !path.empty();
+    }
+
+    /// Finds a texture added in an earlier session. Can be called from any thread.
+    std::optional<Texture> Find(const TextureDiskCacheKey& key) const;
+
+    /// Appends a texture to the file. Can be called from any thread.
+    void Add(const TextureDiskCacheKey& key, u32 width, u32 height, const u8* data);
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const TextureDiskCacheKey& key) const noexcept {
+            return static_cast<std::size_t>(Common::ComputeStructHash64(key));
+        }
+    };
+
+    /// Maps the file and indexes its textures, returns the size of the valid part of the file
+    std::size_t Map();
+
+    std::string path;
+    Common::MappedFile mapped_file;
+    std::unordered_map<TextureDiskCacheKey, Texture, KeyHash> textures;
+
+    std::mutex add_mutex;
+    std::unordered_set<TextureDiskCacheKey, KeyHash> added;
+    FileUtil::IOFile append_file;
+};
+
+} // namespace Core
@@ -2,19 +2,25 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cstddef>
 #include <cstring>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/hle/service/gsp/gsp.h"
 #include "core/hw/gpu.h"
 #include "core/memory.h"
 #include "core/settings.h"
 #include "video_core/command_processor.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
 #include "video_core/primitive_assembly.h"
@@ -36,6 +42,64 @@ constexpr std::array<u32, 16> expand_bits_to_bytes{
     0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff, 0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff,
 };
 
+DrawStats g_draw_stats;
+
+/// Marks count consecutive registers starting at first
+static void SetRegs(std::bitset<Regs::NUM_REGS>& regs, std::size_t first, std::size_t count = 1) {
+    for (std::size_t i = first; i < first + count; ++i) {
+        regs.set(i);
+    }
+}
+
+/**
+ * Registers whose writes do more than store the value, like uploading data, running commands or
+ * starting a draw. Writes to the other registers are skipped if they don't change the value.
+ */
+static const std::bitset<Regs::NUM_REGS> command_regs = [] {
+    std::bitset<Regs::NUM_REGS> regs;
+    SetRegs(regs, PICA_REG_INDEX(trigger_irq));
+    SetRegs(regs, PICA_REG_INDEX(texturing.fog_lut_data), 8);
+    SetRegs(regs, PICA_REG_INDEX(texturing.proctex_lut_data), 8);
+    SetRegs(regs, PICA_REG_INDEX(lighting.lut_data), 8);
+    SetRegs(regs, PICA_REG_INDEX(pipeline.triangle_topology));
+    SetRegs(regs, PICA_REG_INDEX(pipeline.restart_primitive));
+    SetRegs(regs, PICA_REG_INDEX(pipeline.vs_default_attributes_setup.index));
+    SetRegs(regs, PICA_REG_INDEX(pipeline.vs_default_attributes_setup.set_value), 3);
+    SetRegs(regs, PICA_REG_INDEX(pipeline.command_buffer.trigger), 2);
+    SetRegs(regs, PICA_REG_INDEX(pipeline.trigger_draw), 2);
+    for (const std::size_t shader : {PICA_REG_INDEX(gs), PICA_REG_INDEX(vs)}) {
+        SetRegs(regs, shader + offsetof(ShaderRegs, bool_uniforms) / sizeof(u32));
+        SetRegs(regs, shader + offsetof(ShaderRegs, int_uniforms) / sizeof(u32), 4);
+        SetRegs(regs, shader + offsetof(ShaderRegs, uniform_setup.set_value) / sizeof(u32), 8);
+        SetRegs(regs, shader + offsetof(ShaderRegs, program.set_word) / sizeof(u32), 8);
+        SetRegs(regs, shader + offsetof(ShaderRegs, swizzle_patterns.set_word) / sizeof(u32), 8);
+    }
+    return regs;
+}();
+
+/**
+ * Registers that triangles are drawn with, a pending draw is issued before they change.
+ * Vertices are shaded when they're submitted, so the pipeline and shader registers aren't part of
+ * it, except for the registers starting a draw or signaling that the drawing is done.
+ */
+static const std::bitset<Regs::NUM_REGS> draw_state_regs = [] {
+    std::bitset<Regs::NUM_REGS> regs;
+    SetRegs(regs, PICA_REG_INDEX(trigger_irq));
+    SetRegs(regs, PICA_REG_INDEX(rasterizer),
+            PICA_REG_INDEX(pipeline) - PICA_REG_INDEX(rasterizer));
+    SetRegs(regs, PICA_REG_INDEX(pipeline.trigger_draw), 2);
+    return regs;
+}();
+
+/// Issues the draw of the batched immediate mode triangles
+static void FlushImmediateDraw() {
+    if (g_state.immediate.draw_pending) {
+        g_state.immediate.draw_pending = false;
+        VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+        ++g_draw_stats.issued;
+    }
+}
+
 static const char* GetShaderSetupTypeName(Shader::ShaderSetup& setup) {
     if (&setup == &g_state.vs) {
         return "vertex shader";
@@ -110,6 +174,187 @@ static void WriteUniformFloatReg(ShaderRegs& config, Shader::ShaderSetup& setup,
     }
 }
 
+/// Draws with at least this many vertices are shaded in parallel
+constexpr u32 MIN_BATCHED_VERTICES = 96;
+
+/// Number of vertices a worker shades at a time
+constexpr std::size_t BATCH_CHUNK_SIZE = 32;
+
+/// Buffers reused across batched draws
+struct VertexBatch {
+    /// Vertices of the draw to shade in order of first use, and the index of that first use
+    std::vector<u32> vertices;
+    std::vector<u32> first_indices;
+
+    /// Shaded vertices of non-indexed draws, those of indexed draws go to the vertex cache
+    std::vector<Shader::AttributeBuffer> outputs;
+};
+
+/**
+ * Post-transform cache of vertex shader outputs, indexed by vertex id. Its entries stay valid for
+ * the following draws of the same command list as long as they use the same vertex arrays, vertex
+ * shader and uniforms, so meshes drawn in several parts don't shade their shared vertices again.
+ * Vertex memory isn't watched, so the cache is invalidated whenever a new command list starts.
+ */
+class VertexCache {
+public:
+    /// Invalidates the cache if the state the cached outputs depend on has changed
+    void Validate(u64 new_key) {
+        if (!valid || new_key != key) {
+            Invalidate();
+            key = new_key;
+            valid = true;
+        }
+    }
+
+    void Invalidate() {
+        valid = false;
+        outputs.clear();
+        // A generation of 0 marks an empty entry, reset the entries when the counter wraps around
+        if (++generation == 0) {
+            std::fill(entries.begin(), entries.end(), Entry{});
+            generation = 1;
+        }
+    }
+
+    const Shader::AttributeBuffer* Find(u32 vertex) const {
+        const Entry& entry = entries[vertex];
+        return entry.generation == generation ? &outputs[entry.slot] : nullptr;
+    }
+
+    /// Adds an entry for the vertex and returns the index of its output
+    std::size_t Insert(u32 vertex) {
+        const std::size_t slot = outputs.size();
+        entries[vertex] = {generation, static_cast<u32>(slot)};
+        outputs.emplace_back();
+        return slot;
+    }
+
+    Shader::AttributeBuffer& Output(std::size_t slot) {
+        return outputs[slot];
+    }
+
+private:
+    struct Entry {
+        u32 generation = 0;
+        u32 slot = 0;
+    };
+
+    /// One entry for each vertex id an index buffer can hold
+    std::vector<Entry> entries = std::vector<Entry>(0x10000);
+    std::vector<Shader::AttributeBuffer> outputs;
+    u32 generation = 1;
+    u64 key = 0;
+    bool valid = false;
+};
+
+static VertexBatch vertex_batch;
+static VertexCache vertex_cache;
+
+/// Hashes the state the vertex shader outputs of an indexed draw depend on, besides vertex memory
+static u64 ComputeVertexCacheKey() {
+    const auto& regs = g_state.regs;
+    const std::array<u64, 6> hashes{
+        Common::ComputeStructHash64(regs.pipeline.vertex_attributes),
+        Common::ComputeStructHash64(regs.vs),
+        Common::ComputeStructHash64(g_state.vs.uniforms),
+        Common::ComputeStructHash64(g_state.input_default_attributes),
+        g_state.vs.GetProgramCodeHash(),
+        g_state.vs.GetSwizzleDataHash(),
+    };
+    return Common::ComputeStructHash64(hashes);
+}
+
+/**
+ * Runs the vertex shader once for every unique vertex of the current draw that isn't in the vertex
+ * cache yet, spread across worker threads with a shader unit each, then submits the outputs to the
+ * geometry pipeline in index order.
+ */
+static void ShadeVerticesBatched(const VertexLoader& loader, Shader::Engine& shader_engine,
+                                 u32 base_address, bool is_indexed, const u8* index_address_8,
+                                 bool index_u16) {
+    const auto& regs = g_state.regs;
+    const u32 num_vertices = regs.pipeline.num_vertices;
+    const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
+    VertexBatch& batch = vertex_batch;
+
+    batch.vertices.clear();
+    batch.first_indices.clear();
+
+    Shader::AttributeBuffer* outputs;
+    if (is_indexed) {
+        // Only shade the vertices missing from the cache, once each
+        std::size_t first_slot = 0;
+        for (u32 index = 0; index < num_vertices; ++index) {
+            const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+            if (vertex_cache.Find(vertex) == nullptr) {
+                const std::size_t slot = vertex_cache.Insert(vertex);
+                if (batch.vertices.empty()) {
+                    first_slot = slot;
+                }
+                batch.vertices.push_back(vertex);
+                batch.first_indices.push_back(index);
+            }
+        }
+        outputs = batch.vertices.empty() ? nullptr : &vertex_cache.Output(first_slot);
+    } else {
+        for (u32 index = 0; index < num_vertices; ++index) {
+            batch.vertices.push_back(index + regs.pipeline.vertex_offset);
+            batch.first_indices.push_back(index);
+        }
+        batch.outputs.resize(num_vertices);
+        outputs = batch.outputs.data();
+    }
+
+    const std::size_t num_unique = batch.vertices.size();
+    const bool vectorized = shader_engine.SetupVectorized(g_state.vs);
+
+    const std::size_t num_chunks = (num_unique + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+    Common::GetThreadPool().ParallelForNoWait(num_chunks, [&](std::size_t chunk) {
+        const std::size_t end = std::min(num_unique, (chunk + 1) * BATCH_CHUNK_SIZE);
+
+        if (vectorized) {
+            Shader::VectorUnitState shader_unit{};
+            std::array<Shader::AttributeBuffer, Shader::VECTOR_WIDTH> inputs;
+            std::array<Shader::AttributeBuffer, Shader::VECTOR_WIDTH> lane_outputs;
+
+            for (std::size_t i = chunk * BATCH_CHUNK_SIZE; i < end; i += Shader::VECTOR_WIDTH) {
+                const std::size_t count = std::min(Shader::VECTOR_WIDTH, end - i);
+                loader.LoadVertices(base_address, &batch.first_indices[i], &batch.vertices[i],
+                                    count, inputs.data());
+                // Fill the unused lanes of the last group with a copy of its last vertex
+                std::fill(inputs.begin() + count, inputs.end(), inputs[count - 1]);
+
+                shader_unit.LoadInput(regs.vs, inputs);
+                shader_engine.RunVectorized(g_state.vs, shader_unit);
+                shader_unit.WriteOutput(regs.vs, lane_outputs);
+                std::copy_n(lane_outputs.begin(), count, outputs + i);
+            }
+            return;
+        }
+
+        Shader::UnitState shader_unit;
+        Shader::AttributeBuffer input;
+
+        for (std::size_t i = chunk * BATCH_CHUNK_SIZE; i < end; ++i) {
+            loader.LoadVertices(base_address, &batch.first_indices[i], &batch.vertices[i], 1,
+                                &input);
+            shader_unit.LoadInput(regs.vs, input);
+            shader_engine.Run(g_state.vs, shader_unit);
+            shader_unit.WriteOutput(regs.vs, outputs[i]);
+        }
+    });
+
+    for (u32 index = 0; index < num_vertices; ++index) {
+        if (is_indexed) {
+            const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+            g_state.geometry_pipeline.SubmitVertex(*vertex_cache.Find(vertex));
+        } else {
+            g_state.geometry_pipeline.SubmitVertex(outputs[index]);
+        }
+    }
+}
+
 static void WritePicaReg(u32 id, u32 value, u32 mask) {
     auto& regs = g_state.regs;
 
@@ -122,16 +367,34 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     }
 
     // TODO: Figure out how register masking acts on e.g. vs.uniform_setup.set_value
-    u32 old_value = regs.reg_array[id];
+    const u32 old_value = regs.reg_array[id];
 
     const u32 write_mask = expand_bits_to_bytes[mask];
 
-    regs.reg_array[id] = (old_value & ~write_mask) | (value & write_mask);
+    const u32 new_value = (old_value & ~write_mask) | (value & write_mask);
+
+    // Command lists set most of the state before every draw, these writes don't need the pending
+    // draw to be issued nor the rasterizer to sync anything
+    const bool is_command = command_regs[id];
+    if (!is_command && new_value == old_value) {
+        return;
+    }
+
+    if (draw_state_regs[id]) {
+        FlushImmediateDraw();
+    }
+
+    regs.reg_array[id] = new_value;
 
     switch (id) {
     // Trigger IRQ
     case PICA_REG_INDEX(trigger_irq):
-        Service::GSP::SignalInterrupt(Service::GSP::InterruptId::P3D);
+        if (VideoCore::g_gpu_thread != nullptr) {
+            // Delivered once the CPU thread reaches the fence of this command list
+            VideoCore::g_gpu_thread->DeferInterrupt(Service::GSP::InterruptId::P3D);
+        } else {
+            Service::GSP::SignalInterrupt(Service::GSP::InterruptId::P3D);
+        }
         break;
 
     case PICA_REG_INDEX(pipeline.triangle_topology):
@@ -225,10 +488,13 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     g_state.geometry_pipeline.Setup(shader_engine);
                     g_state.geometry_pipeline.SubmitVertex(output);
 
-                    // TODO: If drawing after every immediate mode triangle kills performance,
-                    // change it to flush triangles whenever a drawing config register changes
-                    // See: https://github.com/citra-emu/citra/pull/2866#issuecomment-327011550
-                    VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+                    // Draw the triangles together with the next ones, until a register they're
+                    // drawn with changes or the command list ends
+                    if (g_state.immediate.draw_pending) {
+                        ++g_draw_stats.merged;
+                    } else {
+                        g_state.immediate.draw_pending = true;
+                    }
                 }
             }
         }
@@ -274,16 +540,17 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
         const bool is_indexed = (id == PICA_REG_INDEX(pipeline.trigger_draw_indexed));
 
+        ++g_draw_stats.issued;
+
         if (accelerate_draw &&
             VideoCore::g_renderer->Rasterizer()->AccelerateDrawBatch(is_indexed)) {
             break;
         }
 
         // Processes information about internal vertex attributes to figure out how a vertex is
-        // loaded.
-        // Later, these can be compiled and cached.
+        // loaded, or reuses the loader of an earlier draw with the same layout.
         const u32 base_address = regs.pipeline.vertex_attributes.GetPhysicalBaseAddress();
-        VertexLoader loader(regs.pipeline);
+        const VertexLoader& loader = GetVertexLoader(regs.pipeline);
         Shader::OutputVertex::ValidateSemantics(regs.rasterizer);
 
         // Load vertices
@@ -296,16 +563,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
         bool index_u16 = index_info.format != 0;
 
-        // Simple circular-replacement vertex cache
-        // The size has been tuned for optimal balance between hit-rate and the cost of lookup
-        const std::size_t VERTEX_CACHE_SIZE = 32;
-        std::array<bool, VERTEX_CACHE_SIZE> vertex_cache_valid{};
-        std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
-        std::array<Shader::AttributeBuffer, VERTEX_CACHE_SIZE> vertex_cache;
         Shader::AttributeBuffer vs_output;
 
-        unsigned int vertex_cache_pos = 0;
-
         auto* shader_engine = Shader::GetEngine();
         Shader::UnitState shader_unit;
 
@@ -315,6 +574,16 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         g_state.geometry_pipeline.Setup(shader_engine);
         if (g_state.geometry_pipeline.NeedIndexInput()) {
             ASSERT(is_indexed);
+        } else if (is_indexed) {
+            vertex_cache.Validate(ComputeVertexCacheKey());
+        }
+
+        if (!g_state.geometry_pipeline.NeedIndexInput() &&
+            regs.pipeline.num_vertices >= MIN_BATCHED_VERTICES) {
+            ShadeVerticesBatched(loader, *shader_engine, base_address, is_indexed,
+                                 index_address_8, index_u16);
+            VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+            break;
         }
 
         for (unsigned int index = 0; index < regs.pipeline.num_vertices; ++index) {
@@ -323,39 +592,29 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                 is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index])
                            : (index + regs.pipeline.vertex_offset);
 
-            bool vertex_cache_hit = false;
-
             if (is_indexed) {
                 if (g_state.geometry_pipeline.NeedIndexInput()) {
                     g_state.geometry_pipeline.SubmitIndex(vertex);
                     continue;
                 }
 
-                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
-                    if (vertex_cache_valid[i] && vertex == vertex_cache_ids[i]) {
-                        vs_output = vertex_cache[i];
-                        vertex_cache_hit = true;
-                        break;
-                    }
+                if (const Shader::AttributeBuffer* cached = vertex_cache.Find(vertex)) {
+                    g_state.geometry_pipeline.SubmitVertex(*cached);
+                    continue;
                 }
             }
 
-            if (!vertex_cache_hit) {
-                // Initialize data for the current vertex
-                Shader::AttributeBuffer input;
-                loader.LoadVertex(base_address, index, vertex, input);
-
-                // Send to vertex shader
-                shader_unit.LoadInput(regs.vs, input);
-                shader_engine->Run(g_state.vs, shader_unit);
-                shader_unit.WriteOutput(regs.vs, vs_output);
-
-                if (is_indexed) {
-                    vertex_cache[vertex_cache_pos] = vs_output;
-                    vertex_cache_valid[vertex_cache_pos] = true;
-                    vertex_cache_ids[vertex_cache_pos] = vertex;
-                    vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
-                }
+            // Initialize data for the current vertex
+            Shader::AttributeBuffer input;
+            loader.LoadVertex(base_address, index, vertex, input);
+
+            // Send to vertex shader
+            shader_unit.LoadInput(regs.vs, input);
+            shader_engine->Run(g_state.vs, shader_unit);
+            shader_unit.WriteOutput(regs.vs, vs_output);
+
+            if (is_indexed) {
+                vertex_cache.Output(vertex_cache.Insert(vertex)) = vs_output;
             }
 
             // Send to geometry pipeline
@@ -579,6 +838,9 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 }
 
 void ProcessCommandList(const u32* list, u32 size) {
+    // The CPU may have rewritten vertex data since the previous command list
+    vertex_cache.Invalidate();
+
     g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = list;
     g_state.cmd_list.length = size / sizeof(u32);
 
@@ -598,6 +860,9 @@ void ProcessCommandList(const u32* list, u32 size) {
             WritePicaReg(cmd, *g_state.cmd_list.current_ptr++, header.parameter_mask);
         }
     }
+
+    // The triangles have to be in the framebuffer before the CPU or a display transfer reads it
+    FlushImmediateDraw();
 }
 
 } // namespace Pica::CommandProcessor
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <type_traits>
 #include "common/bit_field.h"
 #include "common/common_types.h"
@@ -32,6 +33,16 @@ static_assert(std::is_standard_layout<CommandHeader>::value == true,
               "CommandHeader does not use standard layout");
 static_assert(sizeof(CommandHeader) == sizeof(u32), "CommandHeader has incorrect size!");
 
+/// Counters of the draws sent to the rasterizer, readable from any thread
+struct DrawStats {
+    /// Draws issued to the rasterizer
+    std::atomic<u64> issued{0};
+    /// Immediate mode vertices added to a pending draw instead of issuing their own
+    std::atomic<u64> merged{0};
+};
+
+extern DrawStats g_draw_stats;
+
 void ProcessCommandList(const u32* list, u32 size);
 
 } // namespace Pica::CommandProcessor
@@ -0,0 +1,99 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/assert.h"
+#include "core/hle/service/gsp/gsp.h"
+#include "video_core/gpu_thread.h"
+
+namespace VideoCore {
+
+GPUThread::GPUThread() : thread([this] { ThreadLoop(); }) {}
+
+GPUThread::~GPUThread() {
+    queue.Push(Work{});
+    thread.join();
+}
+
+u64 GPUThread::Push(std::function<void()> work) {
+    DEBUG_ASSERT(!IsGPUThread());
+    queue.Push(Work{++last_fence, std::move(work)});
+    return last_fence;
+}
+
+void GPUThread::WaitForFence(u64 fence) {
+    // Fences from save states may be from the future
+    fence = std::min(fence, last_fence);
+
+    if (completed_fence.load(std::memory_order_acquire) >= fence) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(completed_mutex);
+    completed_cv.wait(lock, [&] { return completed_fence.load() >= fence; });
+}
+
+void GPUThread::WaitIdle() {
+    WaitForFence(last_fence);
+}
+
+void GPUThread::DeferInterrupt(Service::GSP::InterruptId interrupt_id) {
+    DEBUG_ASSERT(IsGPUThread());
+    std::lock_guard<std::mutex> lock(deferred_mutex);
+    deferred.push_back({running_fence, interrupt_id});
+}
+
+void GPUThread::RunDeferred(u64 fence) {
+    std::vector<DeferredInterrupt> ready;
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        const auto itr =
+            std::find_if(deferred.begin(), deferred.end(),
+                         [fence](const DeferredInterrupt& entry) { return entry.fence > fence; });
+        ready.assign(deferred.begin(), itr);
+        deferred.erase(deferred.begin(), itr);
+    }
+
+    for (const DeferredInterrupt& entry : ready) {
+        Service::GSP::SignalInterrupt(entry.interrupt_id);
+    }
+}
+
+std::vector<DeferredInterrupt> GPUThread::GetDeferred() {
+    DEBUG_ASSERT(!IsGPUThread());
+    std::lock_guard<std::mutex> lock(deferred_mutex);
+    return deferred;
+}
+
+void GPUThread::RestoreDeferred(u64 fence, std::vector<DeferredInterrupt> interrupts) {
+    DEBUG_ASSERT(!IsGPUThread());
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex);
+        last_fence = fence;
+        completed_fence.store(fence, std::memory_order_release);
+    }
+
+    std::lock_guard<std::mutex> lock(deferred_mutex);
+    deferred = std::move(interrupts);
+}
+
+void GPUThread::ThreadLoop() {
+    while (true) {
+        Work work = queue.PopWait();
+        if (!work.function) {
+            return;
+        }
+
+        running_fence = work.fence;
+        work.function();
+
+        {
+            std::lock_guard<std::mutex> lock(completed_mutex);
+            completed_fence.store(work.fence, std::memory_order_release);
+        }
+        completed_cv.notify_all();
+    }
+}
+
+} // namespace VideoCore
@@ -0,0 +1,104 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+#include "common/threadsafe_queue.h"
+
+namespace Service::GSP {
+enum class InterruptId : u8;
+} // namespace Service::GSP
+
+namespace VideoCore {
+
+/// A GSP interrupt waiting for the CPU thread to reach the fence of the work that raised it
+struct DeferredInterrupt {
+    u64 fence;
+    Service::GSP::InterruptId interrupt_id;
+};
+
+/**
+ * Runs PICA command lists, memory fills and display transfers of the software renderer on a
+ * dedicated host thread. The hardware renderer's OpenGL context is bound to the CPU thread, so it
+ * doesn't use this.
+ * Work is queued in order by the emulated CPU thread and tagged with an increasing fence. The GSP
+ * interrupts the work raises are deferred until the CPU thread reaches the work's completion
+ * event, so they're delivered at the same emulated time no matter how fast the host thread is.
+ */
+class GPUThread {
+public:
+    GPUThread();
+    ~GPUThread();
+
+    /// Queues work, returns its fence. Must be called from the CPU thread.
+    u64 Push(std::function<void()> work);
+
+    /// Waits until the work with the given fence and everything queued before it finished
+    void WaitForFence(u64 fence);
+
+    /// Waits until all queued work finished
+    void WaitIdle();
+
+    /// Queues a GSP interrupt to be signaled on the CPU thread once it reaches the fence of the
+    /// running work. Must be called from the GPU thread.
+    void DeferInterrupt(Service::GSP::InterruptId interrupt_id);
+
+    /// Signals the deferred interrupts of work up to and including the given fence, in order.
+    /// Must be called from the CPU thread.
+    void RunDeferred(u64 fence);
+
+    /// Returns the fence of the last queued work
+    u64 GetLastFence() const {
+        return last_fence;
+    }
+
+    /// Gets the interrupts that haven't been signaled yet with the fence of their work.
+    /// Must be called from the CPU thread while the GPU thread is idle.
+    std::vector<DeferredInterrupt> GetDeferred();
+
+    /**
+     * Replaces the fences and deferred interrupts with ones from a save state, treating all
+     * work up to `fence` as done. Must be called from the CPU thread while the GPU thread is idle.
+     */
+    void RestoreDeferred(u64 fence, std::vector<DeferredInterrupt> interrupts);
+
+    bool IsGPUThread() const {
+        return std::this_thread::get_id() == thread.get_id();
+    }
+
+private:
+    struct Work {
+        u64 fence = 0;
+        std::function<void()> function; ///< Empty to stop the thread
+    };
+
+    void ThreadLoop();
+
+    Common::SPSCQueue<Work> queue;
+
+    /// Written by the CPU thread only
+    u64 last_fence = 0;
+
+    /// Written by the GPU thread only
+    u64 running_fence = 0;
+
+    std::atomic<u64> completed_fence{0};
+    std::mutex completed_mutex;
+    std::condition_variable completed_cv;
+
+    std::mutex deferred_mutex;
+    std::vector<DeferredInterrupt> deferred;
+
+    std::thread thread;
+};
+
+} // namespace VideoCore
@@ -4,6 +4,7 @@
 
 #include <cstring>
 #include <type_traits>
+#include "core/savestate.h"
 #include "video_core/geometry_pipeline.h"
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
@@ -62,4 +63,70 @@ void State::Reset() {
     default_attr_write_buffer.fill(0);
 }
 
+namespace {
+
+/// Calls `function` with each part of the Pica state that's saved, in the order they're saved
+template <typename Function>
+void ForEachSavedPart(Function&& function) {
+    const auto shader_setup = [&function](Shader::ShaderSetup& setup) {
+        function(setup.uniforms);
+        function(setup.program_code);
+        function(setup.swizzle_data);
+        function(setup.engine_data.entry_point);
+    };
+
+    function(g_state.regs);
+    shader_setup(g_state.vs);
+    shader_setup(g_state.gs);
+    function(g_state.input_default_attributes);
+    function(g_state.proctex);
+    function(g_state.lighting);
+    function(g_state.fog);
+    function(g_state.immediate.input_vertex);
+    function(g_state.immediate.current_attribute);
+    function(g_state.gs_unit.registers);
+    function(g_state.gs_unit.conditional_code);
+    function(g_state.gs_unit.address_registers);
+    function(g_state.vs_float_regs_counter);
+    function(g_state.vs_uniform_write_buffer);
+    function(g_state.gs_float_regs_counter);
+    function(g_state.gs_uniform_write_buffer);
+    function(g_state.default_attr_counter);
+    function(g_state.default_attr_write_buffer);
+}
+
+} // namespace
+
+void SaveState(Core::StateWriter& writer) {
+    ForEachSavedPart([&writer](const auto& part) { writer.Write(part); });
+}
+
+const u8* ReadState(Core::StateReader& reader) {
+    std::size_t size = 0;
+    ForEachSavedPart([&size](const auto& part) { size += sizeof(part); });
+    return reader.ReadSpan(size);
+}
+
+void RestoreState(const u8* data) {
+    ForEachSavedPart([&data](auto& part) {
+        static_assert(std::is_trivially_copyable_v<std::decay_t<decltype(part)>>);
+        std::memcpy(&part, data, sizeof(part));
+        data += sizeof(part);
+    });
+
+    for (Shader::ShaderSetup* setup : {&g_state.vs, &g_state.gs}) {
+        setup->engine_data.cached_shader = nullptr;
+        setup->MarkProgramCodeDirty();
+        setup->MarkSwizzleDataDirty();
+    }
+
+    Zero(g_state.cmd_list);
+    g_state.immediate.reset_geometry_pipeline = true;
+    g_state.primitive_assembler.Reconfigure(g_state.regs.pipeline.triangle_topology);
+
+    for (u32 id = 0; id < Regs::NUM_REGS; ++id) {
+        VideoCore::g_renderer->Rasterizer()->NotifyPicaRegisterChanged(id);
+    }
+}
+
 } // namespace Pica
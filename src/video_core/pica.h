@@ -5,6 +5,12 @@
 #pragma once
 
 #include "video_core/regs_texturing.h"
+
+namespace Core {
+class StateReader;
+class StateWriter;
+} // namespace Core
+
 namespace Pica {
 
 /// Initialize Pica state
@@ -13,4 +19,17 @@ void Init();
 /// Shutdown Pica state
 void Shutdown();
 
+/// Serializes the Pica state
+void SaveState(Core::StateWriter& writer);
+
+/**
+ * Reads the Pica state serialized by SaveState without changing the current state.
+ * @returns A pointer to the serialized state, to be passed to RestoreState, or nullptr if the
+ * state is truncated.
+ */
+const u8* ReadState(Core::StateReader& reader);
+
+/// Restores the Pica state read by ReadState and resynchronizes the rasterizer with it
+void RestoreState(const u8* data);
+
 } // namespace Pica
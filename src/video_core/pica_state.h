@@ -141,6 +141,9 @@ struct State {
         u32 current_attribute = 0;
         // Indicates the immediate mode just started and the geometry pipeline needs to reconfigure
         bool reset_geometry_pipeline = true;
+        // Indicates vertices were submitted since the last draw, their triangles are batched in
+        // the rasterizer until a register they're drawn with changes
+        bool draw_pending = false;
     } immediate;
 
     // the geometry shader needs to be kept in the global state because some shaders relie on
@@ -0,0 +1,83 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "core/hw/gpu.h"
+
+namespace OpenGL {
+struct ScreenInfo;
+} // namespace OpenGL
+
+namespace Pica::Shader {
+struct OutputVertex;
+} // namespace Pica::Shader
+
+namespace VideoCore {
+
+/// Backend the PICA command processor and the memory system draw and sync through
+class RasterizerInterface {
+public:
+    virtual ~RasterizerInterface() = default;
+
+    /// Queues the primitive formed by the given vertices for rendering
+    virtual void AddTriangle(const Pica::Shader::OutputVertex& v0,
+                             const Pica::Shader::OutputVertex& v1,
+                             const Pica::Shader::OutputVertex& v2) = 0;
+
+    /// Draws the queued primitives
+    virtual void DrawTriangles() = 0;
+
+    /// Notifies the rasterizer that the specified PICA register changed
+    virtual void NotifyPicaRegisterChanged(u32 id) = 0;
+
+    /// Writes everything the rasterizer holds back to emulated memory
+    virtual void FlushAll() = 0;
+
+    /// Writes any cached resources overlapping the region back to emulated memory
+    virtual void FlushRegion(PAddr addr, u32 size) = 0;
+
+    /// Drops any cached resources overlapping the region
+    virtual void InvalidateRegion(PAddr addr, u32 size) = 0;
+
+    /// Writes back and drops any cached resources overlapping the region
+    virtual void FlushAndInvalidateRegion(PAddr addr, u32 size) = 0;
+
+    /// Attempts to do a display transfer, returns false if the caller has to do it on the CPU
+    virtual bool AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) {
+        return false;
+    }
+
+    /// Attempts to do a texture copy, returns false if the caller has to do it on the CPU
+    virtual bool AccelerateTextureCopy(const GPU::Regs::DisplayTransferConfig& config) {
+        return false;
+    }
+
+    /// Attempts to do a memory fill, returns false if the caller has to do it on the CPU
+    virtual bool AccelerateFill(const GPU::Regs::MemoryFillConfig& config) {
+        return false;
+    }
+
+    /// Attempts to use a cached surface as the screen, returns false if the screen has to be
+    /// loaded from emulated memory
+    virtual bool AccelerateDisplay(const GPU::Regs::FramebufferConfig& config,
+                                   PAddr framebuffer_addr, u32 pixel_stride,
+                                   OpenGL::ScreenInfo& screen_info) {
+        return false;
+    }
+
+    /// Attempts to draw the current batch with the vertex shader running on the host GPU,
+    /// returns false if the vertices have to be shaded on the CPU
+    virtual bool AccelerateDrawBatch(bool is_indexed) {
+        return false;
+    }
+
+    /// Drops all cached resources without writing them back
+    virtual void ClearCache() {}
+
+    virtual void LoadDiskShaderCache() {}
+};
+
+} // namespace VideoCore
@@ -0,0 +1,116 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "core/frontend/emu_window.h"
+#include "video_core/renderer/async_shader_compiler.h"
+#include "video_core/renderer/shader_util.h"
+
+namespace OpenGL {
+
+AsyncShaderCompiler::AsyncShaderCompiler(std::unique_ptr<Frontend::GraphicsContext> context)
+    : context(std::move(context)) {
+    thread = std::thread([this] { ThreadLoop(); });
+}
+
+AsyncShaderCompiler::~AsyncShaderCompiler() {
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    job_cv.notify_one();
+    thread.join();
+
+    // Nobody is waiting for these anymore
+    for (const Result& result : results) {
+        if (result.program != 0) {
+            glDeleteProgram(result.program);
+        }
+    }
+}
+
+void AsyncShaderCompiler::Queue(std::function<std::optional<std::string>()> generate,
+                                GLenum type, Callback done) {
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back({std::move(generate), type, std::move(done)});
+    }
+    job_cv.notify_one();
+}
+
+void AsyncShaderCompiler::Poll() {
+    std::vector<Result> finished;
+    {
+        std::lock_guard lock(mutex);
+        if (results.empty()) {
+            return;
+        }
+        finished.swap(results);
+    }
+
+    for (Result& result : finished) {
+        result.done(result.program, result.code_hash, std::move(result.code));
+    }
+}
+
+void AsyncShaderCompiler::ThreadLoop() {
+    context->MakeCurrent();
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            job_cv.wait(lock, [this] { return stop || !jobs.empty(); });
+            if (stop) {
+                break;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        std::optional<std::string> code = job.generate();
+        if (!code) {
+            std::lock_guard lock(mutex);
+            results.push_back({0, 0, {}, std::move(job.done)});
+            continue;
+        }
+
+        const char* const source = code->c_str();
+        const GLuint shader = glCreateShader(job.type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLuint program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        if (GLAD_GL_ARB_get_program_binary) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            LogShaderErrors(shader, program);
+            glDeleteProgram(program);
+            program = 0;
+        } else {
+            glDetachShader(program, shader);
+        }
+        glDeleteShader(shader);
+
+        // The drawing thread may only use the program once this context is done with it
+        glFinish();
+
+        const u64 code_hash = Common::ComputeHash64(code->data(), code->size());
+        std::lock_guard lock(mutex);
+        results.push_back({program, code_hash, std::move(*code), std::move(job.done)});
+    }
+
+    context->DoneCurrent();
+}
+
+} // namespace OpenGL
@@ -0,0 +1,81 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_types.h"
+
+namespace Frontend {
+class GraphicsContext;
+} // namespace Frontend
+
+namespace OpenGL {
+
+/**
+ * Generates and compiles separable programs on a thread with its own OpenGL context, which shares
+ * its objects with the context of the thread that draws.
+ */
+class AsyncShaderCompiler : NonCopyable {
+public:
+    /**
+     * Called on the drawing thread once a program finished compiling
+     * @param program The linked program, owned by the callee, or 0 if generating or linking failed
+     * @param code_hash Hash of the code of the program
+     * @param code The code of the program
+     */
+    using Callback = std::function<void(GLuint program, u64 code_hash, std::string code)>;
+
+    /// @param context Context sharing its objects with the one current on the calling thread
+    explicit AsyncShaderCompiler(std::unique_ptr<Frontend::GraphicsContext> context);
+    ~AsyncShaderCompiler();
+
+    /**
+     * Queues a separable program
+     * @param generate Returns the code of the program or nothing, runs on the compiler thread
+     * @param type Type of the shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
+     * @param done Called by Poll once the program is ready
+     */
+    void Queue(std::function<std::optional<std::string>()> generate, GLenum type, Callback done);
+
+    /// Calls the callbacks of the programs that finished compiling since the last call
+    void Poll();
+
+private:
+    struct Job {
+        std::function<std::optional<std::string>()> generate;
+        GLenum type;
+        Callback done;
+    };
+
+    struct Result {
+        GLuint program;
+        u64 code_hash;
+        std::string code;
+        Callback done;
+    };
+
+    void ThreadLoop();
+
+    std::unique_ptr<Frontend::GraphicsContext> context;
+
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::deque<Job> jobs;
+    std::vector<Result> results;
+    bool stop = false;
+
+    std::thread thread;
+};
+
+} // namespace OpenGL
@@ -0,0 +1,138 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <emmintrin.h>
+#include "common/common_types.h"
+#include "video_core/renderer/surface_params.h"
+#include "video_core/utils.h"
+
+namespace OpenGL {
+
+/// MortonCopyTile for any pixel format, one pixel at a time
+template <bool morton_to_gl, SurfaceParams::PixelFormat format>
+void MortonCopyTileGeneric(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
+    constexpr u32 gl_bytes_per_pixel = SurfaceParams::GetGLBytesPerPixel(format);
+    for (u32 y = 0; y < 8; ++y) {
+        for (u32 x = 0; x < 8; ++x) {
+            u8* tile_ptr = tile_buffer + VideoCore::MortonInterleave(x, y) * bytes_per_pixel;
+            u8* gl_ptr = gl_buffer + ((7 - y) * stride + x) * gl_bytes_per_pixel;
+            if constexpr (morton_to_gl) {
+                if constexpr (format == SurfaceParams::PixelFormat::D24S8) {
+                    gl_ptr[0] = tile_ptr[3];
+                    std::memcpy(gl_ptr + 1, tile_ptr, 3);
+                } else {
+                    std::memcpy(gl_ptr, tile_ptr, bytes_per_pixel);
+                }
+            } else {
+                if constexpr (format == SurfaceParams::PixelFormat::D24S8) {
+                    std::memcpy(tile_ptr, gl_ptr + 1, 3);
+                    tile_ptr[3] = gl_ptr[0];
+                } else {
+                    std::memcpy(tile_ptr, gl_ptr, bytes_per_pixel);
+                }
+            }
+        }
+    }
+}
+
+// In an 8x8 Morton ordered tile, the pixels x and x + 1 of the rows y and y + 1 for even x and y
+// form a 2x2 block of consecutive pixels. These are the indices of the blocks of the pixels
+// (0, y), (2, y), (4, y) and (6, y) relative to the block of the pixel (0, y), and of the block of
+// the pixel (0, y) for every even y.
+constexpr std::array<u32, 4> morton_block_offsets{0, 4, 16, 20};
+constexpr std::array<u32, 4> morton_row_pair_offsets{0, 8, 32, 40};
+
+/// MortonCopyTile for 32-bit pixels. D24S8 moves the stencil from the highest to the lowest byte.
+template <bool morton_to_gl, bool is_d24s8>
+void MortonCopyTile32(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    const auto convert = [](__m128i pixels) {
+        if constexpr (!is_d24s8) {
+            return pixels;
+        } else if constexpr (morton_to_gl) {
+            return _mm_or_si128(_mm_slli_epi32(pixels, 8), _mm_srli_epi32(pixels, 24));
+        } else {
+            return _mm_or_si128(_mm_srli_epi32(pixels, 8), _mm_slli_epi32(pixels, 24));
+        }
+    };
+
+    for (u32 y = 0; y < 8; y += 2) {
+        u8* const blocks = tile_buffer + morton_row_pair_offsets[y / 2] * 4;
+        u8* const row0 = gl_buffer + (7 - y) * stride * 4;
+        u8* const row1 = row0 - stride * 4;
+        for (u32 x = 0; x < 8; x += 4) {
+            // Two blocks hold the pixels x to x + 3 of both rows
+            const u32 block = x / 2;
+            auto* const block0 =
+                reinterpret_cast<__m128i*>(blocks + morton_block_offsets[block] * 4);
+            auto* const block1 =
+                reinterpret_cast<__m128i*>(blocks + morton_block_offsets[block + 1] * 4);
+            auto* const dest0 = reinterpret_cast<__m128i*>(row0 + x * 4);
+            auto* const dest1 = reinterpret_cast<__m128i*>(row1 + x * 4);
+            if constexpr (morton_to_gl) {
+                const __m128i a = convert(_mm_loadu_si128(block0));
+                const __m128i b = convert(_mm_loadu_si128(block1));
+                _mm_storeu_si128(dest0, _mm_unpacklo_epi64(a, b));
+                _mm_storeu_si128(dest1, _mm_unpackhi_epi64(a, b));
+            } else {
+                const __m128i a = convert(_mm_loadu_si128(dest0));
+                const __m128i b = convert(_mm_loadu_si128(dest1));
+                _mm_storeu_si128(block0, _mm_unpacklo_epi64(a, b));
+                _mm_storeu_si128(block1, _mm_unpackhi_epi64(a, b));
+            }
+        }
+    }
+}
+
+/// MortonCopyTile for 16-bit pixels
+template <bool morton_to_gl>
+void MortonCopyTile16(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    for (u32 y = 0; y < 8; y += 2) {
+        u8* const blocks = tile_buffer + morton_row_pair_offsets[y / 2] * 2;
+        auto* const blocks0 = reinterpret_cast<__m128i*>(blocks);
+        auto* const blocks1 = reinterpret_cast<__m128i*>(blocks + morton_block_offsets[2] * 2);
+        auto* const dest0 = reinterpret_cast<__m128i*>(gl_buffer + (7 - y) * stride * 2);
+        auto* const dest1 = reinterpret_cast<__m128i*>(gl_buffer + (6 - y) * stride * 2);
+        // Seen as 32-bit lanes, the four blocks of pixels 0 to 3 hold the pixel pairs
+        // {row 0 x 0-1, row 1 x 0-1, row 0 x 2-3, row 1 x 2-3}. Swapping the middle lanes, which
+        // is its own inverse, groups the pairs of each row.
+        if constexpr (morton_to_gl) {
+            const __m128i a = _mm_shuffle_epi32(_mm_loadu_si128(blocks0), _MM_SHUFFLE(3, 1, 2, 0));
+            const __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(blocks1), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(dest0, _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128(dest1, _mm_unpackhi_epi64(a, b));
+        } else {
+            const __m128i a = _mm_loadu_si128(dest0);
+            const __m128i b = _mm_loadu_si128(dest1);
+            _mm_storeu_si128(blocks0,
+                             _mm_shuffle_epi32(_mm_unpacklo_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+            _mm_storeu_si128(blocks1,
+                             _mm_shuffle_epi32(_mm_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+    }
+}
+
+/**
+ * Copies an 8x8 tile between its Morton ordered pixels in 3DS memory and its rows in gl_buffer, the
+ * last row first. stride is the number of pixels in a row of gl_buffer.
+ */
+template <bool morton_to_gl, SurfaceParams::PixelFormat format>
+void MortonCopyTile(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
+    constexpr u32 gl_bytes_per_pixel = SurfaceParams::GetGLBytesPerPixel(format);
+    if constexpr (bytes_per_pixel == 4 && gl_bytes_per_pixel == 4) {
+        constexpr bool is_d24s8 = format == SurfaceParams::PixelFormat::D24S8;
+        MortonCopyTile32<morton_to_gl, is_d24s8>(stride, tile_buffer, gl_buffer);
+    } else if constexpr (bytes_per_pixel == 2 && gl_bytes_per_pixel == 2) {
+        MortonCopyTile16<morton_to_gl>(stride, tile_buffer, gl_buffer);
+    } else {
+        MortonCopyTileGeneric<morton_to_gl, format>(stride, tile_buffer, gl_buffer);
+    }
+}
+
+} // namespace OpenGL
@@ -15,6 +15,7 @@
 #include "common/scope_exit.h"
 #include "common/vector_math.h"
 #include "core/hw/gpu.h"
+#include "core/settings.h"
 #include "video_core/pica_state.h"
 #include "video_core/regs_framebuffer.h"
 #include "video_core/regs_rasterizer.h"
@@ -39,7 +40,7 @@ static bool NeedToEnableHacks() {
            gpu_renderer == "Intel(R) HD Graphics 5500";
 }
 
-RasterizerOpenGL::RasterizerOpenGL()
+RasterizerOpenGL::RasterizerOpenGL(Frontend::EmuWindow& emu_window)
     : enable_hacks(NeedToEnableHacks()),
       vertex_buffer(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, enable_hacks),
       uniform_buffer(GL_UNIFORM_BUFFER, UNIFORM_BUFFER_SIZE, false),
@@ -155,8 +156,8 @@ RasterizerOpenGL::RasterizerOpenGL()
     state.Apply();
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer.GetHandle());
 
-    shader_program_manager =
-        std::make_unique<ShaderProgramManager>(GLAD_GL_ARB_separate_shader_objects, enable_hacks);
+    shader_program_manager = std::make_unique<ShaderProgramManager>(
+        GLAD_GL_ARB_separate_shader_objects, enable_hacks, emu_window);
 
     glEnable(GL_BLEND);
 
@@ -626,6 +627,7 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
 
     // Sync and bind the texture surfaces
     const auto pica_textures = regs.texturing.GetTextures();
+    std::array<Surface, 3> texture_surfaces;
     for (unsigned texture_index = 0; texture_index < pica_textures.size(); ++texture_index) {
         const auto& texture = pica_textures[texture_index];
 
@@ -744,6 +746,7 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
             if (surface != nullptr) {
                 CheckDuplicateTextureOrBarrier(state.texture_units[texture_index].texture_2d =
                                                    surface->texture.handle);
+                texture_surfaces[texture_index] = std::move(surface);
             } else {
                 // Can occur when texture address is null or its memory is unmapped/invalid
                 // HACK: In this case, the correct behaviour for the PICA is to use the last
@@ -759,6 +762,18 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
         }
     }
 
+    // Textures loaded asynchronously are only waited for now, so that all of them are decoded in
+    // parallel
+    for (std::size_t texture_index = 0; texture_index < texture_surfaces.size(); ++texture_index) {
+        const Surface& surface = texture_surfaces[texture_index];
+        if (surface != nullptr &&
+            !res_cache.CompleteUploads(surface,
+                                       !Settings::values.async_texture_upload_placeholders)) {
+            // Draw with a placeholder until the texture is decoded
+            state.texture_units[texture_index].texture_2d = default_texture;
+        }
+    }
+
     OGLTexture temp_tex;
     if (need_duplicate_texture_or_barrier && GLAD_GL_ARB_copy_image) {
         // Using a surface as a texture and framebuffer at the same time
@@ -796,10 +811,11 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
         }
     }
 
-    // Sync and bind the shader
+    // Sync and bind the shader. While the uber shader stands in for the fragment shader, check
+    // on every draw whether the fragment shader finished compiling.
     if (shader_dirty) {
         SetShader();
-        shader_dirty = false;
+        shader_dirty = shader_program_manager->IsFragmentShaderPending();
     }
 
     // Sync the LUTs within the texture buffer
@@ -16,6 +16,7 @@
 #include "core/hw/gpu.h"
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
+#include "video_core/rasterizer_interface.h"
 #include "video_core/regs_framebuffer.h"
 #include "video_core/regs_lighting.h"
 #include "video_core/regs_rasterizer.h"
@@ -37,27 +38,27 @@ namespace OpenGL {
 
 class ShaderProgramManager;
 
-class RasterizerOpenGL {
+class RasterizerOpenGL : public VideoCore::RasterizerInterface {
 public:
-    RasterizerOpenGL();
-    ~RasterizerOpenGL();
+    explicit RasterizerOpenGL(Frontend::EmuWindow& emu_window);
+    ~RasterizerOpenGL() override;
 
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
-                     const Pica::Shader::OutputVertex& v2);
-    void DrawTriangles();
-    void NotifyPicaRegisterChanged(u32 id);
-    void FlushAll();
-    void FlushRegion(PAddr addr, u32 size);
-    void InvalidateRegion(PAddr addr, u32 size);
-    void FlushAndInvalidateRegion(PAddr addr, u32 size);
-    bool AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config);
-    bool AccelerateTextureCopy(const GPU::Regs::DisplayTransferConfig& config);
-    bool AccelerateFill(const GPU::Regs::MemoryFillConfig& config);
+                     const Pica::Shader::OutputVertex& v2) override;
+    void DrawTriangles() override;
+    void NotifyPicaRegisterChanged(u32 id) override;
+    void FlushAll() override;
+    void FlushRegion(PAddr addr, u32 size) override;
+    void InvalidateRegion(PAddr addr, u32 size) override;
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
+    bool AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) override;
+    bool AccelerateTextureCopy(const GPU::Regs::DisplayTransferConfig& config) override;
+    bool AccelerateFill(const GPU::Regs::MemoryFillConfig& config) override;
     bool AccelerateDisplay(const GPU::Regs::FramebufferConfig& config, PAddr framebuffer_addr,
-                           u32 pixel_stride, ScreenInfo& screen_info);
-    bool AccelerateDrawBatch(bool is_indexed);
-    void ClearCache();
-    void LoadDiskShaderCache();
+                           u32 pixel_stride, ScreenInfo& screen_info) override;
+    bool AccelerateDrawBatch(bool is_indexed) override;
+    void ClearCache() override;
+    void LoadDiskShaderCache() override;
 
 private:
     struct SamplerInfo {
@@ -12,7 +12,6 @@
 #include <iterator>
 #include <memory>
 #include <optional>
-#include <stb_image.h>
 #include <stb_image_write.h>
 #include <unordered_set>
 #include <utility>
@@ -24,6 +23,7 @@
 #include "common/math_util.h"
 #include "common/scope_exit.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/core.h"
 #include "core/custom_tex_cache.h"
@@ -31,13 +31,17 @@
 #include "core/hle/kernel/process.h"
 #include "core/memory.h"
 #include "core/settings.h"
+#include "core/texture_disk_cache.h"
 #include "video_core/pica_state.h"
 #include "video_core/renderer/format_reinterpreter.h"
+#include "video_core/renderer/morton_copy.h"
 #include "video_core/renderer/rasterizer_cache.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/renderer/resource_manager.h"
 #include "video_core/renderer/state.h"
 #include "video_core/renderer/texture_filters/texture_filterer.h"
+#include "video_core/renderer/texture_uploader.h"
+#include "video_core/texture/tile_decode.h"
 #include "video_core/utils.h"
 #include "video_core/video_core.h"
 
@@ -46,6 +50,12 @@ namespace OpenGL {
 using SurfaceType = SurfaceParams::SurfaceType;
 using PixelFormat = SurfaceParams::PixelFormat;
 
+SurfaceCacheStats g_surface_cache_stats;
+
+static SurfaceCacheStats::Category& GetStatsCategory(SurfaceType type) {
+    return g_surface_cache_stats.categories[static_cast<std::size_t>(type)];
+}
+
 static constexpr std::array<FormatTuple, 5> fb_format_tuples = {{
     {GL_RGBA8, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8},     // RGBA8
     {GL_RGB8, GL_BGR, GL_UNSIGNED_BYTE},              // RGB8
@@ -142,39 +152,16 @@ static constexpr auto RangeFromInterval(Map& map, const Interval& interval) {
     return boost::make_iterator_range(map.equal_range(interval));
 }
 
-template <bool morton_to_gl, PixelFormat format>
-static void MortonCopyTile(u32 stride, u8* tile_buffer, u8* gl_buffer) {
-    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
-    constexpr u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(format);
-    for (u32 y = 0; y < 8; ++y) {
-        for (u32 x = 0; x < 8; ++x) {
-            u8* tile_ptr = tile_buffer + VideoCore::MortonInterleave(x, y) * bytes_per_pixel;
-            u8* gl_ptr = gl_buffer + ((7 - y) * stride + x) * gl_bytes_per_pixel;
-            if constexpr (morton_to_gl) {
-                if constexpr (format == PixelFormat::D24S8) {
-                    gl_ptr[0] = tile_ptr[3];
-                    std::memcpy(gl_ptr + 1, tile_ptr, 3);
-                } else {
-                    std::memcpy(gl_ptr, tile_ptr, bytes_per_pixel);
-                }
-            } else {
-                if constexpr (format == PixelFormat::D24S8) {
-                    std::memcpy(tile_ptr, gl_ptr + 1, 3);
-                    tile_ptr[3] = gl_ptr[0];
-                } else {
-                    std::memcpy(tile_ptr, gl_ptr, bytes_per_pixel);
-                }
-            }
-        }
-    }
-}
+/// Copies with at least this many tiles are spread across threads
+constexpr u32 MIN_PARALLEL_MORTON_TILES = 256;
+constexpr u32 MORTON_TILES_PER_CHUNK = 64;
 
 template <bool morton_to_gl, PixelFormat format>
 static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr start, PAddr end) {
     constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
     constexpr u32 tile_size = bytes_per_pixel * 64;
 
-    constexpr u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(format);
+    constexpr u32 gl_bytes_per_pixel = SurfaceParams::GetGLBytesPerPixel(format);
     static_assert(gl_bytes_per_pixel >= bytes_per_pixel, "");
     gl_buffer += gl_bytes_per_pixel - bytes_per_pixel;
 
@@ -184,52 +171,74 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
 
     ASSERT(!morton_to_gl || (aligned_start == start && aligned_end == end));
 
-    const u32 begin_pixel_index = (aligned_down_start - base) / bytes_per_pixel;
-    u32 x = (begin_pixel_index % (stride * 8)) / 8;
-    u32 y = (begin_pixel_index / (stride * 8)) * 8;
-
-    gl_buffer += ((height - 8 - y) * stride + x) * gl_bytes_per_pixel;
-
-    auto glbuf_next_tile = [&] {
-        x = (x + 8) % stride;
-        gl_buffer += 8 * gl_bytes_per_pixel;
-        if (!x) {
-            y += 8;
-            gl_buffer -= stride * 9 * gl_bytes_per_pixel;
-        }
+    // Gets the position in gl_buffer of the tile with the given index in the surface
+    const u32 tiles_per_row = stride / 8;
+    const auto get_gl_tile = [&](u32 index) {
+        const std::ptrdiff_t x = (index % tiles_per_row) * 8;
+        const std::ptrdiff_t y = (index / tiles_per_row) * 8;
+        return gl_buffer +
+               ((static_cast<std::ptrdiff_t>(height) - 8 - y) * stride + x) * gl_bytes_per_pixel;
     };
 
     u8* tile_buffer = VideoCore::g_memory->GetPhysicalPointer(start);
+    u32 tile = (aligned_down_start - base) / tile_size;
 
     if (start < aligned_start && !morton_to_gl) {
         std::array<u8, tile_size> tmp_buf;
-        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
+        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], get_gl_tile(tile));
         std::memcpy(tile_buffer, &tmp_buf[start - aligned_down_start],
                     std::min(aligned_start, end) - start);
 
         tile_buffer += aligned_start - start;
-        glbuf_next_tile();
+        ++tile;
     }
 
-    const u8* const buffer_end = tile_buffer + aligned_end - aligned_start;
-    PAddr current_paddr = aligned_start;
-    while (tile_buffer < buffer_end) {
-        // Pokemon Super Mystery Dungeon will try to use textures that go beyond
-        // the end address of VRAM. Stop reading if reaches invalid address
-        if (!VideoCore::g_memory->IsValidPhysicalAddress(current_paddr) ||
-            !VideoCore::g_memory->IsValidPhysicalAddress(current_paddr + tile_size)) {
+    u32 num_tiles = aligned_end > aligned_start ? (aligned_end - aligned_start) / tile_size : 0;
+
+    // Pokemon Super Mystery Dungeon will try to use textures that go beyond
+    // the end address of VRAM. Stop reading if reaches invalid address
+    const auto is_valid = [](PAddr addr) {
+        return VideoCore::g_memory->IsValidPhysicalAddress(addr);
+    };
+    if (num_tiles != 0 &&
+        !(is_valid(aligned_start) && is_valid(aligned_end) &&
+          VideoCore::g_memory->GetPhysicalPointer(aligned_end) - tile_buffer ==
+              static_cast<std::ptrdiff_t>(aligned_end - aligned_start))) {
+        u32 num_valid_tiles = 0;
+        for (PAddr current_paddr = aligned_start; num_valid_tiles < num_tiles &&
+                                                  is_valid(current_paddr) &&
+                                                  is_valid(current_paddr + tile_size);
+             current_paddr += tile_size) {
+            ++num_valid_tiles;
+        }
+        if (num_valid_tiles != num_tiles) {
             LOG_ERROR(Render_OpenGL, "Out of bound texture");
-            break;
+            num_tiles = num_valid_tiles;
+        }
+    }
+
+    const auto copy_tiles = [&](u32 first, u32 last) {
+        for (u32 i = first; i < last; ++i) {
+            MortonCopyTile<morton_to_gl, format>(stride, tile_buffer + i * tile_size,
+                                                 get_gl_tile(tile + i));
         }
-        MortonCopyTile<morton_to_gl, format>(stride, tile_buffer, gl_buffer);
-        tile_buffer += tile_size;
-        current_paddr += tile_size;
-        glbuf_next_tile();
+    };
+
+    if (num_tiles >= MIN_PARALLEL_MORTON_TILES) {
+        const u32 num_chunks = (num_tiles + MORTON_TILES_PER_CHUNK - 1) / MORTON_TILES_PER_CHUNK;
+        Common::GetThreadPool().ParallelForNoWait(num_chunks, [&](std::size_t chunk) {
+            const u32 first = static_cast<u32>(chunk) * MORTON_TILES_PER_CHUNK;
+            copy_tiles(first, std::min(first + MORTON_TILES_PER_CHUNK, num_tiles));
+        });
+    } else {
+        copy_tiles(0, num_tiles);
     }
+    tile_buffer += num_tiles * tile_size;
+    tile += num_tiles;
 
     if (end > std::max(aligned_start, aligned_end) && !morton_to_gl) {
         std::array<u8, tile_size> tmp_buf;
-        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
+        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], get_gl_tile(tile));
         std::memcpy(tile_buffer, &tmp_buf[0], end - aligned_end);
     }
 }
@@ -276,11 +285,35 @@ static constexpr std::array<void (*)(u32, u32, u8*, PAddr, PAddr, PAddr), 18> gl
     MortonCopy<false, PixelFormat::D24S8> // 17
 };
 
+// Estimate of the host memory used by a texture, drivers may pad it
+static u64 GetTextureBytes(const HostTextureTag& tag) {
+    u64 bytes_per_pixel;
+    switch (tag.format_tuple.internal_format) {
+    case GL_RGB8:
+        bytes_per_pixel = 3;
+        break;
+    case GL_RGB5_A1:
+    case GL_RGB565:
+    case GL_RGBA4:
+    case GL_DEPTH_COMPONENT16:
+        bytes_per_pixel = 2;
+        break;
+    default:
+        bytes_per_pixel = 4;
+        break;
+    }
+    return bytes_per_pixel * tag.width * tag.height;
+}
+
 // Allocate an uninitialized texture of appropriate size and format for the surface
 OGLTexture RasterizerCache::AllocateSurfaceTexture(const FormatTuple& format_tuple, u32 width,
                                                    u32 height) {
     auto recycled_tex = host_texture_recycler.find({format_tuple, width, height});
     if (recycled_tex != host_texture_recycler.end()) {
+        const u64 bytes = GetTextureBytes(recycled_tex->first);
+        memory_usage -= bytes;
+        g_surface_cache_stats.recycled_bytes -= bytes;
+
         OGLTexture texture = std::move(recycled_tex->second);
         host_texture_recycler.erase(recycled_tex);
         return texture;
@@ -470,15 +503,45 @@ static bool FillSurface(const Surface& surface, const u8* fill_data,
     return true;
 }
 
+void RasterizerCache::RecycleTexture(const HostTextureTag& tag, OGLTexture&& texture) {
+    const u64 bytes = GetTextureBytes(tag);
+    memory_usage += bytes;
+    g_surface_cache_stats.recycled_bytes += bytes;
+
+    host_texture_recycler.emplace(tag, std::move(texture));
+}
+
+void RasterizerCache::ReleaseRecycledTextures() {
+    for (const auto& [tag, texture] : host_texture_recycler) {
+        const u64 bytes = GetTextureBytes(tag);
+        memory_usage -= bytes;
+        g_surface_cache_stats.recycled_bytes -= bytes;
+    }
+    host_texture_recycler.clear();
+}
+
 CachedSurface::~CachedSurface() {
     if (texture.handle) {
-        auto tag = is_custom ? HostTextureTag{GetFormatTuple(PixelFormat::RGBA8),
-                                              custom_tex_info.width, custom_tex_info.height}
-                             : HostTextureTag{GetFormatTuple(pixel_format), GetScaledWidth(),
-                                              GetScaledHeight()};
+        owner.RecycleTexture(GetHostTextureTag(), std::move(texture));
+    }
+}
 
-        owner.host_texture_recycler.emplace(tag, std::move(texture));
+HostTextureTag CachedSurface::GetHostTextureTag() const {
+    return is_custom ? HostTextureTag{GetFormatTuple(PixelFormat::RGBA8), custom_tex_info.width,
+                                      custom_tex_info.height}
+                     : HostTextureTag{GetFormatTuple(pixel_format), GetScaledWidth(),
+                                      GetScaledHeight()};
+}
+
+u64 CachedSurface::GetHostMemoryUsage() const {
+    u64 bytes = gl_buffer.capacity();
+    if (texture.handle) {
+        const HostTextureTag tag = GetHostTextureTag();
+        for (u32 level = 0; level <= max_level; ++level) {
+            bytes += GetTextureBytes({tag.format_tuple, tag.width >> level, tag.height >> level});
+        }
     }
+    return bytes;
 }
 
 bool CachedSurface::CanFill(const SurfaceParams& dest_surface,
@@ -529,6 +592,9 @@ void RasterizerCache::CopySurface(const Surface& src_surface, const Surface& dst
 
     ASSERT(src_surface != dst_surface);
 
+    CompleteUploads(src_surface);
+    CompleteUploads(dst_surface);
+
     // This is only called when CanCopy is true, no need to run checks here
     if (src_surface->type == SurfaceType::Fill) {
         // FillSurface needs a 4 bytes buffer
@@ -595,14 +661,12 @@ void CachedSurface::LoadGLBuffer(PAddr load_start, PAddr load_end) {
             const auto rect = GetSubRect(FromInterval(load_interval));
             ASSERT(FromInterval(load_interval).GetInterval() == load_interval);
 
-            for (unsigned y = rect.bottom; y < rect.top; ++y) {
-                for (unsigned x = rect.left; x < rect.right; ++x) {
-                    auto vec4 =
-                        Pica::Texture::LookupTexture(texture_src_data, x, height - 1 - y, tex_info);
-                    const std::size_t offset = (x + (width * y)) * 4;
-                    std::memcpy(&gl_buffer[offset], vec4.AsArray(), 4);
-                }
-            }
+            // The rectangle covers whole tiles. OpenGL stores the rows bottom to top, so the
+            // texture is decoded starting from the last row of the buffer.
+            const std::ptrdiff_t gl_stride = static_cast<std::ptrdiff_t>(width) * 4;
+            Pica::Texture::DecodeTiles(texture_src_data, tex_info, rect.left / 8, rect.right / 8,
+                                       (height - rect.top) / 8, (height - rect.bottom) / 8,
+                                       &gl_buffer[(height - 1) * gl_stride], -gl_stride);
         } else {
             morton_to_gl_fns[static_cast<std::size_t>(pixel_format)](stride, height, &gl_buffer[0],
                                                                      addr, load_start, load_end);
@@ -661,31 +725,14 @@ bool CachedSurface::LoadCustomTexture(u64 tex_hash) {
     if (custom_tex_cache.IsTextureCached(tex_hash)) {
         custom_tex_info = custom_tex_cache.LookupTexture(tex_hash);
         return true;
+    } else if (custom_tex_cache.LoadPackedTexture(tex_hash, custom_tex_info)) {
+        return true;
     } else if (custom_tex_cache.CustomTextureExists(tex_hash)) {
         const Core::CustomTexPathInfo& path_info = custom_tex_cache.LookupTexturePathInfo(tex_hash);
-        unsigned char* image =
-            stbi_load(path_info.path.c_str(), reinterpret_cast<int*>(&custom_tex_info.width),
-                      reinterpret_cast<int*>(&custom_tex_info.height), nullptr, 4);
-        if (image != nullptr) {
-            custom_tex_info.tex.resize(custom_tex_info.width * custom_tex_info.height * 4);
-            std::memcpy(custom_tex_info.tex.data(), image, custom_tex_info.tex.size());
-            free(image);
-
-            // Make sure the texture size is a power of 2
-            std::bitset<32> width_bits(custom_tex_info.width);
-            std::bitset<32> height_bits(custom_tex_info.height);
-            if (width_bits.count() == 1 && height_bits.count() == 1) {
-                LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path_info.path);
-                Common::FlipRGBA8Texture(custom_tex_info.tex, custom_tex_info.width,
-                                         custom_tex_info.height);
-                custom_tex_cache.CacheTexture(path_info.hash, custom_tex_info.tex,
-                                              custom_tex_info.width, custom_tex_info.height);
-                return true;
-            } else {
-                LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2", path_info.path);
-            }
-        } else {
-            LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path_info.path);
+        if (custom_tex_cache.LoadTexture(path_info, custom_tex_info)) {
+            custom_tex_cache.CacheTexture(path_info.hash, custom_tex_info.tex,
+                                          custom_tex_info.width, custom_tex_info.height);
+            return true;
         }
     }
 
@@ -762,6 +809,41 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
         is_custom = LoadCustomTexture(tex_hash);
     }
 
+    // Filtered textures are kept in the texture disk cache, so later sessions can skip the filter
+    Core::TextureDiskCache& disk_cache = Core::System::GetInstance().TextureDiskCache();
+    std::optional<Core::TextureDiskCacheKey> disk_cache_key;
+    if (res_scale != 1 && type == SurfaceType::Texture && !is_custom &&
+        !Settings::values.dump_textures && disk_cache.IsOpen() &&
+        !owner.texture_filterer->IsNull() && rect.left == 0 && rect.bottom == 0 &&
+        rect.right == width && rect.top == height) {
+        if (tex_hash == 0) {
+            tex_hash = Common::ComputeHash64(gl_buffer.data(), gl_buffer.size());
+        }
+        const std::string_view filter_name = owner.texture_filterer->GetFilterName();
+        disk_cache_key = Core::TextureDiskCacheKey{
+            tex_hash, Common::ComputeHash64(filter_name.data(), filter_name.size()),
+            static_cast<u32>(pixel_format), res_scale};
+
+        const auto cached = disk_cache.Find(*disk_cache_key);
+        if (cached && cached->width == GetScaledWidth() && cached->height == GetScaledHeight()) {
+            OpenGLState cur_state = OpenGLState::GetCurState();
+            const GLuint old_tex = cur_state.texture_units[0].texture_2d;
+            cur_state.texture_units[0].texture_2d = texture.handle;
+            cur_state.Apply();
+
+            glActiveTexture(GL_TEXTURE0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(cached->width),
+                            static_cast<GLsizei>(cached->height), GL_RGBA, GL_UNSIGNED_BYTE,
+                            cached->data);
+
+            cur_state.texture_units[0].texture_2d = old_tex;
+            cur_state.Apply();
+
+            InvalidateAllWatcher();
+            return;
+        }
+    }
+
     // Load data from memory to the surface
     GLint x0 = static_cast<GLint>(rect.left);
     GLint y0 = static_cast<GLint>(rect.bottom);
@@ -838,6 +920,23 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
                                             scaled_rect, type, read_fb_handle, draw_fb_handle)) {
             BlitTextures(unscaled_tex.handle, from_rect, texture.handle, scaled_rect, type,
                          read_fb_handle, draw_fb_handle);
+        } else if (disk_cache_key) {
+            // Reading the texture back stalls, but only happens the first time a texture is seen
+            std::vector<u8> filtered(scaled_rect.GetWidth() * scaled_rect.GetHeight() * 4);
+
+            OpenGLState state = OpenGLState::GetCurState();
+            const GLuint old_tex = state.texture_units[0].texture_2d;
+            state.texture_units[0].texture_2d = texture.handle;
+            state.Apply();
+
+            glActiveTexture(GL_TEXTURE0);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, filtered.data());
+
+            state.texture_units[0].texture_2d = old_tex;
+            state.Apply();
+
+            disk_cache.Add(*disk_cache_key, scaled_rect.GetWidth(), scaled_rect.GetHeight(),
+                           filtered.data());
         }
     }
 
@@ -964,7 +1063,7 @@ static constexpr MatchFlags operator|(MatchFlags lhs, MatchFlags rhs) {
 
 /// Get the best surface match (and its match type) for the given flags
 template <MatchFlags find_flags>
-static Surface FindMatch(const SurfaceCache& surface_cache, const SurfaceParams& params,
+static Surface FindMatch(SurfaceIndex& surface_index, const SurfaceParams& params,
                          ScaleMatch match_scale_type,
                          std::optional<SurfaceInterval> validate_interval = std::nullopt) {
     Surface match_surface = nullptr;
@@ -972,86 +1071,84 @@ static Surface FindMatch(const SurfaceCache& surface_cache, const SurfaceParams&
     u32 match_scale = 0;
     SurfaceInterval match_interval{};
 
-    for (const auto& pair : RangeFromInterval(surface_cache, params.GetInterval())) {
-        for (const auto& surface : pair.second) {
-            const bool res_scale_matched = match_scale_type == ScaleMatch::Exact
-                                               ? (params.res_scale == surface->res_scale)
-                                               : (params.res_scale <= surface->res_scale);
-            // Validity will be checked in GetCopyableInterval
-            bool is_valid =
-                find_flags & MatchFlags::Copy
-                    ? true
-                    : surface->IsRegionValid(validate_interval.value_or(params.GetInterval()));
-
-            if (!(find_flags & MatchFlags::Invalid) && !is_valid) {
-                continue;
+    surface_index.ForEachOverlapping(params.addr, params.end, [&](const Surface& surface) {
+        const bool res_scale_matched = match_scale_type == ScaleMatch::Exact
+                                           ? (params.res_scale == surface->res_scale)
+                                           : (params.res_scale <= surface->res_scale);
+        // Validity will be checked in GetCopyableInterval
+        bool is_valid =
+            find_flags & MatchFlags::Copy
+                ? true
+                : surface->IsRegionValid(validate_interval.value_or(params.GetInterval()));
+
+        if (!(find_flags & MatchFlags::Invalid) && !is_valid) {
+            return;
+        }
+
+        auto IsMatch_Helper = [&](auto check_type, auto match_fn) {
+            if (!(find_flags & check_type)) {
+                return;
             }
 
-            auto IsMatch_Helper = [&](auto check_type, auto match_fn) {
-                if (!(find_flags & check_type)) {
-                    return;
-                }
+            bool matched;
+            SurfaceInterval surface_interval;
+            std::tie(matched, surface_interval) = match_fn();
+            if (!matched) {
+                return;
+            }
 
-                bool matched;
-                SurfaceInterval surface_interval;
-                std::tie(matched, surface_interval) = match_fn();
-                if (!matched) {
-                    return;
-                }
+            if (!res_scale_matched && match_scale_type != ScaleMatch::Ignore &&
+                surface->type != SurfaceType::Fill) {
+                return;
+            }
 
-                if (!res_scale_matched && match_scale_type != ScaleMatch::Ignore &&
-                    surface->type != SurfaceType::Fill) {
-                    return;
-                }
+            // Found a match, update only if this is better than the previous one
+            auto UpdateMatch = [&] {
+                match_surface = surface;
+                match_valid = is_valid;
+                match_scale = surface->res_scale;
+                match_interval = surface_interval;
+            };
 
-                // Found a match, update only if this is better than the previous one
-                auto UpdateMatch = [&] {
-                    match_surface = surface;
-                    match_valid = is_valid;
-                    match_scale = surface->res_scale;
-                    match_interval = surface_interval;
-                };
-
-                if (surface->res_scale > match_scale) {
-                    UpdateMatch();
-                    return;
-                } else if (surface->res_scale < match_scale) {
-                    return;
-                }
+            if (surface->res_scale > match_scale) {
+                UpdateMatch();
+                return;
+            } else if (surface->res_scale < match_scale) {
+                return;
+            }
 
-                if (is_valid && !match_valid) {
-                    UpdateMatch();
-                    return;
-                } else if (is_valid != match_valid) {
-                    return;
-                }
+            if (is_valid && !match_valid) {
+                UpdateMatch();
+                return;
+            } else if (is_valid != match_valid) {
+                return;
+            }
 
-                if (boost::icl::length(surface_interval) > boost::icl::length(match_interval)) {
-                    UpdateMatch();
-                }
-            };
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Exact>{}, [&] {
-                return std::make_pair(surface->ExactMatch(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::SubRect>{}, [&] {
-                return std::make_pair(surface->CanSubRect(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Copy>{}, [&] {
-                ASSERT(validate_interval);
-                auto copy_interval =
-                    params.FromInterval(*validate_interval).GetCopyableInterval(surface);
-                bool matched = boost::icl::length(copy_interval & *validate_interval) != 0 &&
-                               surface->CanCopy(params, copy_interval);
-                return std::make_pair(matched, copy_interval);
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Expand>{}, [&] {
-                return std::make_pair(surface->CanExpand(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::TexCopy>{}, [&] {
-                return std::make_pair(surface->CanTexCopy(params), surface->GetInterval());
-            });
-        }
-    }
+            if (boost::icl::length(surface_interval) > boost::icl::length(match_interval)) {
+                UpdateMatch();
+            }
+        };
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Exact>{}, [&] {
+            return std::make_pair(surface->ExactMatch(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::SubRect>{}, [&] {
+            return std::make_pair(surface->CanSubRect(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Copy>{}, [&] {
+            ASSERT(validate_interval);
+            auto copy_interval =
+                params.FromInterval(*validate_interval).GetCopyableInterval(surface);
+            bool matched = boost::icl::length(copy_interval & *validate_interval) != 0 &&
+                           surface->CanCopy(params, copy_interval);
+            return std::make_pair(matched, copy_interval);
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Expand>{}, [&] {
+            return std::make_pair(surface->CanExpand(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::TexCopy>{}, [&] {
+            return std::make_pair(surface->CanTexCopy(params), surface->GetInterval());
+        });
+    });
     return match_surface;
 }
 
@@ -1067,12 +1164,16 @@ RasterizerCache::RasterizerCache() {
 
 RasterizerCache::~RasterizerCache() {
     Clear();
+    ReleaseRecycledTextures();
 }
 
 void RasterizerCache::Clear() {
+    if (texture_uploader) {
+        texture_uploader->CompleteAll();
+    }
     FlushAll();
-    while (!surface_cache.empty()) {
-        UnregisterSurface(*surface_cache.begin()->second.begin());
+    for (const Surface& surface : surface_index.GetSurfaces()) {
+        UnregisterSurface(surface);
     }
     texture_cube_cache.clear();
 }
@@ -1086,6 +1187,9 @@ bool RasterizerCache::BlitSurfaces(const Surface& src_surface,
         return false;
     }
 
+    CompleteUploads(src_surface);
+    CompleteUploads(dst_surface);
+
     dst_surface->InvalidateAllWatcher();
 
     return BlitTextures(src_surface->texture.handle, src_rect, dst_surface->texture.handle,
@@ -1105,16 +1209,19 @@ Surface RasterizerCache::GetSurface(const SurfaceParams& params, ScaleMatch matc
 
     // Check for an exact match in existing surfaces
     Surface surface =
-        FindMatch<MatchFlags::Exact | MatchFlags::Invalid>(surface_cache, params, match_res_scale);
+        FindMatch<MatchFlags::Exact | MatchFlags::Invalid>(surface_index, params, match_res_scale);
 
-    if (surface == nullptr) {
+    if (surface != nullptr) {
+        ++GetStatsCategory(surface->type).hits;
+        TouchSurface(surface);
+    } else {
         u16 target_res_scale = params.res_scale;
         if (match_res_scale != ScaleMatch::Exact) {
             // This surface may have a subrect of another surface with a higher res_scale, find
             // it to adjust our params
             SurfaceParams find_params = params;
             Surface expandable = FindMatch<MatchFlags::Expand | MatchFlags::Invalid>(
-                surface_cache, find_params, match_res_scale);
+                surface_index, find_params, match_res_scale);
             if (expandable != nullptr && expandable->res_scale > target_res_scale) {
                 target_res_scale = expandable->res_scale;
             }
@@ -1122,7 +1229,7 @@ Surface RasterizerCache::GetSurface(const SurfaceParams& params, ScaleMatch matc
             if (params.pixel_format == PixelFormat::RGBA8) {
                 find_params.pixel_format = PixelFormat::D24S8;
                 expandable = FindMatch<MatchFlags::Expand | MatchFlags::Invalid>(
-                    surface_cache, find_params, match_res_scale);
+                    surface_index, find_params, match_res_scale);
                 if (expandable != nullptr && expandable->res_scale > target_res_scale) {
                     target_res_scale = expandable->res_scale;
                 }
@@ -1149,15 +1256,19 @@ SurfaceRect_Tuple RasterizerCache::GetSurfaceSubRect(const SurfaceParams& params
     }
 
     // Attempt to find encompassing surface
-    Surface surface = FindMatch<MatchFlags::SubRect | MatchFlags::Invalid>(surface_cache, params,
+    Surface surface = FindMatch<MatchFlags::SubRect | MatchFlags::Invalid>(surface_index, params,
                                                                            match_res_scale);
+    if (surface != nullptr) {
+        ++GetStatsCategory(surface->type).hits;
+        TouchSurface(surface);
+    }
 
     // Check if FindMatch failed because of res scaling
     // If that's the case create a new surface with
     // the dimensions of the lower res_scale surface
     // to suggest it should not be used again
     if (surface == nullptr && match_res_scale != ScaleMatch::Ignore) {
-        surface = FindMatch<MatchFlags::SubRect | MatchFlags::Invalid>(surface_cache, params,
+        surface = FindMatch<MatchFlags::SubRect | MatchFlags::Invalid>(surface_index, params,
                                                                        ScaleMatch::Ignore);
         if (surface != nullptr) {
             SurfaceParams new_params = *surface;
@@ -1178,7 +1289,7 @@ SurfaceRect_Tuple RasterizerCache::GetSurfaceSubRect(const SurfaceParams& params
 
     // Check for a surface we can expand before creating a new one
     if (surface == nullptr) {
-        surface = FindMatch<MatchFlags::Expand | MatchFlags::Invalid>(surface_cache, aligned_params,
+        surface = FindMatch<MatchFlags::Expand | MatchFlags::Invalid>(surface_index, aligned_params,
                                                                       match_res_scale);
         if (surface != nullptr) {
             aligned_params.width = aligned_params.stride;
@@ -1296,6 +1407,7 @@ Surface RasterizerCache::GetTextureSurface(const Pica::Texture::TextureInfo& inf
                 glGenerateMipmap(GL_TEXTURE_2D);
             }
             surface->max_level = max_level;
+            UpdateMemoryUsage(*surface);
         }
 
         // Blit mipmaps that have been invalidated
@@ -1326,6 +1438,7 @@ Surface RasterizerCache::GetTextureSurface(const Pica::Texture::TextureInfo& inf
                 if (!level_surface->invalid_regions.empty()) {
                     ValidateSurface(level_surface, level_surface->addr, level_surface->size);
                 }
+                CompleteUploads(level_surface);
                 state.ResetTexture(level_surface->texture.handle);
                 state.Apply();
                 if (!surface->is_custom && texture_filterer->IsNull()) {
@@ -1424,6 +1537,7 @@ const CachedTextureCube& RasterizerCache::GetTextureCube(const TextureCubeConfig
             if (!surface->invalid_regions.empty()) {
                 ValidateSurface(surface, surface->addr, surface->size);
             }
+            CompleteUploads(surface);
             state.ResetTexture(surface->texture.handle);
             state.Apply();
             glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
@@ -1561,9 +1675,11 @@ SurfaceRect_Tuple RasterizerCache::GetTexCopySurface(const SurfaceParams& params
     Common::Rectangle<u32> rect{};
 
     Surface match_surface = FindMatch<MatchFlags::TexCopy | MatchFlags::Invalid>(
-        surface_cache, params, ScaleMatch::Ignore);
+        surface_index, params, ScaleMatch::Ignore);
 
     if (match_surface != nullptr) {
+        ++GetStatsCategory(match_surface->type).hits;
+        TouchSurface(match_surface);
         ValidateSurface(match_surface, params.addr, params.size);
 
         SurfaceParams match_subrect;
@@ -1581,6 +1697,10 @@ SurfaceRect_Tuple RasterizerCache::GetTexCopySurface(const SurfaceParams& params
         rect = match_surface->GetScaledSubRect(match_subrect);
     }
 
+    if (match_surface == nullptr) {
+        ++GetStatsCategory(params.type).misses;
+    }
+
     return std::make_tuple(match_surface, rect);
 }
 
@@ -1634,7 +1754,7 @@ void RasterizerCache::ValidateSurface(const Surface& surface, PAddr addr, u32 si
         SurfaceParams params = surface->FromInterval(interval);
 
         Surface copy_surface =
-            FindMatch<MatchFlags::Copy>(surface_cache, params, ScaleMatch::Ignore, interval);
+            FindMatch<MatchFlags::Copy>(surface_index, params, ScaleMatch::Ignore, interval);
         if (copy_surface != nullptr) {
             SurfaceInterval copy_interval = params.GetCopyableInterval(copy_surface);
             CopySurface(copy_surface, surface, copy_interval);
@@ -1665,11 +1785,47 @@ void RasterizerCache::ValidateSurface(const Surface& surface, PAddr addr, u32 si
 
         // Load data from 3DS memory
         FlushRegion(params.addr, params.size);
+        if (QueueUpload(surface, params)) {
+            notify_validated(params.GetInterval());
+            continue;
+        }
         surface->LoadGLBuffer(params.addr, params.end);
         surface->UploadGLTexture(surface->GetSubRect(params), read_framebuffer.handle,
                                  draw_framebuffer.handle);
         notify_validated(params.GetInterval());
     }
+
+    UpdateMemoryUsage(*surface);
+}
+
+bool RasterizerCache::QueueUpload(const Surface& surface, const SurfaceParams& params) {
+    // Texture dumping and custom textures need the whole decoded texture, and texture filters
+    // need the texture to be complete when it's scaled
+    if (!Settings::values.use_async_texture_upload || Settings::values.dump_textures ||
+        Settings::values.use_custom_textures || !texture_filterer->IsNull() ||
+        surface->type != SurfaceType::Texture || surface->res_scale != 1 || surface->is_custom ||
+        !TextureUploader::IsSupported()) {
+        return false;
+    }
+
+    // LoadGLBuffer clamps these to VRAM, leave them to it
+    if ((params.addr < Memory::VRAM_VADDR_END && params.end > Memory::VRAM_VADDR_END) ||
+        (params.addr < Memory::VRAM_VADDR && params.end > Memory::VRAM_VADDR)) {
+        return false;
+    }
+
+    if (!texture_uploader) {
+        texture_uploader = std::make_unique<TextureUploader>();
+    }
+
+    return texture_uploader->Queue(surface, surface->GetSubRect(params));
+}
+
+bool RasterizerCache::CompleteUploads(const Surface& surface, bool wait) {
+    if (surface->pending_uploads == 0) {
+        return true;
+    }
+    return texture_uploader->Complete(surface, wait);
 }
 
 bool RasterizerCache::NoUnimplementedReinterpretations(const Surface& surface,
@@ -1689,7 +1845,7 @@ bool RasterizerCache::NoUnimplementedReinterpretations(const Surface& surface,
             // This could potentially be expensive,
             // although experimentally it hasn't been too bad
             Surface test_surface =
-                FindMatch<MatchFlags::Copy>(surface_cache, params, ScaleMatch::Ignore, interval);
+                FindMatch<MatchFlags::Copy>(surface_index, params, ScaleMatch::Ignore, interval);
             if (test_surface != nullptr) {
                 LOG_WARNING(Render_OpenGL, "Missing pixel_format reinterpreter: {} -> {}",
                             SurfaceParams::PixelFormatAsString(format),
@@ -1704,13 +1860,17 @@ bool RasterizerCache::NoUnimplementedReinterpretations(const Surface& surface,
 bool RasterizerCache::IntervalHasInvalidPixelFormat(SurfaceParams& params,
                                                     const SurfaceInterval& interval) {
     params.pixel_format = PixelFormat::Invalid;
-    for (const auto& set : RangeFromInterval(surface_cache, interval))
-        for (const auto& surface : set.second)
-            if (surface->pixel_format == PixelFormat::Invalid) {
-                LOG_DEBUG(Render_OpenGL, "Surface found with invalid pixel format");
-                return true;
-            }
-    return false;
+    bool found = false;
+    surface_index.ForEachOverlapping(boost::icl::first(interval), boost::icl::last_next(interval),
+                                     [&found](const Surface& surface) {
+                                         if (surface->pixel_format == PixelFormat::Invalid) {
+                                             found = true;
+                                         }
+                                     });
+    if (found) {
+        LOG_DEBUG(Render_OpenGL, "Surface found with invalid pixel format");
+    }
+    return found;
 }
 
 bool RasterizerCache::ValidateByReinterpretation(const Surface& surface, SurfaceParams& params,
@@ -1721,7 +1881,7 @@ bool RasterizerCache::ValidateByReinterpretation(const Surface& surface, Surface
         PixelFormat format = reinterpreter->first.src_format;
         params.pixel_format = format;
         Surface reinterpret_surface =
-            FindMatch<MatchFlags::Copy>(surface_cache, params, ScaleMatch::Ignore, interval);
+            FindMatch<MatchFlags::Copy>(surface_index, params, ScaleMatch::Ignore, interval);
 
         if (reinterpret_surface != nullptr) {
             SurfaceInterval reinterpret_interval = params.GetCopyableInterval(reinterpret_surface);
@@ -1755,6 +1915,7 @@ bool RasterizerCache::ValidateByReinterpretation(const Surface& surface, Surface
                                                    read_framebuffer.handle, surface->texture.handle,
                                                    dest_rect, draw_framebuffer.handle);
             }
+            ++GetStatsCategory(surface->type).reinterpretations;
             return true;
         }
     }
@@ -1787,6 +1948,7 @@ void RasterizerCache::FlushRegion(PAddr addr, u32 size, Surface flush_surface) {
                                        draw_framebuffer.handle);
         }
         surface->FlushGLBuffer(boost::icl::first(interval), boost::icl::last_next(interval));
+        UpdateMemoryUsage(*surface);
         flushed_intervals += interval;
     }
     // Reset dirty regions
@@ -1811,30 +1973,28 @@ void RasterizerCache::InvalidateRegion(PAddr addr, u32 size, const Surface& regi
         region_owner->invalid_regions.erase(invalid_interval);
     }
 
-    for (const auto& pair : RangeFromInterval(surface_cache, invalid_interval)) {
-        for (const auto& cached_surface : pair.second) {
-            if (cached_surface == region_owner)
-                continue;
+    surface_index.ForEachOverlapping(addr, addr + size, [&](const Surface& cached_surface) {
+        if (cached_surface == region_owner)
+            return;
 
-            // If cpu is invalidating this region we want to remove it
-            // to (likely) mark the memory pages as uncached
-            if (region_owner == nullptr && size <= 8) {
-                FlushRegion(cached_surface->addr, cached_surface->size, cached_surface);
-                remove_surfaces.emplace(cached_surface);
-                continue;
-            }
+        // If cpu is invalidating this region we want to remove it
+        // to (likely) mark the memory pages as uncached
+        if (region_owner == nullptr && size <= 8) {
+            FlushRegion(cached_surface->addr, cached_surface->size, cached_surface);
+            remove_surfaces.emplace(cached_surface);
+            return;
+        }
 
-            const auto interval = cached_surface->GetInterval() & invalid_interval;
-            cached_surface->invalid_regions.insert(interval);
-            cached_surface->InvalidateAllWatcher();
+        const auto interval = cached_surface->GetInterval() & invalid_interval;
+        cached_surface->invalid_regions.insert(interval);
+        cached_surface->InvalidateAllWatcher();
 
-            // If the surface has no salvageable data it should be removed from the cache to avoid
-            // clogging the data structure
-            if (cached_surface->IsSurfaceFullyInvalid()) {
-                remove_surfaces.emplace(cached_surface);
-            }
+        // If the surface has no salvageable data it should be removed from the cache to avoid
+        // clogging the data structure
+        if (cached_surface->IsSurfaceFullyInvalid()) {
+            remove_surfaces.emplace(cached_surface);
         }
-    }
+    });
 
     if (region_owner != nullptr)
         dirty_regions.set({invalid_interval, region_owner});
@@ -1844,7 +2004,7 @@ void RasterizerCache::InvalidateRegion(PAddr addr, u32 size, const Surface& regi
     for (const auto& remove_surface : remove_surfaces) {
         if (remove_surface == region_owner) {
             Surface expanded_surface = FindMatch<MatchFlags::SubRect | MatchFlags::Invalid>(
-                surface_cache, *region_owner, ScaleMatch::Ignore);
+                surface_index, *region_owner, ScaleMatch::Ignore);
             ASSERT(expanded_surface);
 
             if ((region_owner->invalid_regions - expanded_surface->invalid_regions).empty()) {
@@ -1869,6 +2029,7 @@ Surface RasterizerCache::CreateSurface(const SurfaceParams& params) {
         AllocateSurfaceTexture(GetFormatTuple(surface->pixel_format), surface->GetScaledWidth(),
                                surface->GetScaledHeight());
 
+    ++GetStatsCategory(surface->type).misses;
     return surface;
 }
 
@@ -1877,8 +2038,14 @@ void RasterizerCache::RegisterSurface(const Surface& surface) {
         return;
     }
     surface->registered = true;
-    surface_cache.add({surface->GetInterval(), SurfaceSet{surface}});
-    UpdatePagesCachedCount(surface->addr, surface->size, 1);
+    surface->index_id =
+        surface_index.Insert(surface, surface->addr, surface->end, [](PAddr start, PAddr end) {
+            VideoCore::g_memory->RasterizerMarkRegionCached(start, end - start, true);
+        });
+    surface->lru_entry = lru.insert(lru.end(), surface.get());
+    UpdateMemoryUsage(*surface);
+
+    EnforceMemoryBudget();
 }
 
 void RasterizerCache::UnregisterSurface(const Surface& surface) {
@@ -1886,42 +2053,77 @@ void RasterizerCache::UnregisterSurface(const Surface& surface) {
         return;
     }
     surface->registered = false;
-    UpdatePagesCachedCount(surface->addr, surface->size, -1);
-    surface_cache.subtract({surface->GetInterval(), SurfaceSet{surface}});
+    surface_index.Remove(surface->index_id, [](PAddr start, PAddr end) {
+        VideoCore::g_memory->RasterizerMarkRegionCached(start, end - start, false);
+    });
+    lru.erase(surface->lru_entry);
+    UpdateMemoryUsage(*surface);
 }
 
-void RasterizerCache::UpdatePagesCachedCount(PAddr addr, u32 size, int delta) {
-    const u32 num_pages =
-        ((addr + size - 1) >> Memory::PAGE_BITS) - (addr >> Memory::PAGE_BITS) + 1;
-    const u32 page_start = addr >> Memory::PAGE_BITS;
-    const u32 page_end = page_start + num_pages;
-
-    // Interval maps will erase segments if count reaches 0, so if delta is negative we have to
-    // subtract after iterating
-    const auto pages_interval = PageMap::interval_type::right_open(page_start, page_end);
-    if (delta > 0)
-        cached_pages.add({pages_interval, delta});
-
-    for (const auto& pair : RangeFromInterval(cached_pages, pages_interval)) {
-        const auto interval = pair.first & pages_interval;
-        const int count = pair.second;
-
-        const PAddr interval_start_addr = boost::icl::first(interval) << Memory::PAGE_BITS;
-        const PAddr interval_end_addr = boost::icl::last_next(interval) << Memory::PAGE_BITS;
-        const u32 interval_size = interval_end_addr - interval_start_addr;
-
-        if (delta > 0 && count == delta)
-            VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr, interval_size,
-                                                            true);
-        else if (delta < 0 && count == -delta)
-            VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr, interval_size,
-                                                            false);
-        else
-            ASSERT(count >= 0);
-    }
-
-    if (delta < 0)
-        cached_pages.add({pages_interval, delta});
+void RasterizerCache::TouchSurface(const Surface& surface) {
+    if (surface->registered) {
+        lru.splice(lru.end(), lru, surface->lru_entry);
+    }
+}
+
+void RasterizerCache::UpdateMemoryUsage(CachedSurface& surface) {
+    const u64 bytes = surface.registered ? surface.GetHostMemoryUsage() : 0;
+    if (bytes == surface.accounted_bytes) {
+        return;
+    }
+
+    // Unsigned wraparound makes this work when the usage shrinks too
+    const u64 difference = bytes - surface.accounted_bytes;
+    memory_usage += difference;
+    GetStatsCategory(surface.type).resident_bytes += difference;
+    surface.accounted_bytes = bytes;
+}
+
+void RasterizerCache::EnforceMemoryBudget() {
+    const u64 budget = static_cast<u64>(Settings::values.surface_cache_budget) * 1024 * 1024;
+    if (budget == 0 || memory_usage <= budget) {
+        return;
+    }
+
+    // Recycled textures aren't used by anything
+    ReleaseRecycledTextures();
+
+    // Surfaces that are still used can't be evicted. After this many of them in a row, the rest
+    // of the list is most likely used too, so a cache that can't shrink isn't scanned whole on
+    // every registration.
+    constexpr std::size_t MaxSkippedSurfaces = 32;
+    std::size_t skipped = 0;
+
+    for (auto it = lru.begin();
+         it != lru.end() && memory_usage > budget && skipped < MaxSkippedSurfaces;) {
+        Surface surface = (*it)->shared_from_this();
+        ++it;
+
+        // The index, this function and every dirty region the surface owns hold one reference
+        // each, more mean the surface is still used, for example by the caller or by a pending
+        // upload
+        long cache_references = 2;
+        for (const auto& pair : RangeFromInterval(dirty_regions, surface->GetInterval())) {
+            if (pair.second == surface) {
+                ++cache_references;
+            }
+        }
+        if (surface.use_count() > cache_references) {
+            ++skipped;
+            continue;
+        }
+        skipped = 0;
+
+        // Dirty surfaces have data that isn't in 3DS memory yet
+        FlushRegion(surface->addr, surface->size, surface);
+
+        UnregisterSurface(surface);
+        ++GetStatsCategory(surface->type).evictions;
+
+        // Don't keep the texture around for recycling
+        surface.reset();
+        ReleaseRecycledTextures();
+    }
 }
 
 } // namespace OpenGL
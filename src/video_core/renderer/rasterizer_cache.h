@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <list>
 #include <memory>
 #include <set>
@@ -27,6 +28,7 @@
 #include "common/math_util.h"
 #include "core/custom_tex_cache.h"
 #include "video_core/renderer/resource_manager.h"
+#include "video_core/renderer/surface_index.h"
 #include "video_core/renderer/surface_params.h"
 #include "video_core/texture/texture_decode.h"
 
@@ -35,6 +37,7 @@ namespace OpenGL {
 class RasterizerCache;
 class TextureFilterer;
 class FormatReinterpreter;
+class TextureUploader;
 
 struct FormatTuple {
     GLint internal_format;
@@ -118,18 +121,30 @@ using SurfaceRegions = boost::icl::interval_set<PAddr, std::less, SurfaceInterva
 using SurfaceMap =
     boost::icl::interval_map<PAddr, Surface, boost::icl::partial_absorber, std::less,
                              boost::icl::inplace_plus, boost::icl::inter_section, SurfaceInterval>;
-using SurfaceCache =
-    boost::icl::interval_map<PAddr, SurfaceSet, boost::icl::partial_absorber, std::less,
-                             boost::icl::inplace_plus, boost::icl::inter_section, SurfaceInterval>;
 
-static_assert(std::is_same<SurfaceRegions::interval_type, SurfaceCache::interval_type>() &&
-                  std::is_same<SurfaceMap::interval_type, SurfaceCache::interval_type>(),
+static_assert(std::is_same<SurfaceRegions::interval_type, SurfaceMap::interval_type>(),
               "incorrect interval types");
 
 using SurfaceRect_Tuple = std::tuple<Surface, Common::Rectangle<u32>>;
 using SurfaceSurfaceRect_Tuple = std::tuple<Surface, Surface, Common::Rectangle<u32>>;
 
-using PageMap = boost::icl::interval_map<u32, int>;
+/// Counters of the surface cache, readable from any thread
+struct SurfaceCacheStats {
+    struct Category {
+        std::atomic<u64> resident_bytes{0};
+        std::atomic<u64> hits{0};
+        std::atomic<u64> misses{0};
+        std::atomic<u64> evictions{0};
+        std::atomic<u64> reinterpretations{0};
+    };
+
+    /// Indexed by SurfaceParams::SurfaceType
+    std::array<Category, 6> categories;
+    /// Bytes of the textures kept in host_texture_recycler
+    std::atomic<u64> recycled_bytes{0};
+};
+
+extern SurfaceCacheStats g_surface_cache_stats;
 
 enum class ScaleMatch {
     Exact,   // Only accept same resolution scale
@@ -188,6 +203,9 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     }
 
     bool registered = false;
+    u32 index_id = 0; /// Id in surface_index of the owner while registered
+    std::list<CachedSurface*>::iterator lru_entry; /// Entry in lru of the owner while registered
+    u64 accounted_bytes = 0; /// Bytes of host memory counted in the memory usage of the owner
     SurfaceRegions invalid_regions;
 
     u32 fill_size = 0; /// Number of bytes to read from fill_data
@@ -202,18 +220,15 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
 
     bool is_custom = false;
     bool is_filtered = false;
+    /// Number of rectangles being decoded by the TextureUploader that aren't in texture yet
+    u32 pending_uploads = 0;
     Core::CustomTexInfo custom_tex_info;
 
-    static constexpr unsigned int GetGLBytesPerPixel(PixelFormat format) {
-        // OpenGL needs 4 bpp alignment for D24 since using GL_UNSIGNED_INT as type
-        return format == PixelFormat::Invalid ? 0
-               : (format == PixelFormat::D24 || GetFormatType(format) == SurfaceType::Texture)
-                   ? 4
-                   : SurfaceParams::GetFormatBpp(format) / 8;
-    }
-
     std::vector<u8> gl_buffer;
 
+    /// Returns the host memory used by the texture and gl_buffer
+    u64 GetHostMemoryUsage() const;
+
     // Read/Write data in 3DS memory to/from gl_buffer
     void LoadGLBuffer(PAddr load_start, PAddr load_end);
     void FlushGLBuffer(PAddr flush_start, PAddr flush_end);
@@ -252,6 +267,9 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     }
 
 private:
+    /// Returns the tag of texture for host_texture_recycler
+    HostTextureTag GetHostTextureTag() const;
+
     RasterizerCache& owner;
     std::list<std::weak_ptr<SurfaceWatcher>> watchers;
     std::array<OGLBuffer, 2> pixel_buffers;
@@ -319,12 +337,22 @@ public:
 
     void Clear();
 
+    /**
+     * Uploads the rectangles of the surface that are being decoded asynchronously. Must be called
+     * before the texture of a surface returned by GetTextureSurface is sampled.
+     * @param wait If false, returns false instead of waiting when the surface isn't decoded yet
+     */
+    bool CompleteUploads(const Surface& surface, bool wait = true);
+
 private:
     void DuplicateSurface(const Surface& src_surface, const Surface& dest_surface);
 
     /// Update surface's texture for given region when necessary
     void ValidateSurface(const Surface& surface, PAddr addr, u32 size);
 
+    /// Starts loading a region of a surface from 3DS memory asynchronously if possible
+    bool QueueUpload(const Surface& surface, const SurfaceParams& params);
+
     // Returns false if there is a surface in the cache at the interval with the same bit-width,
     bool NoUnimplementedReinterpretations(const OpenGL::Surface& surface,
                                           OpenGL::SurfaceParams& params,
@@ -346,11 +374,19 @@ private:
     /// Remove surface from the cache
     void UnregisterSurface(const Surface& surface);
 
-    /// Increase/decrease the number of surface in pages touching the specified region
-    void UpdatePagesCachedCount(PAddr addr, u32 size, int delta);
+    /// Marks a surface as the most recently used one
+    void TouchSurface(const Surface& surface);
+
+    /// Updates the memory usage after the texture or gl_buffer of a surface changed
+    void UpdateMemoryUsage(CachedSurface& surface);
 
-    SurfaceCache surface_cache;
-    PageMap cached_pages;
+    /// Evicts the least recently used surfaces while the cache is over the memory budget
+    void EnforceMemoryBudget();
+
+    /// Deletes the textures in host_texture_recycler
+    void ReleaseRecycledTextures();
+
+    SurfaceIndex surface_index;
     SurfaceMap dirty_regions;
     SurfaceSet remove_surfaces;
 
@@ -361,15 +397,22 @@ private:
 
     std::unordered_map<TextureCubeConfig, CachedTextureCube> texture_cube_cache;
 
+    /// Registered surfaces, least recently used first
+    std::list<CachedSurface*> lru;
+    /// Bytes of host memory used by the registered surfaces and host_texture_recycler
+    u64 memory_usage = 0;
+
 public:
     OGLTexture AllocateSurfaceTexture(const FormatTuple& format_tuple, u32 width, u32 height);
 
     // Textures from destroyed surfaces are stored here to be recycled to reduce allocation overhead
     // in the driver
     std::unordered_multimap<HostTextureTag, OGLTexture> host_texture_recycler;
+    void RecycleTexture(const HostTextureTag& tag, OGLTexture&& texture);
 
     std::unique_ptr<TextureFilterer> texture_filterer;
     std::unique_ptr<FormatReinterpreter> format_reinterpreter;
+    std::unique_ptr<TextureUploader> texture_uploader;
 };
 
 } // namespace OpenGL
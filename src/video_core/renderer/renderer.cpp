@@ -22,6 +22,7 @@
 #include "video_core/renderer/post_processing.h"
 #include "video_core/renderer/rasterizer.h"
 #include "video_core/renderer/renderer.h"
+#include "video_core/swrasterizer/swrasterizer.h"
 #include "video_core/video_core.h"
 
 namespace OpenGL {
@@ -227,7 +228,11 @@ Renderer::Renderer(Frontend::EmuWindow& window) : render_window(window) {
 
     InitOpenGLObjects();
 
-    rasterizer = std::make_unique<RasterizerOpenGL>();
+    if (Settings::values.use_hardware_renderer) {
+        rasterizer = std::make_unique<RasterizerOpenGL>(render_window);
+    } else {
+        rasterizer = std::make_unique<VideoCore::SWRasterizer>();
+    }
 }
 
 Renderer::~Renderer() = default;
@@ -319,6 +324,15 @@ void Renderer::SwapBuffers() {
     prev_state.Apply();
 }
 
+void Renderer::SkipFrame() {
+    Core::System::GetInstance().perf_stats->EndSystemFrame();
+
+    render_window.PollEvents();
+
+    Core::System::GetInstance().frame_limiter.DoFrameLimiting(
+        Core::System::GetInstance().CoreTiming().GetGlobalTimeUs());
+}
+
 /**
  * Loads framebuffer from emulated memory into the active OpenGL texture.
  */
@@ -10,6 +10,7 @@
 #include "common/math_util.h"
 #include "core/frontend/emu_window.h"
 #include "core/hw/gpu.h"
+#include "video_core/rasterizer_interface.h"
 #include "video_core/renderer/resource_manager.h"
 #include "video_core/renderer/state.h"
 
@@ -19,8 +20,6 @@ struct FramebufferLayout;
 
 namespace OpenGL {
 
-class RasterizerOpenGL;
-
 /// Structure used for storing information about the textures for each 3DS screen
 struct TextureInfo {
     OGLTexture resource;
@@ -46,9 +45,12 @@ public:
     /// Swap buffers (render frame)
     void SwapBuffers();
 
+    /// Ends an emulated frame without presenting it
+    void SkipFrame();
+
     void UpdateCurrentFramebufferLayout();
 
-    RasterizerOpenGL* Rasterizer() const {
+    VideoCore::RasterizerInterface* Rasterizer() const {
         return rasterizer.get();
     }
 
@@ -83,7 +85,7 @@ private:
 
     OpenGLState state;
     Frontend::EmuWindow& render_window;
-    std::unique_ptr<RasterizerOpenGL> rasterizer;
+    std::unique_ptr<VideoCore::RasterizerInterface> rasterizer;
 
     // OpenGL object IDs
     OGLVertexArray vertex_array;
@@ -6,6 +6,7 @@
 #include <fmt/format.h>
 #include "common/common_types.h"
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "core/core.h"
 #include "core/hle/kernel/process.h"
@@ -16,6 +17,41 @@ namespace OpenGL {
 
 constexpr u8 DISK_SHADER_CACHE_VERSION = 1;
 
+constexpr u32 PRECOMPILED_MAGIC = 0x31505356; // VSP1
+constexpr u32 PRECOMPILED_VERSION = 1;
+
+namespace {
+
+struct PrecompiledHeader {
+    u32 magic;
+    u32 version;
+    u64 driver_hash;
+};
+
+struct PrecompiledEntryHeader {
+    u64 code_hash;
+    u32 format;
+    u32 size;
+};
+
+static_assert(sizeof(PrecompiledHeader) == 16, "PrecompiledHeader is written to files");
+static_assert(sizeof(PrecompiledEntryHeader) == 16, "PrecompiledEntryHeader is written to files");
+
+/// Program binaries only work with the driver that created them
+u64 GetDriverHash() {
+    std::string driver;
+    for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const GLubyte* const string = glGetString(name);
+        if (string != nullptr) {
+            driver += reinterpret_cast<const char*>(string);
+        }
+        driver += '\n';
+    }
+    return Common::ComputeHash64(driver.data(), driver.size());
+}
+
+} // namespace
+
 ShaderDiskCacheEntry::ShaderDiskCacheEntry(u64 unique_identifier, ProgramType type,
                                            Pica::Regs registers, std::vector<u32> code)
     : unique_identifier(unique_identifier), type(type), registers(registers),
@@ -78,7 +114,16 @@ bool ShaderDiskCacheEntry::Save(FileUtil::IOFile& file) const {
     return true;
 }
 
-ShaderDiskCache::ShaderDiskCache(bool separable) : separable(separable) {}
+ShaderDiskCache::ShaderDiskCache(bool separable) : separable(separable) {
+    if (separable && GLAD_GL_ARB_get_program_binary) {
+        GLint num_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+        if (num_formats > 0) {
+            driver_hash = GetDriverHash();
+            precompiled_usable = true;
+        }
+    }
+}
 
 std::optional<std::vector<ShaderDiskCacheEntry>> ShaderDiskCache::Load() {
     if (GetProgramID() == 0) {
@@ -87,6 +132,8 @@ std::optional<std::vector<ShaderDiskCacheEntry>> ShaderDiskCache::Load() {
 
     tried_to_load = true;
 
+    LoadPrecompiled();
+
     FileUtil::IOFile file(GetCacheFilePath(), "rb");
     if (!file.IsOpen()) {
         LOG_INFO(Render_OpenGL, "No disk shader cache found");
@@ -167,11 +214,135 @@ bool ShaderDiskCache::IsUsable() const {
     return tried_to_load;
 }
 
+std::optional<ShaderDiskCacheBinary> ShaderDiskCache::FindPrecompiled(u64 code_hash) const {
+    const auto it = precompiled.find(code_hash);
+    if (it == precompiled.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void ShaderDiskCache::AddPrecompiled(u64 code_hash, const ShaderDiskCacheBinary& binary) {
+    if (!IsUsable() || !precompiled_usable || binary.size == 0 ||
+        precompiled.count(code_hash) != 0 || !precompiled_added.insert(code_hash).second) {
+        return;
+    }
+
+    if (!precompiled_file.IsOpen()) {
+        if (!FileUtil::CreateDir(FileUtil::GetUserPath(FileUtil::UserPath::ShaderDir))) {
+            LOG_ERROR(Render_OpenGL, "Failed to create user/shaders");
+            return;
+        }
+        if (!precompiled_file.Open(GetPrecompiledFilePath(), "ab")) {
+            LOG_ERROR(Render_OpenGL, "Failed to open precompiled disk shader cache");
+            return;
+        }
+        if (precompiled_file.GetSize() == 0 &&
+            precompiled_file.WriteObject(
+                PrecompiledHeader{PRECOMPILED_MAGIC, PRECOMPILED_VERSION, driver_hash}) != 1) {
+            LOG_ERROR(Render_OpenGL, "Failed to write precompiled disk shader cache header");
+            precompiled_file.Close();
+            return;
+        }
+    }
+
+    const PrecompiledEntryHeader header{code_hash, static_cast<u32>(binary.format),
+                                        static_cast<u32>(binary.size)};
+    if (precompiled_file.WriteObject(header) != 1 ||
+        precompiled_file.WriteBytes(binary.data, binary.size) != binary.size) {
+        // A partly written binary is removed when the file is loaded again
+        LOG_ERROR(Render_OpenGL, "Failed to write to precompiled disk shader cache");
+        precompiled_file.Close();
+    }
+}
+
+void ShaderDiskCache::LoadPrecompiled() {
+    if (!precompiled_usable) {
+        return;
+    }
+
+    const std::string path = GetPrecompiledFilePath();
+    if (!FileUtil::Exists(path)) {
+        return;
+    }
+
+    const std::size_t valid_size = MapPrecompiled();
+    if (valid_size == 0) {
+        LOG_INFO(Render_OpenGL,
+                 "Precompiled disk shader cache is from another driver or version, deleting");
+        ClosePrecompiled();
+        FileUtil::Delete(path);
+        return;
+    }
+
+    if (valid_size != precompiled_mapping.GetSize()) {
+        LOG_WARNING(Render_OpenGL,
+                    "Precompiled disk shader cache is truncated, removing the last binary");
+        ClosePrecompiled();
+        if (!FileUtil::IOFile(path, "r+b").Resize(valid_size)) {
+            LOG_ERROR(Render_OpenGL, "Failed to resize precompiled disk shader cache, deleting");
+            FileUtil::Delete(path);
+            return;
+        }
+        MapPrecompiled();
+    }
+
+    LOG_INFO(Render_OpenGL, "Found a precompiled disk shader cache with {} binaries",
+             precompiled.size());
+}
+
+std::size_t ShaderDiskCache::MapPrecompiled() {
+    if (!precompiled_mapping.Open(GetPrecompiledFilePath())) {
+        return 0;
+    }
+
+    const u8* const data = precompiled_mapping.GetData();
+    const std::size_t size = precompiled_mapping.GetSize();
+
+    PrecompiledHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != PRECOMPILED_MAGIC || header.version != PRECOMPILED_VERSION ||
+        header.driver_hash != driver_hash) {
+        return 0;
+    }
+
+    std::size_t offset = sizeof(header);
+    while (size - offset >= sizeof(PrecompiledEntryHeader)) {
+        PrecompiledEntryHeader entry;
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        if (entry.size > size - offset - sizeof(entry)) {
+            break;
+        }
+
+        precompiled.insert_or_assign(
+            entry.code_hash, ShaderDiskCacheBinary{static_cast<GLenum>(entry.format),
+                                                   data + offset + sizeof(entry), entry.size});
+        offset += sizeof(entry) + entry.size;
+    }
+
+    return offset;
+}
+
+void ShaderDiskCache::ClosePrecompiled() {
+    precompiled_file.Close();
+    precompiled.clear();
+    precompiled_added.clear();
+    precompiled_mapping.Close();
+}
+
 std::string ShaderDiskCache::GetCacheFilePath() {
     return FileUtil::SanitizePath(fmt::format(
         "{}/{:016X}.vsc", FileUtil::GetUserPath(FileUtil::UserPath::ShaderDir), GetProgramID()));
 }
 
+std::string ShaderDiskCache::GetPrecompiledFilePath() {
+    return FileUtil::SanitizePath(fmt::format(
+        "{}/{:016X}.vsp", FileUtil::GetUserPath(FileUtil::UserPath::ShaderDir), GetProgramID()));
+}
+
 u64 ShaderDiskCache::GetProgramID() {
     if (program_id != 0) {
         return program_id;
@@ -187,6 +358,13 @@ void ShaderDiskCache::Delete() {
     if (!FileUtil::Delete(GetCacheFilePath())) {
         LOG_ERROR(Render_OpenGL, "Failed to delete disk shader cache");
     }
+
+    // A shader failing to load might come from a bad binary as well, so start over with both
+    ClosePrecompiled();
+    const std::string precompiled_path = GetPrecompiledFilePath();
+    if (FileUtil::Exists(precompiled_path) && !FileUtil::Delete(precompiled_path)) {
+        LOG_ERROR(Render_OpenGL, "Failed to delete precompiled disk shader cache");
+    }
 }
 
 } // namespace OpenGL
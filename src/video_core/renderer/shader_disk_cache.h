@@ -6,11 +6,14 @@
 
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <glad/glad.h>
 
 #include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/mapped_file.h"
 #include "video_core/regs.h"
 #include "video_core/renderer/shader_decompiler.h"
 #include "video_core/renderer/shader_gen.h"
@@ -19,10 +22,6 @@ namespace Core {
 class System;
 } // namespace Core
 
-namespace FileUtil {
-class IOFile;
-} // namespace FileUtil
-
 namespace OpenGL {
 
 class ShaderDiskCacheEntry {
@@ -58,6 +57,18 @@ private:
     std::vector<u32> code;
 };
 
+/// Program binary of a separable shader program, as returned by glGetProgramBinary
+struct ShaderDiskCacheBinary {
+    GLenum format;
+    const u8* data;
+    std::size_t size;
+};
+
+/**
+ * Stores the registers the shaders of a title were generated from, and next to them the program
+ * binaries the driver compiled the generated GLSL code to. The binaries are keyed by the hash of
+ * the code, and are only used with the driver that created them.
+ */
 class ShaderDiskCache {
 public:
     explicit ShaderDiskCache(bool separable);
@@ -67,13 +78,31 @@ public:
     void Add(const ShaderDiskCacheEntry& entry);
     void Delete();
 
+    /// Finds the program binary of the code with the given hash. The data stays valid until Delete.
+    std::optional<ShaderDiskCacheBinary> FindPrecompiled(u64 code_hash) const;
+    void AddPrecompiled(u64 code_hash, const ShaderDiskCacheBinary& binary);
+
 private:
     bool IsUsable() const;
     FileUtil::IOFile Append();
     std::string GetCacheFilePath();
+    std::string GetPrecompiledFilePath();
     u64 GetProgramID();
 
+    void LoadPrecompiled();
+    /// Maps the precompiled file and indexes its binaries, returns the size of the valid part
+    std::size_t MapPrecompiled();
+    void ClosePrecompiled();
+
     std::unordered_set<u64> hashes;
+
+    u64 driver_hash = 0;
+    Common::MappedFile precompiled_mapping;
+    std::unordered_map<u64, ShaderDiskCacheBinary> precompiled;
+    std::unordered_set<u64> precompiled_added;
+    FileUtil::IOFile precompiled_file;
+    bool precompiled_usable = false;
+
     bool tried_to_load = false;
     bool separable = false;
     u64 program_id = 0;
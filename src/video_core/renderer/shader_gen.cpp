@@ -79,6 +79,59 @@ layout (std140) uniform shader_data {
 };
 )";
 
+// Functions shared by the generated fragment shaders and the uber fragment shader
+constexpr std::string_view FragmentShaderHelpers = R"(
+// Rotate the vector v by the quaternion q
+vec3 quaternion_rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+float LookupLightingLUT(int lut_index, int index, float delta) {
+    vec2 entry = texelFetch(texture_buffer_lut_rg, lighting_lut_offset[lut_index >> 2][lut_index & 3] + index).rg;
+    return entry.r + entry.g * delta;
+}
+
+float LookupLightingLUTUnsigned(int lut_index, float pos) {
+    int index = clamp(int(pos * 256.0), 0, 255);
+    float delta = pos * 256.0 - index;
+    return LookupLightingLUT(lut_index, index, delta);
+}
+
+float LookupLightingLUTSigned(int lut_index, float pos) {
+    int index = clamp(int(pos * 128.0), -128, 127);
+    float delta = pos * 128.0 - index;
+    if (index < 0) {
+        index += 256;
+    }
+    return LookupLightingLUT(lut_index, index, delta);
+}
+
+float byteround(float x) {
+    return round(x * 255.0) * (1.0 / 255.0);
+}
+
+vec2 byteround(vec2 x) {
+    return round(x * 255.0) * (1.0 / 255.0);
+}
+
+vec3 byteround(vec3 x) {
+    return round(x * 255.0) * (1.0 / 255.0);
+}
+
+vec4 byteround(vec4 x) {
+    return round(x * 255.0) * (1.0 / 255.0);
+}
+
+// PICA's LOD formula for 2D textures.
+// This LOD formula is the same as the LOD lower limit defined in OpenGL.
+// f(x, y) >= max{m_u, m_v, m_w}
+// (See OpenGL 4.6 spec, 8.14.1 - Scale Factor and Level-of-Detail)
+float getLod(vec2 coord) {
+    vec2 d = max(abs(dFdx(coord)), abs(dFdy(coord)));
+    return log2(max(d.x, d.y));
+}
+)";
+
 static std::string GetVertexInterfaceDeclaration(bool is_output, bool separable_shader) {
     std::string out;
 
@@ -1261,57 +1314,9 @@ layout(r32ui) uniform uimage2D shadow_buffer;
 
     out += UniformBlockDef;
 
-    out += R"(
-// Rotate the vector v by the quaternion q
-vec3 quaternion_rotate(vec4 q, vec3 v) {
-    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
-}
-
-float LookupLightingLUT(int lut_index, int index, float delta) {
-    vec2 entry = texelFetch(texture_buffer_lut_rg, lighting_lut_offset[lut_index >> 2][lut_index & 3] + index).rg;
-    return entry.r + entry.g * delta;
-}
-
-float LookupLightingLUTUnsigned(int lut_index, float pos) {
-    int index = clamp(int(pos * 256.0), 0, 255);
-    float delta = pos * 256.0 - index;
-    return LookupLightingLUT(lut_index, index, delta);
-}
-
-float LookupLightingLUTSigned(int lut_index, float pos) {
-    int index = clamp(int(pos * 128.0), -128, 127);
-    float delta = pos * 128.0 - index;
-    if (index < 0) {
-        index += 256;
-    }
-    return LookupLightingLUT(lut_index, index, delta);
-}
-
-float byteround(float x) {
-    return round(x * 255.0) * (1.0 / 255.0);
-}
-
-vec2 byteround(vec2 x) {
-    return round(x * 255.0) * (1.0 / 255.0);
-}
-
-vec3 byteround(vec3 x) {
-    return round(x * 255.0) * (1.0 / 255.0);
-}
-
-vec4 byteround(vec4 x) {
-    return round(x * 255.0) * (1.0 / 255.0);
-}
-
-// PICA's LOD formula for 2D textures.
-// This LOD formula is the same as the LOD lower limit defined in OpenGL.
-// f(x, y) >= max{m_u, m_v, m_w}
-// (See OpenGL 4.6 spec, 8.14.1 - Scale Factor and Level-of-Detail)
-float getLod(vec2 coord) {
-    vec2 d = max(abs(dFdx(coord)), abs(dFdy(coord)));
-    return log2(max(d.x, d.y));
-}
+    out += FragmentShaderHelpers;
 
+    out += R"(
 #if ALLOW_SHADOW
 
 uvec2 DecodeShadow(uint pixel) {
@@ -1569,6 +1574,420 @@ do {
     return std::move(out);
 }
 
+UberFSConfig UberFSConfig::BuildFromConfig(const PicaFSConfig& config) {
+    const auto& state = config.state;
+
+    UberFSConfig uber{};
+    for (std::size_t i = 0; i < state.tev_stages.size(); ++i) {
+        const TevStageConfigRaw& stage = state.tev_stages[i];
+        uber.tev_stages[i] = {stage.sources_raw, stage.modifiers_raw, stage.ops_raw,
+                              stage.scales_raw};
+    }
+
+    uber.state = static_cast<u32>(state.alpha_test_func) |
+                 static_cast<u32>(state.scissor_test_mode) << 3 |
+                 static_cast<u32>(state.texture0_type) << 5 |
+                 static_cast<u32>(state.texture2_use_coord1) << 8 |
+                 static_cast<u32>(state.combiner_buffer_input) << 9 |
+                 static_cast<u32>(state.depthmap_enable == RasterizerRegs::WBuffering) << 17 |
+                 static_cast<u32>(state.fog_mode == TexturingRegs::FogMode::Fog) << 18 |
+                 static_cast<u32>(state.fog_flip) << 19 |
+                 static_cast<u32>(state.lighting.enable) << 20 | state.lighting.src_num << 21;
+
+    for (unsigned i = 0; i < state.lighting.src_num; ++i) {
+        const auto& light = state.lighting.light[i];
+        uber.lights[i] = light.num | static_cast<u32>(light.directional) << 3 |
+                         static_cast<u32>(light.two_sided_diffuse) << 4 |
+                         static_cast<u32>(light.dist_atten_enable) << 5 |
+                         static_cast<u32>(light.geometric_factor_0) << 6 |
+                         static_cast<u32>(light.geometric_factor_1) << 7;
+    }
+
+    return uber;
+}
+
+bool IsUberFragmentShaderSupported(const PicaFSConfig& config) {
+    const auto& state = config.state;
+    if (state.shadow_rendering || state.proctex.enable ||
+        state.fog_mode == TexturingRegs::FogMode::Gas ||
+        state.texture0_type == TexturingRegs::TextureConfig::Shadow2D ||
+        state.texture0_type == TexturingRegs::TextureConfig::ShadowCube) {
+        return false;
+    }
+
+    if (!state.lighting.enable) {
+        return true;
+    }
+
+    // Only lighting without LUTs other than distance attenuation is emulated
+    const auto& lighting = state.lighting;
+    if (lighting.bump_mode != LightingRegs::LightingBumpMode::None || lighting.lut_d0.enable ||
+        lighting.lut_d1.enable || lighting.lut_sp.enable || lighting.lut_fr.enable ||
+        lighting.lut_rr.enable || lighting.lut_rg.enable || lighting.lut_rb.enable ||
+        lighting.enable_primary_alpha || lighting.enable_secondary_alpha ||
+        lighting.clamp_highlights) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < lighting.src_num; ++i) {
+        if (lighting.light[i].spot_atten_enable || lighting.light[i].shadow_enable) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string GenerateUberFragmentShader(bool separable_shader) {
+    std::string out = "#version 330 core\n";
+    if (separable_shader) {
+        out += "#extension GL_ARB_separate_shader_objects : enable\n";
+    }
+
+    out += GetVertexInterfaceDeclaration(false, separable_shader);
+
+    out += R"(in vec4 gl_FragCoord;
+out vec4 color;
+
+uniform sampler2D tex0;
+uniform sampler2D tex1;
+uniform sampler2D tex2;
+uniform samplerCube tex_cube;
+uniform samplerBuffer texture_buffer_lut_rg;
+uniform samplerBuffer texture_buffer_lut_rgba;
+)";
+
+    out += UniformBlockDef;
+
+    out += R"(
+// Set from UberFSConfig
+uniform uvec4 tev_stages[NUM_TEV_STAGES];
+uniform uint uber_state;
+uniform uint uber_lights[NUM_LIGHTS];
+)";
+
+    out += FragmentShaderHelpers;
+
+    out += R"(
+vec4 rounded_primary_color;
+vec4 primary_fragment_color;
+vec4 secondary_fragment_color;
+vec4 texture_color[3];
+vec4 combiner_buffer;
+vec4 last_tex_env_out;
+
+vec4 SampleTexture0() {
+    switch ((uber_state >> 5) & 7u) {
+    case 0u:
+        return textureLod(tex0, texcoord0, getLod(texcoord0 * vec2(textureSize(tex0, 0))));
+    case 1u:
+        return texture(tex_cube, vec3(texcoord0, texcoord0_w));
+    case 3u:
+        return textureProj(tex0, vec3(texcoord0, texcoord0_w));
+    default:
+        return vec4(0.0);
+    }
+}
+
+vec4 GetSource(uint source, int stage) {
+    switch (source) {
+    case 0u:
+        return rounded_primary_color;
+    case 1u:
+        return primary_fragment_color;
+    case 2u:
+        return secondary_fragment_color;
+    case 3u:
+    case 4u:
+    case 5u:
+        return texture_color[source - 3u];
+    case 13u:
+        return combiner_buffer;
+    case 14u:
+        return const_color[stage];
+    case 15u:
+        return last_tex_env_out;
+    default:
+        return vec4(0.0);
+    }
+}
+
+vec3 ColorModifier(uint modifier, vec4 value) {
+    switch (modifier) {
+    case 0u:
+        return value.rgb;
+    case 1u:
+        return vec3(1.0) - value.rgb;
+    case 2u:
+        return value.aaa;
+    case 3u:
+        return vec3(1.0) - value.aaa;
+    case 4u:
+        return value.rrr;
+    case 5u:
+        return vec3(1.0) - value.rrr;
+    case 8u:
+        return value.ggg;
+    case 9u:
+        return vec3(1.0) - value.ggg;
+    case 12u:
+        return value.bbb;
+    case 13u:
+        return vec3(1.0) - value.bbb;
+    default:
+        return vec3(0.0);
+    }
+}
+
+float AlphaModifier(uint modifier, vec4 value) {
+    switch (modifier) {
+    case 0u:
+        return value.a;
+    case 1u:
+        return 1.0 - value.a;
+    case 2u:
+        return value.r;
+    case 3u:
+        return 1.0 - value.r;
+    case 4u:
+        return value.g;
+    case 5u:
+        return 1.0 - value.g;
+    case 6u:
+        return value.b;
+    default:
+        return 1.0 - value.b;
+    }
+}
+
+vec3 ColorCombiner(uint operation, vec3 values[3]) {
+    vec3 result;
+    switch (operation) {
+    case 0u:
+        result = values[0];
+        break;
+    case 1u:
+        result = values[0] * values[1];
+        break;
+    case 2u:
+        result = values[0] + values[1];
+        break;
+    case 3u:
+        result = values[0] + values[1] - vec3(0.5);
+        break;
+    case 4u:
+        result = values[0] * values[2] + values[1] * (vec3(1.0) - values[2]);
+        break;
+    case 5u:
+        result = values[0] - values[1];
+        break;
+    case 6u:
+    case 7u:
+        result = vec3(dot(values[0] - vec3(0.5), values[1] - vec3(0.5)) * 4.0);
+        break;
+    case 8u:
+        result = values[0] * values[1] + values[2];
+        break;
+    case 9u:
+        result = min(values[0] + values[1], vec3(1.0)) * values[2];
+        break;
+    default:
+        result = vec3(0.0);
+        break;
+    }
+    return clamp(result, vec3(0.0), vec3(1.0));
+}
+
+float AlphaCombiner(uint operation, float values[3]) {
+    float result;
+    switch (operation) {
+    case 0u:
+        result = values[0];
+        break;
+    case 1u:
+        result = values[0] * values[1];
+        break;
+    case 2u:
+        result = values[0] + values[1];
+        break;
+    case 3u:
+        result = values[0] + values[1] - 0.5;
+        break;
+    case 4u:
+        result = values[0] * values[2] + values[1] * (1.0 - values[2]);
+        break;
+    case 5u:
+        result = values[0] - values[1];
+        break;
+    case 8u:
+        result = values[0] * values[1] + values[2];
+        break;
+    case 9u:
+        result = min(values[0] + values[1], 1.0) * values[2];
+        break;
+    default:
+        result = 0.0;
+        break;
+    }
+    return clamp(result, 0.0, 1.0);
+}
+
+float GetMultiplier(uint scale) {
+    return scale < 3u ? float(1u << scale) : 1.0;
+}
+
+bool PassesAlphaTest(uint func) {
+    int alpha = int(last_tex_env_out.a * 255.0);
+    switch (func) {
+    case 2u:
+        return alpha == alphatest_ref;
+    case 3u:
+        return alpha != alphatest_ref;
+    case 4u:
+        return alpha < alphatest_ref;
+    case 5u:
+        return alpha <= alphatest_ref;
+    case 6u:
+        return alpha > alphatest_ref;
+    case 7u:
+        return alpha >= alphatest_ref;
+    default:
+        return true;
+    }
+}
+
+void main() {
+    rounded_primary_color = byteround(primary_color);
+    primary_fragment_color = vec4(0.0);
+    secondary_fragment_color = vec4(0.0);
+
+    uint alpha_test_func = uber_state & 7u;
+    if (alpha_test_func == 0u) {
+        discard;
+    }
+
+    if (((uber_state >> 3) & 3u) == 3u &&
+        !(gl_FragCoord.x >= scissor_x1 && gl_FragCoord.y >= scissor_y1 &&
+          gl_FragCoord.x < scissor_x2 && gl_FragCoord.y < scissor_y2)) {
+        discard;
+    }
+
+    float z_over_w = 2.0 * gl_FragCoord.z - 1.0;
+    float depth = z_over_w * depth_scale + depth_offset;
+    if ((uber_state & (1u << 17)) != 0u) {
+        depth /= gl_FragCoord.w;
+    }
+
+    texture_color[0] = SampleTexture0();
+    texture_color[1] = textureLod(tex1, texcoord1, getLod(texcoord1 * vec2(textureSize(tex1, 0))));
+    vec2 texcoord2_used = (uber_state & (1u << 8)) != 0u ? texcoord1 : texcoord2;
+    texture_color[2] =
+        textureLod(tex2, texcoord2_used, getLod(texcoord2_used * vec2(textureSize(tex2, 0))));
+
+    // Lighting without bump mapping, shadows, spot attenuation and the specular LUTs, which
+    // leaves the specular colors unscaled
+    if ((uber_state & (1u << 20)) != 0u) {
+        vec3 normal = quaternion_rotate(normalize(normquat), vec3(0.0, 0.0, 1.0));
+        vec3 diffuse_sum = vec3(0.0);
+        vec3 specular_sum = vec3(0.0);
+        uint num_lights = (uber_state >> 21) & 15u;
+        for (uint i = 0u; i < num_lights; ++i) {
+            uint light = uber_lights[i];
+            int num = int(light & 7u);
+            vec3 light_vector = (light & 8u) != 0u ? normalize(light_src[num].position)
+                                                   : normalize(light_src[num].position + view);
+            float dot_product = (light & 16u) != 0u ? abs(dot(light_vector, normal))
+                                                    : max(dot(light_vector, normal), 0.0);
+            float dist_atten = 1.0;
+            if ((light & 32u) != 0u) {
+                float index = clamp(light_src[num].dist_atten_scale *
+                                    length(-view - light_src[num].position) +
+                                    light_src[num].dist_atten_bias, 0.0, 1.0);
+                dist_atten = LookupLightingLUTUnsigned(16 + num, index);
+            }
+            float geo_factor = 1.0;
+            if ((light & 192u) != 0u) {
+                vec3 half_vector = normalize(view) + light_vector;
+                geo_factor = dot(half_vector, half_vector);
+                geo_factor = geo_factor == 0.0 ? 0.0 : min(dot_product / geo_factor, 1.0);
+            }
+            diffuse_sum += (light_src[num].diffuse * dot_product + light_src[num].ambient) *
+                           dist_atten;
+            specular_sum +=
+                (light_src[num].specular_0 * ((light & 64u) != 0u ? geo_factor : 1.0) +
+                 light_src[num].specular_1 * ((light & 128u) != 0u ? geo_factor : 1.0)) *
+                dist_atten;
+        }
+        primary_fragment_color =
+            clamp(vec4(diffuse_sum + lighting_global_ambient, 1.0), vec4(0.0), vec4(1.0));
+        secondary_fragment_color = clamp(vec4(specular_sum, 1.0), vec4(0.0), vec4(1.0));
+    }
+
+    combiner_buffer = vec4(0.0);
+    vec4 next_combiner_buffer = tev_combiner_buffer_color;
+    last_tex_env_out = vec4(0.0);
+
+    for (int i = 0; i < NUM_TEV_STAGES; ++i) {
+        uint sources = tev_stages[i].x;
+        uint modifiers = tev_stages[i].y;
+        uint ops = tev_stages[i].z;
+        uint scales = tev_stages[i].w;
+
+        vec3 color_results[3] = vec3[3](
+            ColorModifier(modifiers & 15u, GetSource(sources & 15u, i)),
+            ColorModifier((modifiers >> 4) & 15u, GetSource((sources >> 4) & 15u, i)),
+            ColorModifier((modifiers >> 8) & 15u, GetSource((sources >> 8) & 15u, i)));
+        uint color_op = ops & 15u;
+        vec3 color_output = byteround(ColorCombiner(color_op, color_results));
+
+        float alpha_output;
+        if (color_op == 7u) {
+            // Dot3_RGBA also places its result in the alpha component
+            alpha_output = color_output[0];
+        } else {
+            float alpha_results[3] = float[3](
+                AlphaModifier((modifiers >> 12) & 7u, GetSource((sources >> 16) & 15u, i)),
+                AlphaModifier((modifiers >> 16) & 7u, GetSource((sources >> 20) & 15u, i)),
+                AlphaModifier((modifiers >> 20) & 7u, GetSource((sources >> 24) & 15u, i)));
+            alpha_output = byteround(AlphaCombiner((ops >> 16) & 15u, alpha_results));
+        }
+
+        last_tex_env_out = vec4(
+            clamp(color_output * GetMultiplier(scales & 3u), vec3(0.0), vec3(1.0)),
+            clamp(alpha_output * GetMultiplier((scales >> 16) & 3u), 0.0, 1.0));
+
+        combiner_buffer = next_combiner_buffer;
+        if (i < 4) {
+            if (((uber_state >> (9 + i)) & 1u) != 0u) {
+                next_combiner_buffer.rgb = last_tex_env_out.rgb;
+            }
+            if (((uber_state >> (13 + i)) & 1u) != 0u) {
+                next_combiner_buffer.a = last_tex_env_out.a;
+            }
+        }
+    }
+
+    if (!PassesAlphaTest(alpha_test_func)) {
+        discard;
+    }
+
+    if ((uber_state & (1u << 18)) != 0u) {
+        float fog_index = ((uber_state & (1u << 19)) != 0u ? 1.0 - depth : depth) * 128.0;
+        float fog_i = clamp(floor(fog_index), 0.0, 127.0);
+        float fog_f = fog_index - fog_i;
+        vec2 fog_lut_entry = texelFetch(texture_buffer_lut_rg, int(fog_i) + fog_lut_offset).rg;
+        float fog_factor = clamp(fog_lut_entry.r + fog_lut_entry.g * fog_f, 0.0, 1.0);
+        last_tex_env_out.rgb = mix(fog_color.rgb, last_tex_env_out.rgb, fog_factor);
+    }
+
+    gl_FragDepth = depth;
+    color = byteround(last_tex_env_out);
+}
+)";
+
+    return out;
+}
+
 std::string GenerateTrivialVertexShader(bool separable_shader) {
     std::string out = "#version 330 core\n";
     if (separable_shader) {
@@ -144,6 +144,26 @@ struct PicaFSConfig : Common::HashableStruct<PicaFSConfigState> {
     }
 };
 
+/**
+ * The state of a PicaFSConfig the uber fragment shader reads from its uniforms, packed in the
+ * layout GenerateUberFragmentShader expects.
+ */
+struct UberFSConfig {
+    std::array<std::array<u32, 4>, 6> tev_stages;
+    u32 state;
+    std::array<u32, 8> lights;
+
+    static UberFSConfig BuildFromConfig(const PicaFSConfig& config);
+
+    bool operator==(const UberFSConfig& o) const {
+        return std::memcmp(this, &o, sizeof(UberFSConfig)) == 0;
+    }
+
+    bool operator!=(const UberFSConfig& o) const {
+        return !(*this == o);
+    }
+};
+
 /**
  * This struct contains common information to identify a GL vertex/geometry shader generated from
  * PICA vertex/geometry shader.
@@ -230,6 +250,19 @@ std::string GenerateFixedGeometryShader(const PicaFixedGSConfig& config, bool se
  */
 std::string GenerateFragmentShader(const PicaFSConfig& config, bool separable_shader);
 
+/// Returns whether the uber fragment shader can draw with the given configuration
+bool IsUberFragmentShaderSupported(const PicaFSConfig& config);
+
+/**
+ * Generates the GLSL fragment shader program source code of the uber shader, which reads the
+ * configuration from uniforms set from an UberFSConfig instead of having it compiled in. It
+ * emulates the texture combiners, the alpha test, fog and fragment lighting without LUTs other than
+ * distance attenuation, and is used while the shader generated for a configuration is compiling.
+ * @param separable_shader generates shader that can be used for separate shader object
+ * @returns String of the shader source code
+ */
+std::string GenerateUberFragmentShader(bool separable_shader);
+
 } // namespace OpenGL
 
 namespace std {
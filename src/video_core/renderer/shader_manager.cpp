@@ -3,15 +3,22 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <cstring>
 #include <boost/container_hash/hash.hpp>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
+#include "common/hash.h"
 #include "common/scope_exit.h"
+#include "common/thread_pool.h"
 #include "core/core.h"
+#include "core/frontend/emu_window.h"
 #include "core/settings.h"
+#include "video_core/renderer/async_shader_compiler.h"
 #include "video_core/renderer/shader_disk_cache.h"
 #include "video_core/renderer/shader_manager.h"
+#include "video_core/renderer/shader_util.h"
 #include "video_core/video_core.h"
 
 namespace OpenGL {
@@ -136,12 +143,107 @@ public:
         if (shader_or_program.index() == 0) {
             std::get<OGLShader>(shader_or_program).Create(source, type);
         } else {
-            OGLShader shader;
-            shader.Create(source, type);
-            OGLProgram& program = std::get<OGLProgram>(shader_or_program);
-            program.Create(true, {shader.handle});
-            SetShaderUniformBlockBindings(program.handle);
-            SetShaderSamplerBindings(program.handle);
+            StartCreate(source, type, Common::ComputeHash64(source, std::strlen(source)));
+            const bool linked = FinishCreate();
+            ASSERT_MSG(linked, "Shader not linked");
+        }
+    }
+
+    /**
+     * Starts compiling and linking a separable program without waiting for the driver, so drivers
+     * that compile on their own threads can work on several programs at once. FinishCreate must be
+     * called before anything else is done with the program.
+     * @param code_hash Hash of the source, which the program binary is saved with
+     */
+    void StartCreate(const char* source, GLenum type, u64 code_hash) {
+        this->code_hash = code_hash;
+
+        pending_shader.handle = glCreateShader(type);
+        glShaderSource(pending_shader.handle, 1, &source, nullptr);
+        glCompileShader(pending_shader.handle);
+
+        OGLProgram& program = std::get<OGLProgram>(shader_or_program);
+        program.handle = glCreateProgram();
+        glProgramParameteri(program.handle, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        if (GLAD_GL_ARB_get_program_binary) {
+            glProgramParameteri(program.handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glAttachShader(program.handle, pending_shader.handle);
+        glLinkProgram(program.handle);
+    }
+
+    /// Waits for the program started by StartCreate, returns whether it linked
+    bool FinishCreate() {
+        OGLProgram& program = std::get<OGLProgram>(shader_or_program);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program.handle, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            LogShaderErrors(pending_shader.handle, program.handle);
+        }
+        glDetachShader(program.handle, pending_shader.handle);
+        pending_shader.Release();
+
+        if (linked != GL_TRUE) {
+            program.Release();
+            return false;
+        }
+        SetShaderUniformBlockBindings(program.handle);
+        SetShaderSamplerBindings(program.handle);
+        return true;
+    }
+
+    /// Takes ownership of a separable program that was linked elsewhere
+    void Adopt(GLuint handle, u64 code_hash) {
+        this->code_hash = code_hash;
+        std::get<OGLProgram>(shader_or_program).handle = handle;
+        SetShaderUniformBlockBindings(handle);
+        SetShaderSamplerBindings(handle);
+    }
+
+    /// Creates a separable program from a binary of the disk cache, returns false if the driver
+    /// rejects the binary
+    bool CreateFromBinary(const ShaderDiskCacheBinary& binary, u64 code_hash) {
+        OGLProgram& program = std::get<OGLProgram>(shader_or_program);
+        program.handle = glCreateProgram();
+        glProgramParameteri(program.handle, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        glProgramBinary(program.handle, binary.format, binary.data,
+                        static_cast<GLsizei>(binary.size));
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program.handle, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            program.Release();
+            return false;
+        }
+
+        // Loading a binary resets the uniforms and the uniform block bindings
+        this->code_hash = code_hash;
+        SetShaderUniformBlockBindings(program.handle);
+        SetShaderSamplerBindings(program.handle);
+        return true;
+    }
+
+    /// Saves the binary of a separable program to the disk cache, if the driver provides one
+    void SaveBinary(ShaderDiskCache& disk_cache) const {
+        if (shader_or_program.index() == 0 || !GLAD_GL_ARB_get_program_binary) {
+            return;
+        }
+
+        const GLuint handle = std::get<OGLProgram>(shader_or_program).handle;
+        GLint length = 0;
+        glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        std::vector<u8> data(length);
+        GLsizei written = 0;
+        GLenum format = 0;
+        glGetProgramBinary(handle, length, &written, &format, data.data());
+        if (written > 0) {
+            disk_cache.AddPrecompiled(code_hash,
+                                      {format, data.data(), static_cast<std::size_t>(written)});
         }
     }
 
@@ -155,6 +257,8 @@ public:
 
 private:
     std::variant<OGLShader, OGLProgram> shader_or_program;
+    OGLShader pending_shader;
+    u64 code_hash = 0;
 };
 
 class TrivialVertexShader {
@@ -176,14 +280,25 @@ template <typename KeyConfigType, std::string (*CodeGenerator)(const KeyConfigTy
 class ShaderCache {
 public:
     explicit ShaderCache(bool separable) : separable(separable) {}
-    std::tuple<GLuint, bool> Get(const KeyConfigType& config) {
+    std::tuple<const OGLShaderStage*, bool> Get(const KeyConfigType& config) {
         auto [iter, new_shader] = shaders.emplace(config, OGLShaderStage{separable});
         OGLShaderStage& cached_shader = iter->second;
         if (new_shader) {
             const std::string result = CodeGenerator(config, separable);
             cached_shader.Create(result.c_str(), ShaderType);
         }
-        return {cached_shader.GetHandle(), new_shader};
+        return {&cached_shader, new_shader};
+    }
+
+    /// Returns the shader of the configuration if it was created already
+    const OGLShaderStage* Find(const KeyConfigType& config) const {
+        const auto it = shaders.find(config);
+        return it == shaders.end() ? nullptr : &it->second;
+    }
+
+    /// Adds a shader that was created from the disk cache or on the compiler thread
+    void Inject(const KeyConfigType& config, OGLShaderStage&& stage) {
+        shaders.emplace(config, std::move(stage));
     }
 
 private:
@@ -203,13 +318,14 @@ template <typename KeyConfigType,
 class ShaderDoubleCache {
 public:
     explicit ShaderDoubleCache(bool separable) : separable(separable) {}
-    std::tuple<GLuint, bool> Get(const KeyConfigType& key, const Pica::Shader::ShaderSetup& setup) {
+    std::tuple<const OGLShaderStage*, bool> Get(const KeyConfigType& key,
+                                                const Pica::Shader::ShaderSetup& setup) {
         auto map_it = shader_map.find(key);
         if (map_it == shader_map.end()) {
             const std::optional<std::string> program = CodeGenerator(setup, key, separable);
             if (!program) {
                 shader_map[key] = nullptr;
-                return {0, false};
+                return {nullptr, false};
             }
 
             auto [iter, new_shader] = shader_cache.emplace(*program, OGLShaderStage{separable});
@@ -218,14 +334,34 @@ public:
                 cached_shader.Create(program->c_str(), ShaderType);
             }
             shader_map[key] = &cached_shader;
-            return {cached_shader.GetHandle(), new_shader};
+            return {&cached_shader, new_shader};
         }
 
-        if (map_it->second == nullptr) {
-            return {0, false};
+        return {map_it->second, false};
+    }
+
+    /**
+     * Returns the shader of the key if it was created already
+     * @returns nothing for unknown keys, and nullptr for keys no shader can be generated for
+     */
+    std::optional<const OGLShaderStage*> Find(const KeyConfigType& key) const {
+        const auto it = shader_map.find(key);
+        if (it == shader_map.end()) {
+            return std::nullopt;
         }
+        return it->second;
+    }
 
-        return {map_it->second->GetHandle(), false};
+    /// Adds a shader that was created out of the given code from the disk cache or on the
+    /// compiler thread
+    void Inject(const KeyConfigType& key, std::string code, OGLShaderStage&& stage) {
+        auto [iter, _] = shader_cache.emplace(std::move(code), std::move(stage));
+        shader_map[key] = &iter->second;
+    }
+
+    /// Marks a key no shader can be generated for
+    void InjectUnsupported(const KeyConfigType& key) {
+        shader_map[key] = nullptr;
     }
 
 private:
@@ -244,14 +380,107 @@ using FragmentShaders = ShaderCache<PicaFSConfig, &GenerateFragmentShader, GL_FR
 
 class ShaderProgramManager::Impl {
 public:
-    explicit Impl(bool separable, bool enable_hacks)
+    explicit Impl(bool separable, bool enable_hacks, Frontend::EmuWindow& emu_window)
         : enable_hacks(enable_hacks), separable(separable), programmable_vertex_shaders(separable),
           trivial_vertex_shader(separable), fixed_geometry_shaders(separable),
-          fragment_shaders(separable) {
+          fragment_shaders(separable), uber_fragment_shader(separable) {
         if (separable) {
             pipeline.Create();
         }
         disk_cache = std::make_unique<ShaderDiskCache>(separable);
+
+        if (Settings::values.async_shader_compilation) {
+            if (!separable) {
+                LOG_WARNING(Render_OpenGL, "Asynchronous shader compilation requires separate "
+                                           "shader programs, compiling synchronously");
+            } else if (auto context = emu_window.CreateSharedContext()) {
+                async_compiler = std::make_unique<AsyncShaderCompiler>(std::move(context));
+
+                uber_fragment_shader.Create(GenerateUberFragmentShader(true).c_str(),
+                                            GL_FRAGMENT_SHADER);
+                const GLuint handle = uber_fragment_shader.GetHandle();
+                uber_tev_stages_location = glGetUniformLocation(handle, "tev_stages");
+                uber_state_location = glGetUniformLocation(handle, "uber_state");
+                uber_lights_location = glGetUniformLocation(handle, "uber_lights");
+            } else {
+                LOG_WARNING(Render_OpenGL, "Asynchronous shader compilation requires a shared "
+                                           "context, compiling synchronously");
+            }
+        }
+    }
+
+    bool IsDiskCacheEnabled() const {
+        return Settings::values.use_hardware_shader && Settings::values.enable_disk_shader_cache;
+    }
+
+    void AddVertexShaderToDiskCache(const Pica::Regs& regs,
+                                    const Pica::Shader::ShaderSetup& setup) {
+        std::vector<u32> code{setup.program_code.begin(), setup.program_code.end()};
+        code.insert(code.end(), setup.swizzle_data.begin(), setup.swizzle_data.end());
+        const u64 unique_identifier = GetUniqueIdentifier(regs, code);
+        const ShaderDiskCacheEntry entry{unique_identifier, ProgramType::VS, regs, std::move(code)};
+        disk_cache->Add(entry);
+    }
+
+    void AddFragmentShaderToDiskCache(const Pica::Regs& regs) {
+        const u64 unique_identifier = GetUniqueIdentifier(regs, {});
+        const ShaderDiskCacheEntry entry{unique_identifier, ProgramType::FS, regs, {}};
+        disk_cache->Add(entry);
+    }
+
+    void QueueVertexShader(const PicaVSConfig& config, const Pica::Shader::ShaderSetup& setup) {
+        async_compiler->Queue(
+            [config, setup] { return GenerateVertexShader(setup, config, true); },
+            GL_VERTEX_SHADER, [this, config](GLuint program, u64 code_hash, std::string code) {
+                pending_vertex_shaders.erase(config);
+                if (program == 0) {
+                    // Keep shading this configuration on the CPU
+                    programmable_vertex_shaders.InjectUnsupported(config);
+                    return;
+                }
+
+                OGLShaderStage stage(true);
+                stage.Adopt(program, code_hash);
+                if (IsDiskCacheEnabled()) {
+                    stage.SaveBinary(*disk_cache);
+                }
+                programmable_vertex_shaders.Inject(config, std::move(code), std::move(stage));
+            });
+    }
+
+    void QueueFragmentShader(const PicaFSConfig& config) {
+        async_compiler->Queue(
+            [config] { return std::optional<std::string>(GenerateFragmentShader(config, true)); },
+            GL_FRAGMENT_SHADER, [this, config](GLuint program, u64 code_hash, std::string) {
+                if (program == 0) {
+                    // Leave it pending, so this configuration keeps using the uber shader
+                    return;
+                }
+                pending_fragment_shaders.erase(config);
+
+                OGLShaderStage stage(true);
+                stage.Adopt(program, code_hash);
+                if (IsDiskCacheEnabled()) {
+                    stage.SaveBinary(*disk_cache);
+                }
+                fragment_shaders.Inject(config, std::move(stage));
+            });
+    }
+
+    void UseUberFragmentShader(const PicaFSConfig& config) {
+        const UberFSConfig uber_config = UberFSConfig::BuildFromConfig(config);
+        const GLuint handle = uber_fragment_shader.GetHandle();
+        if (!uber_fragment_shader_config || *uber_fragment_shader_config != uber_config) {
+            glProgramUniform4uiv(handle, uber_tev_stages_location,
+                                 static_cast<GLsizei>(uber_config.tev_stages.size()),
+                                 uber_config.tev_stages[0].data());
+            glProgramUniform1ui(handle, uber_state_location, uber_config.state);
+            glProgramUniform1uiv(handle, uber_lights_location,
+                                 static_cast<GLsizei>(uber_config.lights.size()),
+                                 uber_config.lights.data());
+            uber_fragment_shader_config = uber_config;
+        }
+        current.fs = handle;
     }
 
     struct ShaderTuple {
@@ -292,28 +521,60 @@ public:
     std::unordered_map<ShaderTuple, OGLProgram, ShaderTuple::Hash> program_cache;
     OGLPipeline pipeline;
     std::unique_ptr<ShaderDiskCache> disk_cache;
+
+    // Asynchronous compilation
+    std::unordered_set<PicaVSConfig> pending_vertex_shaders;
+    std::unordered_set<PicaFSConfig> pending_fragment_shaders;
+    bool fragment_shader_pending = false;
+    OGLShaderStage uber_fragment_shader;
+    std::optional<UberFSConfig> uber_fragment_shader_config;
+    GLint uber_tev_stages_location = -1;
+    GLint uber_state_location = -1;
+    GLint uber_lights_location = -1;
+    // Destroyed first, its callbacks use the members above
+    std::unique_ptr<AsyncShaderCompiler> async_compiler;
 };
 
-ShaderProgramManager::ShaderProgramManager(bool separable, bool enable_hacks)
-    : impl(std::make_unique<Impl>(separable, enable_hacks)) {}
+ShaderProgramManager::ShaderProgramManager(bool separable, bool enable_hacks,
+                                           Frontend::EmuWindow& emu_window)
+    : impl(std::make_unique<Impl>(separable, enable_hacks, emu_window)) {}
 
 ShaderProgramManager::~ShaderProgramManager() = default;
 
 bool ShaderProgramManager::UseProgrammableVertexShader(const Pica::Regs& regs,
                                                        Pica::Shader::ShaderSetup& setup) {
     PicaVSConfig config{regs.vs, setup};
-    auto [handle, new_shader] = impl->programmable_vertex_shaders.Get(config, setup);
-    if (handle == 0) {
+
+    if (impl->async_compiler) {
+        impl->async_compiler->Poll();
+
+        const std::optional<const OGLShaderStage*> found =
+            impl->programmable_vertex_shaders.Find(config);
+        if (!found) {
+            // Shade the vertices on the CPU until the program is ready
+            if (impl->pending_vertex_shaders.insert(config).second) {
+                impl->QueueVertexShader(config, setup);
+                if (impl->IsDiskCacheEnabled()) {
+                    impl->AddVertexShaderToDiskCache(regs, setup);
+                }
+            }
+            return false;
+        }
+        if (*found == nullptr) {
+            return false;
+        }
+        impl->current.vs = (*found)->GetHandle();
+        return true;
+    }
+
+    auto [stage, new_shader] = impl->programmable_vertex_shaders.Get(config, setup);
+    if (stage == nullptr) {
         return false;
     }
-    impl->current.vs = handle;
-    if (Settings::values.use_hardware_shader && Settings::values.enable_disk_shader_cache &&
-        new_shader) {
-        std::vector<u32> code{setup.program_code.begin(), setup.program_code.end()};
-        code.insert(code.end(), setup.swizzle_data.begin(), setup.swizzle_data.end());
-        const u64 unique_identifier = GetUniqueIdentifier(regs, code);
-        const ShaderDiskCacheEntry entry{unique_identifier, ProgramType::VS, regs, std::move(code)};
-        impl->disk_cache->Add(entry);
+    impl->current.vs = stage->GetHandle();
+    if (impl->IsDiskCacheEnabled() && new_shader) {
+        impl->AddVertexShaderToDiskCache(regs, setup);
+        stage->SaveBinary(*impl->disk_cache);
     }
     return true;
 }
@@ -324,8 +585,8 @@ void ShaderProgramManager::UseTrivialVertexShader() {
 
 void ShaderProgramManager::UseFixedGeometryShader(const Pica::Regs& regs) {
     PicaFixedGSConfig gs_config(regs);
-    auto [handle, _] = impl->fixed_geometry_shaders.Get(gs_config);
-    impl->current.gs = handle;
+    auto [stage, _] = impl->fixed_geometry_shaders.Get(gs_config);
+    impl->current.gs = stage->GetHandle();
 }
 
 void ShaderProgramManager::UseTrivialGeometryShader() {
@@ -334,16 +595,41 @@ void ShaderProgramManager::UseTrivialGeometryShader() {
 
 void ShaderProgramManager::UseFragmentShader(const Pica::Regs& regs) {
     PicaFSConfig config = PicaFSConfig::BuildFromRegs(regs);
-    auto [handle, new_shader] = impl->fragment_shaders.Get(config);
-    impl->current.fs = handle;
-    if (Settings::values.use_hardware_shader && Settings::values.enable_disk_shader_cache &&
-        new_shader) {
-        u64 unique_identifier = GetUniqueIdentifier(regs, {});
-        ShaderDiskCacheEntry entry{unique_identifier, ProgramType::FS, regs, {}};
-        impl->disk_cache->Add(entry);
+    impl->fragment_shader_pending = false;
+
+    if (impl->async_compiler) {
+        impl->async_compiler->Poll();
+
+        if (const OGLShaderStage* stage = impl->fragment_shaders.Find(config)) {
+            impl->current.fs = stage->GetHandle();
+            return;
+        }
+
+        if (IsUberFragmentShaderSupported(config)) {
+            if (impl->pending_fragment_shaders.insert(config).second) {
+                impl->QueueFragmentShader(config);
+                if (impl->IsDiskCacheEnabled()) {
+                    impl->AddFragmentShaderToDiskCache(regs);
+                }
+            }
+            impl->UseUberFragmentShader(config);
+            impl->fragment_shader_pending = true;
+            return;
+        }
+    }
+
+    auto [stage, new_shader] = impl->fragment_shaders.Get(config);
+    impl->current.fs = stage->GetHandle();
+    if (impl->IsDiskCacheEnabled() && new_shader) {
+        impl->AddFragmentShaderToDiskCache(regs);
+        stage->SaveBinary(*impl->disk_cache);
     }
 }
 
+bool ShaderProgramManager::IsFragmentShaderPending() const {
+    return impl->fragment_shader_pending;
+}
+
 void ShaderProgramManager::ApplyTo(OpenGLState& state) {
     if (impl->separable) {
         if (impl->enable_hacks) {
@@ -387,36 +673,86 @@ void ShaderProgramManager::LoadDiskCache() {
 
     SCOPE_EXIT({ system.DiskShaderCacheCallback(false, 0, 0); });
 
-    for (std::size_t i = 0; i < entries->size(); ++i) {
-        const auto& entry = entries->at(i);
-        const u64 unique_identifier = entry.GetUniqueIdentifier();
-
-        GLuint handle = 0;
-
-        if (entry.GetType() == ProgramType::VS) {
-            auto [conf, setup] = BuildVsConfigFromEntry(entry);
-            auto [h, _] = impl->programmable_vertex_shaders.Get(conf, setup);
-            handle = h;
-        } else if (entry.GetType() == ProgramType::FS) {
-            PicaFSConfig conf = PicaFSConfig::BuildFromRegs(entry.GetRegisters());
-            auto [h, _] = impl->fragment_shaders.Get(conf);
-            handle = h;
-        } else {
+    for (const ShaderDiskCacheEntry& entry : *entries) {
+        if (entry.GetType() != ProgramType::VS && entry.GetType() != ProgramType::FS) {
             LOG_ERROR(Render_OpenGL,
                       "Unsupported shader type ({}) found in disk shader cache, deleting it",
                       static_cast<u32>(entry.GetType()));
             impl->disk_cache->Delete();
             return;
         }
+    }
 
-        if (handle == 0) {
-            LOG_ERROR(Render_OpenGL, "Compilation failed, deleting cache");
+    // Generating the code only needs the CPU, so it's spread across threads. The program binaries
+    // are looked up by the hash of the code.
+    const std::size_t total = entries->size();
+    std::vector<std::optional<std::string>> codes(total);
+    std::vector<u64> code_hashes(total);
+    Common::GetThreadPool().ParallelFor(total, [&](std::size_t i) {
+        const ShaderDiskCacheEntry& entry = (*entries)[i];
+        if (entry.GetType() == ProgramType::VS) {
+            const auto [conf, setup] = BuildVsConfigFromEntry(entry);
+            codes[i] = GenerateVertexShader(setup, conf, true);
+        } else {
+            codes[i] =
+                GenerateFragmentShader(PicaFSConfig::BuildFromRegs(entry.GetRegisters()), true);
+        }
+        if (codes[i]) {
+            code_hashes[i] = Common::ComputeHash64(codes[i]->data(), codes[i]->size());
+        }
+    });
+
+    // Start compiling every shader that has no usable binary before waiting for any of them
+    std::vector<OGLShaderStage> stages;
+    stages.reserve(total);
+    std::vector<bool> compiling(total);
+    std::size_t num_compiling = 0;
+    for (std::size_t i = 0; i < total; ++i) {
+        if (!codes[i]) {
+            LOG_ERROR(Render_OpenGL, "Code generation failed, deleting cache");
             impl->disk_cache->Delete();
             return;
         }
 
-        system.DiskShaderCacheCallback(true, i + 1, entries->size());
+        OGLShaderStage& stage = stages.emplace_back(true);
+        const auto binary = impl->disk_cache->FindPrecompiled(code_hashes[i]);
+        if (binary && stage.CreateFromBinary(*binary, code_hashes[i])) {
+            continue;
+        }
+
+        const GLenum type =
+            (*entries)[i].GetType() == ProgramType::VS ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+        stage.StartCreate(codes[i]->c_str(), type, code_hashes[i]);
+        compiling[i] = true;
+        ++num_compiling;
+    }
+
+    for (std::size_t i = 0; i < total; ++i) {
+        const ShaderDiskCacheEntry& entry = (*entries)[i];
+        OGLShaderStage& stage = stages[i];
+
+        if (compiling[i]) {
+            if (!stage.FinishCreate()) {
+                LOG_ERROR(Render_OpenGL, "Compilation failed, deleting cache");
+                impl->disk_cache->Delete();
+                return;
+            }
+            stage.SaveBinary(*impl->disk_cache);
+        }
+
+        if (entry.GetType() == ProgramType::VS) {
+            const auto [conf, setup] = BuildVsConfigFromEntry(entry);
+            impl->programmable_vertex_shaders.Inject(conf, std::move(*codes[i]), std::move(stage));
+        } else {
+            impl->fragment_shaders.Inject(PicaFSConfig::BuildFromRegs(entry.GetRegisters()),
+                                          std::move(stage));
+        }
+
+        system.DiskShaderCacheCallback(true, i + 1, total);
     }
+
+    LOG_INFO(Render_OpenGL, "Loaded {} shaders from program binaries and compiled {}",
+             total - num_compiling, num_compiling);
 }
 
 } // namespace OpenGL
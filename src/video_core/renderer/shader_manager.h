@@ -16,6 +16,10 @@ namespace Core {
 class System;
 } // namespace Core
 
+namespace Frontend {
+class EmuWindow;
+} // namespace Frontend
+
 namespace OpenGL {
 
 enum class UniformBindings : GLuint { Common, VS, GS };
@@ -98,7 +102,8 @@ static_assert(sizeof(VSUniformData) < 16384,
 /// A class that manage different shader stages and configures them with given config data.
 class ShaderProgramManager {
 public:
-    explicit ShaderProgramManager(bool separable, bool enable_hacks);
+    explicit ShaderProgramManager(bool separable, bool enable_hacks,
+                                  Frontend::EmuWindow& emu_window);
     ~ShaderProgramManager();
 
     bool UseProgrammableVertexShader(const Pica::Regs& config, Pica::Shader::ShaderSetup& setup);
@@ -106,6 +111,8 @@ public:
     void UseFixedGeometryShader(const Pica::Regs& regs);
     void UseTrivialGeometryShader();
     void UseFragmentShader(const Pica::Regs& config);
+    /// Returns whether the uber shader is drawn with until the fragment shader finished compiling
+    bool IsFragmentShaderPending() const;
     void ApplyTo(OpenGLState& state);
     void LoadDiskCache();
 
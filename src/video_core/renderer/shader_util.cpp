@@ -95,4 +95,21 @@ GLuint LoadProgram(bool separable_program, const std::vector<GLuint>& shaders) {
     return program_id;
 }
 
+void LogShaderErrors(GLuint shader, GLuint program) {
+    GLint info_log_length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 1) {
+        std::vector<char> shader_error(info_log_length);
+        glGetShaderInfoLog(shader, info_log_length, nullptr, &shader_error[0]);
+        LOG_ERROR(Render_OpenGL, "Error compiling shader:\n{}", &shader_error[0]);
+    }
+
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 1) {
+        std::vector<char> program_error(info_log_length);
+        glGetProgramInfoLog(program, info_log_length, nullptr, &program_error[0]);
+        LOG_ERROR(Render_OpenGL, "Error linking shader:\n{}", &program_error[0]);
+    }
+}
+
 } // namespace OpenGL
@@ -24,4 +24,11 @@ GLuint LoadShader(const char* source, GLenum type);
  */
 GLuint LoadProgram(bool separable_program, const std::vector<GLuint>& shaders);
 
+/**
+ * Utility function to log why a shader didn't compile or a program didn't link
+ * @param shader ID of the shader, still attached to the program
+ * @param program ID of the program
+ */
+void LogShaderErrors(GLuint shader, GLuint program);
+
 } // namespace OpenGL
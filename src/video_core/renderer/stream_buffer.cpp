@@ -101,4 +101,10 @@ void OGLStreamBuffer::Unmap(GLsizeiptr size) {
     buffer_pos += size;
 }
 
+bool OGLStreamBuffer::HasSpace(GLsizeiptr size, GLintptr alignment) const {
+    const GLintptr pos =
+        alignment > 0 ? Common::AlignUp<std::size_t>(buffer_pos, alignment) : buffer_pos;
+    return pos + size <= buffer_size;
+}
+
 } // namespace OpenGL
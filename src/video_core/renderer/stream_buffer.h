@@ -32,6 +32,9 @@ public:
 
     void Unmap(GLsizeiptr size);
 
+    /// Returns whether a chunk of "size" bytes can be mapped without reallocating the buffer
+    bool HasSpace(GLsizeiptr size, GLintptr alignment = 0) const;
+
 private:
     OGLBuffer gl_buffer;
     GLenum gl_target;
@@ -0,0 +1,31 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "video_core/renderer/surface_index.h"
+
+namespace OpenGL {
+
+std::vector<Surface> SurfaceIndex::GetSurfaces() const {
+    std::vector<Surface> surfaces;
+    surfaces.reserve(num_surfaces);
+    for (const Slot& slot : slots) {
+        if (slot.surface != nullptr) {
+            surfaces.push_back(slot.surface);
+        }
+    }
+    return surfaces;
+}
+
+u32 SurfaceIndex::NextVisitStamp() {
+    if (++visit_stamp == 0) {
+        // The stamps wrapped around, forget the old ones so they can't collide with new ones
+        for (Slot& slot : slots) {
+            slot.visit = 0;
+        }
+        visit_stamp = 1;
+    }
+    return visit_stamp;
+}
+
+} // namespace OpenGL
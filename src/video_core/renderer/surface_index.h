@@ -0,0 +1,166 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "common/assert.h"
+#include "common/common_types.h"
+#include "core/memory.h"
+#include "video_core/renderer/surface_params.h"
+
+namespace OpenGL {
+
+/**
+ * Index of the cached surfaces by the pages of 3DS memory they cover. Every page has a bucket with
+ * the ids of the surfaces touching it, so finding the surfaces overlapping a region only reads the
+ * buckets of its pages, and doesn't allocate once the buckets have grown.
+ * The number of surfaces in a bucket is also the number of surfaces caching the page.
+ */
+class SurfaceIndex {
+public:
+    /**
+     * Adds a surface covering [addr, end).
+     * @param on_cached Called with the start and end address of every run of pages that no surface
+     *                  covered before
+     * @returns the id of the surface in the index
+     */
+    template <typename Func>
+    u32 Insert(Surface surface, PAddr addr, PAddr end, Func&& on_cached) {
+        u32 id;
+        if (free_ids.empty()) {
+            id = static_cast<u32>(slots.size());
+            slots.emplace_back();
+        } else {
+            id = free_ids.back();
+            free_ids.pop_back();
+        }
+        slots[id] = {std::move(surface), addr, end, 0};
+        ++num_surfaces;
+
+        const u32 first_page = addr >> Memory::PAGE_BITS;
+        const u32 last_page = GetLastPage(addr, end);
+        if (buckets.size() <= last_page) {
+            buckets.resize(last_page + 1);
+        }
+
+        u32 run_start = first_page;
+        for (u32 page = first_page; page <= last_page; ++page) {
+            std::vector<u32>& bucket = buckets[page];
+            bucket.push_back(id);
+            if (bucket.size() != 1) {
+                ReportRun(run_start, page, on_cached);
+                run_start = page + 1;
+            }
+        }
+        ReportRun(run_start, last_page + 1, on_cached);
+
+        return id;
+    }
+
+    /**
+     * Removes a surface.
+     * @param on_uncached Called with the start and end address of every run of pages that no
+     *                    surface covers anymore
+     */
+    template <typename Func>
+    void Remove(u32 id, Func&& on_uncached) {
+        Slot& slot = slots[id];
+        ASSERT(slot.surface != nullptr);
+
+        const u32 first_page = slot.addr >> Memory::PAGE_BITS;
+        const u32 last_page = GetLastPage(slot.addr, slot.end);
+
+        u32 run_start = first_page;
+        for (u32 page = first_page; page <= last_page; ++page) {
+            std::vector<u32>& bucket = buckets[page];
+            const auto it = std::find(bucket.begin(), bucket.end(), id);
+            ASSERT(it != bucket.end());
+            *it = bucket.back();
+            bucket.pop_back();
+            if (!bucket.empty()) {
+                ReportRun(run_start, page, on_uncached);
+                run_start = page + 1;
+            }
+        }
+        ReportRun(run_start, last_page + 1, on_uncached);
+
+        slot.surface = nullptr;
+        free_ids.push_back(id);
+        --num_surfaces;
+    }
+
+    /**
+     * Calls func once for every surface overlapping [addr, end).
+     * func must not modify or query the index.
+     */
+    template <typename Func>
+    void ForEachOverlapping(PAddr addr, PAddr end, Func&& func) {
+        if (end <= addr || num_surfaces == 0) {
+            return;
+        }
+
+        const u32 first_page = addr >> Memory::PAGE_BITS;
+        if (first_page >= buckets.size()) {
+            return;
+        }
+        const u32 last_page = std::min<u32>((end - 1) >> Memory::PAGE_BITS,
+                                            static_cast<u32>(buckets.size()) - 1);
+
+        // Surfaces covering several of the pages are in several buckets, the visit stamp makes
+        // sure they're only reported once
+        const u32 stamp = NextVisitStamp();
+        for (u32 page = first_page; page <= last_page; ++page) {
+            for (const u32 id : buckets[page]) {
+                Slot& slot = slots[id];
+                if (slot.visit == stamp) {
+                    continue;
+                }
+                slot.visit = stamp;
+                if (slot.addr < end && slot.end > addr) {
+                    func(slot.surface);
+                }
+            }
+        }
+    }
+
+    bool IsEmpty() const {
+        return num_surfaces == 0;
+    }
+
+    /// Returns every surface in the index
+    std::vector<Surface> GetSurfaces() const;
+
+private:
+    struct Slot {
+        Surface surface;
+        PAddr addr;
+        PAddr end;
+        u32 visit;
+    };
+
+    /// Empty surfaces are put in the bucket of their address
+    static u32 GetLastPage(PAddr addr, PAddr end) {
+        return (std::max(end, addr + 1) - 1) >> Memory::PAGE_BITS;
+    }
+
+    template <typename Func>
+    static void ReportRun(u32 first_page, u32 end_page, Func& func) {
+        if (first_page != end_page) {
+            func(first_page << Memory::PAGE_BITS, end_page << Memory::PAGE_BITS);
+        }
+    }
+
+    u32 NextVisitStamp();
+
+    std::vector<Slot> slots;
+    std::vector<u32> free_ids;
+    std::vector<std::vector<u32>> buckets;
+    std::size_t num_surfaces = 0;
+    u32 visit_stamp = 0;
+};
+
+} // namespace OpenGL
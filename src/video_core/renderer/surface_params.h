@@ -197,6 +197,14 @@ public:
         return SurfaceType::Invalid;
     }
 
+    static constexpr unsigned int GetGLBytesPerPixel(PixelFormat format) {
+        // OpenGL needs 4 bpp alignment for D24 since using GL_UNSIGNED_INT as type
+        return format == PixelFormat::Invalid ? 0
+               : (format == PixelFormat::D24 || GetFormatType(format) == SurfaceType::Texture)
+                   ? 4
+                   : SurfaceParams::GetFormatBpp(format) / 8;
+    }
+
     /// Update the params "size", "end" and "type" from the already set "addr", "width", "height"
     /// and "pixel_format"
     void UpdateParams() {
@@ -25,6 +25,10 @@ public:
     // Returns true if there is no active filter
     bool IsNull() const;
 
+    std::string_view GetFilterName() const {
+        return filter_name;
+    }
+
     // Returns true if the texture was able to be filtered
     bool Filter(GLuint src_tex, const Common::Rectangle<u32>& src_rect, GLuint dst_tex,
                 const Common::Rectangle<u32>& dst_rect, SurfaceParams::SurfaceType type,
@@ -0,0 +1,197 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <utility>
+#include "common/assert.h"
+#include "core/memory.h"
+#include "video_core/renderer/rasterizer_cache.h"
+#include "video_core/renderer/state.h"
+#include "video_core/renderer/texture_uploader.h"
+#include "video_core/texture/tile_decode.h"
+#include "video_core/video_core.h"
+
+namespace OpenGL {
+
+// Big enough for a few 1024x1024 textures. Everything in the buffer has to be uploaded before it
+// wraps around, so a small buffer makes the draw path wait for the workers more often.
+constexpr GLsizeiptr UPLOAD_BUFFER_SIZE = 32 * 1024 * 1024;
+
+constexpr std::size_t NUM_WORKERS = 2;
+
+TextureUploader::TextureUploader()
+    : buffer(GL_PIXEL_UNPACK_BUFFER, UPLOAD_BUFFER_SIZE, false, true) {
+    // The workers write into the mapping while it's in use, which is only safe if it's persistent
+    // and coherent
+    ASSERT(IsSupported());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (std::size_t i = 0; i < NUM_WORKERS; ++i) {
+        workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+TextureUploader::~TextureUploader() {
+    // The surfaces are being destroyed, just make sure nothing writes into the buffer anymore
+    for (const PendingUpload& upload : pending) {
+        upload.decoded.wait();
+    }
+    pending.clear();
+
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    task_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+bool TextureUploader::IsSupported() {
+    return GLAD_GL_ARB_buffer_storage;
+}
+
+bool TextureUploader::Queue(const Surface& surface, const Common::Rectangle<u32>& rect) {
+    ASSERT(surface->type == SurfaceParams::SurfaceType::Texture && surface->is_tiled);
+
+    const u8* const texture_src_data = VideoCore::g_memory->GetPhysicalPointer(surface->addr);
+    if (texture_src_data == nullptr) {
+        return false;
+    }
+
+    const u32 width = rect.GetWidth();
+    const u32 height = rect.GetHeight();
+    const std::ptrdiff_t pitch = static_cast<std::ptrdiff_t>(width) * 4;
+    const GLsizeiptr size = pitch * height;
+    if (size == 0 || size > buffer.GetSize()) {
+        return false;
+    }
+
+    // Upload what already finished decoding to keep the list short
+    while (!pending.empty() &&
+           pending.front().decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        Upload(pending.front());
+        pending.pop_front();
+    }
+
+    if (!buffer.HasSpace(size, 4)) {
+        // Mapping reallocates the buffer, which must not happen while the workers write into it
+        CompleteAll();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.GetHandle());
+    const auto [pointer, offset, invalidate] = buffer.Map(size, 4);
+    buffer.Unmap(size);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    Pica::Texture::TextureInfo info{};
+    info.width = surface->width;
+    info.height = surface->height;
+    info.format = static_cast<Pica::TexturingRegs::TextureFormat>(surface->pixel_format);
+    info.SetDefaultStride();
+    info.physical_address = surface->addr;
+
+    // Decode only the tiles of the rectangle, bottom row of the rectangle first as OpenGL expects
+    const u32 first_column = rect.left / 8;
+    const u32 first_row = (surface->height - rect.top) / 8;
+    const u8* const source = texture_src_data + first_row * info.stride +
+                             first_column * Pica::Texture::CalculateTileSize(info.format);
+    u8* const dest = pointer + (height - 1) * pitch;
+
+    std::future<void> decoded = RunOnWorker([source, info, width, height, dest, pitch] {
+        Pica::Texture::DecodeTiles(source, info, 0, width / 8, 0, height / 8, dest, -pitch);
+    });
+    pending.push_back({surface, rect, offset, std::move(decoded)});
+    ++surface->pending_uploads;
+    return true;
+}
+
+bool TextureUploader::Complete(const Surface& surface, bool wait) {
+    if (surface->pending_uploads == 0) {
+        return true;
+    }
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->surface != surface) {
+            ++it;
+            continue;
+        }
+
+        if (!wait &&
+            it->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+
+        it->decoded.wait();
+        Upload(*it);
+        it = pending.erase(it);
+    }
+
+    return true;
+}
+
+void TextureUploader::CompleteAll() {
+    for (const PendingUpload& upload : pending) {
+        upload.decoded.wait();
+        Upload(upload);
+    }
+    pending.clear();
+}
+
+std::future<void> TextureUploader::RunOnWorker(std::function<void()> function) {
+    std::packaged_task<void()> task(std::move(function));
+    std::future<void> future = task.get_future();
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    task_cv.notify_one();
+    return future;
+}
+
+void TextureUploader::WorkerLoop() {
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_cv.wait(lock, [this] { return stop || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void TextureUploader::Upload(const PendingUpload& upload) {
+    CachedSurface& surface = *upload.surface;
+
+    OpenGLState cur_state = OpenGLState::GetCurState();
+    const GLuint old_tex = cur_state.texture_units[0].texture_2d;
+    cur_state.texture_units[0].texture_2d = surface.texture.handle;
+    cur_state.Apply();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.GetHandle());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(upload.rect.GetWidth()));
+
+    glActiveTexture(GL_TEXTURE0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(upload.rect.left),
+                    static_cast<GLint>(upload.rect.bottom),
+                    static_cast<GLsizei>(upload.rect.GetWidth()),
+                    static_cast<GLsizei>(upload.rect.GetHeight()), tex_tuple.format,
+                    tex_tuple.type, reinterpret_cast<const void*>(upload.buffer_offset));
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    cur_state.texture_units[0].texture_2d = old_tex;
+    cur_state.Apply();
+
+    --surface.pending_uploads;
+}
+
+} // namespace OpenGL
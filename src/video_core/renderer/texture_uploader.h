@@ -0,0 +1,76 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "common/math_util.h"
+#include "video_core/renderer/stream_buffer.h"
+#include "video_core/renderer/surface_params.h"
+
+namespace OpenGL {
+
+/**
+ * Decodes textures from 3DS memory on worker threads straight into a persistently mapped pixel
+ * unpack buffer, and uploads them to the surface textures once they are needed.
+ */
+class TextureUploader : NonCopyable {
+public:
+    TextureUploader();
+    ~TextureUploader();
+
+    /// Returns whether the host supports the persistently mapped buffer this needs
+    static bool IsSupported();
+
+    /**
+     * Starts decoding a rectangle of a texture surface. The decoded rectangle is uploaded to the
+     * texture by Complete or CompleteAll.
+     * @param rect Rectangle in texels, covering whole tiles
+     * @returns false if the rectangle has to be loaded synchronously instead
+     */
+    bool Queue(const Surface& surface, const Common::Rectangle<u32>& rect);
+
+    /**
+     * Uploads the rectangles of the surface that are being decoded, in the order they were queued.
+     * @param wait If false, stops at the first rectangle that isn't decoded yet
+     * @returns whether the texture of the surface is up to date
+     */
+    bool Complete(const Surface& surface, bool wait);
+
+    /// Waits for and uploads every rectangle that is being decoded
+    void CompleteAll();
+
+private:
+    struct PendingUpload {
+        Surface surface;
+        Common::Rectangle<u32> rect;
+        GLintptr buffer_offset;
+        std::future<void> decoded;
+    };
+
+    std::future<void> RunOnWorker(std::function<void()> function);
+    void WorkerLoop();
+
+    void Upload(const PendingUpload& upload);
+
+    OGLStreamBuffer buffer;
+    std::list<PendingUpload> pending;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable task_cv;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stop = false;
+};
+
+} // namespace OpenGL
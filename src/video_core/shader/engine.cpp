@@ -4,7 +4,10 @@
 
 #include "video_core/shader/compiler.h"
 #include "video_core/shader/engine.h"
+#include "video_core/shader/interpreter.h"
 #include "video_core/shader/shader.h"
+#include "video_core/shader/vector_compiler.h"
+#include "video_core/video_core.h"
 
 namespace Pica::Shader {
 
@@ -15,6 +18,19 @@ void Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
     ASSERT(entry_point < MAX_PROGRAM_CODE_LENGTH);
     setup.engine_data.entry_point = entry_point;
 
+    if (VideoCore::g_shader_profiling_enabled) {
+        setup.engine_data.cached_shader = nullptr;
+        setup.engine_data.profile = &profiler.GetProgramProfile(setup);
+        return;
+    }
+
+    setup.engine_data.profile = nullptr;
+
+    if (!VideoCore::g_shader_jit_enabled) {
+        setup.engine_data.cached_shader = nullptr;
+        return;
+    }
+
     u64 code_hash = setup.GetProgramCodeHash();
     u64 swizzle_hash = setup.GetSwizzleDataHash();
 
@@ -31,10 +47,46 @@ void Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
 }
 
 void Engine::Run(const ShaderSetup& setup, UnitState& state) const {
-    ASSERT(setup.engine_data.cached_shader != nullptr);
+    if (setup.engine_data.cached_shader == nullptr) {
+        RunInterpreter(setup, state, setup.engine_data.entry_point, setup.engine_data.profile);
+        return;
+    }
 
     const Compiler* compiler = static_cast<const Compiler*>(setup.engine_data.cached_shader);
     compiler->Run(setup, state, setup.engine_data.entry_point);
 }
 
+bool Engine::SetupVectorized(ShaderSetup& setup) {
+    // The interpreter has no vectorized variant
+    if (setup.engine_data.cached_shader == nullptr) {
+        return false;
+    }
+
+    u64 code_hash = setup.GetProgramCodeHash();
+    u64 swizzle_hash = setup.GetSwizzleDataHash();
+
+    u64 cache_key = code_hash ^ swizzle_hash;
+    auto iter = vector_cache.find(cache_key);
+    if (iter != vector_cache.end()) {
+        setup.engine_data.cached_vector_shader = iter->second.get();
+    } else {
+        std::unique_ptr<VectorCompiler> shader = std::make_unique<VectorCompiler>();
+        if (!shader->Compile(&setup.program_code, &setup.swizzle_data)) {
+            shader = nullptr;
+        }
+        setup.engine_data.cached_vector_shader = shader.get();
+        vector_cache.emplace_hint(iter, cache_key, std::move(shader));
+    }
+
+    return setup.engine_data.cached_vector_shader != nullptr;
+}
+
+void Engine::RunVectorized(const ShaderSetup& setup, VectorUnitState& state) const {
+    ASSERT(setup.engine_data.cached_vector_shader != nullptr);
+
+    const VectorCompiler* compiler =
+        static_cast<const VectorCompiler*>(setup.engine_data.cached_vector_shader);
+    compiler->Run(setup, state, setup.engine_data.entry_point);
+}
+
 } // namespace Pica::Shader
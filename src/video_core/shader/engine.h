@@ -7,22 +7,46 @@
 #include <memory>
 #include <unordered_map>
 #include "common/common_types.h"
+#include "video_core/shader/profiler.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica::Shader {
 
 class Compiler;
+class VectorCompiler;
 
 class Engine {
 public:
     Engine();
     ~Engine();
 
+    /**
+     * Prepares the shader for the following Run calls, compiling it unless the JIT is disabled.
+     * Enabling profiling selects the interpreter.
+     */
     void SetupBatch(ShaderSetup& setup, unsigned int entry_point);
     void Run(const ShaderSetup& setup, UnitState& state) const;
 
+    /**
+     * Prepares the vectorized variant of the shader prepared by the last SetupBatch call.
+     * @returns false if the shader can't be vectorized, in which case Run has to be used
+     */
+    bool SetupVectorized(ShaderSetup& setup);
+
+    /// Runs the shader on VECTOR_WIDTH vertices at once
+    void RunVectorized(const ShaderSetup& setup, VectorUnitState& state) const;
+
+    Profiler& GetProfiler() {
+        return profiler;
+    }
+
 private:
     std::unordered_map<u64, std::unique_ptr<Compiler>> cache;
+
+    /// Vectorized shaders, nullptr for the ones that can't be vectorized
+    std::unordered_map<u64, std::unique_ptr<VectorCompiler>> vector_cache;
+
+    Profiler profiler;
 };
 
 } // namespace Pica::Shader
@@ -0,0 +1,518 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cmath>
+#include <limits>
+#include <boost/container/static_vector.hpp>
+#include <nihstro/shader_bytecode.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/vector_math.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/interpreter.h"
+#include "video_core/shader/profiler.h"
+#include "video_core/shader/shader.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica::Shader {
+
+namespace {
+
+/// Entry of the interpreter call stack, for subroutines, conditional blocks and loops
+struct CallStackElement {
+    u32 final_address;  ///< Address upon which the block is left
+    u32 return_address; ///< Address to continue at after leaving the block
+    u32 repeat_counter; ///< Number of iterations left, only non-zero for loops
+    u32 loop_increment; ///< Value added to the loop counter after each iteration
+    u32 loop_address;   ///< Address of the first instruction of the block
+    bool is_loop;
+};
+
+constexpr std::size_t MAX_CALL_STACK_DEPTH = 16;
+
+const Common::Vec4<float24> zero_register{float24::Zero(), float24::Zero(), float24::Zero(),
+                                          float24::Zero()};
+
+/// Returns a source register, `offset` registers after `reg` for relative addressing
+const Common::Vec4<float24>& LookupSourceRegister(const UnitState& state, const Uniforms& uniforms,
+                                                  SourceRegister reg, int offset) {
+    const int index = reg.GetIndex() + offset;
+
+    switch (reg.GetRegisterType()) {
+    case RegisterType::Input:
+        if (index >= 0 && index < 16) {
+            return state.registers.input[index];
+        }
+        break;
+
+    case RegisterType::Temporary:
+        if (index >= 0 && index < 16) {
+            return state.registers.temporary[index];
+        }
+        break;
+
+    case RegisterType::FloatUniform:
+        if (index >= 0 && index < 96) {
+            return uniforms.f[index];
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // Out of range reads aren't defined, return zero
+    return zero_register;
+}
+
+/// Applies the swizzle and negation of a source operand
+Common::Vec4<float24> SwizzleSource(const Common::Vec4<float24>& reg, SwizzlePattern swizzle,
+                                    unsigned src_num) {
+    const u8 selector = swizzle.GetRawSelector(src_num);
+    const bool negate[] = {swizzle.negate_src1, swizzle.negate_src2, swizzle.negate_src3};
+
+    Common::Vec4<float24> result;
+    for (std::size_t component = 0; component < 4; ++component) {
+        // The selector of the first component is stored in the highest bits
+        result[component] = reg[(selector >> (6 - 2 * component)) & 3];
+        if (negate[src_num - 1]) {
+            result[component] = -result[component];
+        }
+    }
+    return result;
+}
+
+/// Writes the enabled components of a destination register
+void WriteDest(UnitState& state, DestRegister dest, SwizzlePattern swizzle,
+               const Common::Vec4<float24>& value) {
+    auto& reg = *reinterpret_cast<Common::Vec4<float24>*>(reinterpret_cast<u8*>(&state) +
+                                                          UnitState::OutputOffset(dest));
+    for (std::size_t component = 0; component < 4; ++component) {
+        if (swizzle.DestComponentEnabled(component)) {
+            reg[component] = value[component];
+        }
+    }
+}
+
+Common::Vec4<float24> Broadcast(float24 value) {
+    return {value, value, value, value};
+}
+
+float24 Dot(const Common::Vec4<float24>& a, const Common::Vec4<float24>& b, bool four) {
+    // Same order of additions as Compiler
+    if (four) {
+        return (a.x * b.x + a.y * b.y) + (a.z * b.z + a.w * b.w);
+    }
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/// Converts like CVTTPS2DQ, which returns INT_MIN for NaN and out of range values
+s32 TruncateToS32(float value) {
+    if (!(value >= -2147483648.0f && value < 2147483648.0f)) {
+        return std::numeric_limits<s32>::min();
+    }
+    return static_cast<s32>(value);
+}
+
+bool Compare(Instruction::Common::CompareOpType::Op op, float24 a, float24 b) {
+    using Op = Instruction::Common::CompareOpType::Op;
+    switch (op) {
+    case Op::Equal:
+        return a.ToFloat32() == b.ToFloat32();
+    case Op::NotEqual:
+        return a.ToFloat32() != b.ToFloat32();
+    case Op::LessThan:
+        return a.ToFloat32() < b.ToFloat32();
+    case Op::LessEqual:
+        return a.ToFloat32() <= b.ToFloat32();
+    case Op::GreaterThan:
+        return a.ToFloat32() > b.ToFloat32();
+    case Op::GreaterEqual:
+        return a.ToFloat32() >= b.ToFloat32();
+    default:
+        LOG_ERROR(HW_GPU, "Unknown compare mode {:x}", static_cast<int>(op));
+        return false;
+    }
+}
+
+} // Anonymous namespace
+
+void RunInterpreter(const ShaderSetup& setup, UnitState& state, unsigned offset,
+                    ProgramProfile* profile) {
+    const Uniforms& uniforms = setup.uniforms;
+    const ProgramCode& program_code = setup.program_code;
+    const SwizzleData& swizzle_data = setup.swizzle_data;
+
+    boost::container::static_vector<CallStackElement, MAX_CALL_STACK_DEPTH> call_stack;
+    u32 program_counter = offset;
+
+    if (profile != nullptr) {
+        profile->invocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const auto call = [&](u32 address, u32 num_instructions, u32 return_address,
+                          u32 repeat_counter, u32 loop_increment, bool is_loop) {
+        if (call_stack.size() == call_stack.capacity()) {
+            LOG_CRITICAL(HW_GPU, "Shader call stack overflow at 0x{:03X}", program_counter);
+            return false;
+        }
+        call_stack.push_back({address + num_instructions, return_address, repeat_counter,
+                              loop_increment, address, is_loop});
+        program_counter = address;
+        return true;
+    };
+
+    const auto evaluate_condition = [&state](Instruction instr) {
+        const bool result_x = instr.flow_control.refx.Value() == state.conditional_code[0];
+        const bool result_y = instr.flow_control.refy.Value() == state.conditional_code[1];
+
+        switch (instr.flow_control.op) {
+        case Instruction::FlowControlType::Or:
+            return result_x || result_y;
+        case Instruction::FlowControlType::And:
+            return result_x && result_y;
+        case Instruction::FlowControlType::JustX:
+            return result_x;
+        case Instruction::FlowControlType::JustY:
+            return result_y;
+        default:
+            UNREACHABLE();
+            return false;
+        }
+    };
+
+    while (program_counter < MAX_PROGRAM_CODE_LENGTH) {
+        if (!call_stack.empty()) {
+            CallStackElement& top = call_stack.back();
+            if (program_counter == top.final_address) {
+                state.address_registers[2] += top.loop_increment;
+                if (top.repeat_counter == 0) {
+                    program_counter = top.return_address;
+                    call_stack.pop_back();
+                } else {
+                    --top.repeat_counter;
+                    program_counter = top.loop_address;
+                    if (profile != nullptr) {
+                        profile->loop_iterations[top.loop_address - 1].fetch_add(
+                            1, std::memory_order_relaxed);
+                    }
+                }
+                // The block may end where the enclosing one ends too
+                continue;
+            }
+        }
+
+        const Instruction instr = {program_code[program_counter]};
+        const OpCode::Id opcode = instr.opcode.Value().EffectiveOpCode();
+
+        if (profile != nullptr) {
+            profile->instruction_counts[program_counter].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const bool is_inverted =
+            (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+        switch (opcode) {
+        case OpCode::Id::ADD:
+        case OpCode::Id::DP3:
+        case OpCode::Id::DP4:
+        case OpCode::Id::DPH:
+        case OpCode::Id::DPHI:
+        case OpCode::Id::EX2:
+        case OpCode::Id::LG2:
+        case OpCode::Id::MUL:
+        case OpCode::Id::SGE:
+        case OpCode::Id::SGEI:
+        case OpCode::Id::SLT:
+        case OpCode::Id::SLTI:
+        case OpCode::Id::FLR:
+        case OpCode::Id::MAX:
+        case OpCode::Id::MIN:
+        case OpCode::Id::RCP:
+        case OpCode::Id::RSQ:
+        case OpCode::Id::MOVA:
+        case OpCode::Id::MOV:
+        case OpCode::Id::CMP: {
+            const SwizzlePattern swizzle = {swizzle_data[instr.common.operand_desc_id]};
+            const unsigned address_register_index = instr.common.address_register_index;
+            const int address_offset =
+                address_register_index == 0 ? 0
+                                            : state.address_registers[address_register_index - 1];
+
+            const SourceRegister src1_reg =
+                is_inverted ? instr.common.src1i.Value() : instr.common.src1.Value();
+            const SourceRegister src2_reg =
+                is_inverted ? instr.common.src2i.Value() : instr.common.src2.Value();
+            const Common::Vec4<float24> src1 = SwizzleSource(
+                LookupSourceRegister(state, uniforms, src1_reg, is_inverted ? 0 : address_offset),
+                swizzle, 1);
+            const Common::Vec4<float24> src2 = SwizzleSource(
+                LookupSourceRegister(state, uniforms, src2_reg, is_inverted ? address_offset : 0),
+                swizzle, 2);
+            const DestRegister dest = instr.common.dest.Value();
+
+            switch (opcode) {
+            case OpCode::Id::ADD:
+                WriteDest(state, dest, swizzle,
+                          {src1.x + src2.x, src1.y + src2.y, src1.z + src2.z, src1.w + src2.w});
+                break;
+
+            case OpCode::Id::DP3:
+                WriteDest(state, dest, swizzle, Broadcast(Dot(src1, src2, false)));
+                break;
+
+            case OpCode::Id::DP4:
+                WriteDest(state, dest, swizzle, Broadcast(Dot(src1, src2, true)));
+                break;
+
+            case OpCode::Id::DPH:
+            case OpCode::Id::DPHI: {
+                Common::Vec4<float24> homogeneous = src1;
+                homogeneous.w = float24::FromFloat32(1.0f);
+                WriteDest(state, dest, swizzle, Broadcast(Dot(homogeneous, src2, true)));
+                break;
+            }
+
+            case OpCode::Id::EX2:
+                WriteDest(state, dest, swizzle,
+                          Broadcast(float24::FromFloat32(std::exp2(src1.x.ToFloat32()))));
+                break;
+
+            case OpCode::Id::LG2:
+                WriteDest(state, dest, swizzle,
+                          Broadcast(float24::FromFloat32(std::log2(src1.x.ToFloat32()))));
+                break;
+
+            case OpCode::Id::MUL:
+                WriteDest(state, dest, swizzle,
+                          {src1.x * src2.x, src1.y * src2.y, src1.z * src2.z, src1.w * src2.w});
+                break;
+
+            case OpCode::Id::SGE:
+            case OpCode::Id::SGEI: {
+                Common::Vec4<float24> result;
+                for (std::size_t i = 0; i < 4; ++i) {
+                    result[i] = float24::FromFloat32(src1[i] >= src2[i] ? 1.0f : 0.0f);
+                }
+                WriteDest(state, dest, swizzle, result);
+                break;
+            }
+
+            case OpCode::Id::SLT:
+            case OpCode::Id::SLTI: {
+                Common::Vec4<float24> result;
+                for (std::size_t i = 0; i < 4; ++i) {
+                    result[i] = float24::FromFloat32(src1[i] < src2[i] ? 1.0f : 0.0f);
+                }
+                WriteDest(state, dest, swizzle, result);
+                break;
+            }
+
+            case OpCode::Id::FLR: {
+                Common::Vec4<float24> result;
+                for (std::size_t i = 0; i < 4; ++i) {
+                    result[i] = float24::FromFloat32(std::floor(src1[i].ToFloat32()));
+                }
+                WriteDest(state, dest, swizzle, result);
+                break;
+            }
+
+            case OpCode::Id::MAX:
+            case OpCode::Id::MIN: {
+                // Like SSE, the second operand is returned if either is NaN
+                Common::Vec4<float24> result;
+                for (std::size_t i = 0; i < 4; ++i) {
+                    const bool first = opcode == OpCode::Id::MAX ? src1[i] > src2[i]
+                                                                 : src1[i] < src2[i];
+                    result[i] = first ? src1[i] : src2[i];
+                }
+                WriteDest(state, dest, swizzle, result);
+                break;
+            }
+
+            case OpCode::Id::RCP:
+                WriteDest(state, dest, swizzle,
+                          Broadcast(float24::FromFloat32(1.0f / src1.x.ToFloat32())));
+                break;
+
+            case OpCode::Id::RSQ:
+                WriteDest(state, dest, swizzle,
+                          Broadcast(float24::FromFloat32(1.0f / std::sqrt(src1.x.ToFloat32()))));
+                break;
+
+            case OpCode::Id::MOVA:
+                for (std::size_t i = 0; i < 2; ++i) {
+                    if (swizzle.DestComponentEnabled(i)) {
+                        state.address_registers[i] = TruncateToS32(src1[i].ToFloat32());
+                    }
+                }
+                break;
+
+            case OpCode::Id::MOV:
+                WriteDest(state, dest, swizzle, src1);
+                break;
+
+            case OpCode::Id::CMP:
+                state.conditional_code[0] = Compare(instr.common.compare_op.x, src1.x, src2.x);
+                state.conditional_code[1] = Compare(instr.common.compare_op.y, src1.y, src2.y);
+                break;
+
+            default:
+                UNREACHABLE();
+                break;
+            }
+            break;
+        }
+
+        case OpCode::Id::MAD:
+        case OpCode::Id::MADI: {
+            const SwizzlePattern swizzle = {swizzle_data[instr.mad.operand_desc_id]};
+            const unsigned address_register_index = instr.mad.address_register_index;
+            const int address_offset =
+                address_register_index == 0 ? 0
+                                            : state.address_registers[address_register_index - 1];
+
+            const SourceRegister src2_reg =
+                is_inverted ? instr.mad.src2i.Value() : instr.mad.src2.Value();
+            const SourceRegister src3_reg =
+                is_inverted ? instr.mad.src3i.Value() : instr.mad.src3.Value();
+            const Common::Vec4<float24> src1 = SwizzleSource(
+                LookupSourceRegister(state, uniforms, instr.mad.src1.Value(), 0), swizzle, 1);
+            const Common::Vec4<float24> src2 = SwizzleSource(
+                LookupSourceRegister(state, uniforms, src2_reg, is_inverted ? 0 : address_offset),
+                swizzle, 2);
+            const Common::Vec4<float24> src3 = SwizzleSource(
+                LookupSourceRegister(state, uniforms, src3_reg, is_inverted ? address_offset : 0),
+                swizzle, 3);
+
+            Common::Vec4<float24> result;
+            for (std::size_t i = 0; i < 4; ++i) {
+                result[i] = src1[i] * src2[i] + src3[i];
+            }
+            WriteDest(state, instr.mad.dest.Value(), swizzle, result);
+            break;
+        }
+
+        case OpCode::Id::NOP:
+            break;
+
+        case OpCode::Id::END:
+            return;
+
+        case OpCode::Id::BREAKC:
+            if (evaluate_condition(instr)) {
+                // Leave the innermost loop, along with the blocks inside it
+                while (!call_stack.empty() && !call_stack.back().is_loop) {
+                    call_stack.pop_back();
+                }
+                if (call_stack.empty()) {
+                    LOG_CRITICAL(HW_GPU, "BREAKC outside of a LOOP at 0x{:03X}", program_counter);
+                    return;
+                }
+                program_counter = call_stack.back().return_address;
+                call_stack.pop_back();
+                continue;
+            }
+            break;
+
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU: {
+            const bool taken =
+                opcode == OpCode::Id::CALL ||
+                (opcode == OpCode::Id::CALLC && evaluate_condition(instr)) ||
+                (opcode == OpCode::Id::CALLU && uniforms.b[instr.flow_control.bool_uniform_id]);
+            if (taken) {
+                if (!call(instr.flow_control.dest_offset, instr.flow_control.num_instructions,
+                          program_counter + 1, 0, 0, false)) {
+                    return;
+                }
+                continue;
+            }
+            break;
+        }
+
+        case OpCode::Id::IFU:
+        case OpCode::Id::IFC: {
+            const bool condition = opcode == OpCode::Id::IFU
+                                       ? uniforms.b[instr.flow_control.bool_uniform_id]
+                                       : evaluate_condition(instr);
+            const u32 end_address =
+                instr.flow_control.dest_offset + instr.flow_control.num_instructions;
+            const bool pushed =
+                condition ? call(program_counter + 1,
+                                 instr.flow_control.dest_offset - program_counter - 1, end_address,
+                                 0, 0, false)
+                          : call(instr.flow_control.dest_offset,
+                                 instr.flow_control.num_instructions, end_address, 0, 0, false);
+            if (!pushed) {
+                return;
+            }
+            continue;
+        }
+
+        case OpCode::Id::LOOP: {
+            const Common::Vec4<u8>& loop_param = uniforms.i[instr.flow_control.int_uniform_id];
+            state.address_registers[2] = loop_param.y;
+
+            if (profile != nullptr) {
+                profile->loop_entries[program_counter].fetch_add(1, std::memory_order_relaxed);
+                profile->loop_iterations[program_counter].fetch_add(1,
+                                                                    std::memory_order_relaxed);
+            }
+
+            // The body runs X + 1 times
+            if (!call(program_counter + 1, instr.flow_control.dest_offset - program_counter,
+                      instr.flow_control.dest_offset + 1, loop_param.x, loop_param.z, true)) {
+                return;
+            }
+            continue;
+        }
+
+        case OpCode::Id::JMPC:
+        case OpCode::Id::JMPU: {
+            const bool condition =
+                opcode == OpCode::Id::JMPC
+                    ? evaluate_condition(instr)
+                    : uniforms.b[instr.flow_control.bool_uniform_id] ==
+                          !(instr.flow_control.num_instructions & 1);
+            if (condition) {
+                program_counter = instr.flow_control.dest_offset;
+                continue;
+            }
+            break;
+        }
+
+        case OpCode::Id::EMIT:
+            if (state.emitter_ptr == nullptr) {
+                LOG_CRITICAL(HW_GPU, "Execute EMIT on VS");
+            } else {
+                state.emitter_ptr->Emit(state.registers.output);
+            }
+            break;
+
+        case OpCode::Id::SETEMIT:
+            if (state.emitter_ptr == nullptr) {
+                LOG_CRITICAL(HW_GPU, "Execute SETEMIT on VS");
+            } else {
+                state.emitter_ptr->vertex_id = instr.setemit.vertex_id;
+                state.emitter_ptr->prim_emit = instr.setemit.prim_emit != 0;
+                state.emitter_ptr->winding = instr.setemit.winding != 0;
+            }
+            break;
+
+        default:
+            LOG_CRITICAL(HW_GPU, "Unhandled instruction: 0x{:02x} (0x{:08x})",
+                         static_cast<u32>(opcode), instr.hex);
+            break;
+        }
+
+        ++program_counter;
+    }
+}
+
+} // namespace Pica::Shader
@@ -0,0 +1,22 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "video_core/shader/shader.h"
+
+namespace Pica::Shader {
+
+struct ProgramProfile;
+
+/**
+ * Runs a shader program one instruction at a time. Slower than Compiler, but portable and able to
+ * profile the program.
+ * @param offset Offset of the first instruction to run
+ * @param profile If not nullptr, receives the execution counts of the program
+ */
+void RunInterpreter(const ShaderSetup& setup, UnitState& state, unsigned offset,
+                    ProgramProfile* profile);
+
+} // namespace Pica::Shader
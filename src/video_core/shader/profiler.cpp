@@ -0,0 +1,151 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <vector>
+#include <fmt/format.h>
+#include <nihstro/shader_bytecode.h>
+#include "video_core/shader/profiler.h"
+
+using nihstro::Instruction;
+
+namespace Pica::Shader {
+
+namespace {
+
+struct OpCodeInfo {
+    const char* name;
+    /// Rough estimate of the cycles the instruction takes on the PICA
+    u32 cycles;
+};
+
+// Special functions (EX2, LG2, RCP, RSQ) are assumed to be slower than the arithmetic
+// instructions, and flow control to cost a pipeline refill
+constexpr std::array<OpCodeInfo, 64> opcode_info{{
+    {"add", 1},    {"dp3", 1},   {"dp4", 1},   {"dph", 1},   {"dst", 1},   {"ex2", 4},
+    {"lg2", 4},    {"lit", 1},   {"mul", 1},   {"sge", 1},   {"slt", 1},   {"flr", 1},
+    {"max", 1},    {"min", 1},   {"rcp", 4},   {"rsq", 4},   {"???", 1},   {"???", 1},
+    {"mova", 1},   {"mov", 1},   {"???", 1},   {"???", 1},   {"???", 1},   {"???", 1},
+    {"dphi", 1},   {"dsti", 1},  {"sgei", 1},  {"slti", 1},  {"???", 1},   {"???", 1},
+    {"???", 1},    {"???", 1},   {"break", 2}, {"nop", 1},   {"end", 1},   {"breakc", 2},
+    {"call", 2},   {"callc", 2}, {"callu", 2}, {"ifu", 2},   {"ifc", 2},   {"loop", 2},
+    {"emit", 1},   {"sete", 1},  {"jmpc", 2},  {"jmpu", 2},  {"cmp", 1},   {"cmp", 1},
+    {"madi", 1},   {"madi", 1},  {"madi", 1},  {"madi", 1},  {"madi", 1},  {"madi", 1},
+    {"madi", 1},   {"madi", 1},  {"mad", 1},   {"mad", 1},   {"mad", 1},   {"mad", 1},
+    {"mad", 1},    {"mad", 1},   {"mad", 1},   {"mad", 1},
+}};
+
+const OpCodeInfo& GetOpCodeInfo(u32 instruction) {
+    const Instruction instr = {instruction};
+    return opcode_info[static_cast<u32>(instr.opcode.Value().EffectiveOpCode())];
+}
+
+/// Number of instructions listed for each program in the report
+constexpr std::size_t MAX_REPORTED_INSTRUCTIONS = 10;
+
+} // Anonymous namespace
+
+void ProgramProfile::Clear() {
+    invocations = 0;
+    for (std::size_t offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+        instruction_counts[offset] = 0;
+        loop_entries[offset] = 0;
+        loop_iterations[offset] = 0;
+    }
+}
+
+ProgramProfile& Profiler::GetProgramProfile(ShaderSetup& setup) {
+    const u64 code_hash = setup.GetProgramCodeHash();
+
+    std::lock_guard lock(mutex);
+    std::unique_ptr<ProgramProfile>& profile = programs[code_hash];
+    if (profile == nullptr) {
+        profile = std::make_unique<ProgramProfile>(setup.program_code);
+    }
+    return *profile;
+}
+
+std::string Profiler::GetReport() const {
+    struct ProgramSummary {
+        u64 code_hash;
+        const ProgramProfile* profile;
+        u64 instructions;
+        u64 cycles;
+    };
+
+    std::lock_guard lock(mutex);
+
+    std::vector<ProgramSummary> summaries;
+    u64 total_cycles = 0;
+    for (const auto& [code_hash, profile] : programs) {
+        ProgramSummary summary{code_hash, profile.get(), 0, 0};
+        for (std::size_t offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+            const u64 count = profile->instruction_counts[offset];
+            summary.instructions += count;
+            summary.cycles += count * GetOpCodeInfo(profile->program_code[offset]).cycles;
+        }
+        if (summary.instructions != 0) {
+            total_cycles += summary.cycles;
+            summaries.push_back(summary);
+        }
+    }
+
+    std::sort(summaries.begin(), summaries.end(),
+              [](const ProgramSummary& a, const ProgramSummary& b) { return a.cycles > b.cycles; });
+
+    std::string report = fmt::format("{} shader programs, {} estimated cycles\n", summaries.size(),
+                                     total_cycles);
+
+    for (const ProgramSummary& summary : summaries) {
+        const ProgramProfile& profile = *summary.profile;
+        const u64 invocations = profile.invocations;
+
+        report += fmt::format(
+            "\nProgram {:016X}: {} invocations, {} instructions, {} estimated cycles ({:.1f}%), "
+            "{:.1f} cycles per invocation\n",
+            summary.code_hash, invocations, summary.instructions, summary.cycles,
+            100.0 * summary.cycles / total_cycles,
+            invocations == 0 ? 0.0 : static_cast<double>(summary.cycles) / invocations);
+
+        for (std::size_t offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+            const u64 entries = profile.loop_entries[offset];
+            if (entries != 0) {
+                const u64 iterations = profile.loop_iterations[offset];
+                report += fmt::format(
+                    "  Loop at 0x{:03X}: {} entries, {} iterations, {:.1f} iterations per entry\n",
+                    offset, entries, iterations, static_cast<double>(iterations) / entries);
+            }
+        }
+
+        std::vector<std::pair<u64, std::size_t>> hottest;
+        for (std::size_t offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+            const u64 count = profile.instruction_counts[offset];
+            if (count != 0) {
+                hottest.emplace_back(count * GetOpCodeInfo(profile.program_code[offset]).cycles,
+                                     offset);
+            }
+        }
+        const std::size_t num_reported = std::min(hottest.size(), MAX_REPORTED_INSTRUCTIONS);
+        std::partial_sort(hottest.begin(), hottest.begin() + num_reported, hottest.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        for (std::size_t i = 0; i < num_reported; ++i) {
+            const auto [cycles, offset] = hottest[i];
+            report += fmt::format("  0x{:03X} {:<6} {} executions, {} estimated cycles\n", offset,
+                                  GetOpCodeInfo(profile.program_code[offset]).name,
+                                  profile.instruction_counts[offset].load(), cycles);
+        }
+    }
+
+    return report;
+}
+
+void Profiler::Clear() {
+    std::lock_guard lock(mutex);
+    for (auto& [code_hash, profile] : programs) {
+        profile->Clear();
+    }
+}
+
+} // namespace Pica::Shader
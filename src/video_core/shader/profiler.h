@@ -0,0 +1,62 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica::Shader {
+
+/**
+ * Execution counts of a shader program, collected by the interpreter. The counters are updated by
+ * every thread running the program.
+ */
+struct ProgramProfile {
+    explicit ProgramProfile(const ProgramCode& program_code) : program_code(program_code) {}
+
+    void Clear();
+
+    /// Copy of the program, used to name the instructions in the report
+    const ProgramCode program_code;
+
+    std::atomic<u64> invocations{0};
+
+    /// Number of times each instruction was executed
+    std::array<std::atomic<u64>, MAX_PROGRAM_CODE_LENGTH> instruction_counts{};
+
+    /// Number of times the LOOP instruction at each offset was executed, and the total number of
+    /// iterations of its body
+    std::array<std::atomic<u64>, MAX_PROGRAM_CODE_LENGTH> loop_entries{};
+    std::array<std::atomic<u64>, MAX_PROGRAM_CODE_LENGTH> loop_iterations{};
+};
+
+/// Collects the profiles of the shader programs run by the interpreter, keyed by their code hash
+class Profiler {
+public:
+    /// Returns the profile of the program, creating it if needed. The reference stays valid until
+    /// the profiler is destroyed.
+    ProgramProfile& GetProgramProfile(ShaderSetup& setup);
+
+    /**
+     * Returns a text report with the programs sorted by estimated cycles, including the hottest
+     * instructions and the loops of each program.
+     */
+    std::string GetReport() const;
+
+    /// Resets every counter
+    void Clear();
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<u64, std::unique_ptr<ProgramProfile>> programs;
+};
+
+} // namespace Pica::Shader
@@ -95,6 +95,33 @@ void UnitState::WriteOutput(const ShaderRegs& config, AttributeBuffer& output) {
 
 UnitState::UnitState(GSEmitter* emitter) : emitter_ptr(emitter) {}
 
+void VectorUnitState::LoadInput(const ShaderRegs& config,
+                                const std::array<AttributeBuffer, VECTOR_WIDTH>& inputs) {
+    const unsigned max_attribute = config.max_input_attribute_index;
+
+    for (unsigned attr = 0; attr <= max_attribute; ++attr) {
+        unsigned reg = config.GetRegisterForAttribute(attr);
+        for (std::size_t comp = 0; comp < 4; ++comp) {
+            for (std::size_t lane = 0; lane < VECTOR_WIDTH; ++lane) {
+                registers.input[reg][comp][lane] = inputs[lane].attr[attr][comp];
+            }
+        }
+    }
+}
+
+void VectorUnitState::WriteOutput(const ShaderRegs& config,
+                                  std::array<AttributeBuffer, VECTOR_WIDTH>& outputs) const {
+    int output_i = 0;
+    for (int reg : BitSet<u32>(config.output_mask)) {
+        for (std::size_t lane = 0; lane < VECTOR_WIDTH; ++lane) {
+            for (std::size_t comp = 0; comp < 4; ++comp) {
+                outputs[lane].attr[output_i][comp] = registers.output[reg][comp][lane];
+            }
+        }
+        ++output_i;
+    }
+}
+
 GSEmitter::GSEmitter() {
     handlers = new Handlers;
 }
@@ -138,6 +165,9 @@ Engine* GetEngine() {
 }
 
 void Shutdown() {
+    if (engine != nullptr && VideoCore::g_shader_profiling_enabled) {
+        LOG_INFO(HW_GPU, "Shader profile:\n{}", engine->GetProfiler().GetReport());
+    }
     engine = nullptr;
 }
 
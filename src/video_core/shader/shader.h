@@ -161,6 +161,83 @@ struct UnitState {
     void WriteOutput(const ShaderRegs& config, AttributeBuffer& output);
 };
 
+/// Number of vertices the vectorized shader JIT processes per invocation, one per SSE lane
+constexpr std::size_t VECTOR_WIDTH = 4;
+
+/**
+ * Shader unit state for running a vertex shader on VECTOR_WIDTH vertices at once. Registers are
+ * laid out as structure of arrays: each component of a register holds that component for every
+ * vertex, so a single SSE register processes one component of the whole batch.
+ */
+struct VectorUnitState {
+    /// Number of execution masks that can be saved by nested conditional control flow
+    static constexpr std::size_t MASK_STACK_DEPTH = 64;
+
+    struct Registers {
+        alignas(16) float24 input[16][4][VECTOR_WIDTH];
+        alignas(16) float24 temporary[16][4][VECTOR_WIDTH];
+        alignas(16) float24 output[16][4][VECTOR_WIDTH];
+    } registers;
+    static_assert(std::is_pod<Registers>::value, "Structure is not POD");
+
+    // Per vertex condition codes, all bits are set if true
+    alignas(16) u32 conditional_code[2][VECTOR_WIDTH];
+
+    // Per vertex address registers
+    alignas(16) s32 address_registers[2][VECTOR_WIDTH];
+
+    // Loop counter, control flow depending on it is the same for every vertex
+    s32 loop_counter;
+
+    alignas(16) u32 mask_stack[MASK_STACK_DEPTH][VECTOR_WIDTH];
+
+    /// Returns the offset of the X component of a source register
+    static std::size_t InputOffset(const SourceRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Input:
+            return offsetof(VectorUnitState, registers.input) +
+                   reg.GetIndex() * sizeof(registers.input[0]);
+
+        case RegisterType::Temporary:
+            return offsetof(VectorUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(registers.temporary[0]);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    /// Returns the offset of the X component of a destination register
+    static std::size_t OutputOffset(const DestRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Output:
+            return offsetof(VectorUnitState, registers.output) +
+                   reg.GetIndex() * sizeof(registers.output[0]);
+
+        case RegisterType::Temporary:
+            return offsetof(VectorUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(registers.temporary[0]);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    /**
+     * Loads the unit state with VECTOR_WIDTH input vertices.
+     *
+     * @param config Shader configuration registers corresponding to the unit.
+     * @param inputs Attribute buffers to load into the input registers, one per lane.
+     */
+    void LoadInput(const ShaderRegs& config,
+                   const std::array<AttributeBuffer, VECTOR_WIDTH>& inputs);
+
+    void WriteOutput(const ShaderRegs& config,
+                     std::array<AttributeBuffer, VECTOR_WIDTH>& outputs) const;
+};
+
 /**
  * This is an extended shader unit state that represents the special unit that can run both vertex
  * shader and geometry shader. It contains an additional primitive emitter and utilities for
@@ -195,6 +272,8 @@ struct Uniforms {
     }
 };
 
+struct ProgramProfile;
+
 struct ShaderSetup {
     Uniforms uniforms;
 
@@ -204,6 +283,9 @@ struct ShaderSetup {
     struct EngineData {
         unsigned int entry_point;
         const void* cached_shader = nullptr;
+        const void* cached_vector_shader = nullptr;
+        /// Profile the interpreter records to, nullptr if profiling is disabled
+        ProgramProfile* profile = nullptr;
     } engine_data;
 
     void MarkProgramCodeDirty() {
@@ -0,0 +1,1179 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdint>
+#include <nihstro/shader_bytecode.h>
+#include <smmintrin.h>
+#include <xmmintrin.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/xbyak_abi.h"
+#include "common/x64/xbyak_util.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/vector_compiler.h"
+
+using namespace Common::X64;
+using namespace Xbyak::util;
+using Xbyak::Label;
+using Xbyak::Reg32;
+using Xbyak::Reg64;
+using Xbyak::Xmm;
+
+namespace Pica::Shader {
+
+typedef void (VectorCompiler::*VectorFunction)(Instruction instr);
+
+const VectorFunction vector_instr_table[64] = {
+    &VectorCompiler::Compile_ADD,    // add
+    &VectorCompiler::Compile_DP3,    // dp3
+    &VectorCompiler::Compile_DP4,    // dp4
+    &VectorCompiler::Compile_DPH,    // dph
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_EX2,    // ex2
+    &VectorCompiler::Compile_LG2,    // lg2
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_MUL,    // mul
+    &VectorCompiler::Compile_SGE,    // sge
+    &VectorCompiler::Compile_SLT,    // slt
+    &VectorCompiler::Compile_FLR,    // flr
+    &VectorCompiler::Compile_MAX,    // max
+    &VectorCompiler::Compile_MIN,    // min
+    &VectorCompiler::Compile_RCP,    // rcp
+    &VectorCompiler::Compile_RSQ,    // rsq
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_MOVA,   // mova
+    &VectorCompiler::Compile_MOV,    // mov
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_DPH,    // dphi
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_SGE,    // sgei
+    &VectorCompiler::Compile_SLT,    // slti
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    nullptr,                         // unknown
+    &VectorCompiler::Compile_NOP,    // nop
+    &VectorCompiler::Compile_END,    // end
+    &VectorCompiler::Compile_BREAKC, // breakc
+    &VectorCompiler::Compile_CALL,   // call
+    &VectorCompiler::Compile_CALLC,  // callc
+    &VectorCompiler::Compile_CALLU,  // callu
+    &VectorCompiler::Compile_IF,     // ifu
+    &VectorCompiler::Compile_IF,     // ifc
+    &VectorCompiler::Compile_LOOP,   // loop
+    nullptr,                         // emit (not vectorizable)
+    nullptr,                         // sete (not vectorizable)
+    &VectorCompiler::Compile_JMP,    // jmpc (not vectorizable)
+    &VectorCompiler::Compile_JMP,    // jmpu
+    &VectorCompiler::Compile_CMP,    // cmp
+    &VectorCompiler::Compile_CMP,    // cmp
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // madi
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+    &VectorCompiler::Compile_MAD,    // mad
+};
+
+// The following is used to alias some commonly used registers. Generally, RAX-RDX and XMM0-XMM4 can
+// be used as scratch registers within a compiler function. Every XMM register holds one component
+// of a register for all VECTOR_WIDTH vertices. The other registers have designated purposes, as
+// documented below:
+
+/// Pointer to the uniform memory
+constexpr Reg64 UNIFORMS = r9;
+/// VS loop count register (Multiplied by 16)
+constexpr Reg32 LOOPCOUNT_REG = r12d;
+/// Current VS loop iteration number
+constexpr Reg32 LOOPCOUNT = esi;
+/// Number to increment LOOPCOUNT_REG by on each loop iteration (Multiplied by 16)
+constexpr Reg32 LOOPINC = edi;
+/// Offset of the next free entry of VectorUnitState::mask_stack
+constexpr Reg64 MASK_SP = r13;
+/// Offset of the mask stack entry following the execution mask saved by the current LOOP
+constexpr Reg64 LOOP_MASK_SP = r14;
+/// Pointer to the VectorUnitState instance for the current VS unit
+constexpr Reg64 STATE = r15;
+/// SIMD scratch register, also the implicit mask operand of BLENDVPS
+constexpr Xmm SCRATCH = xmm0;
+/// Loaded with the first source operand, otherwise can be used as a scratch register
+constexpr Xmm SRC1 = xmm1;
+/// Loaded with the second source operand, otherwise can be used as a scratch register
+constexpr Xmm SRC2 = xmm2;
+/// Loaded with the third source operand, otherwise can be used as a scratch register
+constexpr Xmm SRC3 = xmm3;
+/// Additional scratch register
+constexpr Xmm SCRATCH2 = xmm4;
+/// Hold the results for each component until all sources have been read, as a source and the
+/// destination may be the same register
+constexpr Xmm RESULT[4] = {xmm5, xmm6, xmm7, xmm8};
+/// Lanes for which the previous CMP instruction was true, for the X- and Y-component comparison
+constexpr Xmm COND0 = xmm9;
+constexpr Xmm COND1 = xmm10;
+/// Lanes that executed the END instruction
+constexpr Xmm ENDED = xmm11;
+/// Lanes that execute the current instruction
+constexpr Xmm EXEC = xmm12;
+/// Lanes that left the current LOOP block through BREAKC
+constexpr Xmm BROKEN = xmm13;
+/// Constant vector of [1.0f, 1.0f, 1.0f, 1.0f], used to efficiently set a vector to one
+constexpr Xmm ONE = xmm14;
+/// Constant vector of [-0.f, -0.f, -0.f, -0.f], used to efficiently negate a vector with XOR
+constexpr Xmm NEGBIT = xmm15;
+
+/// Size of one component of a register in VectorUnitState
+constexpr int COMPONENT_SIZE = VECTOR_WIDTH * sizeof(float24);
+/// Size of a register in VectorUnitState
+constexpr int REGISTER_SIZE = 4 * COMPONENT_SIZE;
+static_assert(REGISTER_SIZE == 1 << 6, "Relative addressing shifts the address registers by 6");
+/// Movmskps result when every lane is set
+constexpr int ALL_LANES = (1 << VECTOR_WIDTH) - 1;
+
+/// Number of nested calls assumed when checking that the mask stack can't overflow
+constexpr std::size_t MAX_CALL_DEPTH = 4;
+
+static std::size_t MaskStackOffset() {
+    return offsetof(VectorUnitState, mask_stack);
+}
+
+static std::size_t AddressRegisterOffset(unsigned index, unsigned lane) {
+    return offsetof(VectorUnitState, address_registers) + (index * VECTOR_WIDTH + lane) * 4;
+}
+
+static bool IsMAD(Instruction instr) {
+    return instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+           instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+}
+
+static SwizzlePattern GetSwizzle(Instruction instr,
+                                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data) {
+    return {swizzle_data[IsMAD(instr) ? instr.mad.operand_desc_id.Value()
+                                      : instr.common.operand_desc_id.Value()]};
+}
+
+void VectorCompiler::Compile_SwizzleSrc(Instruction instr, unsigned src_num,
+                                        SourceRegister src_reg, unsigned component, Xmm dest) {
+    const bool is_uniform = src_reg.GetRegisterType() == RegisterType::FloatUniform;
+    const bool is_inverted =
+        (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+    unsigned address_register_index;
+    unsigned offset_src;
+
+    if (IsMAD(instr)) {
+        offset_src = is_inverted ? 3 : 2;
+        address_register_index = instr.mad.address_register_index;
+    } else {
+        offset_src = is_inverted ? 2 : 1;
+        address_register_index = instr.common.address_register_index;
+    }
+
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    const unsigned selector = (swiz.GetRawSelector(src_num) >> (6 - 2 * component)) & 3;
+    const bool relative = src_num == offset_src && address_register_index != 0;
+
+    if (is_uniform) {
+        // Uniforms are the same for every vertex and get broadcast to all lanes
+        const std::size_t src_offset = Uniforms::GetFloatUniformOffset(src_reg.GetIndex()) +
+                                       selector * sizeof(float24);
+        const int disp = static_cast<int>(src_offset);
+
+        if (!relative) {
+            movss(dest, dword[UNIFORMS + disp]);
+            shufps(dest, dest, _MM_SHUFFLE(0, 0, 0, 0));
+        } else if (address_register_index == 3) {
+            movss(dest, dword[UNIFORMS + LOOPCOUNT_REG.cvt64() + disp]);
+            shufps(dest, dest, _MM_SHUFFLE(0, 0, 0, 0));
+        } else {
+            // The address registers can differ between vertices, gather every lane separately
+            for (unsigned lane = 0; lane < VECTOR_WIDTH; ++lane) {
+                movsxd(rax, dword[STATE + AddressRegisterOffset(address_register_index - 1, lane)]);
+                shl(rax, 4);
+                insertps(dest, dword[UNIFORMS + rax + disp], lane << 4);
+            }
+        }
+    } else {
+        const std::size_t src_offset =
+            VectorUnitState::InputOffset(src_reg) + selector * COMPONENT_SIZE;
+        const int disp = static_cast<int>(src_offset);
+
+        if (!relative) {
+            movaps(dest, xword[STATE + disp]);
+        } else if (address_register_index == 3) {
+            // LOOPCOUNT_REG is multiplied by 16, registers are 64 bytes large here
+            mov(eax, LOOPCOUNT_REG);
+            shl(eax, 2);
+            movaps(dest, xword[STATE + rax + disp]);
+        } else {
+            for (unsigned lane = 0; lane < VECTOR_WIDTH; ++lane) {
+                movsxd(rax, dword[STATE + AddressRegisterOffset(address_register_index - 1, lane)]);
+                shl(rax, 6);
+                insertps(dest, dword[STATE + rax + disp + lane * sizeof(float24)], lane << 4);
+            }
+        }
+    }
+
+    // If the source register should be negated, flip the negative bit using XOR
+    const bool negate[] = {swiz.negate_src1, swiz.negate_src2, swiz.negate_src3};
+    if (negate[src_num - 1]) {
+        xorps(dest, NEGBIT);
+    }
+}
+
+void VectorCompiler::Compile_DestEnable(Instruction instr, unsigned component, Xmm src) {
+    const DestRegister dest = IsMAD(instr) ? instr.mad.dest.Value() : instr.common.dest.Value();
+    const int disp =
+        static_cast<int>(VectorUnitState::OutputOffset(dest) + component * COMPONENT_SIZE);
+
+    // Keep the previous value in the lanes that are inactive
+    movaps(SCRATCH, EXEC);
+    andnps(SCRATCH, xword[STATE + disp]);
+    movaps(SCRATCH2, src);
+    andps(SCRATCH2, EXEC);
+    orps(SCRATCH2, SCRATCH);
+    movaps(xword[STATE + disp], SCRATCH2);
+}
+
+void VectorCompiler::Compile_DestEnableAll(Instruction instr, Xmm src) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned component = 0; component < 4; ++component) {
+        if (swiz.DestComponentEnabled(component)) {
+            Compile_DestEnable(instr, component, src);
+        }
+    }
+}
+
+void VectorCompiler::Compile_SanitizedMul(Xmm src1, Xmm src2, Xmm scratch) {
+    // 0 * inf and inf * 0 in the PICA should return 0 instead of NaN, see Compiler
+
+    // Set scratch to mask of (src1 != NaN and src2 != NaN)
+    movaps(scratch, src1);
+    cmpordps(scratch, src2);
+
+    mulps(src1, src2);
+
+    // Set src2 to mask of (result == NaN)
+    movaps(src2, src1);
+    cmpunordps(src2, src2);
+
+    // Clear components where scratch != src2 (i.e. if result is NaN where neither source was NaN)
+    xorps(scratch, src2);
+    andps(src1, scratch);
+}
+
+void VectorCompiler::Compile_EvaluateCondition(Instruction instr, Xmm dest) {
+    const auto load = [this](Xmm reg, Xmm cond, bool reference) {
+        movaps(reg, cond);
+        if (!reference) {
+            pcmpeqd(SCRATCH, SCRATCH);
+            xorps(reg, SCRATCH);
+        }
+    };
+
+    switch (instr.flow_control.op) {
+    case Instruction::FlowControlType::Or:
+        load(dest, COND0, instr.flow_control.refx.Value());
+        load(SCRATCH2, COND1, instr.flow_control.refy.Value());
+        orps(dest, SCRATCH2);
+        break;
+
+    case Instruction::FlowControlType::And:
+        load(dest, COND0, instr.flow_control.refx.Value());
+        load(SCRATCH2, COND1, instr.flow_control.refy.Value());
+        andps(dest, SCRATCH2);
+        break;
+
+    case Instruction::FlowControlType::JustX:
+        load(dest, COND0, instr.flow_control.refx.Value());
+        break;
+
+    case Instruction::FlowControlType::JustY:
+        load(dest, COND1, instr.flow_control.refy.Value());
+        break;
+    }
+}
+
+void VectorCompiler::Compile_UniformCondition(Instruction instr) {
+    std::size_t offset = Uniforms::GetBoolUniformOffset(instr.flow_control.bool_uniform_id);
+    cmp(byte[UNIFORMS + offset], 0);
+}
+
+void VectorCompiler::Compile_PushMask(Xmm mask) {
+    movaps(xword[STATE + MASK_SP + MaskStackOffset()], mask);
+    add(MASK_SP, 16);
+
+    max_mask_depth = std::max(max_mask_depth, ++mask_depth);
+}
+
+void VectorCompiler::Compile_PopMask() {
+    sub(MASK_SP, 16);
+    movaps(SCRATCH, BROKEN);
+    orps(SCRATCH, ENDED);
+    andnps(SCRATCH, xword[STATE + MASK_SP + MaskStackOffset()]);
+    movaps(EXEC, SCRATCH);
+
+    --mask_depth;
+}
+
+void VectorCompiler::Compile_ADD(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+            addps(RESULT[c], SRC2);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_DP3(Instruction instr) {
+    for (unsigned c = 0; c < 3; ++c) {
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+        Compile_SanitizedMul(RESULT[c], SRC2, SCRATCH);
+    }
+
+    // Same order of additions as Compiler
+    addps(RESULT[0], RESULT[1]);
+    addps(RESULT[0], RESULT[2]);
+
+    Compile_DestEnableAll(instr, RESULT[0]);
+}
+
+void VectorCompiler::Compile_DP4(Instruction instr) {
+    for (unsigned c = 0; c < 4; ++c) {
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+        Compile_SanitizedMul(RESULT[c], SRC2, SCRATCH);
+    }
+
+    // Same order of additions as the two HADDPS in Compiler
+    addps(RESULT[0], RESULT[1]);
+    addps(RESULT[2], RESULT[3]);
+    addps(RESULT[0], RESULT[2]);
+
+    Compile_DestEnableAll(instr, RESULT[0]);
+}
+
+void VectorCompiler::Compile_DPH(Instruction instr) {
+    const bool is_dphi = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::DPHI;
+    const SourceRegister src1 = is_dphi ? instr.common.src1i.Value() : instr.common.src1.Value();
+    const SourceRegister src2 = is_dphi ? instr.common.src2i.Value() : instr.common.src2.Value();
+
+    for (unsigned c = 0; c < 4; ++c) {
+        if (c == 3) {
+            // The 4th component of the first source is 1.0
+            movaps(RESULT[c], ONE);
+        } else {
+            Compile_SwizzleSrc(instr, 1, src1, c, RESULT[c]);
+        }
+        Compile_SwizzleSrc(instr, 2, src2, c, SRC2);
+        Compile_SanitizedMul(RESULT[c], SRC2, SCRATCH);
+    }
+
+    addps(RESULT[0], RESULT[1]);
+    addps(RESULT[2], RESULT[3]);
+    addps(RESULT[0], RESULT[2]);
+
+    Compile_DestEnableAll(instr, RESULT[0]);
+}
+
+void VectorCompiler::Compile_EX2(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, SRC1);
+    call(exp2_subroutine);
+    Compile_DestEnableAll(instr, SRC1);
+}
+
+void VectorCompiler::Compile_LG2(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, SRC1);
+    call(log2_subroutine);
+    Compile_DestEnableAll(instr, SRC1);
+}
+
+void VectorCompiler::Compile_MUL(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+            Compile_SanitizedMul(RESULT[c], SRC2, SCRATCH);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_SGE(Instruction instr) {
+    const bool is_sgei = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SGEI;
+    const SourceRegister src1 = is_sgei ? instr.common.src1i.Value() : instr.common.src1.Value();
+    const SourceRegister src2 = is_sgei ? instr.common.src2i.Value() : instr.common.src2.Value();
+
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, src1, c, SRC1);
+            Compile_SwizzleSrc(instr, 2, src2, c, RESULT[c]);
+            cmpleps(RESULT[c], SRC1);
+            andps(RESULT[c], ONE);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_SLT(Instruction instr) {
+    const bool is_slti = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SLTI;
+    const SourceRegister src1 = is_slti ? instr.common.src1i.Value() : instr.common.src1.Value();
+    const SourceRegister src2 = is_slti ? instr.common.src2i.Value() : instr.common.src2.Value();
+
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, src2, c, SRC2);
+            cmpltps(RESULT[c], SRC2);
+            andps(RESULT[c], ONE);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_FLR(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            roundps(RESULT[c], RESULT[c], _MM_FROUND_FLOOR);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_MAX(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+            // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+            maxps(RESULT[c], SRC2);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_MIN(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, instr.common.src2, c, SRC2);
+            // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+            minps(RESULT[c], SRC2);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_MOVA(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+
+    // Load both components before writing any, the source can be addressed relative to them
+    for (unsigned c = 0; c < 2; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+            // Convert floats to integers using truncation
+            cvttps2dq(RESULT[c], RESULT[c]);
+        }
+    }
+
+    for (unsigned c = 0; c < 2; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            const int disp = static_cast<int>(AddressRegisterOffset(c, 0));
+            movaps(SCRATCH, EXEC);
+            andnps(SCRATCH, xword[STATE + disp]);
+            andps(RESULT[c], EXEC);
+            orps(RESULT[c], SCRATCH);
+            movaps(xword[STATE + disp], RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_MOV(Instruction instr) {
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_RCP(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, SRC1);
+
+    // Produces the same approximation as RCPSS in Compiler
+    rcpps(SRC1, SRC1);
+
+    Compile_DestEnableAll(instr, SRC1);
+}
+
+void VectorCompiler::Compile_RSQ(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, SRC1);
+
+    // Produces the same approximation as RSQRTSS in Compiler
+    rsqrtps(SRC1, SRC1);
+
+    Compile_DestEnableAll(instr, SRC1);
+}
+
+void VectorCompiler::Compile_NOP(Instruction instr) {}
+
+void VectorCompiler::Compile_END(Instruction instr) {
+    // The lanes that reach END are done, the others may still be running in other branches
+    orps(ENDED, EXEC);
+    xorps(EXEC, EXEC);
+
+    Label not_done;
+    movmskps(eax, ENDED);
+    cmp(eax, ALL_LANES);
+    jne(not_done, T_NEAR);
+
+    // Save conditional code
+    movaps(xword[STATE + offsetof(VectorUnitState, conditional_code[0])], COND0);
+    movaps(xword[STATE + offsetof(VectorUnitState, conditional_code[1])], COND1);
+
+    // Save loop register, the address registers are kept in memory
+    sar(LOOPCOUNT_REG, 4);
+    mov(dword[STATE + offsetof(VectorUnitState, loop_counter)], LOOPCOUNT_REG);
+
+    ABI_PopRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+    ret();
+
+    L(not_done);
+}
+
+void VectorCompiler::Compile_BREAKC(Instruction instr) {
+    if (!looping) {
+        vectorizable = false;
+        return;
+    }
+
+    // Move the lanes that break from the active to the broken ones
+    Compile_EvaluateCondition(instr, SRC1);
+    andps(SRC1, EXEC);
+    orps(BROKEN, SRC1);
+    andnps(SRC1, EXEC);
+    movaps(EXEC, SRC1);
+
+    // Leave the loop once none of the lanes that entered it is still running
+    movaps(SCRATCH, BROKEN);
+    orps(SCRATCH, ENDED);
+    andnps(SCRATCH, xword[STATE + LOOP_MASK_SP + (MaskStackOffset() - 16)]);
+    movmskps(eax, SCRATCH);
+    test(eax, eax);
+    ASSERT(loop_break_label);
+    jz(*loop_break_label, T_NEAR);
+}
+
+void VectorCompiler::Compile_CALL(Instruction instr) {
+    // Push offset of the return
+    push(qword, (instr.flow_control.dest_offset + instr.flow_control.num_instructions));
+
+    // Call the subroutine
+    call(instruction_labels[instr.flow_control.dest_offset]);
+
+    // Skip over the return offset that's on the stack
+    add(rsp, 8);
+}
+
+void VectorCompiler::Compile_CALLC(Instruction instr) {
+    Compile_EvaluateCondition(instr, SRC1);
+    Compile_PushMask(EXEC);
+    andps(EXEC, SRC1);
+
+    Label b;
+    movmskps(eax, EXEC);
+    test(eax, eax);
+    jz(b, T_NEAR);
+    Compile_CALL(instr);
+    L(b);
+
+    Compile_PopMask();
+}
+
+void VectorCompiler::Compile_CALLU(Instruction instr) {
+    Compile_UniformCondition(instr);
+    Label b;
+    jz(b);
+    Compile_CALL(instr);
+    L(b);
+}
+
+void VectorCompiler::Compile_CMP(Instruction instr) {
+    using Op = Instruction::Common::CompareOpType::Op;
+    const Op ops[] = {instr.common.compare_op.x, instr.common.compare_op.y};
+
+    // Load all sources before updating the conditional code
+    for (unsigned c = 0; c < 2; ++c) {
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, c, RESULT[c]);
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, c, RESULT[c + 2]);
+    }
+
+    // SSE doesn't have greater-than (GT) or greater-equal (GE) comparison operators. You need to
+    // emulate them by swapping the lhs and rhs and using LT and LE. NLT and NLE can't be used here
+    // because they don't match when used with NaNs.
+    static const u8 cmp[] = {CMP_EQ, CMP_NEQ, CMP_LT, CMP_LE, CMP_LT, CMP_LE};
+
+    const Xmm cond[] = {COND0, COND1};
+    for (unsigned c = 0; c < 2; ++c) {
+        const bool invert_op = (ops[c] == Op::GreaterThan || ops[c] == Op::GreaterEqual);
+        const Xmm lhs = invert_op ? RESULT[c + 2] : RESULT[c];
+        const Xmm rhs = invert_op ? RESULT[c] : RESULT[c + 2];
+
+        cmpps(lhs, rhs, cmp[ops[c]]);
+
+        // Keep the previous result in the lanes that are inactive
+        andps(lhs, EXEC);
+        movaps(SCRATCH, EXEC);
+        andnps(SCRATCH, cond[c]);
+        orps(SCRATCH, lhs);
+        movaps(cond[c], SCRATCH);
+    }
+}
+
+void VectorCompiler::Compile_MAD(Instruction instr) {
+    const bool is_madi = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+    const SourceRegister src2 = is_madi ? instr.mad.src2i.Value() : instr.mad.src2.Value();
+    const SourceRegister src3 = is_madi ? instr.mad.src3i.Value() : instr.mad.src3.Value();
+
+    const SwizzlePattern swiz = GetSwizzle(instr, *swizzle_data);
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_SwizzleSrc(instr, 1, instr.mad.src1, c, RESULT[c]);
+            Compile_SwizzleSrc(instr, 2, src2, c, SRC2);
+            Compile_SwizzleSrc(instr, 3, src3, c, SRC3);
+            Compile_SanitizedMul(RESULT[c], SRC2, SCRATCH);
+            addps(RESULT[c], SRC3);
+        }
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        if (swiz.DestComponentEnabled(c)) {
+            Compile_DestEnable(instr, c, RESULT[c]);
+        }
+    }
+}
+
+void VectorCompiler::Compile_IF(Instruction instr) {
+    if (instr.flow_control.dest_offset < program_counter) {
+        vectorizable = false;
+        return;
+    }
+
+    Label l_else, l_endif;
+
+    const bool has_else = instr.flow_control.num_instructions != 0;
+    const unsigned else_offset = instr.flow_control.dest_offset;
+    const unsigned endif_offset = else_offset + instr.flow_control.num_instructions;
+
+    if (instr.opcode.Value() == OpCode::Id::IFU) {
+        // The condition is the same for every lane, this works like in Compiler
+        Compile_UniformCondition(instr);
+        jz(l_else, T_NEAR);
+
+        Compile_Block(else_offset);
+
+        if (!has_else) {
+            L(l_else);
+            return;
+        }
+
+        jmp(l_endif, T_NEAR);
+
+        L(l_else);
+        Compile_Block(endif_offset);
+
+        L(l_endif);
+        return;
+    }
+
+    // Run both branches, each one with the lanes that take it. Skip a branch if there are none.
+    Compile_EvaluateCondition(instr, SRC1);
+    Compile_PushMask(EXEC);
+    if (has_else) {
+        Compile_PushMask(SRC1);
+    }
+    andps(EXEC, SRC1);
+
+    masked_block_ends.push_back(endif_offset);
+
+    movmskps(eax, EXEC);
+    test(eax, eax);
+    jz(l_else, T_NEAR);
+
+    Compile_Block(else_offset);
+
+    L(l_else);
+
+    if (has_else) {
+        // Saved mask without the lanes that took the first branch
+        movaps(SCRATCH, BROKEN);
+        orps(SCRATCH, ENDED);
+        orps(SCRATCH, xword[STATE + MASK_SP + (MaskStackOffset() - 16)]);
+        andnps(SCRATCH, xword[STATE + MASK_SP + (MaskStackOffset() - 32)]);
+        movaps(EXEC, SCRATCH);
+
+        movmskps(eax, EXEC);
+        test(eax, eax);
+        jz(l_endif, T_NEAR);
+
+        Compile_Block(endif_offset);
+
+        L(l_endif);
+
+        // Drop the saved condition
+        sub(MASK_SP, 16);
+        --mask_depth;
+    }
+
+    masked_block_ends.pop_back();
+
+    Compile_PopMask();
+}
+
+void VectorCompiler::Compile_LOOP(Instruction instr) {
+    if (instr.flow_control.dest_offset < program_counter || looping) {
+        vectorizable = false;
+        return;
+    }
+
+    looping = true;
+
+    // This decodes the fields from the integer uniform at index instr.flow_control.int_uniform_id.
+    // The Y (LOOPCOUNT_REG) and Z (LOOPINC) component are kept multiplied by 16 (Left shifted by
+    // 4 bits) to be used as an offset into the 16-byte uniform vectors later
+    std::size_t offset = Uniforms::GetIntUniformOffset(instr.flow_control.int_uniform_id);
+    mov(LOOPCOUNT, dword[UNIFORMS + offset]);
+    mov(LOOPCOUNT_REG, LOOPCOUNT);
+    shr(LOOPCOUNT_REG, 4);
+    and_(LOOPCOUNT_REG, 0xFF0); // Y-component is the start
+    mov(LOOPINC, LOOPCOUNT);
+    shr(LOOPINC, 12);
+    and_(LOOPINC, 0xFF0);               // Z-component is the incrementer
+    movzx(LOOPCOUNT, LOOPCOUNT.cvt8()); // X-component is iteration count
+    add(LOOPCOUNT, 1);                  // Iteration count is X-component + 1
+
+    // Save the lanes that enter the loop, masks saved inside of it are above this entry
+    Compile_PushMask(EXEC);
+    mov(LOOP_MASK_SP, MASK_SP);
+
+    masked_block_ends.push_back(instr.flow_control.dest_offset + 1);
+
+    Label l_loop_start;
+    L(l_loop_start);
+
+    loop_break_label = Xbyak::Label();
+    Compile_Block(instr.flow_control.dest_offset + 1);
+
+    add(LOOPCOUNT_REG, LOOPINC); // Increment LOOPCOUNT_REG by Z-component
+    sub(LOOPCOUNT, 1);           // Increment loop count by 1
+    jnz(l_loop_start, T_NEAR);   // Loop if not equal
+    L(*loop_break_label);
+    loop_break_label.reset();
+
+    masked_block_ends.pop_back();
+
+    // BREAKC can leave blocks without restoring their masks
+    mov(MASK_SP, LOOP_MASK_SP);
+    xorps(BROKEN, BROKEN);
+    Compile_PopMask();
+
+    looping = false;
+}
+
+void VectorCompiler::Compile_JMP(Instruction instr) {
+    // JMPC can send lanes to different places, which can't be done with masking
+    if (instr.opcode.Value() != OpCode::Id::JMPU) {
+        vectorizable = false;
+        return;
+    }
+
+    // Jumping out of a block would skip restoring its execution mask
+    const unsigned dest_offset = instr.flow_control.dest_offset;
+    if (!masked_block_ends.empty() &&
+        (dest_offset < program_counter || dest_offset >= masked_block_ends.back())) {
+        vectorizable = false;
+        return;
+    }
+
+    Compile_UniformCondition(instr);
+
+    bool inverted_condition = instr.flow_control.num_instructions & 1;
+
+    Label& b = instruction_labels[dest_offset];
+    if (inverted_condition) {
+        jz(b, T_NEAR);
+    } else {
+        jnz(b, T_NEAR);
+    }
+}
+
+void VectorCompiler::Compile_Block(unsigned end) {
+    while (program_counter < end) {
+        Compile_NextInstr();
+    }
+}
+
+void VectorCompiler::Compile_Return() {
+    // Peek return offset on the stack and check if we're at that offset
+    mov(rax, qword[rsp + 8]);
+    cmp(eax, (program_counter));
+
+    // If so, jump back to before CALL
+    Label b;
+    jnz(b);
+    ret();
+    L(b);
+}
+
+void VectorCompiler::Compile_NextInstr() {
+    if (std::binary_search(return_offsets.begin(), return_offsets.end(), program_counter)) {
+        Compile_Return();
+    }
+
+    L(instruction_labels[program_counter]);
+
+    Instruction instr = {(*program_code)[program_counter++]};
+
+    OpCode::Id opcode = instr.opcode.Value();
+    auto instr_func = vector_instr_table[static_cast<unsigned>(opcode)];
+
+    // Unhandled instructions are logged by Compiler and ignored here as well
+    if (instr_func) {
+        ((*this).*instr_func)(instr);
+    }
+}
+
+bool VectorCompiler::IsVectorizable() const {
+    for (const u32 word : *program_code) {
+        const Instruction instr = {word};
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::EMIT:
+        case OpCode::Id::SETEMIT:
+        case OpCode::Id::JMPC:
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+void VectorCompiler::FindReturnOffsets() {
+    return_offsets.clear();
+
+    for (std::size_t offset = 0; offset < program_code->size(); ++offset) {
+        Instruction instr = {(*program_code)[offset]};
+
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            return_offsets.push_back(instr.flow_control.dest_offset +
+                                     instr.flow_control.num_instructions);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Sort for efficient binary search later
+    std::sort(return_offsets.begin(), return_offsets.end());
+}
+
+bool VectorCompiler::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code_,
+                             const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data_) {
+    // Lanes are gathered and rounded with SSE4.1 instructions
+    if (!Common::GetCPUCaps().sse4_1) {
+        return false;
+    }
+
+    program_code = program_code_;
+    swizzle_data = swizzle_data_;
+
+    if (!IsVectorizable()) {
+        program_code = nullptr;
+        swizzle_data = nullptr;
+        return false;
+    }
+
+    // Reset flow control state
+    program = (CompiledShader*)getCurr();
+    program_counter = 0;
+    looping = false;
+    vectorizable = true;
+    mask_depth = 0;
+    max_mask_depth = 0;
+    masked_block_ends.clear();
+    instruction_labels.fill(Xbyak::Label());
+
+    // Find all `CALL` instructions and identify return locations
+    FindReturnOffsets();
+
+    // The stack pointer is 8 modulo 16 at the entry of a procedure
+    // We reserve 16 bytes and assign a dummy value to the first 8 bytes, to catch any potential
+    // return checks (see Compile_Return) that happen in shader main routine.
+    ABI_PushRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+    mov(qword[rsp + 8], 0xFFFFFFFFFFFFFFFFULL);
+
+    mov(UNIFORMS, ABI_PARAM1);
+    mov(STATE, ABI_PARAM2);
+
+    // Load loop register
+    mov(LOOPCOUNT_REG, dword[STATE + offsetof(VectorUnitState, loop_counter)]);
+    shl(LOOPCOUNT_REG, 4);
+
+    // Load conditional code
+    movaps(COND0, xword[STATE + offsetof(VectorUnitState, conditional_code[0])]);
+    movaps(COND1, xword[STATE + offsetof(VectorUnitState, conditional_code[1])]);
+
+    // Every lane starts active
+    xor_(MASK_SP.cvt32(), MASK_SP.cvt32());
+    xor_(LOOP_MASK_SP.cvt32(), LOOP_MASK_SP.cvt32());
+    pcmpeqd(EXEC, EXEC);
+    xorps(BROKEN, BROKEN);
+    xorps(ENDED, ENDED);
+
+    // Used to set a register to one
+    static const __m128 one = {1.f, 1.f, 1.f, 1.f};
+    mov(rax, reinterpret_cast<std::size_t>(&one));
+    movaps(ONE, xword[rax]);
+
+    // Used to negate registers
+    static const __m128 neg = {-0.f, -0.f, -0.f, -0.f};
+    mov(rax, reinterpret_cast<std::size_t>(&neg));
+    movaps(NEGBIT, xword[rax]);
+
+    // Jump to start of the shader program
+    jmp(ABI_PARAM3);
+
+    // Compile entire program
+    Compile_Block(static_cast<unsigned>(program_code->size()));
+
+    // Free memory that's no longer needed
+    program_code = nullptr;
+    swizzle_data = nullptr;
+    return_offsets.clear();
+    return_offsets.shrink_to_fit();
+    masked_block_ends.clear();
+
+    // Subroutines run with the masks saved at their call sites on the stack
+    if (max_mask_depth * (MAX_CALL_DEPTH + 1) > VectorUnitState::MASK_STACK_DEPTH) {
+        vectorizable = false;
+    }
+
+    if (!vectorizable) {
+        return false;
+    }
+
+    ready();
+
+    ASSERT_MSG(getSize() <= MAX_VECTOR_SHADER_SIZE,
+               "Compiled a shader that exceeds the allocated size!");
+    LOG_DEBUG(HW_GPU, "Compiled vectorized shader size={}", getSize());
+    return true;
+}
+
+VectorCompiler::VectorCompiler() : Xbyak::CodeGenerator(MAX_VECTOR_SHADER_SIZE) {
+    CompilePrelude();
+}
+
+void VectorCompiler::CompilePrelude() {
+    log2_subroutine = CompilePrelude_Log2();
+    exp2_subroutine = CompilePrelude_Exp2();
+}
+
+const void* VectorCompiler::EmitVectorConstant(u32 value) {
+    align(16);
+    const void* constant = getCurr();
+    for (std::size_t lane = 0; lane < VECTOR_WIDTH; ++lane) {
+        dd(value);
+    }
+    return constant;
+}
+
+Xbyak::Label VectorCompiler::CompilePrelude_Log2() {
+    Xbyak::Label subroutine;
+
+    // Same approximation as Compiler, done for every lane of SRC1. The result is broadcast, so it
+    // is computed on the X component only. See Compiler::CompilePrelude_Log2 for the details.
+    const void* c0 = EmitVectorConstant(0x3d74552f);
+    const void* c1 = EmitVectorConstant(0xbeee7397);
+    const void* c2 = EmitVectorConstant(0x3fbd96dd);
+    const void* c3 = EmitVectorConstant(0xc02153f6);
+    const void* c4 = EmitVectorConstant(0x4038d96c);
+    const void* exponent_mask = EmitVectorConstant(0x7f800000);
+    const void* mantissa_mask = EmitVectorConstant(0x007fffff);
+    const void* exponent_bias = EmitVectorConstant(0x7f);
+    const void* one = EmitVectorConstant(0x3f800000);
+    const void* negative_infinity_vector = EmitVectorConstant(0xff800000);
+    const void* default_qnan_vector = EmitVectorConstant(0x7fc00000);
+
+    align(16);
+    L(subroutine);
+
+    // Keep the input for the edge cases
+    movaps(SRC3, SRC1);
+
+    // Split input
+    movaps(SCRATCH2, SRC1);
+    andps(SCRATCH2, xword[rip + exponent_mask]);
+    psrld(SCRATCH2, 23);
+    psubd(SCRATCH2, xword[rip + exponent_bias]);
+    cvtdq2ps(SCRATCH2, SCRATCH2);
+    // SCRATCH2 now contains the exponent of the input.
+    andps(SRC1, xword[rip + mantissa_mask]);
+    orps(SRC1, xword[rip + one]);
+    // SRC1 now contains the mantissa of the input.
+
+    // Compute polynomial
+    movaps(SCRATCH, xword[rip + c0]);
+    mulps(SCRATCH, SRC1);
+    addps(SCRATCH, xword[rip + c1]);
+    mulps(SCRATCH, SRC1);
+    addps(SCRATCH, xword[rip + c2]);
+    mulps(SCRATCH, SRC1);
+    addps(SCRATCH, xword[rip + c3]);
+    mulps(SCRATCH, SRC1);
+    subps(SRC1, ONE);
+    addps(SCRATCH, xword[rip + c4]);
+    mulps(SCRATCH, SRC1);
+    addps(SCRATCH2, SCRATCH);
+    movaps(SRC1, SCRATCH2);
+
+    // Here we handle edge cases: input in {NaN, 0, -Inf, Negative}.
+    xorps(SRC2, SRC2);
+    movaps(SCRATCH, SRC3);
+    cmpleps(SCRATCH, SRC2);
+    blendvps(SRC1, xword[rip + default_qnan_vector]);
+    movaps(SCRATCH, SRC3);
+    cmpeqps(SCRATCH, SRC2);
+    blendvps(SRC1, xword[rip + negative_infinity_vector]);
+    movaps(SCRATCH, SRC3);
+    cmpunordps(SCRATCH, SCRATCH);
+    blendvps(SRC1, SRC3);
+
+    ret();
+
+    return subroutine;
+}
+
+Xbyak::Label VectorCompiler::CompilePrelude_Exp2() {
+    Xbyak::Label subroutine;
+
+    // Same approximation as Compiler, done for every lane of SRC1. See
+    // Compiler::CompilePrelude_Exp2 for the details.
+    const void* input_max = EmitVectorConstant(0x43010000);
+    const void* input_min = EmitVectorConstant(0xc2fdffff);
+    const void* c0 = EmitVectorConstant(0x3c5dbe69);
+    const void* half = EmitVectorConstant(0x3f000000);
+    const void* c1 = EmitVectorConstant(0x3d5509f9);
+    const void* c2 = EmitVectorConstant(0x3e773cc5);
+    const void* c3 = EmitVectorConstant(0x3f3168b3);
+    const void* c4 = EmitVectorConstant(0x3f800016);
+    const void* exponent_bias = EmitVectorConstant(0x7f);
+
+    align(16);
+    L(subroutine);
+
+    // Keep the input, NaN is passed through
+    movaps(SRC3, SRC1);
+
+    // Clamp to maximum range since we shift the value directly into the exponent.
+    minps(SRC1, xword[rip + input_max]);
+    maxps(SRC1, xword[rip + input_min]);
+
+    // Decompose input
+    movaps(SCRATCH, SRC1);
+    movaps(SCRATCH2, xword[rip + c0]); // Preload c0.
+    subps(SCRATCH, xword[rip + half]);
+    cvtps2dq(SRC2, SCRATCH);
+    cvtdq2ps(SCRATCH, SRC2);
+    // SCRATCH now contains input rounded to the nearest integer.
+    paddd(SRC2, xword[rip + exponent_bias]);
+    subps(SRC1, SCRATCH);
+    // SRC1 contains input - round(input), which is in [-0.5, 0.5).
+    mulps(SCRATCH2, SRC1);
+    pslld(SRC2, 23);
+    // SRC2 contains 2^(round(input)).
+
+    // Complete computation of polynomial.
+    addps(SCRATCH2, xword[rip + c1]);
+    mulps(SCRATCH2, SRC1);
+    addps(SCRATCH2, xword[rip + c2]);
+    mulps(SCRATCH2, SRC1);
+    addps(SCRATCH2, xword[rip + c3]);
+    mulps(SRC1, SCRATCH2);
+    addps(SRC1, xword[rip + c4]);
+    mulps(SRC1, SRC2);
+
+    movaps(SCRATCH, SRC3);
+    cmpunordps(SCRATCH, SCRATCH);
+    blendvps(SRC1, SRC3);
+
+    ret();
+
+    return subroutine;
+}
+
+} // namespace Pica::Shader
@@ -0,0 +1,168 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <nihstro/shader_bytecode.h>
+#include <optional>
+#include <vector>
+#include <xbyak.h>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica::Shader {
+
+/// Memory allocated for each compiled vectorized shader
+constexpr std::size_t MAX_VECTOR_SHADER_SIZE = MAX_PROGRAM_CODE_LENGTH * 1024;
+
+/**
+ * Shader JIT that runs a vertex shader on VECTOR_WIDTH vertices at once, using VectorUnitState.
+ * Every instruction is executed for the whole batch. Conditional control flow that may differ
+ * between vertices (IFC, CALLC, BREAKC and END) is handled by masking the lanes that don't take
+ * it, control flow depending only on uniforms is compiled like in Compiler.
+ * Results are bit-exact with Compiler.
+ */
+class VectorCompiler : public Xbyak::CodeGenerator {
+public:
+    VectorCompiler();
+
+    void Run(const ShaderSetup& setup, VectorUnitState& state, unsigned offset) const {
+        program(&setup.uniforms, &state, instruction_labels[offset].getAddress());
+    }
+
+    /**
+     * Compiles a shader program.
+     * @returns false if the program uses features that can't be vectorized (EMIT, SETEMIT, JMPC
+     * or unstructured control flow), in which case it has to run with Compiler.
+     */
+    bool Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
+                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data);
+
+    void Compile_ADD(Instruction instr);
+    void Compile_DP3(Instruction instr);
+    void Compile_DP4(Instruction instr);
+    void Compile_DPH(Instruction instr);
+    void Compile_EX2(Instruction instr);
+    void Compile_LG2(Instruction instr);
+    void Compile_MUL(Instruction instr);
+    void Compile_SGE(Instruction instr);
+    void Compile_SLT(Instruction instr);
+    void Compile_FLR(Instruction instr);
+    void Compile_MAX(Instruction instr);
+    void Compile_MIN(Instruction instr);
+    void Compile_RCP(Instruction instr);
+    void Compile_RSQ(Instruction instr);
+    void Compile_MOVA(Instruction instr);
+    void Compile_MOV(Instruction instr);
+    void Compile_NOP(Instruction instr);
+    void Compile_END(Instruction instr);
+    void Compile_BREAKC(Instruction instr);
+    void Compile_CALL(Instruction instr);
+    void Compile_CALLC(Instruction instr);
+    void Compile_CALLU(Instruction instr);
+    void Compile_IF(Instruction instr);
+    void Compile_LOOP(Instruction instr);
+    void Compile_JMP(Instruction instr);
+    void Compile_CMP(Instruction instr);
+    void Compile_MAD(Instruction instr);
+
+private:
+    void Compile_Block(unsigned end);
+    void Compile_NextInstr();
+
+    /**
+     * Loads one component of a swizzled source register for all lanes into the specified XMM
+     * register.
+     */
+    void Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                            unsigned component, Xbyak::Xmm dest);
+
+    /// Writes one component of the destination register for the active lanes
+    void Compile_DestEnable(Instruction instr, unsigned component, Xbyak::Xmm src);
+
+    /// Writes `src` to every enabled component of the destination register for the active lanes
+    void Compile_DestEnableAll(Instruction instr, Xbyak::Xmm src);
+
+    /**
+     * Compiles a `MUL src1, src2` operation, properly handling the PICA semantics when multiplying
+     * zero by inf. Clobbers `src2` and `scratch`.
+     */
+    void Compile_SanitizedMul(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+
+    /// Computes the mask of lanes for which the condition of a flow control instruction is true
+    void Compile_EvaluateCondition(Instruction instr, Xbyak::Xmm dest);
+    void Compile_UniformCondition(Instruction instr);
+
+    /// Saves an execution mask on the mask stack
+    void Compile_PushMask(Xbyak::Xmm mask);
+
+    /**
+     * Restores the execution mask from the mask stack, leaving out the lanes that finished the
+     * current loop or the program in the meantime.
+     */
+    void Compile_PopMask();
+
+    /**
+     * Emits the code to conditionally return from a subroutine envoked by the `CALL` instruction.
+     */
+    void Compile_Return();
+
+    /**
+     * Checks the entire shader program for instructions that can't be vectorized before emitting
+     * any code.
+     */
+    bool IsVectorizable() const;
+
+    /**
+     * Analyzes the entire shader program for `CALL` instructions before emitting any code,
+     * identifying the locations where a return needs to be inserted.
+     */
+    void FindReturnOffsets();
+
+    /**
+     * Emits data and code for utility functions.
+     */
+    void CompilePrelude();
+    Xbyak::Label CompilePrelude_Log2();
+    Xbyak::Label CompilePrelude_Exp2();
+    const void* EmitVectorConstant(u32 value);
+
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code = nullptr;
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data = nullptr;
+
+    /// Mapping of Pica VS instructions to pointers in the emitted code
+    std::array<Xbyak::Label, MAX_PROGRAM_CODE_LENGTH> instruction_labels;
+
+    /// Label pointing to the end of the current LOOP block. Used by the BREAKC instruction to break
+    /// out of the loop.
+    std::optional<Xbyak::Label> loop_break_label;
+
+    /// Offsets in code where a return needs to be inserted
+    std::vector<unsigned> return_offsets;
+
+    /// End offsets of the enclosing blocks that save an execution mask, innermost last
+    std::vector<unsigned> masked_block_ends;
+
+    unsigned program_counter = 0; ///< Offset of the next instruction to decode
+    bool looping = false;         ///< True if compiling a loop, used to check for nested loops
+    bool vectorizable = true;     ///< Cleared when compiling control flow that can't be masked
+
+    /// Current and maximum number of execution masks saved by the code being compiled
+    std::size_t mask_depth = 0;
+    std::size_t max_mask_depth = 0;
+
+    using CompiledShader = void(const void* setup, void* state, const u8* start_addr);
+    CompiledShader* program = nullptr;
+
+    Xbyak::Label log2_subroutine;
+    Xbyak::Label exp2_subroutine;
+};
+
+} // namespace Pica::Shader
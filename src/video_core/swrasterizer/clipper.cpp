@@ -0,0 +1,191 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <boost/container/static_vector.hpp>
+#include "common/assert.h"
+#include "video_core/pica_state.h"
+#include "video_core/regs_rasterizer.h"
+#include "video_core/swrasterizer/clipper.h"
+
+using Pica::Rasterizer::Vertex;
+
+namespace Pica::Clipper {
+
+namespace {
+
+struct ClippingEdge {
+public:
+    ClippingEdge(Common::Vec4<float24> coeffs,
+                 Common::Vec4<float24> bias = Common::Vec4<float24>(float24::Zero(),
+                                                                    float24::Zero(),
+                                                                    float24::Zero(),
+                                                                    float24::Zero()))
+        : coeffs(coeffs), bias(bias) {}
+
+    bool IsInside(const Vertex& vertex) const {
+        return Common::Dot(vertex.pos + bias, coeffs) >= float24::Zero();
+    }
+
+    bool IsOutSide(const Vertex& vertex) const {
+        return !IsInside(vertex);
+    }
+
+    Vertex GetIntersection(const Vertex& v0, const Vertex& v1) const {
+        const float24 dp = Common::Dot(v0.pos + bias, coeffs);
+        const float24 dp_prev = Common::Dot(v1.pos + bias, coeffs);
+        const float24 factor = dp_prev / (dp_prev - dp);
+
+        return Vertex::Lerp(factor, v0, v1);
+    }
+
+private:
+    Common::Vec4<float24> coeffs;
+    Common::Vec4<float24> bias;
+};
+
+void InitScreenCoordinates(Vertex& vtx) {
+    const auto& regs = g_state.regs;
+
+    struct {
+        float24 halfsize_x;
+        float24 offset_x;
+        float24 halfsize_y;
+        float24 offset_y;
+        float24 zscale;
+        float24 offset_z;
+    } viewport;
+
+    viewport.halfsize_x = float24::FromRaw(regs.rasterizer.viewport_size_x);
+    viewport.halfsize_y = float24::FromRaw(regs.rasterizer.viewport_size_y);
+    viewport.offset_x = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.x));
+    viewport.offset_y = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.y));
+
+    const float24 inv_w = float24::FromFloat32(1.f) / vtx.pos.w;
+    vtx.pos.w = inv_w;
+    vtx.quat *= inv_w;
+    vtx.color *= inv_w;
+    vtx.tc0 *= inv_w;
+    vtx.tc1 *= inv_w;
+    vtx.tc0_w *= inv_w;
+    vtx.view *= inv_w;
+    vtx.tc2 *= inv_w;
+
+    vtx.screenpos[0] =
+        (vtx.pos.x * inv_w + float24::FromFloat32(1.0)) * viewport.halfsize_x + viewport.offset_x;
+    vtx.screenpos[1] =
+        (vtx.pos.y * inv_w + float24::FromFloat32(1.0)) * viewport.halfsize_y + viewport.offset_y;
+    vtx.screenpos[2] = vtx.pos.z * inv_w;
+}
+
+} // namespace
+
+void ProcessTriangle(const Shader::OutputVertex& v0, const Shader::OutputVertex& v1,
+                     const Shader::OutputVertex& v2, std::vector<Rasterizer::Triangle>& output) {
+    using boost::container::static_vector;
+
+    // Clipping a planar n-gon against a plane will remove at least 1 vertex and introduces 2 at
+    // the new edge (or less in degenerate cases). As such, we can say that each clipping plane
+    // introduces at most 1 new vertex to the polygon. Since we start with a triangle and have a
+    // fixed 6 clipping planes, the maximum number of vertices of the clipped polygon is 3 + 6 = 9.
+    // Plus one more for the custom clip plane and one for the w = EPSILON plane.
+    static const std::size_t MAX_VERTICES = 11;
+    static_vector<Vertex, MAX_VERTICES> buffer_a = {v0, v1, v2};
+    static_vector<Vertex, MAX_VERTICES> buffer_b;
+
+    const auto FlipQuaternionIfOpposite = [](auto& a, const auto& b) {
+        if (Common::Dot(a, b) < float24::Zero()) {
+            a = a * float24::FromFloat32(-1.0f);
+        }
+    };
+
+    // Flip the quaternions if they are opposite to prevent interpolating them over the wrong
+    // direction.
+    FlipQuaternionIfOpposite(buffer_a[1].quat, buffer_a[0].quat);
+    FlipQuaternionIfOpposite(buffer_a[2].quat, buffer_a[0].quat);
+
+    auto* input_list = &buffer_a;
+    auto* output_list = &buffer_b;
+
+    // NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
+    // TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
+    //       epsilon possible within float24 accuracy.
+    static const float24 EPSILON = float24::FromFloat32(0.00001f);
+    static const float24 f0 = float24::FromFloat32(0.0);
+    static const float24 f1 = float24::FromFloat32(1.0);
+    static const std::array<ClippingEdge, 7> clipping_edges = {{
+        {Common::MakeVec(-f1, f0, f0, f1)},                                   // x = +w
+        {Common::MakeVec(f1, f0, f0, f1)},                                    // x = -w
+        {Common::MakeVec(f0, -f1, f0, f1)},                                   // y = +w
+        {Common::MakeVec(f0, f1, f0, f1)},                                    // y = -w
+        {Common::MakeVec(f0, f0, -f1, f0)},                                   // z =  0
+        {Common::MakeVec(f0, f0, f1, f1)},                                    // z = -w
+        {Common::MakeVec(f0, f0, f0, f1), Common::Vec4<float24>(f0, f0, f0, -EPSILON)}, // w = EPSILON
+    }};
+
+    // Simple implementation of the Sutherland-Hodgman clipping algorithm.
+    // TODO: Make this less inefficient (currently lots of useless buffering overhead happens here)
+    const auto Clip = [&](const ClippingEdge& edge) {
+        std::swap(input_list, output_list);
+        output_list->clear();
+
+        const Vertex* reference_vertex = &input_list->back();
+
+        for (const auto& vertex : *input_list) {
+            // NOTE: This algorithm changes vertex order in some cases!
+            if (edge.IsInside(vertex)) {
+                if (edge.IsOutSide(*reference_vertex)) {
+                    output_list->push_back(edge.GetIntersection(vertex, *reference_vertex));
+                }
+
+                output_list->push_back(vertex);
+            } else if (edge.IsInside(*reference_vertex)) {
+                output_list->push_back(edge.GetIntersection(vertex, *reference_vertex));
+            }
+            reference_vertex = &vertex;
+        }
+    };
+
+    for (const ClippingEdge& edge : clipping_edges) {
+        Clip(edge);
+
+        // Early exit if polygon is empty
+        if (output_list->empty()) {
+            return;
+        }
+    }
+
+    const auto& regs = g_state.regs;
+    if (regs.rasterizer.clip_enable) {
+        const ClippingEdge custom_edge{regs.rasterizer.GetClipCoef()};
+        Clip(custom_edge);
+
+        if (output_list->empty()) {
+            return;
+        }
+    }
+
+    if (output_list->size() < 3) {
+        return;
+    }
+
+    for (auto& vertex : *output_list) {
+        InitScreenCoordinates(vertex);
+    }
+
+    for (std::size_t i = 0; i < output_list->size() - 2; ++i) {
+        const Vertex& vtx0 = (*output_list)[0];
+        const Vertex& vtx1 = (*output_list)[i + 1];
+        const Vertex& vtx2 = (*output_list)[i + 2];
+
+        Rasterizer::Triangle triangle;
+        if (Rasterizer::SetupTriangle(vtx0, vtx1, vtx2, triangle)) {
+            output.push_back(triangle);
+        }
+    }
+}
+
+} // namespace Pica::Clipper
@@ -0,0 +1,19 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+#include "video_core/swrasterizer/rasterizer.h"
+
+namespace Pica::Clipper {
+
+/**
+ * Clips a triangle against the view volume and the user clip plane, then appends the
+ * resulting triangles that cover pixels to output. Uses the current PICA registers.
+ */
+void ProcessTriangle(const Shader::OutputVertex& v0, const Shader::OutputVertex& v1,
+                     const Shader::OutputVertex& v2, std::vector<Rasterizer::Triangle>& output);
+
+} // namespace Pica::Clipper
@@ -0,0 +1,316 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "video_core/swrasterizer/lighting.h"
+
+namespace Pica::Rasterizer {
+
+namespace {
+
+float LookupLightingLut(const State::Lighting& lighting, std::size_t lut_index, u8 index,
+                        float delta) {
+    ASSERT_MSG(lut_index < lighting.luts.size(), "Out of range lut");
+
+    const auto& lut = lighting.luts[lut_index][index];
+    return lut.ToFloat() + lut.DiffToFloat() * delta;
+}
+
+Common::Vec4<u8> ToColor(const Common::Vec4<float>& value) {
+    return Common::MakeVec<float>(std::clamp(value.x, 0.0f, 1.0f) * 255,
+                                  std::clamp(value.y, 0.0f, 1.0f) * 255,
+                                  std::clamp(value.z, 0.0f, 1.0f) * 255,
+                                  std::clamp(value.w, 0.0f, 1.0f) * 255)
+        .Cast<u8>();
+}
+
+} // namespace
+
+std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
+    const LightingRegs& lighting, const State::Lighting& lighting_state,
+    const Common::Quaternion<float>& normquat, const Common::Vec3<float>& view,
+    const Common::Vec4<u8> (&texture_color)[4]) {
+
+    Common::Vec4<float> shadow = Common::MakeVec(1.0f, 1.0f, 1.0f, 1.0f);
+    if (lighting.config0.enable_shadow) {
+        shadow = texture_color[lighting.config0.shadow_selector].Cast<float>() / 255.0f;
+        if (lighting.config0.shadow_invert) {
+            shadow = Common::MakeVec(1.0f, 1.0f, 1.0f, 1.0f) - shadow;
+        }
+    }
+
+    Common::Vec3<float> surface_normal = Common::MakeVec(0.0f, 0.0f, 1.0f);
+    Common::Vec3<float> surface_tangent = Common::MakeVec(1.0f, 0.0f, 0.0f);
+
+    if (lighting.config0.bump_mode != LightingRegs::LightingBumpMode::None) {
+        Common::Vec3<float> perturbation =
+            texture_color[lighting.config0.bump_selector].xyz().Cast<float>() / 127.5f -
+            Common::MakeVec(1.0f, 1.0f, 1.0f);
+
+        if (lighting.config0.bump_mode == LightingRegs::LightingBumpMode::NormalMap) {
+            if (!lighting.config0.disable_bump_renorm) {
+                const float z_square = 1 - perturbation.xy().Length2();
+                perturbation.z = std::sqrt(std::max(z_square, 0.0f));
+            }
+            surface_normal = perturbation;
+        } else if (lighting.config0.bump_mode == LightingRegs::LightingBumpMode::TangentMap) {
+            surface_tangent = perturbation;
+        } else {
+            LOG_ERROR(HW_GPU, "Unknown bump mode {}",
+                      static_cast<u32>(lighting.config0.bump_mode.Value()));
+        }
+    }
+
+    // Use the normalized the quaternion when performing the rotation
+    const Common::Vec3<float> normal = Common::QuaternionRotate(normquat, surface_normal);
+    const Common::Vec3<float> tangent = Common::QuaternionRotate(normquat, surface_tangent);
+    const Common::Vec3<float> norm_view = view.Normalized();
+
+    Common::Vec4<float> diffuse_sum = {0.0f, 0.0f, 0.0f, 1.0f};
+    Common::Vec4<float> specular_sum = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    for (unsigned light_index = 0; light_index <= lighting.max_light_index; ++light_index) {
+        const unsigned num = lighting.light_enable.GetNum(light_index);
+        const auto& light_config = lighting.light[num];
+
+        const Common::Vec3<float> position = {float16::FromRaw(light_config.x).ToFloat32(),
+                                              float16::FromRaw(light_config.y).ToFloat32(),
+                                              float16::FromRaw(light_config.z).ToFloat32()};
+        Common::Vec3<float> light_vector =
+            light_config.config.directional ? position : position + view;
+        light_vector.Normalize();
+
+        const Common::Vec3<float> half_vector = norm_view + light_vector;
+
+        float dist_atten = 1.0f;
+        if (!lighting.IsDistAttenDisabled(num)) {
+            const float distance = (-view - position).Length();
+            const float scale = float20::FromRaw(light_config.dist_atten_scale).ToFloat32();
+            const float bias = float20::FromRaw(light_config.dist_atten_bias).ToFloat32();
+            const std::size_t lut =
+                static_cast<std::size_t>(LightingRegs::LightingSampler::DistanceAttenuation) + num;
+
+            const float sample_loc = std::clamp(scale * distance + bias, 0.0f, 1.0f);
+            const u8 lutindex =
+                static_cast<u8>(std::clamp(std::floor(sample_loc * 256.0f), 0.0f, 255.0f));
+            const float delta = sample_loc * 256 - lutindex;
+            dist_atten = LookupLightingLut(lighting_state, lut, lutindex, delta);
+        }
+
+        const auto GetLutValue = [&](LightingRegs::LightingLutInput input, bool abs,
+                                     LightingRegs::LightingScale scale_enum,
+                                     LightingRegs::LightingSampler sampler) {
+            float result = 0.0f;
+
+            switch (input) {
+            case LightingRegs::LightingLutInput::NH:
+                result = Common::Dot(normal, half_vector.Normalized());
+                break;
+            case LightingRegs::LightingLutInput::VH:
+                result = Common::Dot(norm_view, half_vector.Normalized());
+                break;
+            case LightingRegs::LightingLutInput::NV:
+                result = Common::Dot(normal, norm_view);
+                break;
+            case LightingRegs::LightingLutInput::LN:
+                result = Common::Dot(light_vector, normal);
+                break;
+            case LightingRegs::LightingLutInput::SP: {
+                const Common::Vec3<s32> spot_dir{light_config.spot_x.Value(),
+                                                 light_config.spot_y.Value(),
+                                                 light_config.spot_z.Value()};
+                result = Common::Dot(light_vector, spot_dir.Cast<float>() / 2047.0f);
+                break;
+            }
+            case LightingRegs::LightingLutInput::CP:
+                if (lighting.config0.config == LightingRegs::LightingConfig::Config7) {
+                    const Common::Vec3<float> norm_half_vector = half_vector.Normalized();
+                    const Common::Vec3<float> half_vector_proj =
+                        norm_half_vector - normal * Common::Dot(normal, norm_half_vector);
+                    result = Common::Dot(half_vector_proj, tangent);
+                }
+                break;
+            default:
+                LOG_CRITICAL(HW_GPU, "Unknown lighting LUT input {}", static_cast<u32>(input));
+                UNIMPLEMENTED();
+                break;
+            }
+
+            u8 index;
+            float delta;
+
+            if (abs) {
+                if (light_config.config.two_sided_diffuse) {
+                    result = std::abs(result);
+                } else {
+                    result = std::max(result, 0.0f);
+                }
+
+                index = static_cast<u8>(std::clamp(std::floor(result * 256.0f), 0.0f, 255.0f));
+                delta = result * 256 - index;
+            } else {
+                const s8 signed_index =
+                    static_cast<s8>(std::clamp(std::floor(result * 128.0f), -128.0f, 127.0f));
+                delta = result * 128.0f - signed_index;
+                index = static_cast<u8>(signed_index);
+            }
+
+            return lighting.lut_scale.GetScale(scale_enum) *
+                   LookupLightingLut(lighting_state, static_cast<std::size_t>(sampler), index,
+                                     delta);
+        };
+
+        const auto IsSamplerEnabled = [&](LightingRegs::LightingSampler sampler) {
+            return LightingRegs::IsLightingSamplerSupported(lighting.config0.config, sampler);
+        };
+
+        // If enabled, compute spot light attenuation value
+        float spot_atten = 1.0f;
+        if (!lighting.IsSpotAttenDisabled(num) &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::SpotlightAttenuation)) {
+            spot_atten = GetLutValue(lighting.lut_input.sp, lighting.abs_lut_input.disable_sp == 0,
+                                     lighting.lut_scale.sp,
+                                     LightingRegs::SpotlightAttenuationSampler(num));
+        }
+
+        // Specular 0 component
+        float d0_lut_value = 1.0f;
+        if (lighting.config1.disable_lut_d0 == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::Distribution0)) {
+            d0_lut_value = GetLutValue(lighting.lut_input.d0,
+                                       lighting.abs_lut_input.disable_d0 == 0,
+                                       lighting.lut_scale.d0,
+                                       LightingRegs::LightingSampler::Distribution0);
+        }
+
+        Common::Vec3<float> specular_0 = d0_lut_value * light_config.specular_0.ToVec3f();
+
+        // If enabled, lookup ReflectRed value, otherwise, 1.0 is used
+        Common::Vec3<float> refl_value;
+        if (lighting.config1.disable_lut_rr == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::ReflectRed)) {
+            refl_value.x = GetLutValue(lighting.lut_input.rr,
+                                       lighting.abs_lut_input.disable_rr == 0,
+                                       lighting.lut_scale.rr,
+                                       LightingRegs::LightingSampler::ReflectRed);
+        } else {
+            refl_value.x = 1.0f;
+        }
+
+        // If enabled, lookup ReflectGreen value, otherwise, ReflectRed value is used
+        if (lighting.config1.disable_lut_rg == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::ReflectGreen)) {
+            refl_value.y = GetLutValue(lighting.lut_input.rg,
+                                       lighting.abs_lut_input.disable_rg == 0,
+                                       lighting.lut_scale.rg,
+                                       LightingRegs::LightingSampler::ReflectGreen);
+        } else {
+            refl_value.y = refl_value.x;
+        }
+
+        // If enabled, lookup ReflectBlue value, otherwise, ReflectRed value is used
+        if (lighting.config1.disable_lut_rb == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::ReflectBlue)) {
+            refl_value.z = GetLutValue(lighting.lut_input.rb,
+                                       lighting.abs_lut_input.disable_rb == 0,
+                                       lighting.lut_scale.rb,
+                                       LightingRegs::LightingSampler::ReflectBlue);
+        } else {
+            refl_value.z = refl_value.x;
+        }
+
+        // Specular 1 component
+        float d1_lut_value = 1.0f;
+        if (lighting.config1.disable_lut_d1 == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::Distribution1)) {
+            d1_lut_value = GetLutValue(lighting.lut_input.d1,
+                                       lighting.abs_lut_input.disable_d1 == 0,
+                                       lighting.lut_scale.d1,
+                                       LightingRegs::LightingSampler::Distribution1);
+        }
+
+        Common::Vec3<float> specular_1 =
+            d1_lut_value * refl_value * light_config.specular_1.ToVec3f();
+
+        // Fresnel
+        // Note: only the last entry in the light slots applies the Fresnel factor
+        if (light_index == lighting.max_light_index && lighting.config1.disable_lut_fr == 0 &&
+            IsSamplerEnabled(LightingRegs::LightingSampler::Fresnel)) {
+            const float lut_value = GetLutValue(lighting.lut_input.fr,
+                                                lighting.abs_lut_input.disable_fr == 0,
+                                                lighting.lut_scale.fr,
+                                                LightingRegs::LightingSampler::Fresnel);
+
+            // Enabled for diffuse lighting alpha component
+            if (lighting.config0.enable_primary_alpha) {
+                diffuse_sum.a() = lut_value;
+            }
+
+            // Enabled for the specular lighting alpha component
+            if (lighting.config0.enable_secondary_alpha) {
+                specular_sum.a() = lut_value;
+            }
+        }
+
+        float dot_product = Common::Dot(light_vector, normal);
+        if (light_config.config.two_sided_diffuse) {
+            dot_product = std::abs(dot_product);
+        } else {
+            dot_product = std::max(dot_product, 0.0f);
+        }
+
+        float clamp_highlights = 1.0f;
+        if (lighting.config0.clamp_highlights) {
+            clamp_highlights = dot_product == 0.0f ? 0.0f : 1.0f;
+        }
+
+        if (light_config.config.geometric_factor_0 || light_config.config.geometric_factor_1) {
+            float geo_factor = half_vector.Length2();
+            geo_factor = geo_factor == 0.0f ? 0.0f : std::min(dot_product / geo_factor, 1.0f);
+            if (light_config.config.geometric_factor_0) {
+                specular_0 *= geo_factor;
+            }
+            if (light_config.config.geometric_factor_1) {
+                specular_1 *= geo_factor;
+            }
+        }
+
+        const bool shadow_primary_enable =
+            lighting.config0.shadow_primary && !lighting.IsShadowDisabled(num);
+        const bool shadow_secondary_enable =
+            lighting.config0.shadow_secondary && !lighting.IsShadowDisabled(num);
+        const Common::Vec3<float> shadow_primary =
+            shadow_primary_enable ? shadow.xyz() : Common::MakeVec(1.0f, 1.0f, 1.0f);
+        const Common::Vec3<float> shadow_secondary =
+            shadow_secondary_enable ? shadow.xyz() : Common::MakeVec(1.0f, 1.0f, 1.0f);
+
+        const Common::Vec3<float> diffuse =
+            (light_config.diffuse.ToVec3f() * dot_product + light_config.ambient.ToVec3f()) *
+            dist_atten * spot_atten * shadow_primary;
+        const Common::Vec3<float> specular = (specular_0 + specular_1) * clamp_highlights *
+                                             dist_atten * spot_atten * shadow_secondary;
+
+        diffuse_sum += Common::MakeVec(diffuse, 0.0f);
+        specular_sum += Common::MakeVec(specular, 0.0f);
+    }
+
+    if (lighting.config0.shadow_alpha) {
+        // Alpha shadow also uses the Fresnel selector to determine which alpha to apply
+        if (lighting.config0.enable_primary_alpha) {
+            diffuse_sum.a() *= shadow.w;
+        }
+        if (lighting.config0.enable_secondary_alpha) {
+            specular_sum.a() *= shadow.w;
+        }
+    }
+
+    diffuse_sum += Common::MakeVec(lighting.global_ambient.ToVec3f(), 0.0f);
+
+    return std::make_tuple(ToColor(diffuse_sum), ToColor(specular_sum));
+}
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,17 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/pica_state.h"
+
+namespace Pica::Rasterizer {
+
+/// Generates the color of the procedural texture at the given texture coordinates
+Common::Vec4<u8> ProcTex(float u, float v, const TexturingRegs& regs,
+                         const State::ProcTex& state);
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,827 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/quaternion.h"
+#include "core/memory.h"
+#include "video_core/pica_state.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/regs_rasterizer.h"
+#include "video_core/regs_texturing.h"
+#include "video_core/swrasterizer/framebuffer.h"
+#include "video_core/swrasterizer/lighting.h"
+#include "video_core/swrasterizer/proctex.h"
+#include "video_core/swrasterizer/rasterizer.h"
+#include "video_core/swrasterizer/texturing.h"
+#include "video_core/texture/texture_decode.h"
+#include "video_core/video_core.h"
+
+namespace Pica::Rasterizer {
+
+namespace {
+
+/// Converts a screen coordinate to 12.4 fixed point
+int FloatToFix(float24 flt) {
+    // TODO: Rounding here is necessary to prevent garbage pixels at
+    //       triangle borders. Is it that the correct solution, though?
+    return static_cast<int>(std::round(flt.ToFloat32() * 16.0f));
+}
+
+/// Calculates the signed area of the triangle spanned by the three vertices, which is positive
+/// if they're in counter-clockwise order
+s64 SignedArea(const Common::Vec2<int>& vtx1, const Common::Vec2<int>& vtx2,
+               const Common::Vec2<int>& vtx3) {
+    return static_cast<s64>(vtx2.x - vtx1.x) * (vtx3.y - vtx1.y) -
+           static_cast<s64>(vtx2.y - vtx1.y) * (vtx3.x - vtx1.x);
+}
+
+// Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
+// drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
+// values which are added to the barycentric coordinates w0, w1 and w2, respectively.
+// NOTE: These are the PSP filling rules. Not sure if the 3DS uses the same ones...
+bool IsRightSideOrFlatBottomEdge(const Common::Vec2<int>& vtx, const Common::Vec2<int>& line1,
+                                 const Common::Vec2<int>& line2) {
+    if (line1.y == line2.y) {
+        // Just check if vertex is above us => bottom line parallel to x-axis
+        return vtx.y < line1.y;
+    }
+
+    // Check if vertex is on our left => right side
+    return vtx.x < line1.x + static_cast<s64>(line2.x - line1.x) * (vtx.y - line1.y) /
+                                 (line2.y - line1.y);
+}
+
+/// Converts a 3D vector for cube map coordinates to 2D texture coordinates along with the face
+std::tuple<float24, float24, float24, PAddr> ConvertCubeCoord(float24 u, float24 v, float24 w,
+                                                               const TexturingRegs& regs) {
+    const float abs_u = std::abs(u.ToFloat32());
+    const float abs_v = std::abs(v.ToFloat32());
+    const float abs_w = std::abs(w.ToFloat32());
+    float24 x, y, z;
+    PAddr addr;
+    if (abs_u > abs_v && abs_u > abs_w) {
+        if (u > float24::Zero()) {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::PositiveX);
+            y = -v;
+        } else {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::NegativeX);
+            y = v;
+        }
+        x = -w;
+        z = u;
+    } else if (abs_v > abs_w) {
+        if (v > float24::Zero()) {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::PositiveY);
+            x = u;
+        } else {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::NegativeY);
+            x = -u;
+        }
+        y = w;
+        z = v;
+    } else {
+        if (w > float24::Zero()) {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::PositiveZ);
+            y = -v;
+        } else {
+            addr = regs.GetCubePhysicalAddress(TexturingRegs::CubeFace::NegativeZ);
+            y = v;
+        }
+        x = u;
+        z = w;
+    }
+    const float24 z_abs = float24::FromFloat32(std::abs(z.ToFloat32()));
+    const float24 half = float24::FromFloat32(0.5f);
+    return std::make_tuple(x / z * half + half, y / z * half + half, z_abs, addr);
+}
+
+bool CompareValues(FramebufferRegs::CompareFunc func, u32 value, u32 ref) {
+    switch (func) {
+    case FramebufferRegs::CompareFunc::Never:
+        return false;
+    case FramebufferRegs::CompareFunc::Always:
+        return true;
+    case FramebufferRegs::CompareFunc::Equal:
+        return value == ref;
+    case FramebufferRegs::CompareFunc::NotEqual:
+        return value != ref;
+    case FramebufferRegs::CompareFunc::LessThan:
+        return value < ref;
+    case FramebufferRegs::CompareFunc::LessThanOrEqual:
+        return value <= ref;
+    case FramebufferRegs::CompareFunc::GreaterThan:
+        return value > ref;
+    case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+        return value >= ref;
+    }
+
+    return true;
+}
+
+/// Edge function of a triangle in 12.4 fixed point, w = a * x + b * y + c
+struct Edge {
+    s64 a;
+    s64 b;
+    s64 c;
+
+    Edge(const Common::Vec2<int>& from, const Common::Vec2<int>& to, int bias)
+        : a(-static_cast<s64>(to.y - from.y)), b(to.x - from.x),
+          c(static_cast<s64>(to.y - from.y) * from.x - static_cast<s64>(to.x - from.x) * from.y +
+            bias) {}
+
+    /// Evaluates the edge function at the center of a pixel
+    s64 At(int x, int y) const {
+        return a * (x * 16 + 8) + b * (y * 16 + 8) + c;
+    }
+};
+
+/// Register derived state that's the same for every pixel of a triangle
+struct DrawState {
+    DrawState()
+        : textures(g_state.regs.texturing.GetTextures()),
+          tev_stages(g_state.regs.texturing.GetTevStages()) {
+        const auto& regs = g_state.regs;
+
+        for (std::size_t i = 0; i < textures.size(); ++i) {
+            if (textures[i].enabled) {
+                texture_infos[i] =
+                    Texture::TextureInfo::FromPicaRegister(textures[i].config, textures[i].format);
+            }
+        }
+
+        stencil_action_enable =
+            regs.framebuffer.output_merger.stencil_test.enable &&
+            regs.framebuffer.framebuffer.depth_format == FramebufferRegs::DepthFormat::D24S8;
+        depth_scale = float24::FromRaw(regs.rasterizer.viewport_depth_range).ToFloat32();
+        depth_offset = float24::FromRaw(regs.rasterizer.viewport_depth_near_plane).ToFloat32();
+        depth_max = (1u << FramebufferRegs::DepthBitsPerPixel(
+                         regs.framebuffer.framebuffer.depth_format)) -
+                    1;
+
+        scissor_x1 = regs.rasterizer.scissor_test.x1 << 4;
+        scissor_y1 = regs.rasterizer.scissor_test.y1 << 4;
+        // x2,y2 have +1 added to cover the entire sub-pixel area
+        scissor_x2 = (regs.rasterizer.scissor_test.x2 + 1) << 4;
+        scissor_y2 = (regs.rasterizer.scissor_test.y2 + 1) << 4;
+    }
+
+    const std::array<TexturingRegs::FullTextureConfig, 3> textures;
+    std::array<Texture::TextureInfo, 3> texture_infos{};
+    const std::array<TexturingRegs::TevStageConfig, 6> tev_stages;
+
+    bool stencil_action_enable;
+    float depth_scale;
+    float depth_offset;
+    u32 depth_max;
+
+    int scissor_x1;
+    int scissor_y1;
+    int scissor_x2;
+    int scissor_y2;
+};
+
+/// Runs the pixel pipeline for a pixel covered by a triangle with the given edge function values
+void ProcessPixel(const Triangle& triangle, const DrawState& state, int x, int y, s64 w0, s64 w1,
+                  s64 w2) {
+    const auto& regs = g_state.regs;
+    const Vertex& v0 = triangle.vertices[0];
+    const Vertex& v1 = triangle.vertices[1];
+    const Vertex& v2 = triangle.vertices[2];
+
+    const float wsum = static_cast<float>(w0 + w1 + w2);
+    const auto baricentric_coordinates = Common::MakeVec(
+        float24::FromFloat32(static_cast<float>(w0)), float24::FromFloat32(static_cast<float>(w1)),
+        float24::FromFloat32(static_cast<float>(w2)));
+    const auto w_inverse = Common::MakeVec(v0.pos.w, v1.pos.w, v2.pos.w);
+    const float24 interpolated_w_inverse =
+        float24::FromFloat32(1.0f) / Common::Dot(w_inverse, baricentric_coordinates);
+
+    // interpolated_z = z / w
+    const float interpolated_z_over_w =
+        (v0.screenpos[2].ToFloat32() * w0 + v1.screenpos[2].ToFloat32() * w1 +
+         v2.screenpos[2].ToFloat32() * w2) /
+        wsum;
+
+    // Not fully accurate. About 3 bits in precision are missing.
+    // Z-Buffer (z / w * scale + offset)
+    float depth = interpolated_z_over_w * state.depth_scale + state.depth_offset;
+
+    // Potentially switch to W-Buffer
+    if (regs.rasterizer.depthmap_enable == RasterizerRegs::DepthBuffering::WBuffering) {
+        // W-Buffer (z * scale + w * offset = (z / w * scale + offset) * w)
+        depth *= interpolated_w_inverse.ToFloat32() * wsum;
+    }
+
+    // Clamp the result
+    depth = std::clamp(depth, 0.0f, 1.0f);
+
+    // Perspective correct attribute interpolation:
+    // Attribute values cannot be calculated by simple linear interpolation since
+    // they are not linear in screen space. For example, when interpolating a
+    // texture coordinate across two vertices, something simple like
+    //     u = (u0*w0 + u1*w1)/(w0+w1)
+    // will not work. However, the attribute value divided by the
+    // clipspace w-coordinate (u/w) and and the inverse w-coordinate (1/w) are linear
+    // in screenspace. Hence, we can linearly interpolate these two independently and
+    // calculate the interpolated attribute by dividing the results.
+    // I.e.
+    //     u_over_w   = ((u0/v0.pos.w)*w0 + (u1/v1.pos.w)*w1)/(w0+w1)
+    //     one_over_w = (( 1/v0.pos.w)*w0 + ( 1/v1.pos.w)*w1)/(w0+w1)
+    //     u = u_over_w / one_over_w
+    //
+    // The generalization to three vertices is straightforward in baricentric coordinates.
+    const auto GetInterpolatedAttribute = [&](float24 attr0, float24 attr1, float24 attr2) {
+        const auto attr_over_w = Common::MakeVec(attr0, attr1, attr2);
+        const float24 interpolated_attr_over_w = Common::Dot(attr_over_w, baricentric_coordinates);
+        return interpolated_attr_over_w * interpolated_w_inverse;
+    };
+
+    const auto GetInterpolatedColor = [&](std::size_t i) {
+        const float value =
+            GetInterpolatedAttribute(v0.color[i], v1.color[i], v2.color[i]).ToFloat32();
+        return static_cast<u8>(std::clamp(std::round(value * 255), 0.0f, 255.0f));
+    };
+
+    const Common::Vec4<u8> primary_color{GetInterpolatedColor(0), GetInterpolatedColor(1),
+                                         GetInterpolatedColor(2), GetInterpolatedColor(3)};
+
+    Common::Vec2<float24> uv[3];
+    uv[0].u() = GetInterpolatedAttribute(v0.tc0.u(), v1.tc0.u(), v2.tc0.u());
+    uv[0].v() = GetInterpolatedAttribute(v0.tc0.v(), v1.tc0.v(), v2.tc0.v());
+    uv[1].u() = GetInterpolatedAttribute(v0.tc1.u(), v1.tc1.u(), v2.tc1.u());
+    uv[1].v() = GetInterpolatedAttribute(v0.tc1.v(), v1.tc1.v(), v2.tc1.v());
+    uv[2].u() = GetInterpolatedAttribute(v0.tc2.u(), v1.tc2.u(), v2.tc2.u());
+    uv[2].v() = GetInterpolatedAttribute(v0.tc2.v(), v1.tc2.v(), v2.tc2.v());
+
+    Common::Vec4<u8> texture_color[4]{};
+    for (std::size_t i = 0; i < 3; ++i) {
+        const auto& texture = state.textures[i];
+        if (!texture.enabled) {
+            continue;
+        }
+
+        const std::size_t coordinate_i =
+            (i == 2 && regs.texturing.main_config.texture2_use_coord1) ? 1 : i;
+        float24 u = uv[coordinate_i].u();
+        float24 v = uv[coordinate_i].v();
+
+        // Only unit 0 respects the texturing type (according to 3DBrew)
+        PAddr texture_address = texture.config.GetPhysicalAddress();
+        float24 shadow_z;
+        if (i == 0) {
+            switch (texture.config.type) {
+            case TexturingRegs::TextureConfig::Texture2D:
+                break;
+            case TexturingRegs::TextureConfig::ShadowCube:
+            case TexturingRegs::TextureConfig::TextureCube: {
+                const float24 w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
+                std::tie(u, v, shadow_z, texture_address) =
+                    ConvertCubeCoord(u, v, w, regs.texturing);
+                break;
+            }
+            case TexturingRegs::TextureConfig::Projection2D: {
+                const float24 tc0_w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
+                u /= tc0_w;
+                v /= tc0_w;
+                break;
+            }
+            case TexturingRegs::TextureConfig::Shadow2D: {
+                const float24 tc0_w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
+                if (!regs.texturing.shadow.orthographic) {
+                    u /= tc0_w;
+                    v /= tc0_w;
+                }
+                shadow_z = float24::FromFloat32(std::abs(tc0_w.ToFloat32()));
+                break;
+            }
+            case TexturingRegs::TextureConfig::Disabled:
+                continue; // skip this unit and continue to the next unit
+            default:
+                LOG_ERROR(HW_GPU, "Unhandled texture type {:x}",
+                          static_cast<u32>(texture.config.type.Value()));
+                UNIMPLEMENTED();
+                break;
+            }
+        }
+
+        const int width = static_cast<int>(texture.config.width);
+        const int height = static_cast<int>(texture.config.height);
+        int s = static_cast<int>((u * float24::FromFloat32(static_cast<float>(width))).ToFloat32());
+        int t =
+            static_cast<int>((v * float24::FromFloat32(static_cast<float>(height))).ToFloat32());
+
+        bool use_border_s = false;
+        bool use_border_t = false;
+
+        if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder) {
+            use_border_s = s < 0 || s >= width;
+        } else if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder2) {
+            use_border_s = s >= width;
+        }
+
+        if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder) {
+            use_border_t = t < 0 || t >= height;
+        } else if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder2) {
+            use_border_t = t >= height;
+        }
+
+        if (use_border_s || use_border_t) {
+            const auto& border_color = texture.config.border_color;
+            texture_color[i] = Common::MakeVec(border_color.r.Value(), border_color.g.Value(),
+                                               border_color.b.Value(), border_color.a.Value())
+                                   .Cast<u8>();
+        } else {
+            // Textures are laid out from bottom to top, hence we invert the t coordinate.
+            // NOTE: This may not be the right place for the inversion.
+            // TODO: Check if this applies to ETC textures, too.
+            s = GetWrappedTexCoord(texture.config.wrap_s, s, width);
+            t = height - 1 - GetWrappedTexCoord(texture.config.wrap_t, t, height);
+
+            const u8* texture_data = VideoCore::g_memory->GetPhysicalPointer(texture_address);
+            if (texture_data != nullptr) {
+                // TODO: Apply the min and mag filters to the texture
+                texture_color[i] =
+                    Texture::LookupTexture(texture_data, s, t, state.texture_infos[i]);
+            }
+        }
+
+        if (i == 0 && (texture.config.type == TexturingRegs::TextureConfig::Shadow2D ||
+                       texture.config.type == TexturingRegs::TextureConfig::ShadowCube)) {
+            s32 z_int = static_cast<s32>(std::min(shadow_z.ToFloat32(), 1.0f) * 0xFFFFFF);
+            z_int -= regs.texturing.shadow.bias << 1;
+            const auto& color = texture_color[i];
+            const s32 z_ref = (color.w << 16) | (color.z << 8) | color.y;
+            const u8 density = z_ref >= z_int ? color.x : 0;
+            texture_color[i] = {density, density, density, density};
+        }
+    }
+
+    // Sample procedural texture
+    if (regs.texturing.main_config.texture3_enable) {
+        const auto& proctex_uv = uv[regs.texturing.main_config.texture3_coordinates];
+        texture_color[3] = ProcTex(proctex_uv.u().ToFloat32(), proctex_uv.v().ToFloat32(),
+                                   regs.texturing, g_state.proctex);
+    }
+
+    Common::Vec4<u8> primary_fragment_color = {0, 0, 0, 0};
+    Common::Vec4<u8> secondary_fragment_color = {0, 0, 0, 0};
+
+    if (!regs.lighting.disable) {
+        const Common::Quaternion<float> normquat =
+            Common::Quaternion<float>{
+                {GetInterpolatedAttribute(v0.quat.x, v1.quat.x, v2.quat.x).ToFloat32(),
+                 GetInterpolatedAttribute(v0.quat.y, v1.quat.y, v2.quat.y).ToFloat32(),
+                 GetInterpolatedAttribute(v0.quat.z, v1.quat.z, v2.quat.z).ToFloat32()},
+                GetInterpolatedAttribute(v0.quat.w, v1.quat.w, v2.quat.w).ToFloat32(),
+            }
+                .Normalized();
+
+        const Common::Vec3<float> view{
+            GetInterpolatedAttribute(v0.view.x, v1.view.x, v2.view.x).ToFloat32(),
+            GetInterpolatedAttribute(v0.view.y, v1.view.y, v2.view.y).ToFloat32(),
+            GetInterpolatedAttribute(v0.view.z, v1.view.z, v2.view.z).ToFloat32(),
+        };
+        std::tie(primary_fragment_color, secondary_fragment_color) = ComputeFragmentsColors(
+            regs.lighting, g_state.lighting, normquat, view, texture_color);
+    }
+
+    // Texture environment - consists of 6 stages of color and alpha combining.
+    //
+    // Color combiners take three input color values from some source (e.g. interpolated
+    // vertex color, texture color, previous stage, etc), perform some very simple
+    // operations on each of them (e.g. inversion) and then calculate the output color
+    // with some basic arithmetic. Alpha combiners can be configured separately but work
+    // analogously.
+    Common::Vec4<u8> combiner_output;
+    Common::Vec4<u8> combiner_buffer = {0, 0, 0, 0};
+    Common::Vec4<u8> next_combiner_buffer =
+        Common::MakeVec(regs.texturing.tev_combiner_buffer_color.r.Value(),
+                        regs.texturing.tev_combiner_buffer_color.g.Value(),
+                        regs.texturing.tev_combiner_buffer_color.b.Value(),
+                        regs.texturing.tev_combiner_buffer_color.a.Value())
+            .Cast<u8>();
+
+    for (unsigned tev_stage_index = 0; tev_stage_index < state.tev_stages.size();
+         ++tev_stage_index) {
+        const auto& tev_stage = state.tev_stages[tev_stage_index];
+        using Source = TexturingRegs::TevStageConfig::Source;
+
+        const auto GetSource = [&](Source source) -> Common::Vec4<u8> {
+            switch (source) {
+            case Source::PrimaryColor:
+                return primary_color;
+            case Source::PrimaryFragmentColor:
+                return primary_fragment_color;
+            case Source::SecondaryFragmentColor:
+                return secondary_fragment_color;
+            case Source::Texture0:
+                return texture_color[0];
+            case Source::Texture1:
+                return texture_color[1];
+            case Source::Texture2:
+                return texture_color[2];
+            case Source::Texture3:
+                return texture_color[3];
+            case Source::PreviousBuffer:
+                return combiner_buffer;
+            case Source::Constant:
+                return Common::MakeVec(tev_stage.const_r.Value(), tev_stage.const_g.Value(),
+                                       tev_stage.const_b.Value(), tev_stage.const_a.Value())
+                    .Cast<u8>();
+            case Source::Previous:
+                return combiner_output;
+            default:
+                LOG_ERROR(HW_GPU, "Unknown color combiner source {}", static_cast<u32>(source));
+                UNIMPLEMENTED();
+                return {0, 0, 0, 0};
+            }
+        };
+
+        // Color combiner
+        // NOTE: Not sure if the alpha combiner might use the color output of the previous
+        //       stage as input. Hence, we currently don't directly write the result to
+        //       combiner_output.rgb(), but instead store it in a temporary variable until
+        //       alpha combining has been done.
+        const Common::Vec3<u8> color_result[3] = {
+            GetColorModifier(tev_stage.color_modifier1, GetSource(tev_stage.color_source1)),
+            GetColorModifier(tev_stage.color_modifier2, GetSource(tev_stage.color_source2)),
+            GetColorModifier(tev_stage.color_modifier3, GetSource(tev_stage.color_source3)),
+        };
+        const Common::Vec3<u8> color_output = ColorCombine(tev_stage.color_op, color_result);
+
+        u8 alpha_output;
+        if (tev_stage.color_op == TexturingRegs::TevStageConfig::Operation::Dot3_RGBA) {
+            // Result of Dot3_RGBA operation is also placed to the alpha component
+            alpha_output = color_output.x;
+        } else {
+            // Alpha combiner
+            const std::array<u8, 3> alpha_result = {{
+                GetAlphaModifier(tev_stage.alpha_modifier1, GetSource(tev_stage.alpha_source1)),
+                GetAlphaModifier(tev_stage.alpha_modifier2, GetSource(tev_stage.alpha_source2)),
+                GetAlphaModifier(tev_stage.alpha_modifier3, GetSource(tev_stage.alpha_source3)),
+            }};
+            alpha_output = AlphaCombine(tev_stage.alpha_op, alpha_result);
+        }
+
+        combiner_output[0] = static_cast<u8>(
+            std::min(255u, color_output.r() * tev_stage.GetColorMultiplier()));
+        combiner_output[1] = static_cast<u8>(
+            std::min(255u, color_output.g() * tev_stage.GetColorMultiplier()));
+        combiner_output[2] = static_cast<u8>(
+            std::min(255u, color_output.b() * tev_stage.GetColorMultiplier()));
+        combiner_output[3] =
+            static_cast<u8>(std::min(255u, alpha_output * tev_stage.GetAlphaMultiplier()));
+
+        combiner_buffer = next_combiner_buffer;
+
+        if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferColor(
+                tev_stage_index)) {
+            next_combiner_buffer.r() = combiner_output.r();
+            next_combiner_buffer.g() = combiner_output.g();
+            next_combiner_buffer.b() = combiner_output.b();
+        }
+
+        if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferAlpha(
+                tev_stage_index)) {
+            next_combiner_buffer.a() = combiner_output.a();
+        }
+    }
+
+    const auto& output_merger = regs.framebuffer.output_merger;
+
+    // TODO: Does alpha testing happen before or after stencil?
+    if (output_merger.alpha_test.enable &&
+        !CompareValues(output_merger.alpha_test.func, combiner_output.a(),
+                       output_merger.alpha_test.ref)) {
+        return;
+    }
+
+    // Apply fog combiner
+    // Not fully accurate. We'd have to know what data type is used to
+    // store the depth etc. Using float for now until we know more
+    // about Pica datatypes
+    if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
+        const Common::Vec3<u8> fog_color = Common::MakeVec(regs.texturing.fog_color.r.Value(),
+                                                           regs.texturing.fog_color.g.Value(),
+                                                           regs.texturing.fog_color.b.Value())
+                                               .Cast<u8>();
+
+        // Get index into fog LUT
+        const float fog_index =
+            regs.texturing.fog_flip ? (1.0f - depth) * 128.0f : depth * 128.0f;
+
+        // Generate clamped fog factor from LUT for given fog index
+        const float fog_i = std::clamp(std::floor(fog_index), 0.0f, 127.0f);
+        const float fog_f = fog_index - fog_i;
+        const auto& fog_lut_entry = g_state.fog.lut[static_cast<unsigned>(fog_i)];
+        const float fog_factor =
+            std::clamp(fog_lut_entry.ToFloat() + fog_lut_entry.DiffToFloat() * fog_f, 0.0f, 1.0f);
+
+        // Blend the fog
+        for (unsigned i = 0; i < 3; i++) {
+            combiner_output[i] = static_cast<u8>(fog_factor * combiner_output[i] +
+                                                 (1.0f - fog_factor) * fog_color[i]);
+        }
+    }
+
+    const auto& stencil_test = output_merger.stencil_test;
+    u8 old_stencil = 0;
+
+    const auto UpdateStencil = [&](FramebufferRegs::StencilAction action) {
+        const u8 new_stencil =
+            PerformStencilAction(action, old_stencil, stencil_test.reference_value);
+        if (regs.framebuffer.framebuffer.allow_depth_stencil_write != 0) {
+            SetStencil(x, y,
+                       (new_stencil & stencil_test.write_mask) |
+                           (old_stencil & ~stencil_test.write_mask));
+        }
+    };
+
+    if (state.stencil_action_enable) {
+        old_stencil = GetStencil(x, y);
+        const u8 dest = old_stencil & stencil_test.input_mask;
+        const u8 ref = stencil_test.reference_value & stencil_test.input_mask;
+
+        // The reference value is on the left side of the comparison
+        if (!CompareValues(stencil_test.func, ref, dest)) {
+            UpdateStencil(stencil_test.action_stencil_fail);
+            return;
+        }
+    }
+
+    if (output_merger.fragment_operation_mode == FramebufferRegs::FragmentOperationMode::Shadow) {
+        // Use green color as stencil and skip the normal output merger pipeline
+        DrawShadowMapPixel(x, y, static_cast<u32>(depth * 0xFFFFFF), combiner_output.g());
+        return;
+    }
+
+    // Convert float to integer
+    const u32 z = static_cast<u32>(depth * state.depth_max);
+
+    if (output_merger.depth_test_enable &&
+        !CompareValues(output_merger.depth_test_func, z, GetDepth(x, y))) {
+        if (state.stencil_action_enable) {
+            UpdateStencil(stencil_test.action_depth_fail);
+        }
+        return;
+    }
+
+    if (regs.framebuffer.framebuffer.allow_depth_stencil_write != 0 &&
+        output_merger.depth_write_enable) {
+        SetDepth(x, y, z);
+    }
+
+    // The stencil depth_pass action is executed even if depth testing is disabled
+    if (state.stencil_action_enable) {
+        UpdateStencil(stencil_test.action_depth_pass);
+    }
+
+    const Common::Vec4<u8> dest = GetPixel(x, y);
+    Common::Vec4<u8> blend_output = combiner_output;
+
+    if (output_merger.alphablend_enable) {
+        const auto& params = output_merger.alpha_blending;
+        const Common::Vec4<u8> blend_const = Common::MakeVec(output_merger.blend_const.r.Value(),
+                                                             output_merger.blend_const.g.Value(),
+                                                             output_merger.blend_const.b.Value(),
+                                                             output_merger.blend_const.a.Value())
+                                                 .Cast<u8>();
+
+        const auto LookupFactor = [&](unsigned channel, FramebufferRegs::BlendFactor factor) -> u8 {
+            DEBUG_ASSERT(channel < 4);
+
+            switch (factor) {
+            case FramebufferRegs::BlendFactor::Zero:
+                return 0;
+            case FramebufferRegs::BlendFactor::One:
+                return 255;
+            case FramebufferRegs::BlendFactor::SourceColor:
+                return combiner_output[channel];
+            case FramebufferRegs::BlendFactor::OneMinusSourceColor:
+                return 255 - combiner_output[channel];
+            case FramebufferRegs::BlendFactor::DestColor:
+                return dest[channel];
+            case FramebufferRegs::BlendFactor::OneMinusDestColor:
+                return 255 - dest[channel];
+            case FramebufferRegs::BlendFactor::SourceAlpha:
+                return combiner_output.a();
+            case FramebufferRegs::BlendFactor::OneMinusSourceAlpha:
+                return 255 - combiner_output.a();
+            case FramebufferRegs::BlendFactor::DestAlpha:
+                return dest.a();
+            case FramebufferRegs::BlendFactor::OneMinusDestAlpha:
+                return 255 - dest.a();
+            case FramebufferRegs::BlendFactor::ConstantColor:
+                return blend_const[channel];
+            case FramebufferRegs::BlendFactor::OneMinusConstantColor:
+                return 255 - blend_const[channel];
+            case FramebufferRegs::BlendFactor::ConstantAlpha:
+                return blend_const.a();
+            case FramebufferRegs::BlendFactor::OneMinusConstantAlpha:
+                return 255 - blend_const.a();
+            case FramebufferRegs::BlendFactor::SourceAlphaSaturate:
+                // Returns 1.0 for the alpha channel
+                if (channel == 3) {
+                    return 255;
+                }
+                return std::min(combiner_output.a(), static_cast<u8>(255 - dest.a()));
+            default:
+                LOG_CRITICAL(HW_GPU, "Unknown blend factor {:x}", static_cast<u32>(factor));
+                UNIMPLEMENTED();
+                break;
+            }
+
+            return combiner_output[channel];
+        };
+
+        const auto srcfactor = Common::MakeVec(LookupFactor(0, params.factor_source_rgb),
+                                               LookupFactor(1, params.factor_source_rgb),
+                                               LookupFactor(2, params.factor_source_rgb),
+                                               LookupFactor(3, params.factor_source_a));
+
+        const auto dstfactor = Common::MakeVec(LookupFactor(0, params.factor_dest_rgb),
+                                               LookupFactor(1, params.factor_dest_rgb),
+                                               LookupFactor(2, params.factor_dest_rgb),
+                                               LookupFactor(3, params.factor_dest_a));
+
+        blend_output = EvaluateBlendEquation(combiner_output, srcfactor, dest, dstfactor,
+                                             params.blend_equation_rgb);
+        blend_output.a() = EvaluateBlendEquation(combiner_output, srcfactor, dest, dstfactor,
+                                                 params.blend_equation_a)
+                               .a();
+    } else {
+        blend_output = Common::MakeVec(LogicOp(combiner_output.r(), dest.r(), output_merger.logic_op),
+                                       LogicOp(combiner_output.g(), dest.g(), output_merger.logic_op),
+                                       LogicOp(combiner_output.b(), dest.b(), output_merger.logic_op),
+                                       LogicOp(combiner_output.a(), dest.a(), output_merger.logic_op));
+    }
+
+    const Common::Vec4<u8> result = {
+        output_merger.red_enable ? blend_output.r() : dest.r(),
+        output_merger.green_enable ? blend_output.g() : dest.g(),
+        output_merger.blue_enable ? blend_output.b() : dest.b(),
+        output_merger.alpha_enable ? blend_output.a() : dest.a(),
+    };
+
+    if (regs.framebuffer.framebuffer.allow_color_write != 0) {
+        DrawPixel(x, y, result);
+    }
+}
+
+} // namespace
+
+bool SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, Triangle& triangle) {
+    const auto& regs = g_state.regs;
+
+    std::array<const Vertex*, 3> vertices{&v0, &v1, &v2};
+    std::array<Common::Vec2<int>, 3> positions;
+    for (std::size_t i = 0; i < 3; ++i) {
+        positions[i] = {FloatToFix(vertices[i]->screenpos.x),
+                        FloatToFix(vertices[i]->screenpos.y)};
+    }
+
+    s64 area = SignedArea(positions[0], positions[1], positions[2]);
+
+    const auto Reverse = [&] {
+        std::swap(vertices[1], vertices[2]);
+        std::swap(positions[1], positions[2]);
+        area = -area;
+    };
+
+    switch (regs.rasterizer.cull_mode) {
+    case RasterizerRegs::CullMode::KeepAll:
+        // Make sure we always end up with a triangle wound counter-clockwise
+        if (area < 0) {
+            Reverse();
+        }
+        break;
+    case RasterizerRegs::CullMode::KeepClockWise:
+        // Reverse vertex order and use the counter-clockwise code path
+        Reverse();
+        break;
+    default:
+        break;
+    }
+
+    // Cull away triangles which are wound clockwise, along with degenerate ones
+    if (area <= 0) {
+        return false;
+    }
+
+    int min_x = std::min({positions[0].x, positions[1].x, positions[2].x});
+    int min_y = std::min({positions[0].y, positions[1].y, positions[2].y});
+    int max_x = std::max({positions[0].x, positions[1].x, positions[2].x});
+    int max_y = std::max({positions[0].y, positions[1].y, positions[2].y});
+
+    if (regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Include) {
+        // Convert the scissor box coordinates to 12.4 fixed point.
+        // x2,y2 have +1 added to cover the entire sub-pixel area.
+        min_x = std::max(min_x, static_cast<int>(regs.rasterizer.scissor_test.x1 << 4));
+        min_y = std::max(min_y, static_cast<int>(regs.rasterizer.scissor_test.y1 << 4));
+        max_x = std::min(max_x, static_cast<int>((regs.rasterizer.scissor_test.x2 + 1) << 4));
+        max_y = std::min(max_y, static_cast<int>((regs.rasterizer.scissor_test.y2 + 1) << 4));
+    }
+
+    // Pixels whose centers are within the box, never outside of the framebuffer
+    const auto& framebuffer = regs.framebuffer.framebuffer;
+    triangle.min_x = std::max(min_x >> 4, 0);
+    triangle.min_y = std::max(min_y >> 4, 0);
+    triangle.max_x = std::min((max_x + 0xF) >> 4, static_cast<int>(framebuffer.GetWidth()));
+    triangle.max_y = std::min((max_y + 0xF) >> 4, static_cast<int>(framebuffer.GetHeight()));
+
+    if (triangle.min_x >= triangle.max_x || triangle.min_y >= triangle.max_y) {
+        return false;
+    }
+
+    triangle.bias[0] =
+        IsRightSideOrFlatBottomEdge(positions[0], positions[1], positions[2]) ? -1 : 0;
+    triangle.bias[1] =
+        IsRightSideOrFlatBottomEdge(positions[1], positions[2], positions[0]) ? -1 : 0;
+    triangle.bias[2] =
+        IsRightSideOrFlatBottomEdge(positions[2], positions[0], positions[1]) ? -1 : 0;
+
+    triangle.vertices = {*vertices[0], *vertices[1], *vertices[2]};
+    triangle.positions = positions;
+    return true;
+}
+
+void DrawTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1) {
+    x0 = std::max(x0, triangle.min_x);
+    y0 = std::max(y0, triangle.min_y);
+    x1 = std::min(x1, triangle.max_x);
+    y1 = std::min(y1, triangle.max_y);
+
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    const auto& regs = g_state.regs;
+    const DrawState state;
+    const bool scissor_exclude =
+        regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Exclude;
+
+    // Edge function i is the signed area spanned by the edge opposite of vertex i and the pixel,
+    // which is the barycentric coordinate of the pixel for vertex i
+    const auto& p = triangle.positions;
+    const std::array<Edge, 3> edges{{
+        {p[1], p[2], triangle.bias[0]},
+        {p[2], p[0], triangle.bias[1]},
+        {p[0], p[1], triangle.bias[2]},
+    }};
+
+    // Walk 8x8 pixel blocks, skipping blocks that are entirely outside of an edge
+    constexpr int BLOCK_SIZE = 8;
+    for (int block_y = y0; block_y < y1; block_y += BLOCK_SIZE) {
+        const int block_y_end = std::min(block_y + BLOCK_SIZE, y1);
+
+        for (int block_x = x0; block_x < x1; block_x += BLOCK_SIZE) {
+            const int block_x_end = std::min(block_x + BLOCK_SIZE, x1);
+
+            const bool outside = std::any_of(edges.begin(), edges.end(), [&](const Edge& edge) {
+                // The edge functions are linear, so their maximum within the block is reached
+                // at a corner
+                const s64 max = edge.At(block_x, block_y) +
+                                std::max<s64>(0, edge.a * (block_x_end - 1 - block_x) * 16) +
+                                std::max<s64>(0, edge.b * (block_y_end - 1 - block_y) * 16);
+                return max < 0;
+            });
+            if (outside) {
+                continue;
+            }
+
+            for (int y = block_y; y < block_y_end; ++y) {
+                s64 w0 = edges[0].At(block_x, y);
+                s64 w1 = edges[1].At(block_x, y);
+                s64 w2 = edges[2].At(block_x, y);
+
+                for (int x = block_x; x < block_x_end;
+                     ++x, w0 += edges[0].a * 16, w1 += edges[1].a * 16, w2 += edges[2].a * 16) {
+                    // If current pixel is not covered by the current primitive
+                    if (w0 < 0 || w1 < 0 || w2 < 0) {
+                        continue;
+                    }
+
+                    // Do not process the pixel if it's inside the scissor box and the scissor
+                    // mode is set to Exclude
+                    if (scissor_exclude) {
+                        const int fx = x * 16 + 8;
+                        const int fy = y * 16 + 8;
+                        if (fx >= state.scissor_x1 && fx < state.scissor_x2 &&
+                            fy >= state.scissor_y1 && fy < state.scissor_y2) {
+                            continue;
+                        }
+                    }
+
+                    ProcessPixel(triangle, state, x, y, w0, w1, w2);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Pica::Rasterizer
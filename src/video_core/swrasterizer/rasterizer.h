@@ -0,0 +1,75 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include "common/vector_math.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica::Rasterizer {
+
+struct Vertex : Shader::OutputVertex {
+    Vertex() = default;
+    Vertex(const OutputVertex& v) : OutputVertex(v) {}
+
+    // Position after the perspective divide, in screen coordinates
+    Common::Vec3<float24> screenpos;
+
+    /**
+     * Linear interpolation of all attributes, factor 1 giving this vertex and 0 giving vtx.
+     * Can't be used after the perspective divide.
+     */
+    void Lerp(float24 factor, const Vertex& vtx) {
+        const float24 other = float24::FromFloat32(1) - factor;
+        pos = pos * factor + vtx.pos * other;
+        quat = quat * factor + vtx.quat * other;
+        color = color * factor + vtx.color * other;
+        tc0 = tc0 * factor + vtx.tc0 * other;
+        tc0_w = tc0_w * factor + vtx.tc0_w * other;
+        view = view * factor + vtx.view * other;
+        tc1 = tc1 * factor + vtx.tc1 * other;
+        tc2 = tc2 * factor + vtx.tc2 * other;
+    }
+
+    /// Linear interpolation of all attributes, factor 1 giving v0 and 0 giving v1
+    static Vertex Lerp(float24 factor, Vertex v0, const Vertex& v1) {
+        v0.Lerp(factor, v1);
+        return v0;
+    }
+};
+
+/// Triangle ready to be drawn, in counter-clockwise order
+struct Triangle {
+    /// Vertices after the perspective divide. pos.w holds 1/w and the attributes are divided by w.
+    std::array<Vertex, 3> vertices;
+
+    /// Vertex positions in 12.4 fixed point rasterizer coordinates
+    std::array<Common::Vec2<int>, 3> positions;
+
+    /// Values added to the edge functions to implement the fill rules
+    std::array<int, 3> bias;
+
+    /// Pixel bounding box, max exclusive
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+/**
+ * Culls a triangle whose vertices went through the perspective divide and computes its bounds.
+ * Uses the current PICA registers.
+ * @returns false if the triangle covers no pixels.
+ */
+bool SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, Triangle& triangle);
+
+/**
+ * Runs the pixel pipeline for the pixels of a triangle within [x0, x1) x [y0, y1).
+ * Uses the current PICA registers. Calls for disjoint rectangles can run in parallel.
+ */
+void DrawTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,99 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/logging/log.h"
+#include "common/thread_pool.h"
+#include "video_core/pica_state.h"
+#include "video_core/swrasterizer/clipper.h"
+#include "video_core/swrasterizer/swrasterizer.h"
+
+namespace VideoCore {
+
+SWRasterizer::SWRasterizer() {
+    LOG_INFO(Render_Software, "Using {} threads", Common::GetThreadPool().GetThreadCount());
+}
+
+SWRasterizer::~SWRasterizer() = default;
+
+void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
+                               const Pica::Shader::OutputVertex& v1,
+                               const Pica::Shader::OutputVertex& v2) {
+    Pica::Clipper::ProcessTriangle(v0, v1, v2, triangles);
+}
+
+void SWRasterizer::DrawTriangles() {
+    if (triangles.empty()) {
+        return;
+    }
+
+    const auto& framebuffer = Pica::g_state.regs.framebuffer.framebuffer;
+    const int tiles_x =
+        (static_cast<int>(framebuffer.GetWidth()) + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles_y =
+        (static_cast<int>(framebuffer.GetHeight()) + TILE_SIZE - 1) / TILE_SIZE;
+
+    if (tiles.size() < static_cast<std::size_t>(tiles_x * tiles_y)) {
+        tiles.resize(tiles_x * tiles_y);
+    }
+
+    // SetupTriangle already clamped the bounding boxes to the framebuffer
+    for (u32 i = 0; i < triangles.size(); ++i) {
+        const auto& triangle = triangles[i];
+        const int tile_x0 = triangle.min_x / TILE_SIZE;
+        const int tile_y0 = triangle.min_y / TILE_SIZE;
+        const int tile_x1 = (triangle.max_x - 1) / TILE_SIZE;
+        const int tile_y1 = (triangle.max_y - 1) / TILE_SIZE;
+
+        for (int tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+            for (int tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+                const u32 tile_index = tile_y * tiles_x + tile_x;
+                auto& tile = tiles[tile_index];
+                if (tile.empty()) {
+                    active_tiles.push_back(tile_index);
+                }
+                tile.push_back(i);
+            }
+        }
+    }
+
+    // Tiles don't overlap, so they're drawn in parallel
+    Common::GetThreadPool().ParallelForNoWait(active_tiles.size(), [&](std::size_t i) {
+        const u32 tile_index = active_tiles[i];
+        const int x0 = static_cast<int>(tile_index % tiles_x) * TILE_SIZE;
+        const int y0 = static_cast<int>(tile_index / tiles_x) * TILE_SIZE;
+
+        auto& tile = tiles[tile_index];
+        for (const u32 triangle_index : tile) {
+            Pica::Rasterizer::DrawTriangle(triangles[triangle_index], x0, y0, x0 + TILE_SIZE,
+                                           y0 + TILE_SIZE);
+        }
+        tile.clear();
+    });
+
+    active_tiles.clear();
+    triangles.clear();
+}
+
+void SWRasterizer::NotifyPicaRegisterChanged(u32 id) {
+    // Queued triangles are drawn with the registers as they are at draw time
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushAll() {
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushRegion(PAddr addr, u32 size) {
+    DrawTriangles();
+}
+
+void SWRasterizer::InvalidateRegion(PAddr addr, u32 size) {
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    DrawTriangles();
+}
+
+} // namespace VideoCore
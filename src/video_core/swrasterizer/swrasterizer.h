@@ -0,0 +1,45 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+#include "video_core/rasterizer_interface.h"
+#include "video_core/swrasterizer/rasterizer.h"
+
+namespace VideoCore {
+
+/**
+ * Rasterizer that runs the PICA pixel pipeline on the CPU and writes straight to emulated memory.
+ * Triangles are batched until DrawTriangles, binned into screen tiles and the tiles are drawn in
+ * parallel. Each tile draws its triangles in submission order, so the output doesn't depend on
+ * the number of threads.
+ */
+class SWRasterizer : public RasterizerInterface {
+public:
+    SWRasterizer();
+    ~SWRasterizer() override;
+
+    void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
+                     const Pica::Shader::OutputVertex& v2) override;
+    void DrawTriangles() override;
+    void NotifyPicaRegisterChanged(u32 id) override;
+    void FlushAll() override;
+    void FlushRegion(PAddr addr, u32 size) override;
+    void InvalidateRegion(PAddr addr, u32 size) override;
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
+
+private:
+    static constexpr int TILE_SIZE = 32;
+
+    std::vector<Pica::Rasterizer::Triangle> triangles;
+
+    /// Indices into triangles for each tile, in submission order
+    std::vector<std::vector<u32>> tiles;
+
+    /// Tiles that have at least one triangle
+    std::vector<u32> active_tiles;
+};
+
+} // namespace VideoCore
@@ -0,0 +1,194 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "video_core/swrasterizer/texturing.h"
+
+namespace Pica::Rasterizer {
+
+using TevStageConfig = TexturingRegs::TevStageConfig;
+
+int GetWrappedTexCoord(TexturingRegs::TextureConfig::WrapMode mode, int val, unsigned size) {
+    switch (mode) {
+    case TexturingRegs::TextureConfig::ClampToEdge2:
+        // For negative coordinate, ClampToEdge2 behaves the same as Repeat
+        if (val < 0) {
+            return static_cast<int>(static_cast<unsigned>(val) % size);
+        }
+        [[fallthrough]];
+    case TexturingRegs::TextureConfig::ClampToEdge:
+        return std::clamp(val, 0, static_cast<int>(size) - 1);
+    case TexturingRegs::TextureConfig::ClampToBorder:
+        return val;
+    case TexturingRegs::TextureConfig::ClampToBorder2:
+        // For ClampToBorder2, the case of positive coordinate beyond the texture size is already
+        // handled outside. Here we only handle the negative coordinate in the same way as Repeat.
+    case TexturingRegs::TextureConfig::Repeat2:
+    case TexturingRegs::TextureConfig::Repeat3:
+    case TexturingRegs::TextureConfig::Repeat:
+        return static_cast<int>(static_cast<unsigned>(val) % size);
+    case TexturingRegs::TextureConfig::MirroredRepeat: {
+        unsigned coord = static_cast<unsigned>(val) % (2 * size);
+        if (coord >= size) {
+            coord = 2 * size - 1 - coord;
+        }
+        return static_cast<int>(coord);
+    }
+    default:
+        LOG_ERROR(HW_GPU, "Unknown texture coordinate wrapping mode {:x}",
+                  static_cast<u32>(mode));
+        UNIMPLEMENTED();
+        return 0;
+    }
+}
+
+Common::Vec3<u8> GetColorModifier(TevStageConfig::ColorModifier factor,
+                                  const Common::Vec4<u8>& values) {
+    using ColorModifier = TevStageConfig::ColorModifier;
+
+    const Common::Vec3<u8> one(255, 255, 255);
+
+    switch (factor) {
+    case ColorModifier::SourceColor:
+        return values.rgb();
+    case ColorModifier::OneMinusSourceColor:
+        return (one - values.rgb()).Cast<u8>();
+    case ColorModifier::SourceAlpha:
+        return values.aaa();
+    case ColorModifier::OneMinusSourceAlpha:
+        return (one - values.aaa()).Cast<u8>();
+    case ColorModifier::SourceRed:
+        return values.rrr();
+    case ColorModifier::OneMinusSourceRed:
+        return (one - values.rrr()).Cast<u8>();
+    case ColorModifier::SourceGreen:
+        return values.ggg();
+    case ColorModifier::OneMinusSourceGreen:
+        return (one - values.ggg()).Cast<u8>();
+    case ColorModifier::SourceBlue:
+        return values.bbb();
+    case ColorModifier::OneMinusSourceBlue:
+        return (one - values.bbb()).Cast<u8>();
+    }
+
+    UNREACHABLE();
+    return values.rgb();
+}
+
+u8 GetAlphaModifier(TevStageConfig::AlphaModifier factor, const Common::Vec4<u8>& values) {
+    using AlphaModifier = TevStageConfig::AlphaModifier;
+
+    switch (factor) {
+    case AlphaModifier::SourceAlpha:
+        return values.a();
+    case AlphaModifier::OneMinusSourceAlpha:
+        return 255 - values.a();
+    case AlphaModifier::SourceRed:
+        return values.r();
+    case AlphaModifier::OneMinusSourceRed:
+        return 255 - values.r();
+    case AlphaModifier::SourceGreen:
+        return values.g();
+    case AlphaModifier::OneMinusSourceGreen:
+        return 255 - values.g();
+    case AlphaModifier::SourceBlue:
+        return values.b();
+    case AlphaModifier::OneMinusSourceBlue:
+        return 255 - values.b();
+    }
+
+    UNREACHABLE();
+    return values.a();
+}
+
+Common::Vec3<u8> ColorCombine(TevStageConfig::Operation op, const Common::Vec3<u8> input[3]) {
+    using Operation = TevStageConfig::Operation;
+
+    const auto clamp = [](const Common::Vec3<int>& value) {
+        return Common::Vec3<u8>(static_cast<u8>(std::clamp(value.r(), 0, 255)),
+                                static_cast<u8>(std::clamp(value.g(), 0, 255)),
+                                static_cast<u8>(std::clamp(value.b(), 0, 255)));
+    };
+
+    const Common::Vec3<int> in0 = input[0].Cast<int>();
+    const Common::Vec3<int> in1 = input[1].Cast<int>();
+    const Common::Vec3<int> in2 = input[2].Cast<int>();
+
+    switch (op) {
+    case Operation::Replace:
+        return input[0];
+    case Operation::Modulate:
+        return ((in0 * in1) / 255).Cast<u8>();
+    case Operation::Add:
+        return clamp(in0 + in1);
+    case Operation::AddSigned:
+        // TODO(bunnei): Verify that the color conversion from (float) 0.5f to (byte) 128 is
+        // correct
+        return clamp(in0 + in1 - Common::MakeVec(128, 128, 128));
+    case Operation::Lerp:
+        return ((in0 * in2 + in1 * (Common::MakeVec(255, 255, 255) - in2)) / 255).Cast<u8>();
+    case Operation::Subtract:
+        return clamp(in0 - in1);
+    case Operation::MultiplyThenAdd:
+        return clamp((in0 * in1 + in2 * 255) / 255);
+    case Operation::AddThenMultiply: {
+        const Common::Vec3<int> sum = clamp(in0 + in1).Cast<int>();
+        return ((sum * in2) / 255).Cast<u8>();
+    }
+    case Operation::Dot3_RGB:
+    case Operation::Dot3_RGBA: {
+        // Not fully accurate. Worst case scenario seems to yield a +/-3 error. Some HW results
+        // indicate that the per-component computation can't have a higher precision than 1/256,
+        // while dot3_rgb((0x80,g0,b0), (0x7F,g1,b1)) and dot3_rgb((0x80,g0,b0), (0x80,g1,b1)) give
+        // different results.
+        int result = ((in0.r() * 2 - 255) * (in1.r() * 2 - 255) + 128) / 256 +
+                     ((in0.g() * 2 - 255) * (in1.g() * 2 - 255) + 128) / 256 +
+                     ((in0.b() * 2 - 255) * (in1.b() * 2 - 255) + 128) / 256;
+        result = std::clamp(result, 0, 255);
+        return Common::Vec3<u8>(static_cast<u8>(result), static_cast<u8>(result),
+                                static_cast<u8>(result));
+    }
+    default:
+        LOG_ERROR(HW_GPU, "Unknown color combiner operation {}", static_cast<u32>(op));
+        UNIMPLEMENTED();
+        return {0, 0, 0};
+    }
+}
+
+u8 AlphaCombine(TevStageConfig::Operation op, const std::array<u8, 3>& input) {
+    using Operation = TevStageConfig::Operation;
+
+    const int in0 = input[0];
+    const int in1 = input[1];
+    const int in2 = input[2];
+
+    switch (op) {
+    case Operation::Replace:
+        return input[0];
+    case Operation::Modulate:
+        return static_cast<u8>(in0 * in1 / 255);
+    case Operation::Add:
+        return static_cast<u8>(std::min(255, in0 + in1));
+    case Operation::AddSigned:
+        // TODO(bunnei): Verify that the color conversion from (float) 0.5f to (byte) 128 is
+        // correct
+        return static_cast<u8>(std::clamp(in0 + in1 - 128, 0, 255));
+    case Operation::Lerp:
+        return static_cast<u8>((in0 * in2 + in1 * (255 - in2)) / 255);
+    case Operation::Subtract:
+        return static_cast<u8>(std::max(0, in0 - in1));
+    case Operation::MultiplyThenAdd:
+        return static_cast<u8>(std::min(255, (in0 * in1 + 255 * in2) / 255));
+    case Operation::AddThenMultiply:
+        return static_cast<u8>((std::min(255, in0 + in1) * in2) / 255);
+    default:
+        LOG_ERROR(HW_GPU, "Unknown alpha combiner operation {}", static_cast<u32>(op));
+        UNIMPLEMENTED();
+        return 0;
+    }
+}
+
+} // namespace Pica::Rasterizer
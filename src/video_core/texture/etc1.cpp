@@ -124,4 +124,56 @@ Common::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y) {
     return tile.GetRGB(x, y);
 }
 
+void DecodeETC1Subtile(u64 value, std::array<Common::Vec3<u8>, 16>& texels) {
+    const ETC1Tile tile{value};
+
+    // Base colors of the two halves of the subtile
+    std::array<Common::Vec3<int>, 2> base;
+    if (tile.differential_mode) {
+        const Common::Vec3<int> first{static_cast<int>(tile.differential.r),
+                                      static_cast<int>(tile.differential.g),
+                                      static_cast<int>(tile.differential.b)};
+        const Common::Vec3<int> second =
+            first + Common::Vec3<int>{static_cast<int>(tile.differential.dr),
+                                      static_cast<int>(tile.differential.dg),
+                                      static_cast<int>(tile.differential.db)};
+        for (std::size_t i = 0; i < 3; ++i) {
+            base[0][i] = Color::Convert5To8(static_cast<u8>(first[i]));
+            base[1][i] = Color::Convert5To8(static_cast<u8>(second[i]));
+        }
+    } else {
+        base[0] = {Color::Convert4To8(static_cast<u8>(tile.separate.r1)),
+                   Color::Convert4To8(static_cast<u8>(tile.separate.g1)),
+                   Color::Convert4To8(static_cast<u8>(tile.separate.b1))};
+        base[1] = {Color::Convert4To8(static_cast<u8>(tile.separate.r2)),
+                   Color::Convert4To8(static_cast<u8>(tile.separate.g2)),
+                   Color::Convert4To8(static_cast<u8>(tile.separate.b2))};
+    }
+
+    // Colors each half can take, indexed by the table subindex and the negation flag of a texel
+    std::array<std::array<Common::Vec3<u8>, 4>, 2> colors;
+    const std::array<unsigned, 2> table_indices{static_cast<unsigned>(tile.table_index_1),
+                                                static_cast<unsigned>(tile.table_index_2)};
+    for (std::size_t half = 0; half < 2; ++half) {
+        for (unsigned index = 0; index < 4; ++index) {
+            int modifier = etc1_modifier_table[table_indices[half]][index & 1];
+            if (index & 2) {
+                modifier = -modifier;
+            }
+            for (std::size_t i = 0; i < 3; ++i) {
+                colors[half][index][i] =
+                    static_cast<u8>(std::clamp(base[half][i] + modifier, 0, 255));
+            }
+        }
+    }
+
+    for (unsigned texel = 0; texel < 16; ++texel) {
+        const unsigned x = texel / 4;
+        const unsigned y = texel % 4;
+        const std::size_t half = ((tile.flip ? y : x) >= 2) ? 1 : 0;
+        const unsigned index = tile.GetTableSubIndex(texel) | (tile.GetNegationFlag(texel) << 1);
+        texels[texel] = colors[half][index];
+    }
+}
+
 } // namespace Pica::Texture
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include "common/common_types.h"
 #include "common/vector_math.h"
 
@@ -11,4 +12,10 @@ namespace Pica::Texture {
 
 Common::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y);
 
+/**
+ * Decodes all texels of a 4x4 ETC1 subtile at once.
+ * @param texels Receives the colors, the one at x, y at index 4 * x + y like in the subtile
+ */
+void DecodeETC1Subtile(u64 value, std::array<Common::Vec3<u8>, 16>& texels);
+
 } // namespace Pica::Texture
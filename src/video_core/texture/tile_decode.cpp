@@ -0,0 +1,320 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstring>
+#include <emmintrin.h>
+#include "common/color.h"
+#include "common/logging/log.h"
+#include "common/swap.h"
+#include "common/thread_pool.h"
+#include "common/vector_math.h"
+#include "video_core/texture/etc1.h"
+#include "video_core/texture/tile_decode.h"
+#include "video_core/utils.h"
+
+using TextureFormat = Pica::TexturingRegs::TextureFormat;
+
+namespace Pica::Texture {
+
+namespace {
+
+/// RGBA8 texels of a tile in Morton order, red in the lowest byte
+using TileTexels = std::array<u32, 64>;
+
+/// Regions with at least this many texels are decoded in parallel
+constexpr std::size_t MIN_PARALLEL_TEXELS = 128 * 128;
+
+/**
+ * Offsets in a Morton ordered tile of the texel pairs (0, y), (2, y), (4, y) and (6, y) for every
+ * row y. The texels x and x + 1 of a pair are adjacent in Morton order.
+ */
+constexpr std::array<u8, 32> pair_offsets = [] {
+    std::array<u8, 32> offsets{};
+    for (u32 y = 0; y < 8; ++y) {
+        for (u32 x = 0; x < 8; x += 2) {
+            offsets[y * 4 + x / 2] = static_cast<u8>(VideoCore::MortonInterleave(x, y));
+        }
+    }
+    return offsets;
+}();
+
+// The kernels below work on 16-bit lanes, each holding one channel of a texel. Two such vectors,
+// with red/green and blue/alpha packed as low/high bytes, are interleaved into RGBA8 texels.
+
+__m128i Expand1To8(__m128i value) {
+    return _mm_and_si128(_mm_sub_epi16(_mm_setzero_si128(), value), _mm_set1_epi16(0xFF));
+}
+
+__m128i Expand4To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 4), value);
+}
+
+__m128i Expand5To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+__m128i Expand6To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 2), _mm_srli_epi16(value, 4));
+}
+
+/// Packs two channels into the low and high bytes of each lane
+__m128i PackChannels(__m128i low, __m128i high) {
+    return _mm_or_si128(low, _mm_slli_epi16(high, 8));
+}
+
+/// Stores 8 texels from their red/green and blue/alpha lanes
+void StoreTexels(u32* dest, __m128i rg, __m128i ba) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), _mm_unpackhi_epi16(rg, ba));
+}
+
+__m128i Mask(u16 mask) {
+    return _mm_set1_epi16(mask);
+}
+
+/// Decodes a tile of a 16 bits per texel format, `expand` turns 8 texels into rg and ba lanes
+template <typename Expand>
+void Decode16(const u8* source, TileTexels& texels, Expand expand) {
+    for (std::size_t i = 0; i < texels.size(); i += 8) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        __m128i rg, ba;
+        expand(pixels, rg, ba);
+        StoreTexels(&texels[i], rg, ba);
+    }
+}
+
+/// Decodes a tile of an 8 bits per texel format, `expand` turns 8 texels into rg and ba lanes
+template <typename Expand>
+void Decode8(const u8* source, TileTexels& texels, Expand expand) {
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t i = 0; i < texels.size(); i += 16) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i rg, ba;
+        expand(_mm_unpacklo_epi8(pixels, zero), rg, ba);
+        StoreTexels(&texels[i], rg, ba);
+        expand(_mm_unpackhi_epi8(pixels, zero), rg, ba);
+        StoreTexels(&texels[i + 8], rg, ba);
+    }
+}
+
+/**
+ * Decodes a tile of a 4 bits per texel format, `expand` turns 8 texels already expanded to 8 bits
+ * into rg and ba lanes. The first texel of a byte is in its low nibble.
+ */
+template <typename Expand>
+void Decode4(const u8* source, TileTexels& texels, Expand expand) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_nibbles = _mm_set1_epi8(0x0F);
+    for (std::size_t i = 0; i < texels.size(); i += 32) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i / 2));
+        const __m128i first = _mm_and_si128(pixels, low_nibbles);
+        const __m128i second = _mm_and_si128(_mm_srli_epi16(pixels, 4), low_nibbles);
+
+        const std::array<__m128i, 2> nibbles{_mm_unpacklo_epi8(first, second),
+                                             _mm_unpackhi_epi8(first, second)};
+        for (std::size_t half = 0; half < 2; ++half) {
+            __m128i rg, ba;
+            expand(Expand4To8(_mm_unpacklo_epi8(nibbles[half], zero)), rg, ba);
+            StoreTexels(&texels[i + half * 16], rg, ba);
+            expand(Expand4To8(_mm_unpackhi_epi8(nibbles[half], zero)), rg, ba);
+            StoreTexels(&texels[i + half * 16 + 8], rg, ba);
+        }
+    }
+}
+
+void DecodeRGBA8(const u8* source, TileTexels& texels) {
+    // Texels are stored as ABGR, reverse the bytes of each one
+    for (std::size_t i = 0; i < texels.size(); i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+        __m128i swapped = _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8));
+        swapped = _mm_shufflelo_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+        swapped = _mm_shufflehi_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&texels[i]), swapped);
+    }
+}
+
+void DecodeRGB8(const u8* source, TileTexels& texels) {
+    for (std::size_t i = 0; i < texels.size(); ++i, source += 3) {
+        texels[i] = source[2] | (source[1] << 8) | (source[0] << 16) | 0xFF000000;
+    }
+}
+
+void DecodeETC1(const u8* source, TileTexels& texels, bool has_alpha) {
+    std::array<Common::Vec3<u8>, 16> colors;
+
+    // ETC1 further subdivides each 8x8 tile into four 4x4 subtiles
+    for (u32 subtile = 0; subtile < 4; ++subtile) {
+        const u32 subtile_x = (subtile % 2) * 4;
+        const u32 subtile_y = (subtile / 2) * 4;
+
+        u64_le packed_alpha = 0xFFFFFFFFFFFFFFFF;
+        if (has_alpha) {
+            std::memcpy(&packed_alpha, source, sizeof(u64));
+            source += sizeof(u64);
+        }
+
+        u64_le subtile_data;
+        std::memcpy(&subtile_data, source, sizeof(u64));
+        source += sizeof(u64);
+
+        DecodeETC1Subtile(subtile_data, colors);
+
+        for (u32 texel = 0; texel < 16; ++texel) {
+            const u32 alpha = Color::Convert4To8((packed_alpha >> (4 * texel)) & 0xF);
+            const Common::Vec3<u8>& color = colors[texel];
+            texels[VideoCore::MortonInterleave(subtile_x + texel / 4, subtile_y + texel % 4)] =
+                color.r() | (color.g() << 8) | (color.b() << 16) | (alpha << 24);
+        }
+    }
+}
+
+void DecodeTileTexels(TextureFormat format, const u8* source, TileTexels& texels) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+        DecodeRGBA8(source, texels);
+        break;
+
+    case TextureFormat::RGB8:
+        DecodeRGB8(source, texels);
+        break;
+
+    case TextureFormat::RGB5A1:
+        Decode16(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            const __m128i r = _mm_srli_epi16(pixels, 11);
+            const __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 6), Mask(0x1F));
+            const __m128i b = _mm_and_si128(_mm_srli_epi16(pixels, 1), Mask(0x1F));
+            const __m128i a = _mm_and_si128(pixels, Mask(0x1));
+            rg = PackChannels(Expand5To8(r), Expand5To8(g));
+            ba = PackChannels(Expand5To8(b), Expand1To8(a));
+        });
+        break;
+
+    case TextureFormat::RGB565:
+        Decode16(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            const __m128i r = _mm_srli_epi16(pixels, 11);
+            const __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 5), Mask(0x3F));
+            const __m128i b = _mm_and_si128(pixels, Mask(0x1F));
+            rg = PackChannels(Expand5To8(r), Expand6To8(g));
+            ba = _mm_or_si128(Expand5To8(b), Mask(0xFF00));
+        });
+        break;
+
+    case TextureFormat::RGBA4:
+        Decode16(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            const __m128i r = _mm_srli_epi16(pixels, 12);
+            const __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 8), Mask(0xF));
+            const __m128i b = _mm_and_si128(_mm_srli_epi16(pixels, 4), Mask(0xF));
+            const __m128i a = _mm_and_si128(pixels, Mask(0xF));
+            rg = PackChannels(Expand4To8(r), Expand4To8(g));
+            ba = PackChannels(Expand4To8(b), Expand4To8(a));
+        });
+        break;
+
+    case TextureFormat::IA8:
+        Decode16(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            const __m128i i = _mm_srli_epi16(pixels, 8);
+            rg = PackChannels(i, i);
+            ba = _mm_or_si128(i, _mm_slli_epi16(pixels, 8));
+        });
+        break;
+
+    case TextureFormat::RG8:
+        Decode16(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            rg = _mm_or_si128(_mm_srli_epi16(pixels, 8), _mm_slli_epi16(pixels, 8));
+            ba = Mask(0xFF00);
+        });
+        break;
+
+    case TextureFormat::I8:
+        Decode8(source, texels, [](__m128i i, __m128i& rg, __m128i& ba) {
+            rg = PackChannels(i, i);
+            ba = _mm_or_si128(i, Mask(0xFF00));
+        });
+        break;
+
+    case TextureFormat::A8:
+        Decode8(source, texels, [](__m128i a, __m128i& rg, __m128i& ba) {
+            rg = _mm_setzero_si128();
+            ba = _mm_slli_epi16(a, 8);
+        });
+        break;
+
+    case TextureFormat::IA4:
+        Decode8(source, texels, [](__m128i pixels, __m128i& rg, __m128i& ba) {
+            const __m128i i = Expand4To8(_mm_srli_epi16(pixels, 4));
+            const __m128i a = Expand4To8(_mm_and_si128(pixels, Mask(0xF)));
+            rg = PackChannels(i, i);
+            ba = PackChannels(i, a);
+        });
+        break;
+
+    case TextureFormat::I4:
+        Decode4(source, texels, [](__m128i i, __m128i& rg, __m128i& ba) {
+            rg = PackChannels(i, i);
+            ba = _mm_or_si128(i, Mask(0xFF00));
+        });
+        break;
+
+    case TextureFormat::A4:
+        Decode4(source, texels, [](__m128i a, __m128i& rg, __m128i& ba) {
+            rg = _mm_setzero_si128();
+            ba = _mm_slli_epi16(a, 8);
+        });
+        break;
+
+    case TextureFormat::ETC1:
+    case TextureFormat::ETC1A4:
+        DecodeETC1(source, texels, format == TextureFormat::ETC1A4);
+        break;
+
+    default:
+        LOG_ERROR(HW_GPU, "Unknown texture format: {:x}", static_cast<u32>(format));
+        texels.fill(0);
+        break;
+    }
+}
+
+} // Anonymous namespace
+
+void DecodeTile(TextureFormat format, const u8* source, u8* dest, std::ptrdiff_t dest_stride) {
+    TileTexels texels;
+    DecodeTileTexels(format, source, texels);
+
+    for (u32 y = 0; y < 8; ++y) {
+        u8* row = dest + static_cast<std::ptrdiff_t>(y) * dest_stride;
+        for (u32 pair = 0; pair < 4; ++pair) {
+            std::memcpy(row + pair * 2 * sizeof(u32), &texels[pair_offsets[y * 4 + pair]],
+                        2 * sizeof(u32));
+        }
+    }
+}
+
+void DecodeTiles(const u8* source, const TextureInfo& info, u32 first_column, u32 last_column,
+                 u32 first_row, u32 last_row, u8* dest, std::ptrdiff_t dest_stride) {
+    const std::size_t tile_size = CalculateTileSize(info.format);
+
+    const auto decode_row = [&](std::size_t index) {
+        const u32 row = first_row + static_cast<u32>(index);
+        const u8* tile = source + row * info.stride + first_column * tile_size;
+        u8* row_dest = dest + static_cast<std::ptrdiff_t>(row) * 8 * dest_stride;
+        for (u32 column = first_column; column < last_column; ++column, tile += tile_size) {
+            DecodeTile(info.format, tile, row_dest + column * 8 * sizeof(u32), dest_stride);
+        }
+    };
+
+    const std::size_t num_rows = last_row - first_row;
+    const std::size_t num_texels = num_rows * (last_column - first_column) * 64;
+    if (num_texels >= MIN_PARALLEL_TEXELS) {
+        // Decodes on this thread alone while another loop uses the pool
+        Common::GetThreadPool().ParallelForNoWait(num_rows, decode_row);
+        return;
+    }
+
+    for (std::size_t index = 0; index < num_rows; ++index) {
+        decode_row(index);
+    }
+}
+
+} // namespace Pica::Texture
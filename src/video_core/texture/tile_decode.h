@@ -0,0 +1,38 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include "common/common_types.h"
+#include "video_core/regs_texturing.h"
+#include "video_core/texture/texture_decode.h"
+
+namespace Pica::Texture {
+
+/**
+ * Decodes a whole 8x8 tile to RGBA8.
+ * @param format Format of the tile
+ * @param source Pointer to the beginning of the tile
+ * @param dest Destination of the texel at x = 0, y = 0 of the tile, where y = 0 is the row that is
+ *             first in memory
+ * @param dest_stride Distance in bytes from a destination row to the next, negative to flip the
+ *                    tile vertically
+ */
+void DecodeTile(TexturingRegs::TextureFormat format, const u8* source, u8* dest,
+                std::ptrdiff_t dest_stride);
+
+/**
+ * Decodes the tile columns [first_column, last_column) of the tile rows [first_row, last_row) of a
+ * texture to RGBA8, spreading large regions across threads.
+ * @param source Pointer to the texture data
+ * @param info TextureInfo describing the texture
+ * @param dest Destination of the texel at x = 0, y = 0 of the texture
+ * @param dest_stride Distance in bytes from a destination row to the next, negative to flip the
+ *                    texture vertically
+ */
+void DecodeTiles(const u8* source, const TextureInfo& info, u32 first_column, u32 last_column,
+                 u32 first_row, u32 last_row, u8* dest, std::ptrdiff_t dest_stride);
+
+} // namespace Pica::Texture
@@ -2,12 +2,17 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <boost/range/algorithm/fill.hpp>
+#include <array>
+#include <cstring>
+#include <emmintrin.h>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include "common/alignment.h"
 #include "common/assert.h"
 #include "common/bit_field.h"
 #include "common/common_types.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/vector_math.h"
 #include "core/memory.h"
@@ -20,16 +25,72 @@
 
 namespace Pica {
 
+namespace {
+
+template <typename T, u32 N>
+void LoadAttribute(const u8* data, Common::Vec4<float24>& attribute) {
+    // float24 holds a float32, so the converted vector can be stored as is
+    static_assert(sizeof(Common::Vec4<float24>) == sizeof(__m128), "float24 is not a float");
+
+    if constexpr (std::is_same_v<T, float>) {
+        float values[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        std::memcpy(values, data, N * sizeof(float));
+        std::memcpy(&attribute, values, sizeof(values));
+    } else {
+        // Only read the elements of the attribute, the others are zero
+        T elements[8 / sizeof(T)]{};
+        std::memcpy(elements, data, N * sizeof(T));
+
+        __m128i integers = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(elements));
+        if constexpr (sizeof(T) == 1) {
+            // Move each byte to the top of its 32-bit lane, then extend it
+            integers = _mm_unpacklo_epi8(integers, integers);
+            integers = _mm_unpacklo_epi16(integers, integers);
+            integers = std::is_signed_v<T> ? _mm_srai_epi32(integers, 24)
+                                           : _mm_srli_epi32(integers, 24);
+        } else {
+            integers = _mm_unpacklo_epi16(integers, integers);
+            integers = _mm_srai_epi32(integers, 16);
+        }
+
+        __m128 values = _mm_cvtepi32_ps(integers);
+        if constexpr (N < 4) {
+            // The missing W element converted to 0.0, set it to 1.0
+            values = _mm_or_ps(values, _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+        }
+        _mm_storeu_ps(reinterpret_cast<float*>(&attribute), values);
+    }
+}
+
+template <typename T>
+constexpr std::array<VertexLoader::AttributeLoadFunction, 4> MakeLoadFunctions() {
+    return {&LoadAttribute<T, 1>, &LoadAttribute<T, 2>, &LoadAttribute<T, 3>,
+            &LoadAttribute<T, 4>};
+}
+
+VertexLoader::AttributeLoadFunction GetLoadFunction(PipelineRegs::VertexAttributeFormat format,
+                                                    u32 elements) {
+    // Indexed by VertexAttributeFormat and number of elements minus 1
+    static constexpr std::array<std::array<VertexLoader::AttributeLoadFunction, 4>, 4> functions{{
+        MakeLoadFunctions<s8>(),
+        MakeLoadFunctions<u8>(),
+        MakeLoadFunctions<s16>(),
+        MakeLoadFunctions<float>(),
+    }};
+    return functions[static_cast<u32>(format)][elements - 1];
+}
+
+} // namespace
+
 void VertexLoader::Setup(const PipelineRegs& regs) {
     ASSERT_MSG(!is_setup, "VertexLoader is not intended to be setup more than once.");
     const auto& attribute_config = regs.vertex_attributes;
     num_total_attributes = attribute_config.GetNumTotalAttributes();
 
-    boost::fill(vertex_attribute_sources, 0xdeadbeef);
-
-    for (int i = 0; i < 16; i++) {
-        vertex_attribute_is_default[i] = attribute_config.IsDefaultAttribute(i);
-    }
+    // Loader and offset in its vertices of each attribute
+    std::array<int, 16> attribute_loaders;
+    std::array<u32, 16> attribute_offsets{};
+    attribute_loaders.fill(-1);
 
     // Setup attribute data from loaders
     for (int loader = 0; loader < 12; ++loader) {
@@ -50,13 +111,8 @@ void VertexLoader::Setup(const PipelineRegs& regs) {
             if (attribute_index < 12) {
                 offset = Common::AlignUp(offset,
                                          attribute_config.GetElementSizeInBytes(attribute_index));
-                vertex_attribute_sources[attribute_index] = loader_config.data_offset + offset;
-                vertex_attribute_strides[attribute_index] =
-                    static_cast<u32>(loader_config.byte_count);
-                vertex_attribute_formats[attribute_index] =
-                    attribute_config.GetFormat(attribute_index);
-                vertex_attribute_elements[attribute_index] =
-                    attribute_config.GetNumElements(attribute_index);
+                attribute_loaders[attribute_index] = loader;
+                attribute_offsets[attribute_index] = offset;
                 offset += attribute_config.GetStride(attribute_index);
             } else if (attribute_index < 16) {
                 // Attribute ids 12, 13, 14 and 15 signify 4, 8, 12 and 16-byte paddings,
@@ -70,83 +126,113 @@ void VertexLoader::Setup(const PipelineRegs& regs) {
         }
     }
 
+    // Resolve everything that doesn't depend on the vertex once, so loading a vertex only has to
+    // convert its data
+    std::array<int, 12> loader_arrays;
+    loader_arrays.fill(-1);
+
+    for (int i = 0; i < num_total_attributes; ++i) {
+        const int loader = attribute_loaders[i];
+        if (loader != -1) {
+            if (loader_arrays[loader] == -1) {
+                const auto& loader_config = attribute_config.attribute_loaders[loader];
+                loader_arrays[loader] = static_cast<int>(num_arrays);
+                arrays[num_arrays++] = {loader_config.data_offset,
+                                        static_cast<u32>(loader_config.byte_count)};
+            }
+
+            const u32 elements = attribute_config.GetNumElements(i);
+            array_attributes[num_array_attributes++] = {
+                static_cast<u32>(i), static_cast<u32>(loader_arrays[loader]),
+                attribute_offsets[i], elements,
+                GetLoadFunction(attribute_config.GetFormat(i), elements)};
+        } else if (attribute_config.IsDefaultAttribute(i)) {
+            default_attributes[num_default_attributes++] = static_cast<u32>(i);
+        } else {
+            // TODO(yuriks): In this case, no data gets loaded and the vertex
+            // remains with the last value it had. This isn't currently maintained
+            // as global state, however, and so won't work in vvctre yet.
+        }
+    }
+
     is_setup = true;
 }
 
 void VertexLoader::LoadVertex(u32 base_address, int index, int vertex,
-                              Shader::AttributeBuffer& input) {
+                              Shader::AttributeBuffer& input) const {
+    const u32 index_u32 = static_cast<u32>(index);
+    const u32 vertex_u32 = static_cast<u32>(vertex);
+    LoadVertices(base_address, &index_u32, &vertex_u32, 1, &input);
+}
+
+void VertexLoader::LoadVertices(u32 base_address, const u32* indices, const u32* vertices,
+                                std::size_t count, Shader::AttributeBuffer* inputs) const {
     ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
 
-    for (int i = 0; i < num_total_attributes; ++i) {
-        if (vertex_attribute_elements[i] != 0) {
-            // Load per-vertex data from the loader arrays
-            u32 source_addr =
-                base_address + vertex_attribute_sources[i] + vertex_attribute_strides[i] * vertex;
-
-            switch (vertex_attribute_formats[i]) {
-            case PipelineRegs::VertexAttributeFormat::BYTE: {
-                const s8* srcdata = reinterpret_cast<const s8*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::UBYTE: {
-                const u8* srcdata = reinterpret_cast<const u8*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::SHORT: {
-                const s16* srcdata = reinterpret_cast<const s16*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::FLOAT: {
-                const float* srcdata = reinterpret_cast<const float*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            }
+    std::array<const u8*, 12> array_data;
+
+    for (std::size_t n = 0; n < count; ++n) {
+        const u32 vertex = vertices[n];
+        Shader::AttributeBuffer& input = inputs[n];
+
+        // Look up the vertex once per array instead of once per attribute
+        for (std::size_t array = 0; array < num_arrays; ++array) {
+            array_data[array] = VideoCore::g_memory->GetPhysicalPointer(
+                base_address + arrays[array].offset + arrays[array].stride * vertex);
+        }
+
+        for (std::size_t a = 0; a < num_array_attributes; ++a) {
+            const ArrayAttribute& attribute = array_attributes[a];
+            const u32 i = attribute.index;
 
             // Default attribute values set if array elements have < 4 components. This
             // is *not* carried over from the default attribute settings even if they're
             // enabled for this attribute.
-            for (unsigned int comp = vertex_attribute_elements[i]; comp < 4; ++comp) {
-                input.attr[i][comp] =
-                    comp == 3 ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
-            }
+            attribute.load(array_data[attribute.array] + attribute.offset, input.attr[i]);
 
             LOG_TRACE(HW_GPU,
                       "Loaded {} components of attribute {:x} for vertex {:x} (index {:x}) from "
                       "0x{:08x} + 0x{:08x} + 0x{:04x}: {} {} {} {}",
-                      vertex_attribute_elements[i], i, vertex, index, base_address,
-                      vertex_attribute_sources[i], vertex_attribute_strides[i] * vertex,
-                      input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
-                      input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
-        } else if (vertex_attribute_is_default[i]) {
+                      attribute.elements, i, vertex, indices[n], base_address,
+                      arrays[attribute.array].offset + attribute.offset,
+                      arrays[attribute.array].stride * vertex, input.attr[i][0].ToFloat32(),
+                      input.attr[i][1].ToFloat32(), input.attr[i][2].ToFloat32(),
+                      input.attr[i][3].ToFloat32());
+        }
+
+        for (std::size_t d = 0; d < num_default_attributes; ++d) {
             // Load the default attribute if we're configured to do so
+            const u32 i = default_attributes[d];
             input.attr[i] = g_state.input_default_attributes.attr[i];
             LOG_TRACE(
                 HW_GPU,
                 "Loaded default attribute {:x} for vertex {:x} (index {:x}): ({}, {}, {}, {})", i,
-                vertex, index, input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
+                vertex, indices[n], input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
                 input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
-        } else {
-            // TODO(yuriks): In this case, no data gets loaded and the vertex
-            // remains with the last value it had. This isn't currently maintained
-            // as global state, however, and so won't work in vvctre yet.
         }
     }
 }
 
+const VertexLoader& GetVertexLoader(const PipelineRegs& regs) {
+    // Enough for the layouts of a few scenes, the cache is emptied when it's full
+    constexpr std::size_t MAX_CACHED_LOADERS = 256;
+    static std::unordered_map<u64, VertexLoader> cache;
+
+    // The base address comes first and doesn't affect the layout, leave it out so that vertex
+    // buffers with the same layout share a loader
+    const auto& attribute_config = regs.vertex_attributes;
+    const u64 hash =
+        Common::ComputeHash64(reinterpret_cast<const u8*>(&attribute_config) + sizeof(u32),
+                              sizeof(attribute_config) - sizeof(u32));
+
+    auto iter = cache.find(hash);
+    if (iter == cache.end()) {
+        if (cache.size() >= MAX_CACHED_LOADERS) {
+            cache.clear();
+        }
+        iter = cache.emplace(hash, VertexLoader(regs)).first;
+    }
+    return iter->second;
+}
+
 } // namespace Pica
@@ -5,7 +5,10 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/pica_types.h"
 #include "video_core/regs_pipeline.h"
 
 namespace Pica {
@@ -16,26 +19,59 @@ struct AttributeBuffer;
 
 class VertexLoader {
 public:
+    /// Converts the elements of an attribute to float24, filling the missing ones with (0, 0, 0, 1)
+    using AttributeLoadFunction = void (*)(const u8* data, Common::Vec4<float24>& attribute);
+
     VertexLoader() = default;
     explicit VertexLoader(const PipelineRegs& regs) {
         Setup(regs);
     }
 
     void Setup(const PipelineRegs& regs);
-    void LoadVertex(u32 base_address, int index, int vertex, Shader::AttributeBuffer& input);
+    void LoadVertex(u32 base_address, int index, int vertex, Shader::AttributeBuffer& input) const;
+
+    /**
+     * Loads several vertices at once.
+     * @param indices Index of each vertex in the draw, only used for logging
+     * @param vertices Vertex to load for each input
+     */
+    void LoadVertices(u32 base_address, const u32* indices, const u32* vertices,
+                      std::size_t count, Shader::AttributeBuffer* inputs) const;
 
     int GetNumTotalAttributes() const {
         return num_total_attributes;
     }
 
 private:
-    std::array<u32, 16> vertex_attribute_sources;
-    std::array<u32, 16> vertex_attribute_strides{};
-    std::array<PipelineRegs::VertexAttributeFormat, 16> vertex_attribute_formats;
-    std::array<u32, 16> vertex_attribute_elements{};
-    std::array<bool, 16> vertex_attribute_is_default;
+    /// Vertex array of an attribute loader
+    struct AttributeArray {
+        u32 offset;
+        u32 stride;
+    };
+
+    /// Attribute loaded from a vertex array, with the conversion for its format and size
+    struct ArrayAttribute {
+        u32 index;
+        u32 array;
+        u32 offset;
+        u32 elements;
+        AttributeLoadFunction load;
+    };
+
+    std::array<AttributeArray, 12> arrays;
+    std::array<ArrayAttribute, 16> array_attributes;
+    std::array<u32, 16> default_attributes;
+    std::size_t num_arrays = 0;
+    std::size_t num_array_attributes = 0;
+    std::size_t num_default_attributes = 0;
     int num_total_attributes = 0;
     bool is_setup = false;
 };
 
+/**
+ * Returns a loader for the attribute layout of the current draw. Loaders are cached by layout, as
+ * most draws reuse the layout of an earlier one.
+ */
+const VertexLoader& GetVertexLoader(const PipelineRegs& regs);
+
 } // namespace Pica
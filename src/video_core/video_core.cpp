@@ -5,6 +5,7 @@
 #include <memory>
 #include "common/logging/log.h"
 #include "core/settings.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/pica.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/video_core.h"
@@ -12,8 +13,11 @@
 namespace VideoCore {
 
 std::unique_ptr<OpenGL::Renderer> g_renderer;
+std::unique_ptr<GPUThread> g_gpu_thread;
 std::atomic<bool> g_hardware_shader_enabled;
 std::atomic<bool> g_hardware_shader_accurate_multiplication;
+std::atomic<bool> g_shader_jit_enabled{true};
+std::atomic<bool> g_shader_profiling_enabled;
 std::atomic<bool> g_renderer_background_color_update_requested;
 std::atomic<bool> g_renderer_sampler_update_requested;
 std::atomic<bool> g_renderer_shader_update_requested;
@@ -28,9 +32,19 @@ void Init(Frontend::EmuWindow& emu_window, Memory::MemorySystem& memory) {
     g_memory = &memory;
     Pica::Init();
     g_renderer = std::make_unique<OpenGL::Renderer>(emu_window);
+
+    if (Settings::values.enable_gpu_thread) {
+        // OpenGL contexts are bound to the thread that created them
+        if (Settings::values.use_hardware_renderer) {
+            LOG_WARNING(Render, "The GPU thread requires the software renderer, ignoring");
+        } else {
+            g_gpu_thread = std::make_unique<GPUThread>();
+        }
+    }
 }
 
 void Shutdown() {
+    g_gpu_thread.reset();
     Pica::Shutdown();
     g_renderer.reset();
 }
@@ -22,9 +22,14 @@ class MemorySystem;
 
 namespace VideoCore {
 
+class GPUThread;
+
 extern std::unique_ptr<OpenGL::Renderer> g_renderer;
+extern std::unique_ptr<GPUThread> g_gpu_thread;
 extern std::atomic<bool> g_hardware_shader_enabled;
 extern std::atomic<bool> g_hardware_shader_accurate_multiplication;
+extern std::atomic<bool> g_shader_jit_enabled;
+extern std::atomic<bool> g_shader_profiling_enabled;
 extern std::atomic<bool> g_renderer_background_color_update_requested;
 extern std::atomic<bool> g_renderer_sampler_update_requested;
 extern std::atomic<bool> g_renderer_shader_update_requested;
@@ -58,7 +58,7 @@ void SDL2_MiiSelector::Setup(const MiiSelectorConfig& config) {
         VideoCore::g_renderer->SwapBuffers();
     }
 
-    SDL_GL_SetSwapInterval(Settings::values.enable_vsync ? 1 : 0);
+    SDL_GL_SetSwapInterval(Settings::values.enable_vsync && !Settings::values.turbo_mode ? 1 : 0);
     Finalize(data.code, data.selected_mii);
 }
 
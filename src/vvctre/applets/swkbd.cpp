@@ -26,7 +26,7 @@ void SDL2_SoftwareKeyboard::Execute(const KeyboardConfig& config) {
         VideoCore::g_renderer->SwapBuffers();
     }
 
-    SDL_GL_SetSwapInterval(Settings::values.enable_vsync ? 1 : 0);
+    SDL_GL_SetSwapInterval(Settings::values.enable_vsync && !Settings::values.turbo_mode ? 1 : 0);
     Finalize(data.text, data.code);
 }
 
@@ -0,0 +1,161 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <fmt/format.h>
+#include <stb_image_write.h>
+#include "audio_core/audio_types.h"
+#include "audio_core/dsp_interface.h"
+#include "common/logging/log.h"
+#include "common/texture.h"
+#include "core/3ds.h"
+#include "core/core.h"
+#include "video_core/video_core.h"
+#include "vvctre/emu_window/emu_window_headless.h"
+#include "vvctre/plugins.h"
+
+namespace {
+
+volatile std::sig_atomic_t is_open = true;
+
+struct WavHeader {
+    char riff_id[4];
+    u32 riff_size;
+    char wave_id[4];
+    char fmt_id[4];
+    u32 fmt_size;
+    u16 format;
+    u16 channels;
+    u32 sample_rate;
+    u32 byte_rate;
+    u16 block_align;
+    u16 bits_per_sample;
+    char data_id[4];
+    u32 data_size;
+};
+static_assert(sizeof(WavHeader) == 44, "WavHeader has incorrect size");
+
+WavHeader MakeWavHeader(u32 data_size) {
+    return {
+        {'R', 'I', 'F', 'F'},
+        data_size + 36,
+        {'W', 'A', 'V', 'E'},
+        {'f', 'm', 't', ' '},
+        16,
+        1, // PCM
+        2,
+        AudioCore::native_sample_rate,
+        AudioCore::native_sample_rate * 4,
+        4,
+        16,
+        {'d', 'a', 't', 'a'},
+        data_size,
+    };
+}
+
+} // namespace
+
+EmuWindow_Headless::EmuWindow_Headless(Core::System& system, PluginManager& plugin_manager,
+                                       std::string frames_folder, u32 frames_interval,
+                                       const std::string& audio_path, u64 max_frames)
+    : system(system), plugin_manager(plugin_manager), frames_folder(std::move(frames_folder)),
+      frames_interval(std::max<u32>(frames_interval, 1)), max_frames(max_frames) {
+    signal(SIGINT, [](int) { is_open = false; });
+    signal(SIGTERM, [](int) { is_open = false; });
+
+    UpdateCurrentFramebufferLayout(Core::kScreenTopWidth,
+                                   Core::kScreenTopHeight + Core::kScreenBottomHeight);
+
+    if (!this->frames_folder.empty()) {
+        if (this->frames_folder.back() != '/' && this->frames_folder.back() != '\\') {
+            this->frames_folder += '/';
+        }
+
+        FileUtil::CreateFullPath(this->frames_folder);
+    }
+
+    if (!audio_path.empty()) {
+        audio_file = FileUtil::IOFile(audio_path, "wb");
+        if (!audio_file.IsOpen()) {
+            LOG_ERROR(Frontend, "Failed to open {} for dumping audio", audio_path);
+        } else {
+            audio_file.WriteObject(MakeWavHeader(0));
+        }
+    }
+}
+
+EmuWindow_Headless::~EmuWindow_Headless() {
+    FinishAudioDump();
+}
+
+void EmuWindow_Headless::SwapBuffers() {
+    ++frame_count;
+
+    if (!frames_folder.empty() && frame_count % frames_interval == 0) {
+        const Layout::FramebufferLayout& layout = GetFramebufferLayout();
+        frame_bits.resize(layout.width * layout.height * 4);
+
+        // The screenshot is taken while rendering the next frame
+        const u64 frame_number = frame_count + 1;
+        VideoCore::RequestScreenshot(
+            frame_bits.data(),
+            [this, layout, frame_number] {
+                std::vector<u8> v(frame_bits.size());
+                for (std::size_t i = 0; i < v.size(); i += 4) {
+                    v[i] = frame_bits[i + 2];
+                    v[i + 1] = frame_bits[i + 1];
+                    v[i + 2] = frame_bits[i];
+                    v[i + 3] = 0xFF;
+                }
+                Common::FlipRGBA8Texture(v, static_cast<u64>(layout.width),
+                                         static_cast<u64>(layout.height));
+
+                const std::string path = fmt::format("{}{:08}.png", frames_folder, frame_number);
+                if (!stbi_write_png(path.c_str(), layout.width, layout.height, 4, v.data(),
+                                    layout.width * 4)) {
+                    LOG_ERROR(Frontend, "Failed to write {}", path);
+                }
+            },
+            layout);
+    }
+
+    plugin_manager.AfterSwapWindow();
+
+    if (max_frames != 0 && frame_count >= max_frames) {
+        Close();
+    }
+}
+
+void EmuWindow_Headless::PollEvents() {}
+
+bool EmuWindow_Headless::IsOpen() const {
+    return is_open;
+}
+
+void EmuWindow_Headless::Close() {
+    is_open = false;
+}
+
+void EmuWindow_Headless::OnEmulationStarting() {
+    if (audio_file.IsOpen()) {
+        system.DSP().SetDumpCallback(
+            [this](const s16* samples, std::size_t count) { DumpAudio(samples, count); });
+    }
+}
+
+void EmuWindow_Headless::DumpAudio(const s16* samples, std::size_t count) {
+    audio_bytes += static_cast<u32>(audio_file.WriteArray(samples, count * 2) * sizeof(s16));
+}
+
+void EmuWindow_Headless::FinishAudioDump() {
+    if (!audio_file.IsOpen()) {
+        return;
+    }
+
+    audio_file.Seek(0, SEEK_SET);
+    audio_file.WriteObject(MakeWavHeader(audio_bytes));
+    audio_file.Close();
+}
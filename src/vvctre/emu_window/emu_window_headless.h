@@ -0,0 +1,63 @@
+// Copyright 2020 vvctre project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "core/frontend/emu_window.h"
+
+class PluginManager;
+
+namespace Core {
+class System;
+} // namespace Core
+
+/// Window used by --headless. Frames are rendered offscreen and never presented.
+class EmuWindow_Headless : public Frontend::EmuWindow {
+public:
+    /**
+     * @param frames_folder Folder frames are dumped to as PNG files, empty to not dump frames
+     * @param frames_interval A frame is dumped every this many frames
+     * @param audio_path WAV file the audio output is dumped to, empty to not dump audio
+     * @param max_frames Number of frames after which the window closes, 0 for no limit
+     */
+    explicit EmuWindow_Headless(Core::System& system, PluginManager& plugin_manager,
+                                std::string frames_folder, u32 frames_interval,
+                                const std::string& audio_path, u64 max_frames);
+    ~EmuWindow_Headless();
+
+    /// Counts the frame and requests dumping the next one if needed
+    void SwapBuffers() override;
+
+    /// Does nothing, there's no window to get events from
+    void PollEvents() override;
+
+    /// Whether the frame limit wasn't reached and a close request hasn't yet been sent
+    bool IsOpen() const;
+
+    void Close();
+
+    /// Connects the audio dump to the DSP. Must be called after the DSP is created.
+    void OnEmulationStarting();
+
+private:
+    void DumpAudio(const s16* samples, std::size_t count);
+    void FinishAudioDump();
+
+    Core::System& system;
+    PluginManager& plugin_manager;
+
+    std::string frames_folder;
+    u32 frames_interval;
+    u64 max_frames;
+    u64 frame_count = 0;
+    std::vector<u8> frame_bits;
+
+    FileUtil::IOFile audio_file;
+    u32 audio_bytes = 0;
+};
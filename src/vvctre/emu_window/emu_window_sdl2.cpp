@@ -59,6 +59,7 @@
 #include "network/room_member.h"
 #include "video_core/renderer/renderer.h"
 #include "video_core/renderer/texture_filters/texture_filterer.h"
+#include "video_core/shader/engine.h"
 #include "video_core/video_core.h"
 #include "vvctre/common.h"
 #include "vvctre/emu_window/emu_window_sdl2.h"
@@ -66,6 +67,30 @@
 
 static bool is_open = true;
 
+/// Context with a hidden window of its own, so it can be current while the main window's is too
+class SDLGraphicsContext : public Frontend::GraphicsContext {
+public:
+    SDLGraphicsContext(SDL_Window* window, SDL_GLContext context)
+        : window(window), context(context) {}
+
+    ~SDLGraphicsContext() override {
+        SDL_GL_DeleteContext(context);
+        SDL_DestroyWindow(window);
+    }
+
+    void MakeCurrent() override {
+        SDL_GL_MakeCurrent(window, context);
+    }
+
+    void DoneCurrent() override {
+        SDL_GL_MakeCurrent(window, nullptr);
+    }
+
+private:
+    SDL_Window* window;
+    SDL_GLContext context;
+};
+
 std::pair<unsigned, unsigned> EmuWindow_SDL2::TouchToPixelPos(float touch_x, float touch_y) const {
     int w, h;
     SDL_GetWindowSize(window, &w, &h);
@@ -85,6 +110,32 @@ void EmuWindow_SDL2::Close() {
     is_open = false;
 }
 
+std::unique_ptr<Frontend::GraphicsContext> EmuWindow_SDL2::CreateSharedContext() const {
+    SDL_GLContext current_context = SDL_GL_GetCurrentContext();
+
+    SDL_Window* context_window =
+        SDL_CreateWindow("", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (context_window == nullptr) {
+        LOG_ERROR(Frontend, "Failed to create shared context window: {}", SDL_GetError());
+        return nullptr;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    SDL_GLContext context = SDL_GL_CreateContext(context_window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+
+    // Creating a context makes it current
+    SDL_GL_MakeCurrent(window, current_context);
+
+    if (context == nullptr) {
+        LOG_ERROR(Frontend, "Failed to create shared context: {}", SDL_GetError());
+        SDL_DestroyWindow(context_window);
+        return nullptr;
+    }
+
+    return std::make_unique<SDLGraphicsContext>(context_window, context);
+}
+
 void EmuWindow_SDL2::OnResize() {
     int width, height;
     SDL_GetWindowSize(window, &width, &height);
@@ -199,7 +250,7 @@ EmuWindow_SDL2::EmuWindow_SDL2(Core::System& system, PluginManager& plugin_manag
                                            vvctre_version_minor, vvctre_version_patch)
                                    .c_str());
 
-    SDL_GL_SetSwapInterval(Settings::values.enable_vsync ? 1 : 0);
+    SDL_GL_SetSwapInterval(Settings::values.enable_vsync && !Settings::values.turbo_mode ? 1 : 0);
 
     OnResize();
     SDL_PumpEvents();
@@ -217,6 +268,11 @@ void EmuWindow_SDL2::SwapBuffers() {
     ImGuiIO& io = ImGui::GetIO();
     ImGuiStyle& style = ImGui::GetStyle();
 
+    if (swap_interval_turbo_mode != Settings::values.turbo_mode) {
+        swap_interval_turbo_mode = Settings::values.turbo_mode;
+        SDL_GL_SetSwapInterval(Settings::values.enable_vsync && !swap_interval_turbo_mode ? 1 : 0);
+    }
+
     plugin_manager.BeforeDrawingFPS();
 
     ImGui::SetNextWindowPos(ImVec2(), ImGuiCond_Once);
@@ -225,7 +281,13 @@ void EmuWindow_SDL2::SwapBuffers() {
                      ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings |
                          ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_AlwaysAutoResize |
                          ImGuiWindowFlags_NoFocusOnAppearing)) {
-        ImGui::TextColored(fps_color, "%d FPS", static_cast<int>(io.Framerate));
+        if (Settings::values.turbo_mode) {
+            // Only some frames are presented, show how many are emulated
+            ImGui::TextColored(fps_color, "%d FPS (Turbo)",
+                               static_cast<int>(system.perf_stats->GetEmulatedFps()));
+        } else {
+            ImGui::TextColored(fps_color, "%d FPS", static_cast<int>(io.Framerate));
+        }
 
         if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
             ImGui::OpenPopup("Menu");
@@ -598,9 +660,28 @@ void EmuWindow_SDL2::SwapBuffers() {
                         ImGui::EndTooltip();
                     }
 
+                    if (Settings::values.enable_core_2) {
+                        ImGui::Indent();
+                        if (ImGui::Checkbox("Run Cores In Parallel",
+                                            &Settings::values.run_cores_in_parallel)) {
+                            request_reset = true;
+                        }
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted(
+                                "Runs core 2 on a thread of its own while core 1 runs. This is "
+                                "faster in games that use core 2 a lot, but may be less stable.");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
+                        ImGui::Unindent();
+                    }
+
                     ImGui::PushTextWrapPos();
-                    ImGui::TextUnformatted("If you enable or disable core 2, emulation will "
-                                           "restart when the menu is closed.");
+                    ImGui::TextUnformatted("If you enable or disable core 2 or running the cores "
+                                           "in parallel, emulation will restart when the menu is "
+                                           "closed.");
                     ImGui::PopTextWrapPos();
 
                     ImGui::NewLine();
@@ -615,6 +696,21 @@ void EmuWindow_SDL2::SwapBuffers() {
                                            &Settings::values.speed_limit, nullptr, nullptr, "%d%%");
                     }
 
+                    ImGui::Checkbox("Turbo Mode", &Settings::values.turbo_mode);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Runs as fast as possible without VSync or speed limiting, drops audio "
+                            "that can't be played in time and only shows some frames.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+                    if (Settings::values.turbo_mode) {
+                        ImGui::InputScalar("Show Every Nth Frame", ImGuiDataType_U32,
+                                           &Settings::values.turbo_mode_present_interval);
+                    }
+
                     if (Settings::values.use_custom_cpu_ticks) {
                         ImGui::InputScalar("Custom CPU Ticks", ImGuiDataType_U64,
                                            &Settings::values.custom_cpu_ticks);
@@ -625,6 +721,45 @@ void EmuWindow_SDL2::SwapBuffers() {
                     ImGui::SliderScalar("CPU Clock Percentage", ImGuiDataType_U32,
                                         &Settings::values.cpu_clock_percentage, &min, &max, "%d%%");
 
+                    ImGui::Checkbox("Skip Idle Loops", &Settings::values.skip_idle_loops);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Skips to the next event when the game keeps polling for something to "
+                            "do and nothing is ready. This lowers CPU usage in loading screens and "
+                            "menus, but may break some games.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+                    if (Settings::values.skip_idle_loops) {
+                        ImGui::Indent();
+                        const u64 program_id =
+                            system.Kernel().GetCurrentProcess()->codeset->program_id;
+                        bool skip_in_title =
+                            Settings::values.idle_loop_skipping_disabled_titles.count(
+                                program_id) == 0;
+                        if (ImGui::Checkbox("Skip Idle Loops In This Game", &skip_in_title)) {
+                            if (skip_in_title) {
+                                Settings::values.idle_loop_skipping_disabled_titles.erase(
+                                    program_id);
+                            } else {
+                                Settings::values.idle_loop_skipping_disabled_titles.insert(
+                                    program_id);
+                            }
+                        }
+                        ImGui::Unindent();
+                    }
+
+                    ImGui::Checkbox("Enable Rewind", &Settings::values.enable_rewind);
+                    if (Settings::values.enable_rewind) {
+                        ImGui::InputScalar("Rewind Interval", ImGuiDataType_U32,
+                                           &Settings::values.rewind_interval, nullptr, nullptr,
+                                           "%d frames");
+                        ImGui::InputScalar("Rewind Captures", ImGuiDataType_U32,
+                                           &Settings::values.rewind_captures);
+                    }
+
                     ImGui::NewLine();
 
                     ImGui::TextUnformatted("Core::System::Run()");
@@ -2841,6 +2976,45 @@ void EmuWindow_SDL2::SwapBuffers() {
                         ImGui::Unindent();
                     }
 
+                    if (ImGui::Checkbox("Async Shader Compilation",
+                                        &Settings::values.async_shader_compilation)) {
+                        request_reset = true;
+                    }
+
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted("If you change this, emulation will restart when "
+                                               "the menu is closed");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
+                    if (ImGui::Checkbox("Use Shader JIT", &Settings::values.use_shader_jit)) {
+                        VideoCore::g_shader_jit_enabled = Settings::values.use_shader_jit;
+                    }
+
+                    if (ImGui::Checkbox("Enable Shader Profiling",
+                                        &Settings::values.enable_shader_profiling)) {
+                        VideoCore::g_shader_profiling_enabled =
+                            Settings::values.enable_shader_profiling;
+                    }
+
+                    if (Settings::values.enable_shader_profiling) {
+                        ImGui::Indent();
+
+                        if (ImGui::MenuItem("Copy Shader Profile")) {
+                            ImGui::SetClipboardText(
+                                Pica::Shader::GetEngine()->GetProfiler().GetReport().c_str());
+                        }
+
+                        if (ImGui::MenuItem("Clear Shader Profile")) {
+                            Pica::Shader::GetEngine()->GetProfiler().Clear();
+                        }
+
+                        ImGui::Unindent();
+                    }
+
                     if (ImGui::Checkbox("Sharper Distant Objects",
                                         &Settings::values.sharper_distant_objects)) {
                         request_reset = true;
@@ -2855,6 +3029,49 @@ void EmuWindow_SDL2::SwapBuffers() {
                         ImGui::EndTooltip();
                     }
 
+                    ImGui::Checkbox("Async Texture Upload",
+                                    &Settings::values.use_async_texture_upload);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Decodes textures on other threads. Not used when dumping textures, "
+                            "using custom textures or using a texture filter.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
+                    if (Settings::values.use_async_texture_upload) {
+                        ImGui::Indent();
+
+                        ImGui::Checkbox("Draw Placeholders",
+                                        &Settings::values.async_texture_upload_placeholders);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted(
+                                "Draws without textures that are still being decoded instead of "
+                                "waiting for them. Removes stutter, but textures may pop in.");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
+
+                        ImGui::Unindent();
+                    }
+
+                    ImGui::InputScalar("Surface Cache Budget", ImGuiDataType_U32,
+                                       &Settings::values.surface_cache_budget, nullptr, nullptr,
+                                       "%d MiB");
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Host memory the cached surfaces can use before the least recently "
+                            "used ones are removed. 0 means no limit.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
                     ImGui::Checkbox("Use Custom Textures", &Settings::values.use_custom_textures);
 
                     ImGui::Checkbox("Preload Custom Textures",
@@ -2889,6 +3106,18 @@ void EmuWindow_SDL2::SwapBuffers() {
                         ImGui::Unindent();
                     }
 
+                    ImGui::Checkbox("Texture Disk Cache", &Settings::values.use_texture_disk_cache);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Saves decoded custom textures and filtered textures in "
+                            "user/texture_cache, so they load faster next time. Takes effect "
+                            "when a game is started.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
                     ImGui::Checkbox("Dump Textures", &Settings::values.dump_textures);
 
                     const u16 min = 0;
@@ -2915,7 +3144,9 @@ void EmuWindow_SDL2::SwapBuffers() {
 
                     if (ImGui::Checkbox("Enable VSync", &Settings::values.enable_vsync)) {
                         if (!paused) {
-                            SDL_GL_SetSwapInterval(Settings::values.enable_vsync ? 1 : 0);
+                            SDL_GL_SetSwapInterval(
+                                Settings::values.enable_vsync && !Settings::values.turbo_mode ? 1
+                                                                                               : 0);
                         }
                     }
 
@@ -3450,6 +3681,98 @@ void EmuWindow_SDL2::SwapBuffers() {
                     }
                 }
 
+                if (ImGui::MenuItem("Create Custom Texture Pack")) {
+                    const u64 program_id =
+                        system.Kernel().GetCurrentProcess()->codeset->program_id;
+
+                    std::atomic<bool> creating{true};
+                    std::atomic<bool> created{false};
+                    std::atomic<std::size_t> current_texture{0};
+                    std::atomic<std::size_t> total_textures{0};
+
+                    // The pack is replaced, so the running game can't have it mapped meanwhile
+                    Core::CustomTexCache& custom_tex_cache = system.CustomTexCache();
+                    custom_tex_cache.ClosePack();
+
+                    std::thread([&] {
+                        created = Core::CustomTexCache::CreatePack(
+                            program_id, [&](std::size_t current, std::size_t total) {
+                                current_texture = current;
+                                total_textures = total;
+                            });
+                        creating = false;
+                    }).detach();
+
+                    SDL_Event event;
+
+                    while (creating) {
+                        while (SDL_PollEvent(&event)) {
+                            ImGui_ImplSDL2_ProcessEvent(&event);
+
+                            if (event.type == SDL_QUIT) {
+                                if (pfd::message("vvctre", "Would you like to exit now?",
+                                                 pfd::choice::yes_no, pfd::icon::question)
+                                        .result() == pfd::button::yes) {
+                                    vvctreShutdown(&plugin_manager);
+                                    std::exit(0);
+                                }
+                            }
+                        }
+
+                        ImGui_ImplOpenGL3_NewFrame();
+                        ImGui_ImplSDL2_NewFrame(window);
+                        ImGui::NewFrame();
+
+                        ImGui::OpenPopup("Creating Custom Texture Pack");
+
+                        ImGui::SetNextWindowPos(
+                            ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.5f),
+                            ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+
+                        if (ImGui::BeginPopupModal("Creating Custom Texture Pack", nullptr,
+                                                   ImGuiWindowFlags_NoSavedSettings |
+                                                       ImGuiWindowFlags_NoMove |
+                                                       ImGuiWindowFlags_AlwaysAutoResize)) {
+                            const std::size_t current = current_texture;
+                            const std::size_t total = total_textures;
+
+                            ImGui::Text("%zu / %zu textures", current, total);
+                            ImGui::ProgressBar(
+                                total == 0 ? 0.0f
+                                           : static_cast<float>(current) /
+                                                 static_cast<float>(total),
+                                ImVec2(ImGui::CalcTextSize("Creating Custom Texture Pack").x,
+                                       0.0f));
+
+                            ImGui::EndPopup();
+                        }
+
+                        glClearColor(Settings::values.background_color_red,
+                                     Settings::values.background_color_green,
+                                     Settings::values.background_color_blue, 0.0f);
+
+                        glClear(GL_COLOR_BUFFER_BIT);
+
+                        ImGui::Render();
+                        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+                        SDL_GL_SwapWindow(window);
+                    }
+
+                    if (Settings::values.use_custom_textures) {
+                        custom_tex_cache.OpenPack();
+                    }
+
+                    if (created) {
+                        pfd::message("vvctre", "Custom texture pack created", pfd::choice::ok);
+                    } else {
+                        pfd::message("vvctre", "Failed to create custom texture pack",
+                                     pfd::choice::ok, pfd::icon::error);
+                    }
+
+                    return;
+                }
+
                 if (ImGui::BeginMenu("Screenshot")) {
                     if (ImGui::MenuItem("Save Screenshot")) {
                         const auto& layout = GetFramebufferLayout();
@@ -34,6 +34,8 @@ public:
     /// Polls window events
     void PollEvents() override;
 
+    std::unique_ptr<Frontend::GraphicsContext> CreateSharedContext() const override;
+
     /// Whether the window is still open, and a close request hasn't yet been sent
     bool IsOpen() const;
 
@@ -78,6 +80,9 @@ private:
     // Default: Green
     ImVec4 fps_color{0.0f, 1.0f, 0.0f, 1.0f};
 
+    // Turbo mode the swap interval was last set for
+    bool swap_interval_turbo_mode = false;
+
     // Installed
     bool installed_menu_opened = false;
     std::vector<std::tuple<std::string, std::string>> all_installed;
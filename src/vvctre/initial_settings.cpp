@@ -402,6 +402,21 @@ InitialSettings::InitialSettings(PluginManager& plugin_manager, SDL_Window* wind
                         ImGui::PopTextWrapPos();
                         ImGui::EndTooltip();
                     }
+                    if (Settings::values.enable_core_2) {
+                        ImGui::Indent();
+                        ImGui::Checkbox("Run Cores In Parallel",
+                                        &Settings::values.run_cores_in_parallel);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted(
+                                "Runs core 2 on a thread of its own while core 1 runs. This is "
+                                "faster in games that use core 2 a lot, but may be less stable.");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
+                        ImGui::Unindent();
+                    }
                     ImGui::Checkbox("Limit Speed", &Settings::values.limit_speed);
                     ImGui::Checkbox("Enable Custom CPU Ticks",
                                     &Settings::values.use_custom_cpu_ticks);
@@ -411,6 +426,21 @@ InitialSettings::InitialSettings(PluginManager& plugin_manager, SDL_Window* wind
                                            &Settings::values.speed_limit, nullptr, nullptr, "%d%%");
                     }
 
+                    ImGui::Checkbox("Turbo Mode", &Settings::values.turbo_mode);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Runs as fast as possible without VSync or speed limiting, drops audio "
+                            "that can't be played in time and only shows some frames.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+                    if (Settings::values.turbo_mode) {
+                        ImGui::InputScalar("Show Every Nth Frame", ImGuiDataType_U32,
+                                           &Settings::values.turbo_mode_present_interval);
+                    }
+
                     if (Settings::values.use_custom_cpu_ticks) {
                         ImGui::InputScalar("Custom CPU Ticks", ImGuiDataType_U64,
                                            &Settings::values.custom_cpu_ticks);
@@ -421,6 +451,27 @@ InitialSettings::InitialSettings(PluginManager& plugin_manager, SDL_Window* wind
                     ImGui::SliderScalar("CPU Clock Percentage", ImGuiDataType_U32,
                                         &Settings::values.cpu_clock_percentage, &min, &max, "%d%%");
 
+                    ImGui::Checkbox("Skip Idle Loops", &Settings::values.skip_idle_loops);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Skips to the next event when the game keeps polling for something to "
+                            "do and nothing is ready. This lowers CPU usage in loading screens and "
+                            "menus, but may break some games.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
+                    ImGui::Checkbox("Enable Rewind", &Settings::values.enable_rewind);
+                    if (Settings::values.enable_rewind) {
+                        ImGui::InputScalar("Rewind Interval", ImGuiDataType_U32,
+                                           &Settings::values.rewind_interval, nullptr, nullptr,
+                                           "%d frames");
+                        ImGui::InputScalar("Rewind Captures", ImGuiDataType_U32,
+                                           &Settings::values.rewind_captures);
+                    }
+
                     ImGui::NewLine();
 
                     ImGui::TextUnformatted("Core::System::Run()");
@@ -2368,23 +2419,134 @@ InitialSettings::InitialSettings(PluginManager& plugin_manager, SDL_Window* wind
                 }
 
                 if (ImGui::BeginTabItem("Graphics")) {
-                    ImGui::Checkbox("Use Hardware Shader", &Settings::values.use_hardware_shader);
+                    ImGui::Checkbox("Use Hardware Renderer",
+                                    &Settings::values.use_hardware_renderer);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted("If disabled, triangles are drawn on the CPU "
+                                               "using all cores");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
 
-                    if (Settings::values.use_hardware_shader) {
+                    if (Settings::values.use_hardware_renderer) {
                         ImGui::Indent();
 
-                        ImGui::Checkbox("Accurate Multiplication",
-                                        &Settings::values.hardware_shader_accurate_multiplication);
+                        ImGui::Checkbox("Use Hardware Shader",
+                                        &Settings::values.use_hardware_shader);
+
+                        if (Settings::values.use_hardware_shader) {
+                            ImGui::Indent();
+
+                            ImGui::Checkbox(
+                                "Accurate Multiplication",
+                                &Settings::values.hardware_shader_accurate_multiplication);
+
+                            ImGui::Checkbox("Enable Disk Shader Cache",
+                                            &Settings::values.enable_disk_shader_cache);
+
+                            ImGui::Unindent();
+                        }
 
-                        ImGui::Checkbox("Enable Disk Shader Cache",
-                                        &Settings::values.enable_disk_shader_cache);
+                        ImGui::Checkbox("Async Shader Compilation",
+                                        &Settings::values.async_shader_compilation);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted(
+                                "Compiles new shaders on a separate thread. Meanwhile, vertices "
+                                "are shaded on the CPU and fragments are drawn with a generic "
+                                "shader that approximates lighting.");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
+
+                        ImGui::Unindent();
+                    } else {
+                        ImGui::Indent();
+
+                        ImGui::Checkbox("Enable GPU Thread", &Settings::values.enable_gpu_thread);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted("Processes GPU commands on a separate thread "
+                                                   "while the CPU keeps running");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
 
                         ImGui::Unindent();
                     }
 
+                    ImGui::Checkbox("Use Shader JIT", &Settings::values.use_shader_jit);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted("If disabled, shaders that run on the CPU are "
+                                               "interpreted, which is slower");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
+                    ImGui::Checkbox("Enable Shader Profiling",
+                                    &Settings::values.enable_shader_profiling);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Counts the instructions run by shaders that run on the CPU using the "
+                            "interpreter, and logs a report when emulation stops");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
                     ImGui::Checkbox("Sharper Distant Objects",
                                     &Settings::values.sharper_distant_objects);
 
+                    ImGui::Checkbox("Async Texture Upload",
+                                    &Settings::values.use_async_texture_upload);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Decodes textures on other threads. Not used when dumping textures, "
+                            "using custom textures or using a texture filter.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
+                    if (Settings::values.use_async_texture_upload) {
+                        ImGui::Indent();
+
+                        ImGui::Checkbox("Draw Placeholders",
+                                        &Settings::values.async_texture_upload_placeholders);
+                        if (ImGui::IsItemHovered()) {
+                            ImGui::BeginTooltip();
+                            ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                            ImGui::TextUnformatted(
+                                "Draws without textures that are still being decoded instead of "
+                                "waiting for them. Removes stutter, but textures may pop in.");
+                            ImGui::PopTextWrapPos();
+                            ImGui::EndTooltip();
+                        }
+
+                        ImGui::Unindent();
+                    }
+
+                    ImGui::InputScalar("Surface Cache Budget", ImGuiDataType_U32,
+                                       &Settings::values.surface_cache_budget, nullptr, nullptr,
+                                       "%d MiB");
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Host memory the cached surfaces can use before the least recently "
+                            "used ones are removed. 0 means no limit.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
                     ImGui::Checkbox("Use Custom Textures", &Settings::values.use_custom_textures);
 
                     ImGui::Checkbox("Preload Custom Textures",
@@ -2419,6 +2581,18 @@ InitialSettings::InitialSettings(PluginManager& plugin_manager, SDL_Window* wind
                         ImGui::Unindent();
                     }
 
+                    ImGui::Checkbox("Texture Disk Cache", &Settings::values.use_texture_disk_cache);
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::BeginTooltip();
+                        ImGui::PushTextWrapPos(io.DisplaySize.x * 0.5f);
+                        ImGui::TextUnformatted(
+                            "Saves decoded custom textures and filtered textures in "
+                            "user/texture_cache, so they load faster next time. Takes effect "
+                            "when a game is started.");
+                        ImGui::PopTextWrapPos();
+                        ImGui::EndTooltip();
+                    }
+
                     ImGui::Checkbox("Dump Textures", &Settings::values.dump_textures);
 
                     const u16 min = 0;
@@ -14,6 +14,7 @@
 #include <mbedtls/ssl.h>
 #include <nlohmann/json.hpp>
 #include <whereami.h>
+#include "audio_core/dsp_interface.h"
 #include "common/common_funcs.h"
 #include "common/file_util.h"
 #include "common/logging/backend.h"
@@ -40,7 +41,10 @@
 #include "core/settings.h"
 #include "network/room.h"
 #include "network/room_member.h"
+#include "video_core/command_processor.h"
+#include "video_core/renderer/rasterizer_cache.h"
 #include "video_core/renderer/renderer.h"
+#include "video_core/shader/engine.h"
 #include "video_core/video_core.h"
 #include "vvctre/common.h"
 #include "vvctre/function_logger.h"
@@ -420,6 +424,64 @@ void vvctre_restart(void* core) {
     static_cast<Core::System*>(core)->RequestReset();
 }
 
+void vvctre_save_state(void* core, const char* path) {
+    static_cast<Core::System*>(core)->RequestSaveState(std::string(path));
+}
+
+void vvctre_load_state(void* core, const char* path) {
+    static_cast<Core::System*>(core)->RequestLoadState(std::string(path));
+}
+
+void vvctre_rewind(void* core, u32 steps) {
+    static_cast<Core::System*>(core)->RequestRewind(steps);
+}
+
+u32 vvctre_get_rewind_capture_count(void* core) {
+    return static_cast<u32>(
+        static_cast<Core::System*>(core)->GetRewindBuffer().GetCaptureCount());
+}
+
+u64 vvctre_get_rewind_memory_usage(void* core) {
+    return static_cast<u64>(
+        static_cast<Core::System*>(core)->GetRewindBuffer().GetMemoryUsage());
+}
+
+void vvctre_get_surface_cache_stats(int surface_type, u64* resident_bytes_out, u64* hits_out,
+                                    u64* misses_out, u64* evictions_out,
+                                    u64* reinterpretations_out) {
+    const OpenGL::SurfaceCacheStats::Category& category =
+        OpenGL::g_surface_cache_stats.categories.at(static_cast<std::size_t>(surface_type));
+    *resident_bytes_out = category.resident_bytes;
+    *hits_out = category.hits;
+    *misses_out = category.misses;
+    *evictions_out = category.evictions;
+    *reinterpretations_out = category.reinterpretations;
+}
+
+u64 vvctre_get_surface_cache_recycled_bytes() {
+    return OpenGL::g_surface_cache_stats.recycled_bytes;
+}
+
+void vvctre_get_draw_stats(u64* issued_out, u64* merged_out) {
+    *issued_out = Pica::CommandProcessor::g_draw_stats.issued;
+    *merged_out = Pica::CommandProcessor::g_draw_stats.merged;
+}
+
+void vvctre_get_audio_output_stats(u64* underruns_out, u64* overruns_out,
+                                   u64 callback_duration_histogram_out[16]) {
+    *underruns_out = AudioCore::g_audio_output_stats.underruns;
+    *overruns_out = AudioCore::g_audio_output_stats.overruns;
+    for (std::size_t i = 0; i < AudioCore::g_audio_output_stats.callback_duration_histogram.size();
+         ++i) {
+        callback_duration_histogram_out[i] =
+            AudioCore::g_audio_output_stats.callback_duration_histogram[i];
+    }
+}
+
+double vvctre_get_emulated_fps(void* core) {
+    return static_cast<Core::System*>(core)->perf_stats->GetEmulatedFps();
+}
+
 void vvctre_set_paused(void* plugin_manager, bool paused) {
     static_cast<PluginManager*>(plugin_manager)->paused = paused;
 }
@@ -2971,6 +3033,14 @@ bool vvctre_settings_get_enable_core_2() {
     return Settings::values.enable_core_2;
 }
 
+void vvctre_settings_set_run_cores_in_parallel(bool value) {
+    Settings::values.run_cores_in_parallel = value;
+}
+
+bool vvctre_settings_get_run_cores_in_parallel() {
+    return Settings::values.run_cores_in_parallel;
+}
+
 void vvctre_settings_set_limit_speed(bool value) {
     Settings::values.limit_speed = value;
 }
@@ -2987,6 +3057,22 @@ u16 vvctre_settings_get_speed_limit() {
     return Settings::values.speed_limit;
 }
 
+void vvctre_settings_set_turbo_mode(bool value) {
+    Settings::values.turbo_mode = value;
+}
+
+bool vvctre_settings_get_turbo_mode() {
+    return Settings::values.turbo_mode;
+}
+
+void vvctre_settings_set_turbo_mode_present_interval(u32 value) {
+    Settings::values.turbo_mode_present_interval = value;
+}
+
+u32 vvctre_settings_get_turbo_mode_present_interval() {
+    return Settings::values.turbo_mode_present_interval;
+}
+
 void vvctre_settings_set_use_custom_cpu_ticks(bool value) {
     Settings::values.use_custom_cpu_ticks = value;
 }
@@ -3011,6 +3097,50 @@ u32 vvctre_settings_get_cpu_clock_percentage() {
     return Settings::values.cpu_clock_percentage;
 }
 
+void vvctre_settings_set_skip_idle_loops(bool value) {
+    Settings::values.skip_idle_loops = value;
+}
+
+bool vvctre_settings_get_skip_idle_loops() {
+    return Settings::values.skip_idle_loops;
+}
+
+void vvctre_settings_set_skip_idle_loops_in_title(u64 program_id, bool value) {
+    if (value) {
+        Settings::values.idle_loop_skipping_disabled_titles.erase(program_id);
+    } else {
+        Settings::values.idle_loop_skipping_disabled_titles.insert(program_id);
+    }
+}
+
+bool vvctre_settings_get_skip_idle_loops_in_title(u64 program_id) {
+    return Settings::values.idle_loop_skipping_disabled_titles.count(program_id) == 0;
+}
+
+void vvctre_settings_set_enable_rewind(bool value) {
+    Settings::values.enable_rewind = value;
+}
+
+bool vvctre_settings_get_enable_rewind() {
+    return Settings::values.enable_rewind;
+}
+
+void vvctre_settings_set_rewind_interval(u32 value) {
+    Settings::values.rewind_interval = value;
+}
+
+u32 vvctre_settings_get_rewind_interval() {
+    return Settings::values.rewind_interval;
+}
+
+void vvctre_settings_set_rewind_captures(u32 value) {
+    Settings::values.rewind_captures = value;
+}
+
+u32 vvctre_settings_get_rewind_captures() {
+    return Settings::values.rewind_captures;
+}
+
 void vvctre_settings_set_core_system_run_default_max_slice_value(s64 value) {
     Settings::values.core_system_run_default_max_slice_value = value;
 }
@@ -3226,6 +3356,22 @@ void vvctre_settings_write_config_savegame(void* cfg) {
     static_cast<Service::CFG::Module*>(cfg)->UpdateConfigNANDSavegame();
 }
 
+void vvctre_settings_set_use_hardware_renderer(bool value) {
+    Settings::values.use_hardware_renderer = value;
+}
+
+bool vvctre_settings_get_use_hardware_renderer() {
+    return Settings::values.use_hardware_renderer;
+}
+
+void vvctre_settings_set_enable_gpu_thread(bool value) {
+    Settings::values.enable_gpu_thread = value;
+}
+
+bool vvctre_settings_get_enable_gpu_thread() {
+    return Settings::values.enable_gpu_thread;
+}
+
 void vvctre_settings_set_use_hardware_shader(bool value) {
     Settings::values.use_hardware_shader = value;
 }
@@ -3250,6 +3396,38 @@ bool vvctre_settings_get_enable_disk_shader_cache() {
     return Settings::values.enable_disk_shader_cache;
 }
 
+void vvctre_settings_set_async_shader_compilation(bool value) {
+    Settings::values.async_shader_compilation = value;
+}
+
+bool vvctre_settings_get_async_shader_compilation() {
+    return Settings::values.async_shader_compilation;
+}
+
+void vvctre_settings_set_use_shader_jit(bool value) {
+    Settings::values.use_shader_jit = value;
+}
+
+bool vvctre_settings_get_use_shader_jit() {
+    return Settings::values.use_shader_jit;
+}
+
+void vvctre_settings_set_enable_shader_profiling(bool value) {
+    Settings::values.enable_shader_profiling = value;
+}
+
+bool vvctre_settings_get_enable_shader_profiling() {
+    return Settings::values.enable_shader_profiling;
+}
+
+char* vvctre_get_shader_profile_report() {
+    return VVCTRE_STRDUP(Pica::Shader::GetEngine()->GetProfiler().GetReport().c_str());
+}
+
+void vvctre_clear_shader_profile() {
+    Pica::Shader::GetEngine()->GetProfiler().Clear();
+}
+
 void vvctre_settings_set_enable_vsync(bool value) {
     Settings::values.enable_vsync = value;
 }
@@ -3258,6 +3436,30 @@ bool vvctre_settings_get_enable_vsync() {
     return Settings::values.enable_vsync;
 }
 
+void vvctre_settings_set_use_async_texture_upload(bool value) {
+    Settings::values.use_async_texture_upload = value;
+}
+
+bool vvctre_settings_get_use_async_texture_upload() {
+    return Settings::values.use_async_texture_upload;
+}
+
+void vvctre_settings_set_async_texture_upload_placeholders(bool value) {
+    Settings::values.async_texture_upload_placeholders = value;
+}
+
+bool vvctre_settings_get_async_texture_upload_placeholders() {
+    return Settings::values.async_texture_upload_placeholders;
+}
+
+void vvctre_settings_set_surface_cache_budget(u32 value) {
+    Settings::values.surface_cache_budget = value;
+}
+
+u32 vvctre_settings_get_surface_cache_budget() {
+    return Settings::values.surface_cache_budget;
+}
+
 void vvctre_settings_set_dump_textures(bool value) {
     Settings::values.dump_textures = value;
 }
@@ -3291,6 +3493,14 @@ Settings::PreloadCustomTexturesFolder vvctre_settings_get_preload_custom_texture
     return Settings::values.preload_custom_textures_folder;
 }
 
+void vvctre_settings_set_use_texture_disk_cache(bool value) {
+    Settings::values.use_texture_disk_cache = value;
+}
+
+bool vvctre_settings_get_use_texture_disk_cache() {
+    return Settings::values.use_texture_disk_cache;
+}
+
 void vvctre_settings_set_enable_linear_filtering(bool value) {
     Settings::values.enable_linear_filtering = value;
 }
@@ -4257,6 +4467,16 @@ std::unordered_map<std::string, void*> PluginManager::function_map = {
     {"vvctre_get_program_id", (void*)&vvctre_get_program_id},
     {"vvctre_get_process_name", (void*)&vvctre_get_process_name},
     {"vvctre_restart", (void*)&vvctre_restart},
+    {"vvctre_save_state", (void*)&vvctre_save_state},
+    {"vvctre_load_state", (void*)&vvctre_load_state},
+    {"vvctre_rewind", (void*)&vvctre_rewind},
+    {"vvctre_get_rewind_capture_count", (void*)&vvctre_get_rewind_capture_count},
+    {"vvctre_get_rewind_memory_usage", (void*)&vvctre_get_rewind_memory_usage},
+    {"vvctre_get_surface_cache_stats", (void*)&vvctre_get_surface_cache_stats},
+    {"vvctre_get_surface_cache_recycled_bytes", (void*)&vvctre_get_surface_cache_recycled_bytes},
+    {"vvctre_get_draw_stats", (void*)&vvctre_get_draw_stats},
+    {"vvctre_get_emulated_fps", (void*)&vvctre_get_emulated_fps},
+    {"vvctre_get_audio_output_stats", (void*)&vvctre_get_audio_output_stats},
     {"vvctre_set_paused", (void*)&vvctre_set_paused},
     {"vvctre_get_paused", (void*)&vvctre_get_paused},
     {"vvctre_emulation_running", (void*)&vvctre_emulation_running},
@@ -4795,16 +5015,38 @@ std::unordered_map<std::string, void*> PluginManager::function_map = {
     {"vvctre_settings_get_unix_timestamp", (void*)&vvctre_settings_get_unix_timestamp},
     {"vvctre_settings_set_enable_core_2", (void*)&vvctre_settings_set_enable_core_2},
     {"vvctre_settings_get_enable_core_2", (void*)&vvctre_settings_get_enable_core_2},
+    {"vvctre_settings_set_run_cores_in_parallel",
+     (void*)&vvctre_settings_set_run_cores_in_parallel},
+    {"vvctre_settings_get_run_cores_in_parallel",
+     (void*)&vvctre_settings_get_run_cores_in_parallel},
     {"vvctre_settings_set_limit_speed", (void*)&vvctre_settings_set_limit_speed},
     {"vvctre_settings_get_limit_speed", (void*)&vvctre_settings_get_limit_speed},
     {"vvctre_settings_set_speed_limit", (void*)&vvctre_settings_set_speed_limit},
     {"vvctre_settings_get_speed_limit", (void*)&vvctre_settings_get_speed_limit},
+    {"vvctre_settings_set_turbo_mode", (void*)&vvctre_settings_set_turbo_mode},
+    {"vvctre_settings_get_turbo_mode", (void*)&vvctre_settings_get_turbo_mode},
+    {"vvctre_settings_set_turbo_mode_present_interval",
+     (void*)&vvctre_settings_set_turbo_mode_present_interval},
+    {"vvctre_settings_get_turbo_mode_present_interval",
+     (void*)&vvctre_settings_get_turbo_mode_present_interval},
     {"vvctre_settings_set_use_custom_cpu_ticks", (void*)&vvctre_settings_set_use_custom_cpu_ticks},
     {"vvctre_settings_get_use_custom_cpu_ticks", (void*)&vvctre_settings_get_use_custom_cpu_ticks},
     {"vvctre_settings_set_custom_cpu_ticks", (void*)&vvctre_settings_set_custom_cpu_ticks},
     {"vvctre_settings_get_custom_cpu_ticks", (void*)&vvctre_settings_get_custom_cpu_ticks},
     {"vvctre_settings_set_cpu_clock_percentage", (void*)&vvctre_settings_set_cpu_clock_percentage},
     {"vvctre_settings_get_cpu_clock_percentage", (void*)&vvctre_settings_get_cpu_clock_percentage},
+    {"vvctre_settings_set_skip_idle_loops", (void*)&vvctre_settings_set_skip_idle_loops},
+    {"vvctre_settings_get_skip_idle_loops", (void*)&vvctre_settings_get_skip_idle_loops},
+    {"vvctre_settings_set_skip_idle_loops_in_title",
+     (void*)&vvctre_settings_set_skip_idle_loops_in_title},
+    {"vvctre_settings_get_skip_idle_loops_in_title",
+     (void*)&vvctre_settings_get_skip_idle_loops_in_title},
+    {"vvctre_settings_set_enable_rewind", (void*)&vvctre_settings_set_enable_rewind},
+    {"vvctre_settings_get_enable_rewind", (void*)&vvctre_settings_get_enable_rewind},
+    {"vvctre_settings_set_rewind_interval", (void*)&vvctre_settings_set_rewind_interval},
+    {"vvctre_settings_get_rewind_interval", (void*)&vvctre_settings_get_rewind_interval},
+    {"vvctre_settings_set_rewind_captures", (void*)&vvctre_settings_set_rewind_captures},
+    {"vvctre_settings_get_rewind_captures", (void*)&vvctre_settings_get_rewind_captures},
     {"vvctre_settings_set_core_system_run_default_max_slice_value",
      (void*)&vvctre_settings_set_core_system_run_default_max_slice_value},
     {"vvctre_settings_get_core_system_run_default_max_slice_value",
@@ -4874,6 +5116,12 @@ std::unordered_map<std::string, void*> PluginManager::function_map = {
     {"vvctre_settings_set_eula_version", (void*)&vvctre_settings_set_eula_version},
     {"vvctre_settings_get_eula_version", (void*)&vvctre_settings_get_eula_version},
     {"vvctre_settings_write_config_savegame", (void*)&vvctre_settings_write_config_savegame},
+    {"vvctre_settings_set_use_hardware_renderer",
+     (void*)&vvctre_settings_set_use_hardware_renderer},
+    {"vvctre_settings_get_use_hardware_renderer",
+     (void*)&vvctre_settings_get_use_hardware_renderer},
+    {"vvctre_settings_set_enable_gpu_thread", (void*)&vvctre_settings_set_enable_gpu_thread},
+    {"vvctre_settings_get_enable_gpu_thread", (void*)&vvctre_settings_get_enable_gpu_thread},
     {"vvctre_settings_set_use_hardware_shader", (void*)&vvctre_settings_set_use_hardware_shader},
     {"vvctre_settings_get_use_hardware_shader", (void*)&vvctre_settings_get_use_hardware_shader},
     {"vvctre_settings_set_hardware_shader_accurate_multiplication",
@@ -4884,8 +5132,30 @@ std::unordered_map<std::string, void*> PluginManager::function_map = {
      (void*)&vvctre_settings_set_enable_disk_shader_cache},
     {"vvctre_settings_get_enable_disk_shader_cache",
      (void*)&vvctre_settings_get_enable_disk_shader_cache},
+    {"vvctre_settings_set_async_shader_compilation",
+     (void*)&vvctre_settings_set_async_shader_compilation},
+    {"vvctre_settings_get_async_shader_compilation",
+     (void*)&vvctre_settings_get_async_shader_compilation},
+    {"vvctre_settings_set_use_shader_jit", (void*)&vvctre_settings_set_use_shader_jit},
+    {"vvctre_settings_get_use_shader_jit", (void*)&vvctre_settings_get_use_shader_jit},
+    {"vvctre_settings_set_enable_shader_profiling",
+     (void*)&vvctre_settings_set_enable_shader_profiling},
+    {"vvctre_settings_get_enable_shader_profiling",
+     (void*)&vvctre_settings_get_enable_shader_profiling},
+    {"vvctre_get_shader_profile_report", (void*)&vvctre_get_shader_profile_report},
+    {"vvctre_clear_shader_profile", (void*)&vvctre_clear_shader_profile},
     {"vvctre_settings_set_enable_vsync", (void*)&vvctre_settings_set_enable_vsync},
     {"vvctre_settings_get_enable_vsync", (void*)&vvctre_settings_get_enable_vsync},
+    {"vvctre_settings_set_use_async_texture_upload",
+     (void*)&vvctre_settings_set_use_async_texture_upload},
+    {"vvctre_settings_get_use_async_texture_upload",
+     (void*)&vvctre_settings_get_use_async_texture_upload},
+    {"vvctre_settings_set_async_texture_upload_placeholders",
+     (void*)&vvctre_settings_set_async_texture_upload_placeholders},
+    {"vvctre_settings_get_async_texture_upload_placeholders",
+     (void*)&vvctre_settings_get_async_texture_upload_placeholders},
+    {"vvctre_settings_set_surface_cache_budget", (void*)&vvctre_settings_set_surface_cache_budget},
+    {"vvctre_settings_get_surface_cache_budget", (void*)&vvctre_settings_get_surface_cache_budget},
     {"vvctre_settings_set_dump_textures", (void*)&vvctre_settings_set_dump_textures},
     {"vvctre_settings_get_dump_textures", (void*)&vvctre_settings_get_dump_textures},
     {"vvctre_settings_set_custom_textures", (void*)&vvctre_settings_set_custom_textures},
@@ -4896,6 +5166,10 @@ std::unordered_map<std::string, void*> PluginManager::function_map = {
      (void*)&vvctre_settings_set_preload_custom_textures_folder},
     {"vvctre_settings_get_preload_custom_textures_folder",
      (void*)&vvctre_settings_get_preload_custom_textures_folder},
+    {"vvctre_settings_set_use_texture_disk_cache",
+     (void*)&vvctre_settings_set_use_texture_disk_cache},
+    {"vvctre_settings_get_use_texture_disk_cache",
+     (void*)&vvctre_settings_get_use_texture_disk_cache},
     {"vvctre_settings_set_enable_linear_filtering",
      (void*)&vvctre_settings_set_enable_linear_filtering},
     {"vvctre_settings_get_enable_linear_filtering",
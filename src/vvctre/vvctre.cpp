@@ -37,6 +37,7 @@
 #include "common/scope_exit.h"
 #include "core/3ds.h"
 #include "core/core.h"
+#include "core/frontend/applets/default_applets.h"
 #include "core/hle/service/am/am.h"
 #include "core/hle/service/cfg/cfg.h"
 #include "core/loader/loader.h"
@@ -51,6 +52,7 @@
 #include "vvctre/camera/image.h"
 #include "vvctre/camera/tcp_client_rgb24_640x480.h"
 #include "vvctre/common.h"
+#include "vvctre/emu_window/emu_window_headless.h"
 #include "vvctre/emu_window/emu_window_sdl2.h"
 #include "vvctre/initial_settings.h"
 #include "vvctre/plugins.h"
@@ -68,7 +70,92 @@ __declspec(dllexport) unsigned long NvOptimusEnablement = 0x00000001;
 
 static std::function<void()> play_movie_loop_callback;
 
+static int RunHeadless(Core::System& system, PluginManager& plugin_manager,
+                       std::shared_ptr<Service::CFG::Module>& cfg, const flags::args& args) {
+    EmuWindow_Headless emu_window(
+        system, plugin_manager, args.get<std::string>("dump-frames", ""),
+        args.get<u32>("dump-frames-interval", 1), args.get<std::string>("dump-audio", ""),
+        args.get<u64>("frames", 0));
+
+    system.SetBeforeLoadingAfterFirstTime(
+        [&plugin_manager] { plugin_manager.BeforeLoadingAfterFirstTime(); });
+    system.SetEmulationStartingAfterFirstTime([&plugin_manager, &emu_window] {
+        emu_window.OnEmulationStarting();
+        plugin_manager.EmulationStartingAfterFirstTime();
+    });
+    system.SetPreloadCustomTexturesFunction(
+        [&system] { system.CustomTexCache().PreloadTextures([](std::size_t, std::size_t) {}); });
+    system.SetDiskShaderCacheCallback([](bool, std::size_t, std::size_t) {});
+
+    Frontend::RegisterDefaultApplets();
+    Camera::RegisterFactory("image", std::make_unique<Camera::ImageCameraFactory>());
+    Camera::RegisterFactory("tcp_client_rgb24_640x480",
+                            std::make_unique<Camera::TCP_Client_RGB24_640x480_Camera_Factory>());
+
+    plugin_manager.BeforeLoading();
+    cfg.reset();
+    plugin_manager.cfg = nullptr;
+
+    if (system.Load(emu_window, Settings::values.file_path) != Core::System::ResultStatus::Success) {
+        vvctreShutdown(&plugin_manager);
+        return 1;
+    }
+
+    emu_window.OnEmulationStarting();
+    plugin_manager.EmulationStarting();
+
+    if (!Settings::values.play_movie.empty()) {
+        Core::Movie& movie = Core::Movie::GetInstance();
+
+        switch (movie.ValidateMovie(Settings::values.play_movie)) {
+        case Core::Movie::ValidationResult::DifferentProgramID:
+            LOG_WARNING(Frontend, "Movie was recorded using a ROM with a different program ID");
+            [[fallthrough]];
+        case Core::Movie::ValidationResult::OK:
+            // Stop when the movie ends
+            movie.StartPlayback(Settings::values.play_movie, [&emu_window] { emu_window.Close(); });
+            break;
+        case Core::Movie::ValidationResult::Invalid:
+            LOG_ERROR(Frontend, "Movie file doesn't have a valid header");
+            break;
+        }
+    }
+
+    if (!Settings::values.record_movie.empty()) {
+        Core::Movie::GetInstance().StartRecording(Settings::values.record_movie);
+    }
+
+    int exit_code = 0;
+
+    while (emu_window.IsOpen()) {
+        switch (system.Run()) {
+        case Core::System::ResultStatus::FatalError:
+            plugin_manager.FatalError();
+            exit_code = 1;
+            emu_window.Close();
+            break;
+        case Core::System::ResultStatus::ShutdownRequested:
+            emu_window.Close();
+            break;
+        default:
+            break;
+        }
+    }
+
+    vvctreShutdown(&plugin_manager);
+
+    return exit_code;
+}
+
 int main(int argc, char** argv) {
+    const flags::args args(argc, argv);
+
+    // Headless mode renders offscreen through EGL, so it doesn't need a display server
+    const bool headless = args.get<bool>("headless", false);
+    if (headless) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0) {
         pfd::message("vvctre", fmt::format("Failed to initialize SDL2: {}", SDL_GetError()),
                      pfd::choice::ok, pfd::icon::error);
@@ -95,7 +182,8 @@ int main(int argc, char** argv) {
                          SDL_WINDOWPOS_UNDEFINED, // x position
                          SDL_WINDOWPOS_UNDEFINED, // y position
                          Core::kScreenTopWidth, Core::kScreenTopHeight + Core::kScreenBottomHeight,
-                         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+                         headless ? (SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN)
+                                  : (SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE));
     if (window == nullptr) {
         pfd::message("vvctre", fmt::format("Failed to create window: {}", SDL_GetError()),
                      pfd::choice::ok, pfd::icon::error);
@@ -117,7 +205,7 @@ int main(int argc, char** argv) {
         vvctreShutdown(nullptr);
         std::exit(1);
     }
-    SDL_GL_SetSwapInterval(1);
+    SDL_GL_SetSwapInterval(headless ? 0 : 1);
     SDL_PumpEvents();
 
     IMGUI_CHECKVERSION();
@@ -136,7 +224,6 @@ int main(int argc, char** argv) {
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
     Core::System& system = Core::System::GetInstance();
-    const flags::args args(argc, argv);
 
     if (std::optional<std::string> o = args.get<std::string>("user-folder-path")) {
         FileUtil::InitUserPaths(fmt::format("{}/", *o));
@@ -153,7 +240,7 @@ int main(int argc, char** argv) {
     PluginManager plugin_manager(system, window, args);
     system.SetEmulationStartingAfterFirstTime(
         [&plugin_manager] { plugin_manager.EmulationStartingAfterFirstTime(); });
-    if (!system.IsOnLoadFailedSet()) {
+    if (!system.IsOnLoadFailedSet() && !headless) {
         system.SetOnLoadFailed([&plugin_manager](Core::System::ResultStatus result) {
             switch (result) {
             case Core::System::ResultStatus::ErrorNotInitialized:
@@ -189,7 +276,11 @@ int main(int argc, char** argv) {
     plugin_manager.InitialSettingsOpening();
     std::atomic<bool> update_found{false};
     bool ok_multiplayer = false;
-    if (args.positional().empty()) {
+    if (args.positional().empty() && headless) {
+        std::cerr << "--headless requires a file path" << std::endl;
+        vvctreShutdown(&plugin_manager);
+        return 1;
+    } else if (args.positional().empty()) {
         if (args.get<bool>("disable-update-check", false)) {
             SDL_Event event;
             while (SDL_PollEvent(&event)) {
@@ -304,6 +395,21 @@ int main(int argc, char** argv) {
         }
     } else {
         Settings::values.file_path = std::string(args.positional()[0]);
+
+        if (headless) {
+            Settings::values.audio_sink_id = "null";
+            Settings::values.enable_vsync = false;
+            Settings::values.limit_speed = false;
+        }
+
+        if (args.get<bool>("software-renderer", false)) {
+            Settings::values.use_hardware_renderer = false;
+        }
+
+        if (args.get<bool>("gpu-thread", false)) {
+            Settings::values.enable_gpu_thread = true;
+        }
+
         Settings::Apply();
     }
     plugin_manager.InitialSettingsOkPressed();
@@ -323,6 +429,10 @@ int main(int argc, char** argv) {
         Core::Movie::GetInstance().PrepareForPlayback(Settings::values.play_movie);
     }
 
+    if (headless) {
+        return RunHeadless(system, plugin_manager, cfg, args);
+    }
+
     std::unique_ptr<EmuWindow_SDL2> emu_window =
         std::make_unique<EmuWindow_SDL2>(system, plugin_manager, window, ok_multiplayer);
 
@@ -536,7 +646,8 @@ int main(int argc, char** argv) {
                 VideoCore::g_renderer->SwapBuffers();
                 SDL_GL_SetSwapInterval(1);
             }
-            SDL_GL_SetSwapInterval(Settings::values.enable_vsync ? 1 : 0);
+            SDL_GL_SetSwapInterval(
+                Settings::values.enable_vsync && !Settings::values.turbo_mode ? 1 : 0);
         }
 
         switch (system.Run()) {